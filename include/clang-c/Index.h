@@ -19,6 +19,7 @@
 #include <time.h>
 
 #include "clang-c/Platform.h"
+#include "clang-c/CXCompilationDatabase.h"
 #include "clang-c/CXString.h"
 
 /**
@@ -30,7 +31,7 @@
  * compatible, thus CINDEX_VERSION_MAJOR is expected to remain stable.
  */
 #define CINDEX_VERSION_MAJOR 0
-#define CINDEX_VERSION_MINOR 20
+#define CINDEX_VERSION_MINOR 22
 
 #define CINDEX_VERSION_ENCODE(major, minor) ( \
       ((major) * 10000)                       \
@@ -4987,6 +4988,45 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
                                             unsigned num_unsaved_files,
                                             unsigned options);
 
+/**
+ * \brief Perform code completion at a given location in a translation unit,
+ * returning only the best results that match the text typed so far.
+ *
+ * This function is like \c clang_codeCompleteAt(), but does the filtering
+ * that a client would otherwise do on all the results. A result whose
+ * typed text doesn't match \p filter is dropped before its completion
+ * string is built, as are the results that don't rank among the best
+ * \p max_results.
+ *
+ * A result matches the filter if its typed text contains all the characters
+ * of \p filter, in order, compared case-insensitively. The results are
+ * returned best first. They are ranked by whether the typed text starts
+ * with \p filter, with the same case and then with any case. Ties are
+ * broken by their priority and then by the order of
+ * \c clang_sortCodeCompletionResults(). Overload candidates are not
+ * filtered.
+ *
+ * \param filter The text of the token typed so far, or NULL or the empty
+ * string to keep all results.
+ *
+ * \param max_results The maximum number of results to return, or 0 for no
+ * limit.
+ *
+ * The rest of the parameters and the result are as for
+ * \c clang_codeCompleteAt().
+ */
+CINDEX_LINKAGE
+CXCodeCompleteResults *
+clang_codeCompleteAtWithFilter(CXTranslationUnit TU,
+                               const char *complete_filename,
+                               unsigned complete_line,
+                               unsigned complete_column,
+                               struct CXUnsavedFile *unsaved_files,
+                               unsigned num_unsaved_files,
+                               unsigned options,
+                               const char *filter,
+                               unsigned max_results);
+
 /**
  * \brief Sort the code-completion results in case-insensitive alphabetical 
  * order.
@@ -5810,6 +5850,43 @@ CINDEX_LINKAGE int clang_indexTranslationUnit(CXIndexAction,
                                               unsigned index_options,
                                               CXTranslationUnit);
 
+/**
+ * \brief Index the translation units of all the compile commands of the
+ * given compilation database, on several threads at once.
+ *
+ * Each translation unit is indexed as if by #clang_indexSourceFile, with the
+ * arguments of its compile command, and relative paths resolved against the
+ * command's directory. The translation units share the index action, so a
+ * function body that another translation unit already parsed is skipped when
+ * CXIndexOpt_SkipParsedBodiesInSession is set.
+ *
+ * The callbacks are invoked concurrently from the worker threads, with the
+ * same \p client_data; a client must synchronize its accesses to its data.
+ * IndexerCallbacks#abortQuery is also invoked, with a NULL reserved argument,
+ * before each translation unit is parsed; if it returns non-zero, the
+ * translation unit is skipped.
+ *
+ * \param CDb The compilation database whose compile commands are indexed.
+ *
+ * \param num_threads The number of translation units to index at once, or 0
+ * to index as many as the host has hardware threads.
+ *
+ * \param TU_options A bitmask of options, as for #clang_indexSourceFile.
+ *
+ * \returns The number of translation units that could not be indexed, or -1
+ * if the arguments are invalid.
+ *
+ * The rest of the parameters are the same as #clang_indexSourceFile.
+ */
+CINDEX_LINKAGE int clang_indexCompilationDatabase(CXIndexAction,
+                                              CXClientData client_data,
+                                              IndexerCallbacks *index_callbacks,
+                                              unsigned index_callbacks_size,
+                                              unsigned index_options,
+                                              CXCompilationDatabase CDb,
+                                              unsigned num_threads,
+                                              unsigned TU_options);
+
 /**
  * \brief Retrieve the CXIdxFile, file, line, column, and offset represented by
  * the given CXIdxLoc.
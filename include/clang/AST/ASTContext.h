@@ -58,6 +58,8 @@ namespace clang {
   class SelectorTable;
   class TargetInfo;
   class CXXABI;
+  class ConstexprCallCache;
+  class ConstexprInterpreter;
   class MangleNumberingContext;
   // Decls
   class MangleContext;
@@ -372,6 +374,10 @@ private:
   
   ImportDecl *FirstLocalImport;
   ImportDecl *LastLocalImport;
+
+  /// \brief The number of declarations made visible to name lookup in a
+  /// namespace or a class so far.
+  unsigned VisibleDeclGeneration;
   
   TranslationUnitDecl *TUDecl;
 
@@ -395,6 +401,38 @@ private:
   OwningPtr<CXXABI> ABI;
   CXXABI *createCXXABI(const TargetInfo &T);
 
+  /// \brief The bytecode interpreter for constexpr function calls, created
+  /// on first use (-fconstexpr-bytecode).
+  mutable OwningPtr<ConstexprInterpreter> ConstexprInterp;
+
+  /// \brief The memoized results of constexpr function calls, created on
+  /// first use.
+  mutable OwningPtr<ConstexprCallCache> ConstexprCalls;
+
+  /// \brief The arena that statements are being allocated in, if the body of
+  /// a function whose statements may be freed is being parsed
+  /// (-ffree-function-bodies).
+  llvm::BumpPtrAllocator *FunctionBodyArena;
+
+  /// \brief The function whose body is being allocated in FunctionBodyArena.
+  const FunctionDecl *FunctionBodyArenaOwner;
+
+  /// \brief The number of times allocation in FunctionBodyArena has been
+  /// suspended and not yet resumed.
+  unsigned FunctionBodyArenaSuspensions;
+
+  /// \brief The arenas holding the bodies of function definitions that can
+  /// be freed once they have been emitted.
+  llvm::DenseMap<const FunctionDecl *, llvm::BumpPtrAllocator *>
+    FreeableFunctionBodies;
+
+  /// \brief The arenas holding bodies that something outside the body may
+  /// refer to, which live as long as the ASTContext.
+  std::vector<llvm::BumpPtrAllocator *> KeptFunctionBodyArenas;
+
+  unsigned NumFreedFunctionBodies;
+  size_t NumFreedFunctionBodyBytes;
+
   /// \brief The logical -> physical address space map.
   const LangAS::Map *AddrSpaceMap;
 
@@ -474,7 +512,49 @@ public:
     return BumpAlloc.Allocate(Size, Align);
   }
   void Deallocate(void *Ptr) const { }
-  
+
+  /// \brief Allocate memory for a statement, in the arena of the function
+  /// body being parsed if there is one.
+  void *AllocateStmt(size_t Size, unsigned Align = 8) const {
+    if (FunctionBodyArena && !FunctionBodyArenaSuspensions)
+      return FunctionBodyArena->Allocate(Size, Align);
+    return BumpAlloc.Allocate(Size, Align);
+  }
+
+  /// \brief Start allocating the statements of the body of the function
+  /// definition \p FD in an arena of their own, so that they can be freed
+  /// once the function has been emitted.
+  ///
+  /// \returns false if the statements of another body are already being
+  /// allocated in an arena, or allocation in arenas is suspended.
+  bool startFunctionBodyArena(const FunctionDecl *FD);
+
+  /// \brief Stop allocating statements in the arena of the body of \p FD.
+  ///
+  /// \param CanFree Whether nothing outside the body refers to the
+  /// statements in it. If not, the arena lives as long as the ASTContext.
+  void finishFunctionBodyArena(const FunctionDecl *FD, bool CanFree);
+
+  /// \brief Returns the function whose body statements are being allocated
+  /// in an arena, if any.
+  const FunctionDecl *getFunctionBodyArenaOwner() const {
+    return FunctionBodyArenaOwner;
+  }
+
+  /// \brief Allocate statements in the ASTContext's own allocator until
+  /// resumeFunctionBodyArena() is called, e.g. while a template is
+  /// instantiated in the middle of a function body.
+  void suspendFunctionBodyArena() { ++FunctionBodyArenaSuspensions; }
+  void resumeFunctionBodyArena() {
+    assert(FunctionBodyArenaSuspensions && "arena not suspended");
+    --FunctionBodyArenaSuspensions;
+  }
+
+  /// \brief Free the statements in the body of the function \p FD if they
+  /// were allocated in an arena that can be freed, leaving an empty
+  /// compound statement as its body.
+  void freeFunctionBody(const FunctionDecl *FD);
+
   /// Return the total amount of physical memory allocated for representing
   /// AST nodes and type information.
   size_t getASTAllocatedMemory() const {
@@ -706,6 +786,15 @@ public:
   /// parsed or implicitly created within this translation unit.
   void addedLocalImportDecl(ImportDecl *Import);
 
+  /// \brief Notify the AST context that a declaration was made visible to
+  /// name lookup in a namespace or a class.
+  void addedVisibleDecl() { ++VisibleDeclGeneration; }
+
+  /// \brief Returns a number that changes whenever a declaration is made
+  /// visible to name lookup in a namespace or a class, so that the outcome
+  /// of a lookup can be known not to have changed since.
+  unsigned getVisibleDeclGeneration() const { return VisibleDeclGeneration; }
+
   static ImportDecl *getNextLocalImport(ImportDecl *Import) {
     return Import->NextLocalImport;
   }
@@ -832,6 +921,13 @@ public:
   void PrintStats() const;
   const SmallVectorImpl<Type *>& getTypes() const { return Types; }
 
+  /// \brief Retrieve the bytecode interpreter used to evaluate constexpr
+  /// function calls when -fconstexpr-bytecode is enabled.
+  ConstexprInterpreter &getConstexprInterpreter() const;
+
+  /// \brief Retrieve the cache of the results of constexpr function calls.
+  ConstexprCallCache &getConstexprCallCache() const;
+
   /// \brief Retrieve the declaration for the 128-bit signed integer type.
   TypedefDecl *getInt128Decl() const;
 
@@ -3413,6 +3413,13 @@ class CilkSpawnDecl : public Decl {
   /// a Cilk spawn call.
   CapturedStmt *CapturedSpawn;
 
+  /// \brief The scheduling priority given by '#pragma cilk priority', or 0.
+  unsigned Priority;
+
+  /// \brief The value-dependent priority expression of a spawn in a template,
+  /// which is evaluated when the template is instantiated.
+  Expr *DependentPriority;
+
   CilkSpawnDecl(DeclContext *DC, CapturedStmt *Spawn);
 
 public:
@@ -3436,6 +3443,20 @@ public:
   CapturedStmt *getCapturedStmt() { return CapturedSpawn; }
   const CapturedStmt *getCapturedStmt() const { return CapturedSpawn; }
 
+  /// \brief Returns the priority of this spawn. If it is a dataflow spawn
+  /// whose arguments are not ready, the pending frame is queued ahead of
+  /// frames with a lower priority once it becomes ready, e.g.
+  /// \code
+  ///   #pragma cilk priority(2)
+  ///   _Cilk_spawn factorize(blk);
+  /// \endcode
+  unsigned getPriority() const { return Priority; }
+  void setPriority(unsigned P) { Priority = P; }
+
+  /// \brief Returns the priority expression if it is value-dependent, or null.
+  Expr *getDependentPriority() const { return DependentPriority; }
+  void setDependentPriority(Expr *E) { DependentPriority = E; }
+
   static bool classof(const Decl *D) { return classofKind(D->getKind()); }
   static bool classofKind(Kind K) { return K == CilkSpawn; }
 
@@ -3553,6 +3574,8 @@ void Redeclarable<decl_type>::setPreviousDecl(decl_type *PrevDecl) {
     // redeclaration is invalid, it won't be PrevDecl, but we want it anyway.
     First = PrevDecl->getFirstDecl();
     assert(First->RedeclLink.NextIsLatest() && "Expected first");
+    if (First->LazyRedeclChain)
+      First->loadRedeclChain();
     decl_type *MostRecent = First->RedeclLink.getNext();
     RedeclLink = PreviousDeclLink(cast<decl_type>(MostRecent));
 
@@ -298,6 +298,11 @@ protected:
   /// Otherwise, it is the linkage + 1.
   mutable unsigned CacheValidAndLinkage : 3;
 
+  /// \brief Whether this is the first declaration of an entity that was
+  /// loaded from an AST file, and whether the rest of its redeclaration
+  /// chain is only loaded from there when it is needed.
+  mutable unsigned LazyRedeclChain : 1;
+
   friend class ASTDeclWriter;
   friend class ASTDeclReader;
   friend class ASTReader;
@@ -308,6 +313,10 @@ protected:
 private:
   void CheckAccessDeclContext() const;
 
+  /// \brief Load the redeclaration chain of this declaration, which has a
+  /// LazyRedeclChain, from the external AST source.
+  void loadRedeclChain() const;
+
 protected:
 
   Decl(Kind DK, DeclContext *DC, SourceLocation L)
@@ -316,7 +325,7 @@ protected:
       HasAttrs(false), Implicit(false), Used(false), Referenced(false),
       Access(AS_none), FromASTFile(0), Hidden(0),
       IdentifierNamespace(getIdentifierNamespaceForKind(DK)),
-      CacheValidAndLinkage(0)
+      CacheValidAndLinkage(0), LazyRedeclChain(0)
   {
     if (StatisticsEnabled) add(DK);
   }
@@ -326,7 +335,7 @@ protected:
       HasAttrs(false), Implicit(false), Used(false), Referenced(false),
       Access(AS_none), FromASTFile(0), Hidden(0),
       IdentifierNamespace(getIdentifierNamespaceForKind(DK)),
-      CacheValidAndLinkage(0)
+      CacheValidAndLinkage(0), LazyRedeclChain(0)
   {
     if (StatisticsEnabled) add(DK);
   }
@@ -775,6 +784,9 @@ public:
   /// \brief Returns iterator for all the redeclarations of the same decl.
   /// It will iterate at least once (when this decl is the only one).
   redecl_iterator redecls_begin() const {
+    const Decl *Canon = getCanonicalDecl();
+    if (Canon->LazyRedeclChain)
+      Canon->loadRedeclChain();
     return redecl_iterator(const_cast<Decl*>(this));
   }
   redecl_iterator redecls_end() const { return redecl_iterator(); }
@@ -25,6 +25,7 @@ class CXXBaseSpecifier;
 class DeclarationName;
 class ExternalSemaSource; // layering violation required for downcasting
 class FieldDecl;
+class FunctionDecl;
 class Module;
 class NamedDecl;
 class RecordDecl;
@@ -121,6 +122,12 @@ public:
   /// \brief Update an out-of-date identifier.
   virtual void updateOutOfDateIdentifier(IdentifierInfo &II) { }
 
+  /// \brief Load the redeclarations of \p D, the first declaration of an
+  /// entity, that the source left to be loaded when they are needed.
+  ///
+  /// The default implementation of this method is a no-op.
+  virtual void CompleteRedeclChain(const Decl *D) { }
+
   /// \brief Find all declarations with the given name in the given context,
   /// and add them to the context by calling SetExternalVisibleDeclsForName
   /// or SetNoExternalVisibleDeclsForName.
@@ -252,6 +259,27 @@ public:
   { 
     return false;
   }
+
+  /// \brief Where the code of a function definition that was loaded from
+  /// this source is generated.
+  enum CodeLocation {
+    /// \brief In each translation unit that uses the function, as usual.
+    CL_Default,
+    /// \brief Once, in this translation unit, which builds the object file
+    /// that goes with the AST file.
+    CL_ThisObject,
+    /// \brief In the object file that goes with the AST file, which was
+    /// built with -fpch-codegen.
+    CL_OtherObject
+  };
+
+  /// \brief Determine where the code of the function definition \p FD is
+  /// generated.
+  ///
+  /// The default implementation of this method returns CL_Default.
+  virtual CodeLocation getCodeLocation(const FunctionDecl *FD) {
+    return CL_Default;
+  }
   
   //===--------------------------------------------------------------------===//
   // Queries for performance analysis.
@@ -56,6 +56,11 @@ protected:
   ///  #3 int f(int x, int y) { return x + y; } // <pointer to #2, false>
   ///
   /// If there is only one declaration, it is <pointer to self, true>
+  ///
+  /// The first declaration of an entity loaded from an AST file may have a
+  /// LazyRedeclChain, in which case the later redeclarations of that file
+  /// are only linked in when the most recent declaration, or the list of
+  /// redeclarations, is asked for.
   DeclLink RedeclLink;
 
 public:
@@ -96,12 +101,18 @@ public:
 
   /// \brief Returns the most recent (re)declaration of this declaration.
   decl_type *getMostRecentDecl() {
-    return getFirstDecl()->RedeclLink.getNext();
+    decl_type *First = getFirstDecl();
+    if (First->LazyRedeclChain)
+      First->loadRedeclChain();
+    return First->RedeclLink.getNext();
   }
 
   /// \brief Returns the most recent (re)declaration of this declaration.
   const decl_type *getMostRecentDecl() const {
-    return getFirstDecl()->RedeclLink.getNext();
+    const decl_type *First = getFirstDecl();
+    if (First->LazyRedeclChain)
+      First->loadRedeclChain();
+    return First->RedeclLink.getNext();
   }
   
   /// \brief Set the previous declaration. If PrevDecl is NULL, set this as the
@@ -164,6 +175,9 @@ public:
   /// \brief Returns iterator for all the redeclarations of the same decl.
   /// It will iterate at least once (when this decl is the only one).
   redecl_iterator redecls_begin() const {
+    const decl_type *First = getFirstDecl();
+    if (First->LazyRedeclChain)
+      First->loadRedeclChain();
     return redecl_iterator(const_cast<decl_type*>(
                                           static_cast<const decl_type*>(this)));
   }
@@ -1120,13 +1120,18 @@ class ForStmt : public Stmt {
   SourceLocation ForLoc;
   SourceLocation LParenLoc, RParenLoc;
 
+  /// \brief The loop count of a loop whose body only spawns a call, or null
+  /// if this loop is not spawned in the same way as a '_Cilk_for'.
+  Expr *SpawnLoopCount;
+
 public:
   ForStmt(const ASTContext &C, Stmt *Init, Expr *Cond, VarDecl *condVar,
           Expr *Inc, Stmt *Body, SourceLocation FL, SourceLocation LP,
           SourceLocation RP);
 
   /// \brief Build an empty for statement.
-  explicit ForStmt(EmptyShell Empty) : Stmt(ForStmtClass, Empty) { }
+  explicit ForStmt(EmptyShell Empty)
+    : Stmt(ForStmtClass, Empty), SpawnLoopCount(0) { }
 
   Stmt *getInit() { return SubExprs[INIT]; }
 
@@ -1161,6 +1166,15 @@ public:
   void setInc(Expr *E) { SubExprs[INC] = reinterpret_cast<Stmt*>(E); }
   void setBody(Stmt *S) { SubExprs[BODY] = S; }
 
+  /// \brief Retrieve the loop count used to spawn the iterations of this
+  /// loop with divide-and-conquer spawning.
+  /// \code
+  /// for (int i = 0; i < n; ++i)
+  ///   _Cilk_spawn f(i);
+  /// \endcode
+  Expr *getSpawnLoopCount() const { return SpawnLoopCount; }
+  void setSpawnLoopCount(Expr *E) { SpawnLoopCount = E; }
+
   SourceLocation getForLoc() const { return ForLoc; }
   void setForLoc(SourceLocation L) { ForLoc = L; }
   SourceLocation getLParenLoc() const { return LParenLoc; }
@@ -2189,6 +2203,9 @@ private:
   /// \brief The source location of closing parenthesis.
   SourceLocation RParenLoc;
 
+  /// \brief The source location of '#pragma cilk affinity', if any.
+  SourceLocation AffinityLoc;
+
   /// \brief The loop control variable.
   const VarDecl *LoopControlVar;
 
@@ -2257,6 +2274,18 @@ public:
   void setLParenLoc(SourceLocation L) { LParenLoc = L; }
   void setRParenLoc(SourceLocation L) { RParenLoc = L; }
 
+  /// \brief Returns true if the runtime should replay the chunk-to-worker
+  /// mapping of the previous execution of this loop.
+  /// \code
+  /// #pragma cilk affinity
+  /// _Cilk_for (int i = 0; i < n; ++i) {
+  ///   // ...
+  /// }
+  /// \endcode
+  bool hasAffinity() const { return AffinityLoc.isValid(); }
+  SourceLocation getAffinityLoc() const LLVM_READONLY { return AffinityLoc; }
+  void setAffinityLoc(SourceLocation L) { AffinityLoc = L; }
+
   SourceLocation getLocStart() const LLVM_READONLY { return CilkForLoc; }
   SourceLocation getLocEnd() const LLVM_READONLY {
     return SubExprs[BODY]->getLocEnd();
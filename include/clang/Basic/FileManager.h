@@ -164,6 +164,33 @@ class FileManager : public RefCountedBase<FileManager> {
   ///
   unsigned NextFileUID;
 
+  /// \brief The number of times revalidateLookups() was called. A cached
+  /// lookup made before the last call is checked again when it is used.
+  unsigned LookupGeneration;
+
+  /// \brief The value of LookupGeneration when each name in SeenDirEntries
+  /// and SeenFileEntries was last looked up or checked.
+  llvm::StringMap<unsigned, llvm::BumpPtrAllocator> DirLookupGenerations;
+  llvm::StringMap<unsigned, llvm::BumpPtrAllocator> FileLookupGenerations;
+
+  /// \brief What is known about the contents of a real directory, which
+  /// tells whether the files that were not found in it may exist now.
+  struct RealDirStatus {
+    /// \brief The modification time of the directory when it was last
+    /// checked.
+    time_t ModTime;
+
+    /// \brief Whether the directory may have been modified within the same
+    /// second after it was checked, so that an unchanged ModTime doesn't
+    /// prove that its contents are unchanged.
+    bool ModTimeIsRacy;
+
+    /// \brief The LookupGeneration in which the directory was found to have
+    /// changed.
+    unsigned ChangedGeneration;
+  };
+  llvm::DenseMap<const DirectoryEntry *, RealDirStatus> RealDirStatuses;
+
   // Statistics.
   unsigned NumDirLookups, NumFileLookups;
   unsigned NumDirCacheMisses, NumFileCacheMisses;
@@ -174,6 +201,15 @@ class FileManager : public RefCountedBase<FileManager> {
   bool getStatValue(const char *Path, FileData &Data, bool isFile,
                     int *FileDescriptor);
 
+  /// \brief Record that the cached lookup of \p Name is current, and
+  /// return whether it was made before the last call to revalidateLookups().
+  bool isStaleLookup(llvm::StringMap<unsigned, llvm::BumpPtrAllocator> &Gens,
+                     StringRef Name);
+
+  /// \brief Whether a file that was not found at \p Filename before the last
+  /// call to revalidateLookups() can't have been created since.
+  bool isMissingFileUnchanged(StringRef Filename);
+
   /// Add all ancestors of the given path (pointing to either a file
   /// or a directory) as virtual directories.
   void addAncestorsAsVirtualDirs(StringRef Path);
@@ -251,6 +287,19 @@ public:
   /// \brief Remove the real file \p Entry from the cache.
   void invalidateCache(const FileEntry *Entry);
 
+  /// \brief Prepare the cached lookups to be used by another compilation,
+  /// by checking each of them against the file system again the first time
+  /// it is used from now on.
+  ///
+  /// A file that exists is stat'ed again when it is next looked up. A file
+  /// that wasn't found is only looked for again if its directory has been
+  /// modified since, so the misses of header search cost a stat of each
+  /// search directory rather than one per header.
+  ///
+  /// \returns false if the lookups can't be reused, because virtual files
+  /// have been added.
+  bool revalidateLookups();
+
   /// \brief If path is not absolute and FileSystemOptions set the working
   /// directory, the path is modified to be relative to the given
   /// working directory.
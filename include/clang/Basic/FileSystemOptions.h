@@ -25,6 +25,10 @@ public:
   /// \brief If set, paths are resolved as if the working directory was
   /// set to the value of WorkingDir.
   std::string WorkingDir;
+
+  /// \brief If set, the path of a file caching 'stat' results across compiler
+  /// invocations (see PersistentStatCache).
+  std::string StatCachePath;
 };
 
 } // end namespace clang
@@ -0,0 +1,106 @@
+//===--- PersistentStatCache.h - On-disk cache of 'stat' calls --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the PersistentStatCache interface, used by -fstat-cache.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_PERSISTENTSTATCACHE_H
+#define LLVM_CLANG_PERSISTENTSTATCACHE_H
+
+#include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/SmallString.h"
+#include <string>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+/// \brief A stat cache backed by a file that is shared by all of the compiler
+/// invocations in a build.
+///
+/// The file is memory mapped read-only, so any number of processes can use
+/// it concurrently. It records failed lookups and directories, which make up
+/// most of the 'stat' calls done by header search. Each entry remembers the
+/// modification time of its parent directory, and is only trusted while that
+/// directory is unchanged; the parent is stat'ed at most once per process.
+/// Successful file lookups always go to the file system, since the client
+/// needs an open descriptor and an up-to-date size anyway.
+///
+/// Lookups that were not in the file are written back by write(), which
+/// atomically replaces the file so that readers never see a partial cache.
+class PersistentStatCache : public FileSystemStatCache {
+public:
+  /// \brief The cached result of one lookup.
+  struct Entry {
+    /// \brief The modification time of the parent directory, plus one.
+    uint64_t ParentStamp;
+    /// \brief Whether the lookup succeeded; if so, Data is valid.
+    bool Exists;
+    FileData Data;
+  };
+
+private:
+  /// \brief The path of the cache file.
+  std::string CachePath;
+
+  /// \brief The directory relative paths are resolved against.
+  SmallString<128> WorkingDir;
+
+  /// \brief The contents of the cache file, if it was valid.
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+
+  /// \brief The on-disk hash table within Buffer, or null.
+  void *Table;
+
+  /// \brief The modification time of each directory whose entries have been
+  /// looked up, plus one; zero if entries of that directory can't be cached.
+  llvm::StringMap<uint64_t> DirStamps;
+
+  /// \brief Directories modified after this time are still changing, and
+  /// their entries are not cached.
+  uint64_t StableBefore;
+
+  /// \brief Lookups made by this process that were not in the file.
+  llvm::StringMap<Entry> NewEntries;
+
+  /// \brief Cacheable lookups that were answered from, or missing from, the
+  /// file.
+  unsigned NumHits, NumMisses;
+
+  uint64_t getDirectoryStamp(StringRef Dir);
+
+  PersistentStatCache(const PersistentStatCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const PersistentStatCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  /// \brief Use the cache in \p Path, which need not exist yet. Relative paths
+  /// are resolved against \p WorkingDir, or the current directory if empty.
+  PersistentStatCache(StringRef Path, StringRef WorkingDir);
+  ~PersistentStatCache();
+
+  /// \brief Write the lookups made by this process back to the cache file,
+  /// if there are any.
+  ///
+  /// \returns true on error, with a description in \p ErrorInfo.
+  bool write(std::string &ErrorInfo);
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+
+  virtual LookupResult getStat(const char *Path, FileData &Data, bool isFile,
+                               int *FileDescriptor);
+};
+
+} // end namespace clang
+
+#endif
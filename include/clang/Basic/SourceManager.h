@@ -49,6 +49,7 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cassert>
+#include <cstring>
 #include <map>
 #include <vector>
 
@@ -233,22 +234,31 @@ namespace SrcMgr {
   ///
   /// FileInfos contain a "ContentCache *", with the contents of the file.
   ///
+  /// The number of FileIDs created while preprocessing the file is kept by
+  /// the SourceManager instead, since it is only known for some files.
   class FileInfo {
     /// \brief The location of the \#include that brought in this file.
     ///
     /// This is an invalid SLOC for the main file (top of the \#include chain).
     unsigned IncludeLoc;  // Really a SourceLocation
 
-    /// \brief Number of FileIDs (files and macros) that were created during
-    /// preprocessing of this \#include, including this SLocEntry.
-    ///
-    /// Zero means the preprocessor didn't provide such info for this SLocEntry.
-    unsigned NumCreatedFIDs;
-
     /// \brief Contains the ContentCache* and the bits indicating the
     /// characteristic of the file and whether it has \#line info, all
     /// bitmangled together.
-    uintptr_t Data;
+    ///
+    /// This is a uintptr_t stored as 32-bit words, so that a FileInfo has the
+    /// size and alignment of an ExpansionInfo, and an SLocEntry takes 16 bytes
+    /// rather than 24 on 64-bit hosts.
+    unsigned Data[sizeof(uintptr_t) / sizeof(unsigned)];
+
+    uintptr_t getData() const {
+      uintptr_t D;
+      memcpy(&D, Data, sizeof(D));
+      return D;
+    }
+    void setData(uintptr_t D) {
+      memcpy(Data, &D, sizeof(D));
+    }
 
     friend class clang::SourceManager;
     friend class clang::ASTWriter;
@@ -259,11 +269,10 @@ namespace SrcMgr {
                         CharacteristicKind FileCharacter) {
       FileInfo X;
       X.IncludeLoc = IL.getRawEncoding();
-      X.NumCreatedFIDs = 0;
-      X.Data = (uintptr_t)Con;
-      assert((X.Data & 7) == 0 &&"ContentCache pointer insufficiently aligned");
+      uintptr_t D = (uintptr_t)Con;
+      assert((D & 7) == 0 && "ContentCache pointer insufficiently aligned");
       assert((unsigned)FileCharacter < 4 && "invalid file character");
-      X.Data |= (unsigned)FileCharacter;
+      X.setData(D | (unsigned)FileCharacter);
       return X;
     }
 
@@ -271,21 +280,21 @@ namespace SrcMgr {
       return SourceLocation::getFromRawEncoding(IncludeLoc);
     }
     const ContentCache* getContentCache() const {
-      return reinterpret_cast<const ContentCache*>(Data & ~uintptr_t(7));
+      return reinterpret_cast<const ContentCache*>(getData() & ~uintptr_t(7));
     }
 
     /// \brief Return whether this is a system header or not.
     CharacteristicKind getFileCharacteristic() const {
-      return (CharacteristicKind)(Data & 3);
+      return (CharacteristicKind)(getData() & 3);
     }
 
     /// \brief Return true if this FileID has \#line directives in it.
-    bool hasLineDirectives() const { return (Data & 4) != 0; }
+    bool hasLineDirectives() const { return (getData() & 4) != 0; }
 
     /// \brief Set the flag that indicates that this FileID has
     /// line table entries associated with it.
     void setHasLineDirectives() {
-      Data |= 4;
+      setData(getData() | 4);
     }
   };
 
@@ -680,6 +689,11 @@ class SourceManager : public RefCountedBase<SourceManager> {
 
   mutable llvm::DenseMap<FileID, MacroArgsMap *> MacroArgsCacheMap;
 
+  /// \brief The number of FileIDs (files and macros) that were created during
+  /// preprocessing of each file that the preprocessor provided it for,
+  /// including the file's own FileID.
+  mutable llvm::DenseMap<FileID, unsigned> NumCreatedFIDs;
+
   /// \brief The stack of modules being built, which is used to detect
   /// cycles in the module dependency graph as modules are being built, as
   /// well as to describe why we're rebuilding a particular module.
@@ -936,13 +950,10 @@ public:
 
   /// \brief Get the number of FileIDs (files and macros) that were created
   /// during preprocessing of \p FID, including it.
+  ///
+  /// Zero means the preprocessor didn't provide such info for \p FID.
   unsigned getNumCreatedFIDsForFileID(FileID FID) const {
-    bool Invalid = false;
-    const SrcMgr::SLocEntry &Entry = getSLocEntry(FID, &Invalid);
-    if (Invalid || !Entry.isFile())
-      return 0;
-
-    return Entry.getFile().NumCreatedFIDs;
+    return NumCreatedFIDs.lookup(FID);
   }
 
   /// \brief Set the number of FileIDs (files and macros) that were created
@@ -950,11 +961,11 @@ public:
   void setNumCreatedFIDsForFileID(FileID FID, unsigned NumFIDs) const {
     bool Invalid = false;
     const SrcMgr::SLocEntry &Entry = getSLocEntry(FID, &Invalid);
-    if (Invalid || !Entry.isFile())
+    if (Invalid || !Entry.isFile() || NumFIDs == 0)
       return;
 
-    assert(Entry.getFile().NumCreatedFIDs == 0 && "Already set!");
-    const_cast<SrcMgr::FileInfo &>(Entry.getFile()).NumCreatedFIDs = NumFIDs;
+    assert(!NumCreatedFIDs.count(FID) && "Already set!");
+    NumCreatedFIDs[FID] = NumFIDs;
   }
 
   //===--------------------------------------------------------------------===//
@@ -0,0 +1,73 @@
+//===--- ThreadPool.h - Fixed-size pool of worker threads -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the ThreadPool class, which runs tasks on a fixed number of
+/// worker threads.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_THREADPOOL_H
+#define LLVM_CLANG_BASIC_THREADPOOL_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/Support/Compiler.h"
+
+namespace clang {
+
+/// \brief Runs tasks on a fixed number of worker threads.
+///
+/// Tasks are started in the order in which they were queued. Worker threads
+/// get a stack large enough to run the frontend. If the host has no thread
+/// support, or the pool has a single thread and doesn't run in the
+/// background, each task runs synchronously when it is queued.
+class ThreadPool {
+public:
+  typedef void (*TaskFn)(void *Data);
+
+private:
+  class Impl;
+  Impl *TheImpl;
+  unsigned NumThreads;
+
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+
+public:
+  /// \brief Create a pool of \p NumThreads threads, or of one thread per
+  /// hardware thread if zero.
+  ///
+  /// \param Background Whether a pool of a single thread still runs its tasks
+  /// on that thread, so that they overlap with the work of the caller.
+  explicit ThreadPool(unsigned NumThreads = 0, bool Background = false);
+
+  /// \brief Waits for the queued tasks to finish, then stops the threads.
+  ~ThreadPool();
+
+  /// \brief The number of tasks that can run at the same time.
+  unsigned getNumThreads() const { return NumThreads; }
+
+  /// \brief Whether queued tasks run on worker threads, rather than
+  /// synchronously in async().
+  bool runsInBackground() const { return TheImpl != 0; }
+
+  /// \brief Queue a call to \p Fn with \p Data.
+  void async(TaskFn Fn, void *Data);
+
+  /// \brief Block until all queued tasks have finished.
+  void wait();
+
+  /// \brief The number of threads the host can run concurrently, or 1 if
+  /// that can't be determined.
+  static unsigned getHardwareConcurrency();
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,78 @@
+//===--- TimeTrace.h - Hierarchical compile-time trace ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the scoped events recorded for -ftime-trace and their
+/// output in the Chrome trace event format (chrome://tracing).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_TIMETRACE_H
+#define LLVM_CLANG_BASIC_TIMETRACE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+
+struct TimeTraceProfiler;
+
+/// \brief Start recording the events of this thread; each thread records a
+/// trace of its own. Events shorter than \p GranularityUS microseconds are
+/// dropped to keep the trace small; the per-name totals still account for
+/// them.
+void timeTraceProfilerBegin(unsigned GranularityUS);
+
+/// \brief Stop recording and write all events recorded since the matching
+/// timeTraceProfilerBegin to \p OS as a Chrome trace JSON object.
+void timeTraceProfilerEnd(raw_ostream &OS);
+
+/// \brief Returns true if the events of this thread are being recorded.
+bool isTimeTraceEnabled();
+
+/// \brief Returns the trace that this thread records its events into, or
+/// null.
+TimeTraceProfiler *getTimeTraceProfiler();
+
+/// \brief Record the events of this thread into \p Profiler, or stop
+/// recording them if it is null. This lets a thread that works on behalf of
+/// another, which waits for it meanwhile, add to the other's trace.
+void setTimeTraceProfiler(TimeTraceProfiler *Profiler);
+
+/// \brief Open an event that does not correspond to a C++ scope, such as the
+/// lexing of an #included file. It must be closed by timeTraceEndEvent, or
+/// it is closed together with the innermost enclosing TimeTraceScope.
+void timeTraceBeginEvent(StringRef Name, StringRef Detail = StringRef());
+
+/// \brief Close the innermost open event.
+void timeTraceEndEvent();
+
+/// \brief Records the time spent between construction and destruction as an
+/// event nested in the enclosing scopes, e.g.
+/// \code
+///   TimeTraceScope Scope("Source", FileName);
+/// \endcode
+/// This is a no-op if no trace is being recorded. Callers should only
+/// compute an expensive \p Detail if isTimeTraceEnabled().
+class TimeTraceScope {
+  /// \brief The number of open events before this one, or ~0U if no trace
+  /// was being recorded at construction.
+  unsigned Depth;
+
+  TimeTraceScope(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit TimeTraceScope(StringRef Name, StringRef Detail = StringRef());
+  ~TimeTraceScope();
+};
+
+} // end namespace clang
+
+#endif
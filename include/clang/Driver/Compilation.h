@@ -69,6 +69,15 @@ class Compilation {
   /// Redirection for stdout, stderr, etc.
   const StringRef **Redirects;
 
+  /// The number of independent jobs that may run at the same time (-j).
+  unsigned NumParallelJobs;
+
+  /// The socket of the compile server that runs -cc1 jobs, if any.
+  std::string CompileServerPath;
+
+  void ExecuteJobsInParallel(const JobList &Jobs,
+     SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
+
 public:
   Compilation(const Driver &D, const ToolChain &DefaultToolChain,
               llvm::opt::InputArgList *Args,
@@ -101,6 +110,17 @@ public:
     return FailureResultFiles;
   }
 
+  unsigned getNumParallelJobs() const { return NumParallelJobs; }
+  void setNumParallelJobs(unsigned N) { NumParallelJobs = N; }
+
+  StringRef getCompileServerPath() const { return CompileServerPath; }
+  void setCompileServerPath(StringRef Path) { CompileServerPath = Path; }
+
+  /// ExecuteCommandOnce - Run \p C, in the compile server if there is one
+  /// that can, without printing it or reporting errors.
+  int ExecuteCommandOnce(const Command &C, const StringRef **Redirects,
+                         std::string *ErrMsg, bool *ExecutionFailed) const;
+
   /// Returns the sysroot path.
   StringRef getSysRoot() const;
 
@@ -164,6 +184,11 @@ public:
 
   /// ExecuteJob - Execute a single job.
   ///
+  /// With more than one parallel job, the commands of a job list run
+  /// concurrently once the commands producing their inputs have finished.
+  /// The output of each command is buffered and printed, along with any
+  /// failure, in the order in which the commands would have run serially.
+  ///
   /// \param FailingCommands - For non-zero results, this will be a vector of
   /// failing commands and their associated result code.
   void ExecuteJob(const Job &J,
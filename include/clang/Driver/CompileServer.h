@@ -0,0 +1,84 @@
+//===--- CompileServer.h - Running -cc1 jobs in a server --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the protocol between the driver and a compile server
+/// (clang -cc1server), which runs -cc1 jobs in a long-running process.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_DRIVER_COMPILESERVER_H_
+#define CLANG_DRIVER_COMPILESERVER_H_
+
+#include "clang/Basic/LLVM.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace driver {
+
+class Command;
+
+/// \brief The first field of every message, which changes whenever the
+/// protocol does.
+extern const char CompileServerProtocolVersion[];
+
+/// \brief Send a message made of \p Fields over the connection \p FD.
+///
+/// A message is the number of fields followed by each field, prefixed by its
+/// size. Sizes are 32-bit little-endian integers.
+///
+/// \returns true on error.
+bool writeCompileServerMessage(int FD, ArrayRef<std::string> Fields);
+
+/// \brief Receive a message from the connection \p FD into \p Fields.
+///
+/// \returns true on error, including if the connection was closed.
+bool readCompileServerMessage(int FD, std::vector<std::string> &Fields);
+
+/// \brief Listen for connections on the Unix domain socket \p Path,
+/// replacing any socket file that is already there.
+///
+/// The socket file only appears once the server is listening, so a driver
+/// that finds it can connect. The listening socket is non-blocking, so that
+/// several worker processes can wait for connections on it.
+///
+/// \returns the listening socket, or -1 with a description in \p Error.
+int listenOnCompileServerSocket(StringRef Path, std::string &Error);
+
+/// \brief Wait for a connection on \p ListenFD, which may be shared with
+/// other processes.
+///
+/// \param Timeout - The number of seconds to wait, or zero to wait forever.
+///
+/// \returns the connection, or -1 on error or if \p Timeout seconds passed,
+/// in which case \p TimedOut is set.
+int acceptCompileServerConnection(int ListenFD, unsigned Timeout,
+                                  bool &TimedOut);
+
+/// \brief Close a socket returned by the functions above.
+void closeCompileServerSocket(int FD);
+
+/// \brief Run the -cc1 command \p C in the compile server listening on
+/// \p Path, in the current directory.
+///
+/// \param Redirects - As for Command::Execute; the output of the command is
+/// written to the files named there, or to the driver's standard output and
+/// error if null.
+///
+/// \returns false if the server can't run the command, e.g. because there is
+/// none or it is a different compiler, in which case the caller should run
+/// the command itself. Otherwise sets \p Result to its exit code.
+bool executeOnCompileServer(StringRef Path, const Command &C,
+                            const StringRef **Redirects, int &Result);
+
+} // end namespace driver
+} // end namespace clang
+
+#endif
@@ -21,6 +21,7 @@
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Frontend/PrecompiledPreambleCache.h"
 #include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/ModuleLoader.h"
 #include "clang/Lex/PreprocessingRecord.h"
@@ -64,6 +65,15 @@ class ASTDeserializationListener;
 ///
 class ASTUnit : public ModuleLoader {
 private:
+  /// \brief The cache of precompiled preambles shared with other translation
+  /// units, if any. Preambles are then kept in memory rather than in a
+  /// temporary file.
+  IntrusiveRefCntPtr<PrecompiledPreambleCache> PreambleCache;
+
+  /// \brief The precompiled preamble from \c PreambleCache that the AST was
+  /// read with, which must outlive the AST.
+  IntrusiveRefCntPtr<PrecompiledPreamble> ParsedPreamble;
+
   IntrusiveRefCntPtr<LangOptions>         LangOpts;
   IntrusiveRefCntPtr<DiagnosticsEngine>   Diagnostics;
   IntrusiveRefCntPtr<FileManager>         FileMgr;
@@ -211,6 +221,10 @@ private:
   /// \c PreambleFile.
   PreambleData Preamble;
 
+  /// \brief The precompiled preamble from \c PreambleCache for \c Preamble,
+  /// if any.
+  IntrusiveRefCntPtr<PrecompiledPreamble> SharedPreamble;
+
   /// \brief Whether the preamble ends at the start of a new line.
   /// 
   /// Used to inform the lexer as to whether it's starting at the beginning of
@@ -275,6 +289,10 @@ private:
 
   void clearFileLevelDecls();
 
+  /// \brief The name of the AST file of the precompiled preamble, or empty if
+  /// there is none.
+  StringRef getPreamblePCHFile() const;
+
 public:
   /// \brief A cached code-completion result, which may be introduced in one of
   /// many different contexts.
@@ -714,6 +732,9 @@ public:
   /// This will only receive an ASTUnit if a new one was created. If an already
   /// created ASTUnit was passed in \p Unit then the caller can check that.
   ///
+  /// \param PreambleCache - If non-null, the cache of precompiled preambles
+  /// to share with other translation units.
+  ///
   static ASTUnit *LoadFromCompilerInvocationAction(CompilerInvocation *CI,
                               IntrusiveRefCntPtr<DiagnosticsEngine> Diags,
                                              ASTFrontendAction *Action = 0,
@@ -726,7 +747,8 @@ public:
                                        bool CacheCodeCompletionResults = false,
                               bool IncludeBriefCommentsInCodeCompletion = false,
                                        bool UserFilesAreVolatile = false,
-                                       OwningPtr<ASTUnit> *ErrAST = 0);
+                                       OwningPtr<ASTUnit> *ErrAST = 0,
+                              PrecompiledPreambleCache *PreambleCache = 0);
 
   /// LoadFromCompilerInvocation - Create an ASTUnit from a source file, via a
   /// CompilerInvocation object.
@@ -765,6 +787,9 @@ public:
   /// (e.g. because the PCH could not be loaded), this accepts the ASTUnit
   /// mainly to allow the caller to see the diagnostics.
   ///
+  /// \param PreambleCache - If non-null, the cache of precompiled preambles
+  /// to share with other translation units.
+  ///
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
   static ASTUnit *LoadFromCommandLine(const char **ArgBegin,
@@ -784,7 +809,8 @@ public:
                                       bool SkipFunctionBodies = false,
                                       bool UserFilesAreVolatile = false,
                                       bool ForSerialization = false,
-                                      OwningPtr<ASTUnit> *ErrAST = 0);
+                                      OwningPtr<ASTUnit> *ErrAST = 0,
+                              PrecompiledPreambleCache *PreambleCache = 0);
   
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
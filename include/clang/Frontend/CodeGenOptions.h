@@ -115,6 +115,15 @@ public:
   /// in the backend for setting the name in the skeleton cu.
   std::string SplitDwarfFile;
 
+  /// The object files to write parts of the module to, each generated on a
+  /// thread of its own. The rest of the module goes to the main output.
+  std::vector<std::string> ParallelCodeGenOutputs;
+
+  /// The object file that the parts are linked into. The names that the parts
+  /// refer to each other's local symbols by are derived from it, so that they
+  /// don't clash with those of another object file built from the same source.
+  std::string ParallelCodeGenObject;
+
   /// The name of the relocation model to use.
   std::string RelocationModel;
 
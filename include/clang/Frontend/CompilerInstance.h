@@ -41,6 +41,7 @@ class FileEntry;
 class FileManager;
 class FrontendAction;
 class Module;
+class PersistentStatCache;
 class Preprocessor;
 class Sema;
 class SourceManager;
@@ -77,6 +78,10 @@ class CompilerInstance : public ModuleLoader {
   /// The file manager.
   IntrusiveRefCntPtr<FileManager> FileMgr;
 
+  /// \brief Non-owning reference to the -fstat-cache cache installed in
+  /// FileMgr by createFileManager, if any.
+  PersistentStatCache *StatCacheFile;
+
   /// The source manager.
   IntrusiveRefCntPtr<SourceManager> SourceMgr;
 
@@ -138,6 +143,9 @@ class CompilerInstance : public ModuleLoader {
   /// The list of active output files.
   std::list<OutputFile> OutputFiles;
 
+  /// \brief Write back the lookups recorded by StatCacheFile, if any.
+  void writeStatCacheFile();
+
   CompilerInstance(const CompilerInstance &) LLVM_DELETED_FUNCTION;
   void operator=(const CompilerInstance &) LLVM_DELETED_FUNCTION;
 public:
@@ -653,7 +661,21 @@ public:
                 const FrontendOptions &Opts);
 
   /// }
-  
+
+  /// \brief Build the module files of the modules given to
+  /// -fmodules-prebuild, and of the modules they use or export, that are
+  /// missing from the module cache, building modules that don't depend on
+  /// each other in parallel.
+  ///
+  /// Dependencies are taken from the 'use' and 'export' declarations of the
+  /// module maps; a module that imports another without declaring it still
+  /// builds correctly, but may wait for the other module to be built. The
+  /// diagnostics of each build are reported once it is done, and a module
+  /// that fails to build is recorded as failed, so that importing it doesn't
+  /// build it again. The global module index is updated once, after the
+  /// translation unit has been compiled.
+  void prebuildModules();
+
   virtual ModuleLoadResult loadModule(SourceLocation ImportLoc,
                                       ModuleIdPath Path,
                                       Module::NameVisibilityKind Visibility,
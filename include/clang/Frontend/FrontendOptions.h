@@ -125,6 +125,8 @@ public:
                                            /// metrics and statistics.
   unsigned ShowTimers : 1;                 ///< Show timers for individual
                                            /// actions.
+  unsigned TimeTrace : 1;                  ///< Write a Chrome trace of the
+                                           /// frontend phases per input.
   unsigned ShowVersion : 1;                ///< Show the -version text.
   unsigned FixWhatYouCan : 1;              ///< Apply fixes even if there are
                                            /// unfixable errors.
@@ -234,17 +236,30 @@ public:
   /// \brief File name of the file that will provide record layouts
   /// (in the format produced by -fdump-record-layouts).
   std::string OverrideRecordLayoutsFile;
+
+  /// \brief Minimum duration, in microseconds, of the events written by
+  /// -ftime-trace.
+  unsigned TimeTraceGranularity;
+
+  /// \brief The modules to build before parsing with -fmodules-prebuild,
+  /// along with the modules they declare that they use or export.
+  std::vector<std::string> ModulesPrebuild;
+
+  /// \brief The number of modules built at the same time by
+  /// -fmodules-prebuild, or zero for one per hardware thread.
+  unsigned ModulePrebuildThreads;
   
 public:
   FrontendOptions() :
     DisableFree(false), RelocatablePCH(false), ShowHelp(false),
-    ShowStats(false), ShowTimers(false), ShowVersion(false),
+    ShowStats(false), ShowTimers(false), TimeTrace(false), ShowVersion(false),
     FixWhatYouCan(false), FixOnlyWarnings(false), FixAndRecompile(false),
     FixToTemporaries(false), ARCMTMigrateEmitARCErrors(false),
     SkipFunctionBodies(false), UseGlobalModuleIndex(true),
     GenerateGlobalModuleIndex(true), ASTDumpLookups(false),
     ARCMTAction(ARCMT_None), ObjCMTAction(ObjCMT_None),
-    ProgramAction(frontend::ParseSyntaxOnly)
+    ProgramAction(frontend::ParseSyntaxOnly), TimeTraceGranularity(500),
+    ModulePrebuildThreads(0)
   {}
 
   /// getInputKindForExtension - Return the appropriate input kind for a file
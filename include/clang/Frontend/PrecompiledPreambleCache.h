@@ -0,0 +1,150 @@
+//===--- PrecompiledPreambleCache.h - Shared preambles ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the PrecompiledPreambleCache class, which lets the
+// ASTUnits created by one index share the precompiled preambles of their main
+// files.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_FRONTEND_PRECOMPILEDPREAMBLECACHE_H
+#define LLVM_CLANG_FRONTEND_PRECOMPILEDPREAMBLECACHE_H
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LLVM.h"
+#include "clang/Serialization/ASTBitCodes.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+  class MemoryBuffer;
+}
+
+namespace clang {
+
+class CompilerInvocation;
+class PrecompiledPreambleCache;
+
+/// \brief A precompiled preamble that is kept in memory rather than in a
+/// temporary file, along with what an ASTUnit learned while building it.
+///
+/// A preamble is reference-counted by the ASTUnits that use it, and is freed,
+/// and forgotten by its cache, when the last of them releases it.
+class PrecompiledPreamble : public llvm::FoldingSetNode {
+  friend class PrecompiledPreambleCache;
+
+  IntrusiveRefCntPtr<PrecompiledPreambleCache> Cache;
+  llvm::FoldingSetNodeID Key;
+  unsigned RefCount;
+
+  /// \brief Whether the preamble can still be found in its cache, i.e. it
+  /// hasn't been replaced by a newer preamble with the same key.
+  bool InCache;
+
+  std::string PCHName;
+  OwningPtr<llvm::MemoryBuffer> PCHBuffer;
+
+  PrecompiledPreamble(const PrecompiledPreamble &) LLVM_DELETED_FUNCTION;
+  void operator=(const PrecompiledPreamble &) LLVM_DELETED_FUNCTION;
+
+public:
+  /// \brief Create a preamble whose AST file has the contents \p PCHBuffer,
+  /// and takes ownership of it.
+  ///
+  /// \param PCHName The name the AST reader is to know the AST file by.
+  PrecompiledPreamble(StringRef PCHName, llvm::MemoryBuffer *PCHBuffer);
+  ~PrecompiledPreamble();
+
+  StringRef getPCHName() const { return PCHName; }
+  const llvm::MemoryBuffer *getPCHBuffer() const { return PCHBuffer.get(); }
+
+  /// \brief The size of the buffer reserved for the main file within the
+  /// preamble.
+  unsigned ReservedSize;
+
+  /// \brief The files used by the preamble, with their size and modification
+  /// time at the time it was built.
+  llvm::StringMap<std::pair<off_t, time_t> > FilesInPreamble;
+
+  /// \brief The diagnostics produced when building the preamble.
+  SmallVector<StoredDiagnostic, 4> Diagnostics;
+
+  /// \brief The number of warnings produced when building the preamble.
+  unsigned NumWarnings;
+
+  /// \brief The IDs of the top-level declarations of the preamble.
+  std::vector<serialization::DeclID> TopLevelDecls;
+
+  /// \brief The hash of the top-level declarations and macros of the
+  /// preamble.
+  unsigned TopLevelHashValue;
+
+  void Retain();
+  void Release();
+
+  void Profile(llvm::FoldingSetNodeID &ID) const { ID = Key; }
+};
+
+/// \brief The precompiled preambles of the translation units of an index, so
+/// that translation units that start with the same #includes, such as the
+/// source files of one component, share one preamble instead of each
+/// building its own.
+///
+/// A preamble is keyed on its text, on the directory of the main file that
+/// quoted #includes are looked up in, on the contents of the unsaved files,
+/// and on the options that affect how it is compiled. Translation units with
+/// different main files share a preamble: its main file is mapped onto the
+/// main file of the unit that reads it. The files it uses are checked
+/// against their size and modification time by each translation unit
+/// before it is used.
+///
+/// The cache is used by ASTUnits on several threads at once.
+class PrecompiledPreambleCache
+    : public llvm::ThreadSafeRefCountedBase<PrecompiledPreambleCache> {
+  friend class PrecompiledPreamble;
+
+  llvm::sys::Mutex Lock;
+  llvm::FoldingSet<PrecompiledPreamble> Preambles;
+
+public:
+  ~PrecompiledPreambleCache();
+
+  /// \brief Compute the key of the preamble \p Preamble of the main file
+  /// \p MainFile, compiled with \p Invocation.
+  static void Profile(llvm::FoldingSetNodeID &ID,
+                      const CompilerInvocation &Invocation, StringRef MainFile,
+                      StringRef Preamble, bool EndsAtStartOfLine);
+
+  /// \brief Find the preamble with the key \p Key.
+  ///
+  /// \returns null if there is no such preamble.
+  IntrusiveRefCntPtr<PrecompiledPreamble>
+  lookup(const llvm::FoldingSetNodeID &Key);
+
+  /// \brief Add the new preamble \p P with the key \p Key, taking ownership
+  /// of it.
+  ///
+  /// A preamble with the same key that is already in the cache, which was
+  /// out of date for the caller, is replaced, but stays alive for the
+  /// translation units that use it.
+  IntrusiveRefCntPtr<PrecompiledPreamble>
+  insert(const llvm::FoldingSetNodeID &Key, PrecompiledPreamble *P);
+};
+
+} // end namespace clang
+
+#endif
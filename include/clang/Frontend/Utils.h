@@ -101,6 +101,18 @@ void AttachHeaderIncludeGen(Preprocessor &PP, bool ShowAllHeaders = false,
 /// a seekable stream.
 void CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS);
 
+/// CacheHeaderTokens - Write a PTH file holding the tokens of the file of
+/// \p FID alone, stored under the name \p Name, for the HeaderTokenCache.
+/// Returns false if the file can't be cached. Note that this requires a
+/// seekable stream.
+bool CacheHeaderTokens(Preprocessor &PP, FileID FID, const char *Name,
+                       llvm::raw_fd_ostream *OS);
+
+/// AttachHeaderTokenCacheWriter - Write the guarded headers that are missing
+/// from the preprocessor's HeaderTokenCache to the cache once they have been
+/// preprocessed.
+void AttachHeaderTokenCacheWriter(Preprocessor &PP);
+
 /// createInvocationFromCommandLine - Construct a compiler invocation object for
 /// a command line argument vector.
 ///
@@ -0,0 +1,71 @@
+//===--- DependencyDirectivesMinimizer.h - Directive-only sources -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the minimizer used by -fminimize-dependency-scan, which
+/// reduces source files to the preprocessor directives that determine their
+/// dependencies.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_DEPENDENCYDIRECTIVESMINIMIZER_H
+#define LLVM_CLANG_LEX_DEPENDENCYDIRECTIVESMINIMIZER_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/Support/FileSystem.h"
+#include <map>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+class FileEntry;
+
+/// \brief Append to \p Output the preprocessor directives of \p Input, one
+/// logical line each, with comments removed and everything else dropped.
+///
+/// Preprocessing the result finds the same #includes as preprocessing
+/// \p Input, as long as no directive is produced by macro expansion or
+/// _Pragma. Line numbers are not preserved.
+void minimizeSourceToDependencyDirectives(StringRef Input,
+                                          SmallVectorImpl<char> &Output);
+
+/// \brief The minimized contents of the files seen by one or more
+/// preprocessors, so that a header included by many translation units is only
+/// minimized once.
+class MinimizedSourceCache : public RefCountedBase<MinimizedSourceCache> {
+  struct Entry {
+    time_t ModTime;
+    off_t Size;
+    llvm::MemoryBuffer *Buffer;
+
+    Entry() : ModTime(0), Size(0), Buffer(0) {}
+  };
+
+  std::map<llvm::sys::fs::UniqueID, Entry> Entries;
+
+public:
+  ~MinimizedSourceCache();
+
+  /// \brief Returns the minimized contents of \p File, or null if they
+  /// haven't been computed or \p File has changed since.
+  const llvm::MemoryBuffer *lookup(const FileEntry *File) const;
+
+  /// \brief Minimizes \p Contents, the contents of \p File, and caches the
+  /// result. The cache owns the returned buffer.
+  const llvm::MemoryBuffer *insert(const FileEntry *File,
+                                   const llvm::MemoryBuffer *Contents);
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,100 @@
+//===--- HeaderTokenCache.h - Content-addressed header tokens ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the HeaderTokenCache class, used by -fheader-token-cache.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+#define LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+class LangOptions;
+class PTHLexer;
+class PTHManager;
+class Preprocessor;
+
+/// \brief A directory of PTH files, each holding the tokens of one header,
+/// that is shared by all of the compilations of a build.
+///
+/// Each file is named after a hash of the contents of the header, the
+/// language options and the compiler version, so a header is lexed from
+/// source once no matter how many translation units include it or where it
+/// is found. The cached tokens are the raw tokens of the file, which don't
+/// depend on the macros defined where it is included; the preprocessor
+/// still expands macros and evaluates the directives in them.
+///
+/// The preprocessor asks the cache for every file it enters except the main
+/// file. A header that isn't cached is lexed from source, and written to the
+/// cache by the client when its end is reached if the multiple-include
+/// optimization found it to be guarded, since those are the headers that are
+/// included by many translation units and seldom edited.
+class HeaderTokenCache {
+  /// \brief The directory holding the cache files.
+  std::string Directory;
+
+  /// \brief The hash of the language options and the compiler version that
+  /// is part of every key.
+  std::string ConfigurationHash;
+
+  /// \brief The cache files opened so far, which must live as long as the
+  /// tokens read from them.
+  std::vector<PTHManager *> Managers;
+
+  /// \brief The keys of the files that were entered but not found in the
+  /// cache.
+  llvm::DenseMap<FileID, std::string> Missed;
+
+  unsigned NumHits, NumMisses, NumWritten;
+
+  HeaderTokenCache(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  HeaderTokenCache(StringRef Directory, const LangOptions &LangOpts);
+  ~HeaderTokenCache();
+
+  StringRef getDirectory() const { return Directory; }
+
+  /// \brief Returns the key of a header with the given contents.
+  std::string getKey(const llvm::MemoryBuffer *Contents) const;
+
+  /// \brief Returns the path of the cache file for \p Key.
+  std::string getPath(StringRef Key) const;
+
+  /// \brief Returns a lexer for the cached tokens of \p FID, whose contents
+  /// are \p Contents, or null if they aren't cached.
+  PTHLexer *createLexer(Preprocessor &PP, FileID FID,
+                        const llvm::MemoryBuffer *Contents);
+
+  /// \brief If \p FID was not found in the cache, returns its key and
+  /// forgets about it; otherwise returns an empty string.
+  std::string takeMissedKey(FileID FID);
+
+  /// \brief Notes that the tokens of a header were written to the cache.
+  void noteWritten() { ++NumWritten; }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -66,6 +66,10 @@ class PTHManager : public IdentifierInfoLookup {
   ///  PTHLexer objects.
   Preprocessor* PP;
 
+  /// IdentTable - If non-null, the table in which identifiers are resolved
+  ///  instead of being allocated by the PTHManager.
+  IdentifierTable* IdentTable;
+
   /// SpellingBase - The base offset within the PTH memory buffer that
   ///  contains the cached spellings for literals.
   const unsigned char* const SpellingBase;
@@ -98,6 +102,10 @@ class PTHManager : public IdentifierInfoLookup {
   }
   IdentifierInfo* LazilyCreateIdentifierInfo(unsigned PersistentID);
 
+  /// CreateLexer - Return a PTHLexer for the tokens of FID at the given
+  ///  offsets within the PTH file.
+  PTHLexer *CreateLexer(FileID FID, uint32_t TokenOff, uint32_t PPCondOff);
+
 public:
   // The current PTH version.
   enum { Version = 10 };
@@ -122,11 +130,21 @@ public:
 
   void setPreprocessor(Preprocessor *pp) { PP = pp; }
 
+  /// setIdentifierTable - Resolve the identifiers of the PTH file in the
+  ///  given table, so that cached tokens can be mixed with tokens lexed from
+  ///  source.  This must be called before any token is read.
+  void setIdentifierTable(IdentifierTable *Table) { IdentTable = Table; }
+
   /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens for the
   ///  specified file.  This method returns NULL if no cached tokens exist.
   ///  It is the responsibility of the caller to 'delete' the returned object.
   PTHLexer *CreateLexer(FileID FID);
 
+  /// CreateLexer - Return a PTHLexer for the tokens cached under the name
+  ///  \p Name rather than under the name of the file of FID, or NULL if
+  ///  there are none.
+  PTHLexer *CreateLexer(FileID FID, const char *Name);
+
   /// createStatCache - Returns a FileSystemStatCache object for use with
   ///  FileManager objects.  These objects use the PTH data to speed up
   ///  calls to stat by memoizing their results from when the PTH file
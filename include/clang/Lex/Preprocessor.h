@@ -45,6 +45,7 @@ class ExternalPreprocessorSource;
 class FileManager;
 class FileEntry;
 class HeaderSearch;
+class HeaderTokenCache;
 class PragmaNamespace;
 class PragmaHandler;
 class CommentHandler;
@@ -102,6 +103,10 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   ///  a token cache rather than lexing the original source file.
   OwningPtr<PTHManager> PTH;
 
+  /// \brief An optional cache of the tokens of headers, consulted for each
+  /// file that is entered (-fheader-token-cache).
+  OwningPtr<HeaderTokenCache> HeaderTokens;
+
   /// BP - A BumpPtrAllocator object used to quickly allocate and release
   ///  objects internal to the Preprocessor.
   llvm::BumpPtrAllocator BP;
@@ -453,6 +458,12 @@ public:
 
   PTHManager *getPTHManager() { return PTH.get(); }
 
+  /// \brief Use \p Cache for the tokens of the headers entered from now on.
+  /// The preprocessor takes ownership of it.
+  void setHeaderTokenCache(HeaderTokenCache *Cache);
+
+  HeaderTokenCache *getHeaderTokenCache() { return HeaderTokens.get(); }
+
   void setExternalSource(ExternalPreprocessorSource *Source) {
     ExternalSource = Source;
   }
@@ -11,10 +11,12 @@
 #define LLVM_CLANG_LEX_PREPROCESSOROPTIONS_H_
 
 #include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/DependencyDirectivesMinimizer.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Mutex.h"
 #include <cassert>
 #include <set>
 #include <string>
@@ -58,6 +60,13 @@ public:
   /// The implicit PCH included at the start of the translation unit, or empty.
   std::string ImplicitPCHInclude;
 
+  /// \brief If non-null, the contents of the implicit PCH include, which is
+  /// then read from memory rather than from the file system.
+  ///
+  /// This is used for precompiled preambles that are shared among
+  /// translation units, and isn't owned by the options.
+  const llvm::MemoryBuffer *ImplicitPCHBuffer;
+
   /// \brief Headers that will be converted to chained PCHs in memory.
   std::vector<std::string> ChainedIncludes;
 
@@ -71,6 +80,14 @@ public:
   /// \brief Dump declarations that are deserialized from PCH, for testing.
   bool DumpDeserializedPCHDecls;
 
+  /// \brief Whether the redeclarations of a declaration from a PCH are only
+  /// read when they are needed, rather than with the declaration.
+  bool LazyPCHRedeclChains;
+
+  /// \brief If given, the file that records which parts of the PCH files are
+  /// read, so that later compilations can read them ahead of time.
+  std::string PCHAccessProfile;
+
   /// \brief This is a set of names for decls that we do not want to be
   /// deserialized, and we emit an error if they are; for testing purposes.
   std::set<std::string> DeserializedPCHDeclsToErrorOn;
@@ -81,6 +98,13 @@ public:
   /// The boolean indicates whether the preamble ends at the start of a new
   /// line.
   std::pair<unsigned, bool> PrecompiledPreambleBytes;
+
+  /// \brief If non-empty, the main file of the translation unit, which the
+  /// main file of the precompiled preamble is mapped onto.
+  ///
+  /// A shared preamble may have been built for another main file that starts
+  /// with the same text.
+  std::string PrecompiledPreambleMainFile;
   
   /// The implicit PTH input included at the start of the translation unit, or
   /// empty.
@@ -89,6 +113,22 @@ public:
   /// If given, a PTH cache file to use for speeding up header parsing.
   std::string TokenCache;
 
+  /// \brief If given, the directory of the HeaderTokenCache, which holds the
+  /// tokens of headers shared by all the compilations of a build.
+  std::string HeaderTokenCachePath;
+
+  /// \brief Whether to preprocess only the directives of each file, which is
+  /// enough to find its dependencies (-fminimize-dependency-scan).
+  bool MinimizeSourceToDependencyDirectives;
+
+  /// \brief The minimized contents of the files seen so far, if
+  /// MinimizeSourceToDependencyDirectives.
+  ///
+  /// This pointer can be shared among the compiler instances of a tool that
+  /// scans many translation units, so that each header is only minimized
+  /// once.
+  IntrusiveRefCntPtr<MinimizedSourceCache> MinimizedSources;
+
   /// \brief True if the SourceManager should report the original file name for
   /// contents of files that were remapped to other files. Defaults to true.
   bool RemappedFilesKeepOriginalName;
@@ -119,15 +159,22 @@ public:
   ObjCXXARCStandardLibraryKind ObjCXXARCStandardLibrary;
     
   /// \brief Records the set of modules
-  class FailedModulesSet : public RefCountedBase<FailedModulesSet> {
+  ///
+  /// Modules built in parallel by -fmodules-prebuild share one set, so it
+  /// may be used from several threads.
+  class FailedModulesSet
+    : public llvm::ThreadSafeRefCountedBase<FailedModulesSet> {
+    llvm::sys::Mutex Lock;
     llvm::StringSet<> Failed;
 
   public:
     bool hasAlreadyFailed(StringRef module) {
+      llvm::sys::ScopedLock Guard(Lock);
       return Failed.count(module) > 0;
     }
 
     void addFailed(StringRef module) {
+      llvm::sys::ScopedLock Guard(Lock);
       Failed.insert(module);
     }
   };
@@ -176,10 +223,13 @@ public:
   
 public:
   PreprocessorOptions() : UsePredefines(true), DetailedRecord(false),
+                          ImplicitPCHBuffer(0),
                           DisablePCHValidation(false),
                           AllowPCHWithCompilerErrors(false),
                           DumpDeserializedPCHDecls(false),
+                          LazyPCHRedeclChains(false),
                           PrecompiledPreambleBytes(0, true),
+                          MinimizeSourceToDependencyDirectives(false),
                           RemappedFilesKeepOriginalName(true),
                           RetainRemappedFileBuffers(false),
                           ObjCXXARCStandardLibrary(ARCXX_nolib) { }
@@ -220,11 +270,16 @@ public:
     ChainedIncludes.clear();
     DumpDeserializedPCHDecls = false;
     ImplicitPCHInclude.clear();
+    ImplicitPCHBuffer = 0;
+    PCHAccessProfile.clear();
     ImplicitPTHInclude.clear();
     TokenCache.clear();
+    MinimizeSourceToDependencyDirectives = false;
+    MinimizedSources = 0;
     RetainRemappedFileBuffers = true;
     PrecompiledPreambleBytes.first = 0;
     PrecompiledPreambleBytes.second = 0;
+    PrecompiledPreambleMainFile.clear();
   }
 };
 
@@ -1561,6 +1561,19 @@ private:
   /// _Cilk_for (...)
   StmtResult ParsePragmaCilkGrainsize();
 
+  /// \brief Parse the Cilk affinity pragma followed by a Cilk for statement.
+  ///
+  /// #pragma cilk affinity
+  /// _Cilk_for (...)
+  StmtResult ParsePragmaCilkAffinity();
+
+  /// \brief Parse the Cilk priority pragma followed by a statement with a
+  /// Cilk spawn.
+  ///
+  /// #pragma cilk priority(...)
+  /// _Cilk_spawn f(...);
+  StmtResult ParsePragmaCilkPriority();
+
   /// \brief Describes the behavior that should be taken for an __if_exists
   /// block.
   enum IfExistsBehavior {
@@ -124,6 +124,10 @@ public:
   virtual void FindFileRegionDecls(FileID File, unsigned Offset,unsigned Length,
                                    SmallVectorImpl<Decl *> &Decls);
 
+  /// \brief Load the redeclarations of \p D that were left to be loaded
+  /// when they are needed.
+  virtual void CompleteRedeclChain(const Decl *D);
+
   /// \brief Gives the external AST source an opportunity to complete
   /// an incomplete type.
   virtual void CompleteType(TagDecl *Tag);
@@ -191,6 +195,10 @@ public:
                  llvm::DenseMap<const CXXRecordDecl *, CharUnits> &BaseOffsets,
           llvm::DenseMap<const CXXRecordDecl *, CharUnits> &VirtualBaseOffsets);
 
+  /// \brief Determine where the code of the function definition \p FD is
+  /// generated.
+  virtual CodeLocation getCodeLocation(const FunctionDecl *FD);
+
   /// Return the amount of memory used by memory buffers, breaking down
   /// by heap-backed versus mmap'ed memory.
   virtual void getMemoryBufferSizes(MemoryBufferSizes &sizes) const;
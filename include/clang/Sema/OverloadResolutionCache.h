@@ -0,0 +1,106 @@
+//===--- OverloadResolutionCache.h - Cached overload resolution -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the OverloadResolutionCache class, which Sema uses to
+// remember the outcome of overload resolution for calls when
+// -foverload-resolution-cache is enabled.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SEMA_OVERLOADRESOLUTIONCACHE_H
+#define LLVM_CLANG_SEMA_OVERLOADRESOLUTIONCACHE_H
+
+#include "clang/AST/DeclAccessPair.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/FoldingSet.h"
+#include <vector>
+
+namespace clang {
+
+class FunctionDecl;
+
+/// \brief The functions that calls and overloaded operators in a translation
+/// unit resolved to, so that resolving the same call again, e.g. in another
+/// instantiation of a template, doesn't need to deduce template arguments
+/// for, and rank, every candidate again.
+///
+/// A call is keyed on the functions that name lookup found for it, including
+/// those found by argument-dependent lookup, and on the canonical types and
+/// value kinds of its arguments; SemaOverload.cpp decides which calls have a
+/// key. Because argument-dependent lookup is part of the key, declaring
+/// another function in an associated namespace or class changes the key of a
+/// call. Only successful resolutions whose conversions involve complete
+/// classes are cached, since completing a class may add conversions.
+///
+/// Deducing template arguments, or looking for a user-defined conversion, can
+/// look up names that aren't part of the key, e.g. in the return type of a
+/// candidate. An outcome that did so is only used while no declaration has
+/// been made visible in a namespace or a class since it was cached, as told by
+/// ASTContext::getVisibleDeclGeneration().
+class OverloadResolutionCache {
+public:
+  /// \brief The outcome of overload resolution for a call.
+  struct Result {
+    /// \brief The declaration that lookup found for the function.
+    DeclAccessPair FoundDecl;
+
+    /// \brief The function, or the function template specialization, that
+    /// the call resolved to.
+    FunctionDecl *Function;
+
+    /// \brief Whether there was more than one candidate.
+    bool HadMultipleCandidates;
+
+    /// \brief Whether the outcome may change once more declarations are
+    /// visible, since resolving the call looked up names that aren't part of
+    /// its key.
+    bool DependsOnVisibleDecls;
+  };
+
+private:
+  class Entry;
+
+  llvm::FoldingSet<Entry> Entries;
+
+  /// \brief All entries, in the order they were added, to free them.
+  std::vector<Entry *> AllEntries;
+
+  unsigned NumHits, NumMisses, NumStale, NumUncacheable;
+
+  OverloadResolutionCache(const OverloadResolutionCache &)
+    LLVM_DELETED_FUNCTION;
+  void operator=(const OverloadResolutionCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  OverloadResolutionCache();
+  ~OverloadResolutionCache();
+
+  /// \brief Find the outcome of overload resolution for the call with the
+  /// key \p Key, when the visible declaration generation is \p Generation.
+  ///
+  /// \returns false if the call hasn't been cached, or if its outcome
+  /// depends on declarations that have been made visible since.
+  bool lookup(const llvm::FoldingSetNodeID &Key, unsigned Generation,
+              Result &R);
+
+  /// \brief Cache the outcome of overload resolution for the call with the
+  /// key \p Key, reached when the visible declaration generation was
+  /// \p Generation, replacing an outcome that is out of date.
+  void insert(const llvm::FoldingSetNodeID &Key, unsigned Generation,
+              const Result &R);
+
+  /// \brief Note a call that couldn't be given a key.
+  void noteUncacheableCall() { ++NumUncacheable; }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -105,6 +105,7 @@ namespace clang {
   class Expr;
   class ExtVectorType;
   class ExternalSemaSource;
+  class ForStmt;
   class FormatAttr;
   class FriendDecl;
   class FunctionDecl;
@@ -142,6 +143,7 @@ namespace clang {
   class OMPClause;
   class OverloadCandidateSet;
   class OverloadExpr;
+  class OverloadResolutionCache;
   class ParenListExpr;
   class ParmVarDecl;
   class Preprocessor;
@@ -315,6 +317,10 @@ public:
   /// FieldCollector - Collects CXXFieldDecls during parsing of C++ classes.
   OwningPtr<CXXFieldCollector> FieldCollector;
 
+  /// \brief The outcomes of overload resolution for calls, if
+  /// -foverload-resolution-cache is enabled.
+  OwningPtr<OverloadResolutionCache> OverloadCache;
+
   typedef llvm::SmallSetVector<const NamedDecl*, 16> NamedDeclSetType;
 
   /// \brief Set containing all declared private fields that are not used.
@@ -493,6 +499,7 @@ public:
     {
       assert(ContextToPush && "pushing null context");
       S.CurContext = ContextToPush;
+      S.suspendFunctionBodyArena();
     }
 
     void pop() {
@@ -500,6 +507,7 @@ public:
       S.CurContext = SavedContext;
       S.DelayedDiagnostics.popUndelayed(SavedContextState);
       S.CXXThisTypeOverride = SavedCXXThisTypeOverride;
+      S.resumeFunctionBodyArena();
       SavedContext = 0;
     }
 
@@ -782,6 +790,10 @@ public:
   /// \brief The number of SFINAE diagnostics that have been trapped.
   unsigned NumSFINAEErrors;
 
+  /// \brief The number of access checks whose result depended on the
+  /// context they were performed in.
+  unsigned NumContextDependentAccessChecks;
+
   typedef llvm::DenseMap<ParmVarDecl *, SmallVector<ParmVarDecl *, 1> >
     UnparsedDefaultArgInstantiationsMap;
 
@@ -1605,6 +1617,12 @@ public:
   /// \c constexpr in C++11 or has an 'auto' return type in C++14).
   bool canSkipFunctionBody(Decl *D);
 
+  /// \brief Allocate statements in the ASTContext's own allocator, rather
+  /// than in the arena of the function body being parsed, until
+  /// resumeFunctionBodyArena() is called (-ffree-function-bodies).
+  void suspendFunctionBodyArena();
+  void resumeFunctionBodyArena();
+
   void computeNRVO(Stmt *Body, sema::FunctionScopeInfo *Scope);
   Decl *ActOnFinishFunctionBody(Decl *Decl, Stmt *Body);
   Decl *ActOnFinishFunctionBody(Decl *Decl, Stmt *Body, bool IsInstantiation);
@@ -3047,6 +3065,13 @@ public:
   StmtResult ActOnCilkForGrainsizePragma(Expr *GrainsizeExpr,
                                          Stmt *CilkFor,
                                          SourceLocation LocStart);
+  StmtResult ActOnCilkForAffinityPragma(Stmt *CilkFor,
+                                        SourceLocation LocStart);
+  StmtResult ActOnCilkSpawnPriorityPragma(Expr *PriorityExpr, Stmt *Spawn,
+                                          SourceLocation LocStart);
+  bool SetCilkSpawnPriority(CilkSpawnDecl *Spawn, Expr *PriorityExpr);
+  bool SubstCilkSpawnPriority(CilkSpawnDecl *Pattern, CilkSpawnDecl *Spawn,
+                              ExprResult Priority);
 
   bool CheckIfBodyModifiesLoopControlVar(Stmt *Body);
   StmtResult ActOnCilkForStmt(SourceLocation CilkForLoc,
@@ -3072,6 +3097,8 @@ public:
                                        Expr *Increment, Expr *StrideExpr,
                                        int Dir, BinaryOperatorKind Opcode);
 
+  void ActOnCilkSpawnLoop(ForStmt *S);
+
   StmtResult ActOnGCCAsmStmt(SourceLocation AsmLoc, bool IsSimple,
                              bool IsVolatile, unsigned NumOutputs,
                              unsigned NumInputs, IdentifierInfo **Names,
@@ -206,6 +206,7 @@ private:
 
 namespace serialization {
 
+class ASTPrefetcher;
 class ReadMethodPoolVisitor;
 
 namespace reader {
@@ -615,6 +616,14 @@ private:
   /// consumer eagerly.
   SmallVector<uint64_t, 16> ExternalDefinitions;
 
+  /// \brief The template instantiations whose code is generated in the
+  /// object file compiled from an AST file built with -fpch-codegen, mapped
+  /// to whether that AST file is the one being compiled.
+  ///
+  /// This contains the data loaded from all PCH_CODEGEN_DECLS blocks in the
+  /// chain.
+  llvm::DenseMap<serialization::DeclID, bool> PCHCodegenDecls;
+
   /// \brief The IDs of all tentative definitions stored in the chain.
   ///
   /// Sema keeps track of all tentative definitions in a TU because it has to
@@ -860,6 +869,30 @@ private:
   /// \brief Keeps track of the elements added to PendingDeclChains.
   llvm::SmallSet<serialization::DeclID, 16> PendingDeclChainsKnown;
 
+  /// \brief Whether a redeclaration chain of which only the first
+  /// declaration has been deserialized is left to be loaded when it is
+  /// needed, rather than with the pending actions (-fpch-lazy-redecl-chains).
+  bool LazyRedeclChains;
+
+  /// \brief The elements of PendingDeclChains that can't be left to be
+  /// loaded later, because a declaration other than the first one has been
+  /// deserialized, or because the chain was asked for while a declaration
+  /// was being read.
+  llvm::SmallSet<serialization::DeclID, 16> PendingDeclChainsNeeded;
+
+  /// \brief The number of redeclaration chains that were left to be loaded
+  /// when they are needed, and the number of those that were loaded.
+  unsigned NumLazyRedeclChains, NumLazyRedeclChainsLoaded;
+
+  /// \brief The access profile that records which parts of the AST files
+  /// this translation unit reads, for later compilations to prefetch, or
+  /// empty (-fpch-access-profile).
+  std::string AccessProfilePath;
+
+  /// \brief Reads the parts of the AST files that the access profile lists
+  /// on a background thread, ahead of the reader.
+  OwningPtr<serialization::ASTPrefetcher> Prefetcher;
+
   /// \brief The Decl IDs for the Sema/Lexical DeclContext of a Decl that has
   /// been loaded but its DeclContext was not set yet.
   struct PendingDeclContextInfo {
@@ -997,6 +1030,7 @@ private:
                             SmallVectorImpl<ImportedModule> &Loaded,
                             off_t ExpectedSize, time_t ExpectedModTime,
                             unsigned ClientLoadCapabilities);
+  void startPrefetching(SmallVectorImpl<ImportedModule> &Loaded);
   ASTReadResult ReadControlBlock(ModuleFile &F,
                                  SmallVectorImpl<ImportedModule> &Loaded,
                                  unsigned ClientLoadCapabilities);
@@ -1035,6 +1069,7 @@ private:
                                  unsigned &RawLocation);
   void loadDeclUpdateRecords(serialization::DeclID ID, Decl *D);
   void loadPendingDeclChain(serialization::GlobalDeclID ID);
+  bool canDeferDeclChain(serialization::GlobalDeclID ID);
   void loadObjCCategories(serialization::GlobalDeclID ID, ObjCInterfaceDecl *D,
                           unsigned PreviousGeneration = 0);
 
@@ -1186,6 +1221,13 @@ public:
   SourceManager &getSourceManager() const { return SourceMgr; }
   FileManager &getFileManager() const { return FileMgr; }
 
+  /// \brief Stop prefetching the AST files, and write the parts of them that
+  /// this translation unit read to the access profile, if there is one.
+  ///
+  /// This is called when the translation unit is done; later reads are not
+  /// recorded.
+  void finishAccessProfile();
+
   /// \brief Flags that indicate what kind of AST loading failures the client
   /// of the AST reader can directly handle.
   ///
@@ -1555,6 +1597,10 @@ public:
   /// a decl or type. Must be paired with StartedDeserializing.
   virtual void FinishedDeserializing();
 
+  /// \brief Load the redeclarations of \p D that were left to be loaded
+  /// when they are needed.
+  virtual void CompleteRedeclChain(const Decl *D);
+
   /// \brief Function that will be invoked when we begin parsing a new
   /// translation unit involving this external AST source.
   ///
@@ -1562,6 +1608,10 @@ public:
   /// the ASTConsumer.
   virtual void StartTranslationUnit(ASTConsumer *Consumer);
 
+  /// \brief Determine where the code of the function definition \p FD is
+  /// generated.
+  virtual CodeLocation getCodeLocation(const FunctionDecl *FD);
+
   /// \brief Print some statistics about AST usage.
   virtual void PrintStats();
 
@@ -308,6 +308,11 @@ private:
   /// record.
   SmallVector<uint64_t, 16> ExternalDefinitions;
 
+  /// \brief The template instantiations whose code is generated in the
+  /// object file compiled from this PCH, with -fpch-codegen. These are
+  /// written to a PCH_CODEGEN_DECLS record.
+  SmallVector<uint64_t, 16> PCHCodegenDecls;
+
   /// \brief DeclContexts that have received extensions since their serialized
   /// form.
   ///
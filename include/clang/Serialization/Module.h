@@ -18,6 +18,7 @@
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Serialization/ASTBitCodes.h"
 #include "clang/Serialization/ContinuousRangeMap.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Bitcode/BitstreamReader.h"
@@ -153,6 +154,32 @@ public:
   /// \brief The main bitstream cursor for the main block.
   llvm::BitstreamCursor Stream;
 
+  /// \brief The size of the blocks of the file whose reads AccessedBlocks
+  /// records.
+  static const unsigned AccessBlockSize = 4096;
+
+  /// \brief If the AST reader records which parts of this file it reads
+  /// (-fpch-access-profile), a bit for each block of the file that is set
+  /// once the block has been read. Otherwise empty.
+  llvm::BitVector AccessedBlocks;
+
+  /// \brief Note that the AST reader read the data at bit \p BitOffset of
+  /// this file.
+  void noteBitAccess(uint64_t BitOffset) {
+    if (!AccessedBlocks.empty()) {
+      uint64_t Block = BitOffset / (8 * AccessBlockSize);
+      if (Block < AccessedBlocks.size())
+        AccessedBlocks.set(Block);
+    }
+  }
+
+  /// \brief Note that the AST reader read the data at \p Data, which points
+  /// into the buffer of this file.
+  void noteDataAccess(const unsigned char *Data) {
+    if (!AccessedBlocks.empty())
+      noteBitAccess(getBitOffset(Data));
+  }
+
   /// \brief The source location where the module was explicitly or implicitly
   /// imported in the local translation unit.
   ///
@@ -428,6 +455,10 @@ public:
   /// any point during translation.
   bool isDirectlyImported() const { return DirectlyImported; }
 
+  /// \brief Determine the bit offset of \p Data, which points into the buffer
+  /// of this file.
+  uint64_t getBitOffset(const unsigned char *Data) const;
+
   /// \brief Dump debugging output for this module.
   void dump();
 };
@@ -192,6 +192,20 @@ struct TranslationUnitReplacements {
   std::vector<Replacement> Replacements;
 };
 
+/// \brief Interface to create the action that finds the replacements for one
+/// translation unit, for RefactoringTool::runAndSaveInParallel.
+class RefactoringActionFactory {
+public:
+  virtual ~RefactoringActionFactory();
+
+  /// \brief Returns a new action which adds the replacements it finds to
+  /// \p Replace.
+  ///
+  /// This is called on the thread that runs the action, so it must be safe to
+  /// call concurrently. The caller takes ownership of the returned action.
+  virtual ToolAction *create(Replacements &Replace) = 0;
+};
+
 /// \brief A tool to run refactorings.
 ///
 /// This is a refactoring specific version of \see ClangTool. FrontendActions
@@ -213,6 +227,17 @@ public:
   /// \returns 0 upon success. Non-zero upon failure.
   int runAndSave(FrontendActionFactory *ActionFactory);
 
+  /// \brief Like runAndSave(), but processes up to \p NumThreads translation
+  /// units at once; see ClangTool::runInParallel.
+  ///
+  /// Each translation unit collects replacements in a set of its own, and the
+  /// sets are merged into getReplacements() in the order of the compile
+  /// commands.
+  ///
+  /// \returns 0 upon success. Non-zero upon failure.
+  int runAndSaveInParallel(RefactoringActionFactory *ActionFactory,
+                           unsigned NumThreads = 0);
+
   /// \brief Apply all stored replacements to the given Rewriter.
   ///
   /// Replacement applications happen independently of the success of other
@@ -222,6 +247,10 @@ public:
   bool applyAllReplacements(Rewriter &Rewrite);
 
 private:
+  /// \brief Apply all stored replacements, and write the refactored files to
+  /// disk.
+  int applyAndSaveReplacements();
+
   /// \brief Write all refactored files to disk.
   int saveRewrittenFiles(Rewriter &Rewrite);
 
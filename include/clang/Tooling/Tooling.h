@@ -68,6 +68,32 @@ public:
                              DiagnosticConsumer *DiagConsumer) = 0;
 };
 
+/// \brief Interface to create a separate ToolAction for each translation unit
+/// processed by ClangTool::runInParallel.
+///
+/// Since each action only sees one translation unit, it can collect results
+/// without synchronization; finish() then merges them in a deterministic
+/// order.
+class ToolActionFactory {
+public:
+  virtual ~ToolActionFactory();
+
+  /// \brief Returns a new action for one translation unit.
+  ///
+  /// This is called on the thread that runs the action, so it must be safe to
+  /// call concurrently.
+  virtual ToolAction *create() = 0;
+
+  /// \brief Takes back an action returned by create() after it ran.
+  ///
+  /// This is called on the thread that called runInParallel, once all
+  /// translation units have been processed, in the order of the compile
+  /// commands. The default implementation deletes \p Action.
+  ///
+  /// \param Succeeded Whether the action ran successfully.
+  virtual void finish(ToolAction *Action, bool Succeeded);
+};
+
 /// \brief Interface to generate clang::FrontendActions.
 ///
 /// Having a factory interface allows, for example, a new FrontendAction to be
@@ -280,6 +306,29 @@ class ClangTool {
   /// \param Action Tool action.
   int run(ToolAction *Action);
 
+  /// \brief Runs an action over all files specified in the command line,
+  /// processing up to \p NumThreads translation units at once.
+  ///
+  /// Rather than changing the current directory for each compile command,
+  /// this resolves the relative paths of a translation unit against the
+  /// directory of its compile command, and gives each translation unit its
+  /// own FileManager instead of the one returned by getFiles(). The
+  /// diagnostics of each translation unit are printed in one piece, in the
+  /// order of the compile commands; a DiagnosticConsumer set with
+  /// setDiagnosticConsumer() is called by one thread at a time, but may see
+  /// the diagnostics of different translation units interleaved.
+  ///
+  /// \param Factory Creates the action for each translation unit.
+  /// \param NumThreads The number of threads to use, or zero to use one per
+  /// hardware thread.
+  int runInParallel(ToolActionFactory *Factory, unsigned NumThreads = 0);
+
+  /// \brief Like runInParallel(ToolActionFactory*, unsigned), but runs the
+  /// same action on every translation unit, which must therefore be safe to
+  /// call concurrently. A FrontendActionFactory whose create() returns a new
+  /// action each time usually is.
+  int runInParallel(ToolAction *Action, unsigned NumThreads = 0);
+
   /// \brief Create an AST for each file specified in the command line and
   /// append them to ASTs.
   int buildASTs(std::vector<ASTUnit *> &ASTs);
@@ -13,6 +13,8 @@
 
 #include "clang/AST/ASTContext.h"
 #include "CXXABI.h"
+#include "ConstexprCallCache.h"
+#include "ConstexprInterpreter.h"
 #include "clang/AST/ASTMutationListener.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/CharUnits.h"
@@ -32,6 +34,7 @@
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
@@ -730,8 +733,11 @@ ASTContext::ASTContext(LangOptions& LOpts, SourceManager &SM,
     BlockDescriptorType(0), BlockDescriptorExtendedType(0),
     cudaConfigureCallDecl(0),
     NullTypeSourceInfo(QualType()), 
-    FirstLocalImport(), LastLocalImport(),
+    FirstLocalImport(), LastLocalImport(), VisibleDeclGeneration(0),
     SourceMgr(SM), LangOpts(LOpts), 
+    FunctionBodyArena(0), FunctionBodyArenaOwner(0),
+    FunctionBodyArenaSuspensions(0), NumFreedFunctionBodies(0),
+    NumFreedFunctionBodyBytes(0),
     AddrSpaceMap(0), Target(t), PrintingPolicy(LOpts),
     Idents(idents), Selectors(sels),
     BuiltinInfo(builtins),
@@ -787,6 +793,58 @@ ASTContext::~ASTContext() {
            E = MangleNumberingContexts.end();
        I != E; ++I)
     delete I->second;
+
+  for (llvm::DenseMap<const FunctionDecl *, llvm::BumpPtrAllocator *>::iterator
+           I = FreeableFunctionBodies.begin(),
+           E = FreeableFunctionBodies.end();
+       I != E; ++I)
+    delete I->second;
+  llvm::DeleteContainerPointers(KeptFunctionBodyArenas);
+  delete FunctionBodyArena;
+}
+
+bool ASTContext::startFunctionBodyArena(const FunctionDecl *FD) {
+  if (FunctionBodyArena || FunctionBodyArenaSuspensions)
+    return false;
+  FunctionBodyArena = new llvm::BumpPtrAllocator();
+  FunctionBodyArenaOwner = FD;
+  return true;
+}
+
+void ASTContext::finishFunctionBodyArena(const FunctionDecl *FD,
+                                         bool CanFree) {
+  assert(FD == FunctionBodyArenaOwner && "finishing the wrong body");
+  assert(!FunctionBodyArenaSuspensions && "arena still suspended");
+  if (CanFree)
+    FreeableFunctionBodies[FD] = FunctionBodyArena;
+  else
+    KeptFunctionBodyArenas.push_back(FunctionBodyArena);
+  FunctionBodyArena = 0;
+  FunctionBodyArenaOwner = 0;
+}
+
+void ASTContext::freeFunctionBody(const FunctionDecl *FD) {
+  const FunctionDecl *Definition;
+  if (!FD->isDefined(Definition))
+    return;
+  llvm::DenseMap<const FunctionDecl *, llvm::BumpPtrAllocator *>::iterator
+    Pos = FreeableFunctionBodies.find(Definition);
+  if (Pos == FreeableFunctionBodies.end())
+    return;
+
+  // Leave a body behind, so that the function is still a definition, in the
+  // ASTContext's own allocator.
+  Stmt *Body = Definition->getBody();
+  void *Mem = BumpAlloc.Allocate(sizeof(CompoundStmt),
+                                 llvm::alignOf<CompoundStmt>());
+  const_cast<FunctionDecl *>(Definition)->setBody(
+      new (Mem) CompoundStmt(*this, ArrayRef<Stmt *>(), Body->getLocStart(),
+                             Body->getLocEnd()));
+
+  ++NumFreedFunctionBodies;
+  NumFreedFunctionBodyBytes += Pos->second->getTotalMemory();
+  delete Pos->second;
+  FreeableFunctionBodies.erase(Pos);
 }
 
 void ASTContext::AddDeallocation(void (*Callback)(void*), void *Data) {
@@ -854,9 +912,41 @@ void ASTContext::PrintStats() const {
     ExternalSource->PrintStats();
   }
 
+  if (ConstexprInterp.get()) {
+    llvm::errs() << "\n";
+    ConstexprInterp->PrintStats();
+  }
+
+  if (ConstexprCalls.get()) {
+    llvm::errs() << "\n";
+    ConstexprCalls->PrintStats();
+  }
+
+  if (LangOpts.FreeFunctionBodies) {
+    llvm::errs() << "\n*** Function Body Arena Stats:\n";
+    llvm::errs() << "  " << NumFreedFunctionBodies << " bodies freed, "
+                 << NumFreedFunctionBodyBytes << " bytes.\n";
+    llvm::errs() << "  " << FreeableFunctionBodies.size()
+                 << " bodies not emitted, " << KeptFunctionBodyArenas.size()
+                 << " bodies kept.\n";
+  }
+
   BumpAlloc.PrintStats();
 }
 
+ConstexprInterpreter &ASTContext::getConstexprInterpreter() const {
+  if (!ConstexprInterp.get())
+    ConstexprInterp.reset(
+        new ConstexprInterpreter(const_cast<ASTContext &>(*this)));
+  return *ConstexprInterp;
+}
+
+ConstexprCallCache &ASTContext::getConstexprCallCache() const {
+  if (!ConstexprCalls.get())
+    ConstexprCalls.reset(new ConstexprCallCache());
+  return *ConstexprCalls;
+}
+
 TypedefDecl *ASTContext::getInt128Decl() const {
   if (!Int128Decl) {
     TypeSourceInfo *TInfo = getTrivialTypeSourceInfo(Int128Ty);
@@ -7875,6 +7965,21 @@ GVALinkage ASTContext::GetGVALinkageForFunction(const FunctionDecl *FD) {
     break;
   }
 
+  // The code of an instantiation performed in a PCH built with -fpch-codegen
+  // is generated once, in the object file compiled from that PCH. Treat it
+  // like an explicit instantiation definition there, and like an explicit
+  // instantiation declaration everywhere else.
+  if (External == GVA_TemplateInstantiation && ExternalSource) {
+    switch (ExternalSource->getCodeLocation(FD)) {
+    case ExternalASTSource::CL_Default:
+      break;
+    case ExternalASTSource::CL_ThisObject:
+      return GVA_ExplicitTemplateInstantiation;
+    case ExternalASTSource::CL_OtherObject:
+      return GVA_C99Inline;
+    }
+  }
+
   if (!FD->isInlined())
     return External;
 
@@ -1237,6 +1237,10 @@ void ASTDumper::VisitFriendDecl(const FriendDecl *D) {
 }
 
 void ASTDumper::VisitCilkSpawnDecl(const CilkSpawnDecl *D) {
+  if (D->getPriority())
+    OS << " priority " << D->getPriority();
+  if (Expr *Priority = D->getDependentPriority())
+    dumpStmt(Priority);
   lastChild();
   dumpStmt(D->getCapturedStmt());
 }
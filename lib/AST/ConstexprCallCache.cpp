@@ -0,0 +1,148 @@
+//===--- ConstexprCallCache.cpp - Memoized constexpr calls ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache of the results of constexpr function calls.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ConstexprCallCache.h"
+#include "clang/AST/APValue.h"
+#include "clang/AST/Decl.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+/// A memoized call.
+class ConstexprCallCache::Entry : public llvm::FoldingSetNode {
+public:
+  const FunctionDecl *FD;
+  SmallVector<APValue, 4> Args;
+  APValue Result;
+  unsigned Steps;
+  unsigned Depth;
+
+  Entry(const FunctionDecl *FD, ArrayRef<APValue> Args, const APValue &Result,
+        unsigned Steps, unsigned Depth)
+    : FD(FD), Args(Args.begin(), Args.end()), Result(Result), Steps(Steps),
+      Depth(Depth) {}
+
+  static void Profile(llvm::FoldingSetNodeID &ID, const FunctionDecl *FD,
+                      ArrayRef<APValue> Args) {
+    ID.AddPointer(FD);
+    for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+      const APValue &Arg = Args[I];
+      ID.AddInteger(Arg.getKind());
+      if (Arg.isInt()) {
+        Arg.getInt().Profile(ID);
+      } else {
+        // Values of different types may have the same representation.
+        ID.AddPointer(&Arg.getFloat().getSemantics());
+        Arg.getFloat().Profile(ID);
+      }
+    }
+  }
+
+  void Profile(llvm::FoldingSetNodeID &ID) const { Profile(ID, FD, Args); }
+};
+
+ConstexprCallCache::ConstexprCallCache() : NumHits(0), NumMisses(0) {}
+
+ConstexprCallCache::~ConstexprCallCache() {
+  llvm::DeleteContainerPointers(AllEntries);
+}
+
+bool ConstexprCallCache::canMemoizeArgs(ArrayRef<APValue> Args) {
+  // An argument that refers to an object would let the call depend on, or
+  // modify, the value of that object.
+  for (unsigned I = 0, N = Args.size(); I != N; ++I)
+    if (!Args[I].isInt() && !Args[I].isFloat())
+      return false;
+  return true;
+}
+
+bool ConstexprCallCache::canMemoizeResult(const APValue &Value) {
+  switch (Value.getKind()) {
+  case APValue::Uninitialized:
+  case APValue::Int:
+  case APValue::Float:
+  case APValue::ComplexInt:
+  case APValue::ComplexFloat:
+    return true;
+
+  case APValue::Vector:
+    for (unsigned I = 0, N = Value.getVectorLength(); I != N; ++I)
+      if (!canMemoizeResult(Value.getVectorElt(I)))
+        return false;
+    return true;
+
+  case APValue::Array:
+    for (unsigned I = 0, N = Value.getArrayInitializedElts(); I != N; ++I)
+      if (!canMemoizeResult(Value.getArrayInitializedElt(I)))
+        return false;
+    return !Value.hasArrayFiller() || canMemoizeResult(Value.getArrayFiller());
+
+  case APValue::Struct:
+    for (unsigned I = 0, N = Value.getStructNumBases(); I != N; ++I)
+      if (!canMemoizeResult(Value.getStructBase(I)))
+        return false;
+    for (unsigned I = 0, N = Value.getStructNumFields(); I != N; ++I)
+      if (!canMemoizeResult(Value.getStructField(I)))
+        return false;
+    return true;
+
+  case APValue::Union:
+    return canMemoizeResult(Value.getUnionValue());
+
+  // Addresses may refer to temporaries of the evaluation that produced them.
+  case APValue::LValue:
+  case APValue::MemberPointer:
+  case APValue::AddrLabelDiff:
+    return false;
+  }
+  llvm_unreachable("unknown APValue kind");
+}
+
+bool ConstexprCallCache::lookup(const FunctionDecl *FD, ArrayRef<APValue> Args,
+                                unsigned MaxDepth, unsigned &StepsLeft,
+                                unsigned &Depth, APValue &Result) {
+  llvm::FoldingSetNodeID ID;
+  Entry::Profile(ID, FD, Args);
+  void *InsertPos;
+  const Entry *E = Entries.FindNodeOrInsertPos(ID, InsertPos);
+  // Evaluate the call again if it would exceed a limit, to diagnose that.
+  if (!E || E->Steps > StepsLeft || E->Depth > MaxDepth) {
+    ++NumMisses;
+    return false;
+  }
+  ++NumHits;
+  StepsLeft -= E->Steps;
+  Depth = E->Depth;
+  Result = E->Result;
+  return true;
+}
+
+void ConstexprCallCache::insert(const FunctionDecl *FD, ArrayRef<APValue> Args,
+                                const APValue &Result, unsigned Steps,
+                                unsigned Depth) {
+  llvm::FoldingSetNodeID ID;
+  Entry::Profile(ID, FD, Args);
+  void *InsertPos;
+  if (Entries.FindNodeOrInsertPos(ID, InsertPos))
+    return;
+  Entry *E = new Entry(FD, Args, Result, Steps, Depth);
+  Entries.InsertNode(E, InsertPos);
+  AllEntries.push_back(E);
+}
+
+void ConstexprCallCache::PrintStats() const {
+  llvm::errs() << "*** Constexpr Call Cache Stats:\n";
+  llvm::errs() << "  " << AllEntries.size() << " calls memoized.\n";
+  llvm::errs() << "  " << NumHits << " hits, " << NumMisses << " misses.\n";
+}
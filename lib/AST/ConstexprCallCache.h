@@ -0,0 +1,85 @@
+//===--- ConstexprCallCache.h - Memoized constexpr calls --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This provides the cache of the results of constexpr function calls used by
+// the constant evaluator.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+#define LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/FoldingSet.h"
+#include <vector>
+
+namespace clang {
+
+class APValue;
+class FunctionDecl;
+
+/// \brief The results of the calls to constexpr functions that have been
+/// evaluated in an ASTContext, keyed on the function and its arguments.
+///
+/// Only calls whose arguments are integers or floating-point values, and
+/// whose evaluation didn't depend on anything but those arguments, are
+/// memoized; ExprConstant.cpp decides which those are. Along with each
+/// result, the cache records the number of steps and nested calls that
+/// evaluating the call took, so that a memoized call still counts against
+/// -fconstexpr-steps and -fconstexpr-depth.
+class ConstexprCallCache {
+  class Entry;
+
+  llvm::FoldingSet<Entry> Entries;
+
+  /// \brief All entries, in the order they were added, to free them.
+  std::vector<Entry *> AllEntries;
+
+  unsigned NumHits, NumMisses;
+
+  ConstexprCallCache(const ConstexprCallCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConstexprCallCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  ConstexprCallCache();
+  ~ConstexprCallCache();
+
+  /// \brief Whether a call with the arguments \p Args can be memoized.
+  static bool canMemoizeArgs(ArrayRef<APValue> Args);
+
+  /// \brief Whether \p Value, the result of a call, can be memoized.
+  static bool canMemoizeResult(const APValue &Value);
+
+  /// \brief Find the result of a call to the constexpr function definition
+  /// \p FD.
+  ///
+  /// \param MaxDepth The number of nested calls, including this one, that
+  /// may be active at once.
+  /// \param StepsLeft The number of statements that may be evaluated;
+  /// decremented by the number the call took.
+  /// \param Depth Set to the number of nested calls, including this one,
+  /// that the call took.
+  ///
+  /// \returns false, without changing \p StepsLeft or \p Result, if the call
+  /// hasn't been memoized, or would exceed a limit.
+  bool lookup(const FunctionDecl *FD, ArrayRef<APValue> Args,
+              unsigned MaxDepth, unsigned &StepsLeft, unsigned &Depth,
+              APValue &Result);
+
+  /// \brief Memoize the result of a call to \p FD, which took \p Steps
+  /// statements and \p Depth nested calls to evaluate.
+  void insert(const FunctionDecl *FD, ArrayRef<APValue> Args,
+              const APValue &Result, unsigned Steps, unsigned Depth);
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,1160 @@
+//===--- ConstexprInterpreter.cpp - Bytecode for constexpr calls ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the compiler from constexpr function bodies to
+// bytecode, and the register machine running it.
+//
+// Every integer is held in a 64-bit register, sign-extended from the width
+// of its type if the type is signed and zero-extended otherwise, so that
+// comparisons and bitwise operations don't need to know the type. Operations
+// that can overflow or truncate carry the type they are performed in.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ConstexprInterpreter.h"
+#include "clang/AST/APValue.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace clang;
+
+namespace {
+/// The instructions of the bytecode. The operands following each opcode are
+/// registers, types (see encodeType), or code offsets.
+enum Opcode {
+  OP_Step,          // Count a statement against the step limit.
+  OP_Const,         // Dst, ConstantIndex
+  OP_Move,          // Dst, Src
+  OP_Add,           // Dst, LHS, RHS, Type
+  OP_Sub,           // Dst, LHS, RHS, Type
+  OP_Mul,           // Dst, LHS, RHS, Type
+  OP_Div,           // Dst, LHS, RHS, Type
+  OP_Rem,           // Dst, LHS, RHS, Type
+  OP_And,           // Dst, LHS, RHS
+  OP_Or,            // Dst, LHS, RHS
+  OP_Xor,           // Dst, LHS, RHS
+  OP_Shl,           // Dst, LHS, RHS, LHSType, RHSType
+  OP_Shr,           // Dst, LHS, RHS, LHSType, RHSType
+  OP_EQ,            // Dst, LHS, RHS
+  OP_NE,            // Dst, LHS, RHS
+  OP_LT,            // Dst, LHS, RHS, Type
+  OP_LE,            // Dst, LHS, RHS, Type
+  OP_Neg,           // Dst, Src, Type
+  OP_Not,           // Dst, Src, Type
+  OP_Convert,       // Dst, Src, Type
+  OP_LNot,          // Dst, Src
+  OP_ToBool,        // Dst, Src
+  OP_Inc,           // Reg, Type
+  OP_Dec,           // Reg, Type
+  OP_Jump,          // Target
+  OP_JumpIfZero,    // Src, Target
+  OP_JumpIfNonZero, // Src, Target
+  OP_Call,          // Dst, CalleeIndex, FirstArg
+  OP_Return,        // Src
+  OP_Trap           // Control reached the end of a function.
+};
+} // end anonymous namespace
+
+/// Encode an integer type of the given width and signedness as an operand.
+static unsigned encodeType(unsigned Width, bool IsSigned) {
+  return (Width << 1) | IsSigned;
+}
+static unsigned getTypeWidth(unsigned Type) { return Type >> 1; }
+static bool isSignedType(unsigned Type) { return Type & 1; }
+
+/// Bring \p Value into the canonical representation of \p Type, truncating
+/// it to the width of the type.
+static uint64_t normalize(uint64_t Value, unsigned Type) {
+  unsigned Width = getTypeWidth(Type);
+  if (Width == 64)
+    return Value;
+  if (isSignedType(Type))
+    return uint64_t(int64_t(Value << (64 - Width)) >> (64 - Width));
+  return Value & ((uint64_t(1) << Width) - 1);
+}
+
+/// Whether \p Value is the smallest value of the signed \p Type.
+static bool isMinSignedValue(uint64_t Value, unsigned Type) {
+  return Value == normalize(uint64_t(1) << (getTypeWidth(Type) - 1), Type);
+}
+
+/// The bytecode of a function.
+class ConstexprInterpreter::Function {
+public:
+  enum StateKind {
+    /// The function is being compiled, so it must not be called yet.
+    Compiling,
+    Ready,
+    /// The function can't be compiled, so it must be evaluated by the tree
+    /// walker.
+    Unsupported
+  };
+  StateKind State;
+
+  unsigned NumRegisters;
+  unsigned ResultType;
+  /// The types of the parameters, which are held in the first registers.
+  SmallVector<unsigned, 4> ParamTypes;
+
+  SmallVector<uint32_t, 64> Code;
+  SmallVector<uint64_t, 8> Constants;
+  SmallVector<Function *, 4> Callees;
+
+  Function() : State(Compiling), NumRegisters(0), ResultType(0) {}
+};
+
+//===----------------------------------------------------------------------===//
+// Compiler
+//===----------------------------------------------------------------------===//
+
+namespace {
+class BytecodeCompiler {
+  typedef ConstexprInterpreter::Function Function;
+
+  ASTContext &Ctx;
+  ConstexprInterpreter &Interp;
+  Function &F;
+
+  /// A parameter or local variable.
+  struct Variable {
+    unsigned Reg;
+    unsigned Type;
+    bool IsConst;
+  };
+  llvm::DenseMap<const VarDecl *, Variable> Variables;
+
+  /// The first register that isn't holding a variable or a temporary.
+  unsigned NextReg;
+
+  /// The jumps to patch at the end of a loop.
+  struct Loop {
+    SmallVector<unsigned, 4> Breaks;
+    SmallVector<unsigned, 4> Continues;
+  };
+  SmallVector<Loop *, 4> Loops;
+
+  unsigned allocateRegister() {
+    unsigned Reg = NextReg++;
+    F.NumRegisters = std::max(F.NumRegisters, NextReg);
+    return Reg;
+  }
+
+  void emit(uint32_t Op) { F.Code.push_back(Op); }
+  void emit(uint32_t Op, uint32_t A) { emit(Op); emit(A); }
+  void emit(uint32_t Op, uint32_t A, uint32_t B) { emit(Op, A); emit(B); }
+  void emit(uint32_t Op, uint32_t A, uint32_t B, uint32_t C) {
+    emit(Op, A, B);
+    emit(C);
+  }
+  void emit(uint32_t Op, uint32_t A, uint32_t B, uint32_t C, uint32_t D) {
+    emit(Op, A, B, C);
+    emit(D);
+  }
+
+  /// Emit a jump, and return the offset of its target to patch.
+  unsigned emitJump(Opcode Op, unsigned Src = 0) {
+    if (Op == OP_Jump)
+      emit(Op);
+    else
+      emit(Op, Src);
+    emit(0);
+    return F.Code.size() - 1;
+  }
+  void patchJumpsToHere(ArrayRef<unsigned> Jumps) {
+    for (unsigned I = 0, N = Jumps.size(); I != N; ++I)
+      F.Code[Jumps[I]] = F.Code.size();
+  }
+  void emitJumpTo(unsigned Target) { emit(OP_Jump, Target); }
+
+  void emitConstant(unsigned Dst, uint64_t Value) {
+    emit(OP_Const, Dst, F.Constants.size());
+    F.Constants.push_back(Value);
+  }
+
+  bool getType(QualType T, unsigned &Type);
+  bool getVariable(const Expr *E, Variable &V);
+
+  bool compileStmt(const Stmt *S);
+  bool compileVarDecl(const VarDecl *VD);
+  bool compileCondition(const Expr *Cond, unsigned &Jump);
+  bool compileLoopBody(const Stmt *Body, Loop &L);
+
+  bool compileIgnored(const Expr *E);
+  bool compileLValue(const Expr *E, Variable &V);
+  bool compileRValue(const Expr *E, unsigned Dst);
+  bool compileCast(const CastExpr *E, unsigned Type, unsigned Dst);
+  bool compileBinaryOperator(const BinaryOperator *E, unsigned Type,
+                             unsigned Dst);
+  bool compileUnaryOperator(const UnaryOperator *E, unsigned Type,
+                            unsigned Dst);
+  bool compileCall(const CallExpr *E, unsigned Type, unsigned Dst);
+  bool compileConstant(const Expr *E, unsigned Type, unsigned Dst);
+  bool emitBinaryOperation(BinaryOperatorKind Opcode, unsigned Dst,
+                           unsigned LHS, unsigned RHS, unsigned LHSType,
+                           unsigned RHSType, unsigned ResultType);
+  bool emitIncDec(const UnaryOperator *E, const Variable &V);
+
+public:
+  BytecodeCompiler(ASTContext &Ctx, ConstexprInterpreter &Interp, Function &F)
+    : Ctx(Ctx), Interp(Interp), F(F), NextReg(0) {}
+
+  bool compileFunction(const FunctionDecl *FD);
+};
+} // end anonymous namespace
+
+/// Get the encoding of \p T, if it is an integer type the interpreter
+/// supports.
+bool BytecodeCompiler::getType(QualType T, unsigned &Type) {
+  if (!T->isIntegralOrEnumerationType() || T.isVolatileQualified())
+    return false;
+  unsigned Width = Ctx.getIntWidth(T);
+  if (Width == 0 || Width > 64)
+    return false;
+  Type = encodeType(Width, T->isSignedIntegerOrEnumerationType());
+  return true;
+}
+
+bool BytecodeCompiler::compileFunction(const FunctionDecl *FD) {
+  const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD);
+  if ((MD && MD->isInstance()) || FD->isVariadic() ||
+      !getType(FD->getResultType(), F.ResultType))
+    return false;
+
+  for (unsigned I = 0, N = FD->getNumParams(); I != N; ++I) {
+    const ParmVarDecl *PD = FD->getParamDecl(I);
+    Variable V;
+    if (!getType(PD->getType(), V.Type))
+      return false;
+    V.Reg = allocateRegister();
+    V.IsConst = PD->getType().isConstQualified();
+    Variables[PD] = V;
+    F.ParamTypes.push_back(V.Type);
+  }
+
+  const Stmt *Body = FD->getBody();
+  if (!Body || !compileStmt(Body))
+    return false;
+  emit(OP_Trap);
+  return true;
+}
+
+/// Compile a statement. Every statement counts as one step, as it does for
+/// EvaluateStmt, so that the interpreter stops exactly where the tree
+/// walker would.
+bool BytecodeCompiler::compileStmt(const Stmt *S) {
+  emit(OP_Step);
+
+  // Temporaries and the variables declared by a statement don't outlive it.
+  unsigned SavedNextReg = NextReg;
+  bool Success = false;
+
+  switch (S->getStmtClass()) {
+  default:
+    if (const Expr *E = dyn_cast<Expr>(S))
+      Success = compileIgnored(E);
+    break;
+
+  case Stmt::NullStmtClass:
+    Success = true;
+    break;
+
+  case Stmt::DeclStmtClass: {
+    const DeclStmt *DS = cast<DeclStmt>(S);
+    Success = true;
+    for (DeclStmt::const_decl_iterator I = DS->decl_begin(),
+           E = DS->decl_end(); Success && I != E; ++I)
+      // Other declarations, such as typedefs, have no effect.
+      if (const VarDecl *VD = dyn_cast<VarDecl>(*I))
+        Success = compileVarDecl(VD);
+    // The variables live until the end of the enclosing block.
+    return Success;
+  }
+
+  case Stmt::ReturnStmtClass: {
+    const Expr *RetValue = cast<ReturnStmt>(S)->getRetValue();
+    if (!RetValue)
+      break;
+    unsigned Reg = allocateRegister();
+    if (!compileRValue(RetValue, Reg))
+      break;
+    emit(OP_Return, Reg);
+    Success = true;
+    break;
+  }
+
+  case Stmt::CompoundStmtClass: {
+    const CompoundStmt *CS = cast<CompoundStmt>(S);
+    Success = true;
+    for (CompoundStmt::const_body_iterator I = CS->body_begin(),
+           E = CS->body_end(); Success && I != E; ++I)
+      Success = compileStmt(*I);
+    break;
+  }
+
+  case Stmt::IfStmtClass: {
+    const IfStmt *IS = cast<IfStmt>(S);
+    unsigned ToElse;
+    if (IS->getConditionVariable() || !compileCondition(IS->getCond(), ToElse))
+      break;
+    if (!compileStmt(IS->getThen()))
+      break;
+    if (const Stmt *Else = IS->getElse()) {
+      unsigned ToEnd = emitJump(OP_Jump);
+      patchJumpsToHere(ToElse);
+      if (!compileStmt(Else))
+        break;
+      patchJumpsToHere(ToEnd);
+    } else {
+      patchJumpsToHere(ToElse);
+    }
+    Success = true;
+    break;
+  }
+
+  case Stmt::WhileStmtClass: {
+    const WhileStmt *WS = cast<WhileStmt>(S);
+    Loop L;
+    unsigned Start = F.Code.size();
+    unsigned ToEnd;
+    if (WS->getConditionVariable() || !compileCondition(WS->getCond(), ToEnd) ||
+        !compileLoopBody(WS->getBody(), L))
+      break;
+    patchJumpsToHere(L.Continues);
+    emitJumpTo(Start);
+    patchJumpsToHere(ToEnd);
+    patchJumpsToHere(L.Breaks);
+    Success = true;
+    break;
+  }
+
+  case Stmt::DoStmtClass: {
+    const DoStmt *DS = cast<DoStmt>(S);
+    Loop L;
+    unsigned Start = F.Code.size();
+    if (!compileLoopBody(DS->getBody(), L))
+      break;
+    patchJumpsToHere(L.Continues);
+    unsigned Reg = allocateRegister();
+    if (!compileRValue(DS->getCond(), Reg))
+      break;
+    NextReg = Reg;
+    emit(OP_JumpIfNonZero, Reg, Start);
+    patchJumpsToHere(L.Breaks);
+    Success = true;
+    break;
+  }
+
+  case Stmt::ForStmtClass: {
+    const ForStmt *FS = cast<ForStmt>(S);
+    if (FS->getInit() && !compileStmt(FS->getInit()))
+      break;
+    Loop L;
+    unsigned Start = F.Code.size();
+    unsigned ToEnd = 0;
+    if (FS->getConditionVariable() ||
+        (FS->getCond() && !compileCondition(FS->getCond(), ToEnd)) ||
+        !compileLoopBody(FS->getBody(), L))
+      break;
+    patchJumpsToHere(L.Continues);
+    if (FS->getInc()) {
+      unsigned LoopNextReg = NextReg;
+      if (!compileIgnored(FS->getInc()))
+        break;
+      NextReg = LoopNextReg;
+    }
+    emitJumpTo(Start);
+    if (FS->getCond())
+      patchJumpsToHere(ToEnd);
+    patchJumpsToHere(L.Breaks);
+    Success = true;
+    break;
+  }
+
+  case Stmt::BreakStmtClass:
+    if (Loops.empty())
+      break;
+    Loops.back()->Breaks.push_back(emitJump(OP_Jump));
+    Success = true;
+    break;
+
+  case Stmt::ContinueStmtClass:
+    if (Loops.empty())
+      break;
+    Loops.back()->Continues.push_back(emitJump(OP_Jump));
+    Success = true;
+    break;
+
+  case Stmt::LabelStmtClass:
+    Success = compileStmt(cast<LabelStmt>(S)->getSubStmt());
+    break;
+
+  case Stmt::AttributedStmtClass:
+    Success = compileStmt(cast<AttributedStmt>(S)->getSubStmt());
+    break;
+  }
+
+  NextReg = SavedNextReg;
+  return Success;
+}
+
+bool BytecodeCompiler::compileVarDecl(const VarDecl *VD) {
+  Variable V;
+  if (!VD->hasLocalStorage() || !VD->getInit() ||
+      VD->getType()->isReferenceType() || !getType(VD->getType(), V.Type))
+    return false;
+  V.Reg = allocateRegister();
+  V.IsConst = VD->getType().isConstQualified();
+  // The variable is only in scope after its initializer, which therefore
+  // can't read it.
+  if (!compileRValue(VD->getInit(), V.Reg))
+    return false;
+  NextReg = V.Reg + 1;
+  Variables[VD] = V;
+  return true;
+}
+
+/// Compile a condition, and a jump taken if it is false.
+bool BytecodeCompiler::compileCondition(const Expr *Cond, unsigned &Jump) {
+  unsigned Reg = allocateRegister();
+  if (!compileRValue(Cond, Reg))
+    return false;
+  NextReg = Reg;
+  Jump = emitJump(OP_JumpIfZero, Reg);
+  return true;
+}
+
+bool BytecodeCompiler::compileLoopBody(const Stmt *Body, Loop &L) {
+  Loops.push_back(&L);
+  bool Success = compileStmt(Body);
+  Loops.pop_back();
+  return Success;
+}
+
+/// Compile an expression evaluated for its side effects.
+bool BytecodeCompiler::compileIgnored(const Expr *E) {
+  E = E->IgnoreParens();
+  if (const CastExpr *CE = dyn_cast<CastExpr>(E))
+    if (CE->getCastKind() == CK_ToVoid)
+      return compileIgnored(CE->getSubExpr());
+
+  if (E->isGLValue()) {
+    Variable V;
+    return compileLValue(E, V);
+  }
+  return compileRValue(E, allocateRegister());
+}
+
+/// Find the variable named by \p E, if it is a parameter or local variable.
+bool BytecodeCompiler::getVariable(const Expr *E, Variable &V) {
+  const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E);
+  if (!DRE)
+    return false;
+  const VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl());
+  if (!VD)
+    return false;
+  llvm::DenseMap<const VarDecl *, Variable>::iterator Known =
+    Variables.find(VD);
+  if (Known == Variables.end())
+    return false;
+  V = Known->second;
+  return true;
+}
+
+/// Compile an lvalue expression that designates a variable, and set \p V to
+/// that variable.
+bool BytecodeCompiler::compileLValue(const Expr *E, Variable &V) {
+  E = E->IgnoreParens();
+  if (getVariable(E, V))
+    return true;
+
+  // Only C++1y allows constexpr functions to modify their variables.
+  if (!Ctx.getLangOpts().CPlusPlus1y)
+    return false;
+
+  if (const UnaryOperator *UO = dyn_cast<UnaryOperator>(E)) {
+    if (!UO->isPrefix() || !UO->isIncrementDecrementOp())
+      return false;
+    return compileLValue(UO->getSubExpr(), V) && emitIncDec(UO, V);
+  }
+
+  const BinaryOperator *BO = dyn_cast<BinaryOperator>(E);
+  if (!BO || !BO->isAssignmentOp())
+    return false;
+  // As in the tree walker, the left-hand side is evaluated first, and its
+  // value is read after the right-hand side has been evaluated.
+  if (!compileLValue(BO->getLHS(), V) || V.IsConst)
+    return false;
+  unsigned RHS = allocateRegister();
+  if (!compileRValue(BO->getRHS(), RHS))
+    return false;
+
+  if (BO->getOpcode() == BO_Assign) {
+    emit(OP_Move, V.Reg, RHS);
+    return true;
+  }
+
+  const CompoundAssignOperator *CAO = cast<CompoundAssignOperator>(BO);
+  unsigned LHSType, RHSType, ResultType;
+  if (!getType(CAO->getComputationLHSType(), LHSType) ||
+      !getType(CAO->getRHS()->getType(), RHSType) ||
+      !getType(CAO->getComputationResultType(), ResultType))
+    return false;
+  unsigned LHS = allocateRegister();
+  emit(OP_Convert, LHS, V.Reg, LHSType);
+  if (!emitBinaryOperation(
+          BinaryOperator::getOpForCompoundAssignment(CAO->getOpcode()), LHS,
+          LHS, RHS, LHSType, RHSType, ResultType))
+    return false;
+  emit(OP_Convert, V.Reg, LHS, V.Type);
+  return true;
+}
+
+bool BytecodeCompiler::emitIncDec(const UnaryOperator *E, const Variable &V) {
+  // Incrementing a bool isn't arithmetic.
+  if (V.IsConst || E->getSubExpr()->getType()->isBooleanType())
+    return false;
+  emit(E->isIncrementOp() ? OP_Inc : OP_Dec, V.Reg, V.Type);
+  return true;
+}
+
+/// Compile an integer prvalue expression, leaving its value in \p Dst.
+bool BytecodeCompiler::compileRValue(const Expr *E, unsigned Dst) {
+  unsigned Type;
+  if (!getType(E->getType(), Type))
+    return false;
+
+  switch (E->getStmtClass()) {
+  default:
+    return false;
+
+  case Stmt::ParenExprClass:
+    return compileRValue(cast<ParenExpr>(E)->getSubExpr(), Dst);
+
+  case Stmt::IntegerLiteralClass:
+    emitConstant(Dst, normalize(cast<IntegerLiteral>(E)->getValue()
+                                  .getZExtValue(), Type));
+    return true;
+
+  case Stmt::CharacterLiteralClass:
+    emitConstant(Dst, normalize(cast<CharacterLiteral>(E)->getValue(), Type));
+    return true;
+
+  case Stmt::CXXBoolLiteralExprClass:
+    emitConstant(Dst, cast<CXXBoolLiteralExpr>(E)->getValue());
+    return true;
+
+  case Stmt::DeclRefExprClass: {
+    const EnumConstantDecl *ECD =
+      dyn_cast<EnumConstantDecl>(cast<DeclRefExpr>(E)->getDecl());
+    if (!ECD)
+      return false;
+    const llvm::APSInt &Value = ECD->getInitVal();
+    if (Value.getBitWidth() > 64)
+      return false;
+    emitConstant(Dst, normalize(Value.isSigned() ? Value.getSExtValue()
+                                                 : Value.getZExtValue(),
+                                Type));
+    return true;
+  }
+
+  case Stmt::UnaryExprOrTypeTraitExprClass:
+    return compileConstant(E, Type, Dst);
+
+  case Stmt::CXXDefaultArgExprClass:
+    return compileRValue(cast<CXXDefaultArgExpr>(E)->getExpr(), Dst);
+
+  case Stmt::ImplicitCastExprClass:
+  case Stmt::CStyleCastExprClass:
+  case Stmt::CXXFunctionalCastExprClass:
+  case Stmt::CXXStaticCastExprClass:
+    return compileCast(cast<CastExpr>(E), Type, Dst);
+
+  case Stmt::BinaryOperatorClass:
+    return compileBinaryOperator(cast<BinaryOperator>(E), Type, Dst);
+
+  case Stmt::UnaryOperatorClass:
+    return compileUnaryOperator(cast<UnaryOperator>(E), Type, Dst);
+
+  case Stmt::ConditionalOperatorClass: {
+    const ConditionalOperator *CO = cast<ConditionalOperator>(E);
+    if (!compileRValue(CO->getCond(), Dst))
+      return false;
+    unsigned ToFalse = emitJump(OP_JumpIfZero, Dst);
+    if (!compileRValue(CO->getTrueExpr(), Dst))
+      return false;
+    unsigned ToEnd = emitJump(OP_Jump);
+    patchJumpsToHere(ToFalse);
+    if (!compileRValue(CO->getFalseExpr(), Dst))
+      return false;
+    patchJumpsToHere(ToEnd);
+    return true;
+  }
+
+  case Stmt::CallExprClass:
+    return compileCall(cast<CallExpr>(E), Type, Dst);
+  }
+}
+
+/// Evaluate \p E, which doesn't depend on the arguments of the call, while
+/// compiling.
+bool BytecodeCompiler::compileConstant(const Expr *E, unsigned Type,
+                                       unsigned Dst) {
+  APValue Value;
+  if (!E->isCXX11ConstantExpr(Ctx, &Value) || !Value.isInt() ||
+      Value.getInt().getBitWidth() != getTypeWidth(Type))
+    return false;
+  emitConstant(Dst, normalize(Value.getInt().getZExtValue(), Type));
+  return true;
+}
+
+bool BytecodeCompiler::compileCast(const CastExpr *E, unsigned Type,
+                                   unsigned Dst) {
+  const Expr *SubExpr = E->getSubExpr();
+  switch (E->getCastKind()) {
+  default:
+    return false;
+
+  case CK_LValueToRValue: {
+    if (SubExpr->getType().isVolatileQualified())
+      return false;
+    // Read a global constant once, while compiling. Its initializer is
+    // evaluated once by the tree walker too.
+    if (const DeclRefExpr *DRE =
+          dyn_cast<DeclRefExpr>(SubExpr->IgnoreParens()))
+      if (const VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl()))
+        if (!VD->hasLocalStorage())
+          return compileConstant(E, Type, Dst);
+    Variable V;
+    if (!compileLValue(SubExpr, V) || V.Type != Type)
+      return false;
+    emit(OP_Move, Dst, V.Reg);
+    return true;
+  }
+
+  case CK_NoOp: {
+    unsigned SubType;
+    return getType(SubExpr->getType(), SubType) && SubType == Type &&
+           compileRValue(SubExpr, Dst);
+  }
+
+  case CK_IntegralCast:
+    if (!compileRValue(SubExpr, Dst))
+      return false;
+    emit(OP_Convert, Dst, Dst, Type);
+    return true;
+
+  case CK_IntegralToBoolean:
+    if (!compileRValue(SubExpr, Dst))
+      return false;
+    emit(OP_ToBool, Dst, Dst);
+    return true;
+  }
+}
+
+bool BytecodeCompiler::emitBinaryOperation(BinaryOperatorKind Opcode,
+                                           unsigned Dst, unsigned LHS,
+                                           unsigned RHS, unsigned LHSType,
+                                           unsigned RHSType,
+                                           unsigned ResultType) {
+  switch (Opcode) {
+  default:
+    return false;
+
+  case BO_Mul:
+  case BO_Div:
+  case BO_Rem:
+  case BO_Add:
+  case BO_Sub:
+  case BO_And:
+  case BO_Xor:
+  case BO_Or: {
+    // The operands have been converted to the type of the result.
+    if (LHSType != ResultType || RHSType != ResultType)
+      return false;
+    switch (Opcode) {
+    default: llvm_unreachable("not an arithmetic operator");
+    case BO_Mul: emit(OP_Mul, Dst, LHS, RHS, ResultType); break;
+    case BO_Div: emit(OP_Div, Dst, LHS, RHS, ResultType); break;
+    case BO_Rem: emit(OP_Rem, Dst, LHS, RHS, ResultType); break;
+    case BO_Add: emit(OP_Add, Dst, LHS, RHS, ResultType); break;
+    case BO_Sub: emit(OP_Sub, Dst, LHS, RHS, ResultType); break;
+    case BO_And: emit(OP_And, Dst, LHS, RHS); break;
+    case BO_Xor: emit(OP_Xor, Dst, LHS, RHS); break;
+    case BO_Or:  emit(OP_Or, Dst, LHS, RHS); break;
+    }
+    return true;
+  }
+
+  case BO_Shl:
+  case BO_Shr:
+    if (LHSType != ResultType)
+      return false;
+    emit(Opcode == BO_Shl ? OP_Shl : OP_Shr, Dst, LHS, RHS, LHSType, RHSType);
+    return true;
+
+  case BO_LT:
+  case BO_GT:
+  case BO_LE:
+  case BO_GE:
+  case BO_EQ:
+  case BO_NE:
+    if (LHSType != RHSType)
+      return false;
+    switch (Opcode) {
+    default: llvm_unreachable("not a comparison");
+    case BO_LT: emit(OP_LT, Dst, LHS, RHS, LHSType); break;
+    case BO_GT: emit(OP_LT, Dst, RHS, LHS, LHSType); break;
+    case BO_LE: emit(OP_LE, Dst, LHS, RHS, LHSType); break;
+    case BO_GE: emit(OP_LE, Dst, RHS, LHS, LHSType); break;
+    case BO_EQ: emit(OP_EQ, Dst, LHS, RHS); break;
+    case BO_NE: emit(OP_NE, Dst, LHS, RHS); break;
+    }
+    return true;
+  }
+}
+
+bool BytecodeCompiler::compileBinaryOperator(const BinaryOperator *E,
+                                             unsigned Type, unsigned Dst) {
+  BinaryOperatorKind Opcode = E->getOpcode();
+  switch (Opcode) {
+  case BO_Comma:
+    return compileIgnored(E->getLHS()) && compileRValue(E->getRHS(), Dst);
+
+  case BO_LAnd:
+  case BO_LOr: {
+    if (!compileRValue(E->getLHS(), Dst))
+      return false;
+    emit(OP_ToBool, Dst, Dst);
+    unsigned ToEnd =
+      emitJump(Opcode == BO_LAnd ? OP_JumpIfZero : OP_JumpIfNonZero, Dst);
+    if (!compileRValue(E->getRHS(), Dst))
+      return false;
+    emit(OP_ToBool, Dst, Dst);
+    patchJumpsToHere(ToEnd);
+    return true;
+  }
+
+  default:
+    break;
+  }
+
+  unsigned LHSType, RHSType;
+  if (!getType(E->getLHS()->getType(), LHSType) ||
+      !getType(E->getRHS()->getType(), RHSType) ||
+      !compileRValue(E->getLHS(), Dst))
+    return false;
+  unsigned RHS = allocateRegister();
+  return compileRValue(E->getRHS(), RHS) &&
+         emitBinaryOperation(Opcode, Dst, Dst, RHS, LHSType, RHSType, Type);
+}
+
+bool BytecodeCompiler::compileUnaryOperator(const UnaryOperator *E,
+                                            unsigned Type, unsigned Dst) {
+  const Expr *SubExpr = E->getSubExpr();
+  switch (E->getOpcode()) {
+  default:
+    return false;
+
+  case UO_Plus:
+    return compileRValue(SubExpr, Dst);
+
+  case UO_Minus:
+  case UO_Not: {
+    unsigned SubType;
+    if (!getType(SubExpr->getType(), SubType) || SubType != Type ||
+        !compileRValue(SubExpr, Dst))
+      return false;
+    emit(E->getOpcode() == UO_Minus ? OP_Neg : OP_Not, Dst, Dst, Type);
+    return true;
+  }
+
+  case UO_LNot:
+    if (!compileRValue(SubExpr, Dst))
+      return false;
+    emit(OP_LNot, Dst, Dst);
+    return true;
+
+  case UO_PostInc:
+  case UO_PostDec: {
+    Variable V;
+    if (!Ctx.getLangOpts().CPlusPlus1y || !compileLValue(SubExpr, V) ||
+        V.Type != Type)
+      return false;
+    emit(OP_Move, Dst, V.Reg);
+    return emitIncDec(E, V);
+  }
+  }
+}
+
+bool BytecodeCompiler::compileCall(const CallExpr *E, unsigned Type,
+                                   unsigned Dst) {
+  const DeclRefExpr *Callee =
+    dyn_cast<DeclRefExpr>(E->getCallee()->IgnoreParenImpCasts());
+  if (!Callee)
+    return false;
+  const FunctionDecl *FD = dyn_cast<FunctionDecl>(Callee->getDecl());
+  const FunctionDecl *Definition = 0;
+  if (!FD || FD->isInvalidDecl() || FD->getBuiltinID() ||
+      !FD->getBody(Definition) || !Definition->isConstexpr() ||
+      Definition->isInvalidDecl() ||
+      E->getNumArgs() != Definition->getNumParams())
+    return false;
+
+  Function *CalleeF = Interp.getFunction(Definition);
+  if (CalleeF->State == Function::Unsupported)
+    return false;
+
+  // The arguments go in consecutive registers.
+  unsigned FirstArg = NextReg;
+  for (unsigned I = 0, N = E->getNumArgs(); I != N; ++I)
+    allocateRegister();
+  for (unsigned I = 0, N = E->getNumArgs(); I != N; ++I) {
+    unsigned ArgType, ParamType;
+    if (!getType(E->getArg(I)->getType(), ArgType) ||
+        !getType(Definition->getParamDecl(I)->getType(), ParamType) ||
+        ArgType != ParamType || !compileRValue(E->getArg(I), FirstArg + I))
+      return false;
+  }
+
+  unsigned CalleeIndex =
+    std::find(F.Callees.begin(), F.Callees.end(), CalleeF) - F.Callees.begin();
+  if (CalleeIndex == F.Callees.size())
+    F.Callees.push_back(CalleeF);
+  emit(OP_Call, Dst, CalleeIndex, FirstArg);
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Interpreter
+//===----------------------------------------------------------------------===//
+
+ConstexprInterpreter::ConstexprInterpreter(ASTContext &Ctx)
+  : Ctx(Ctx), NumCompiled(0), NumUnsupported(0), NumEvaluated(0),
+    NumFallbacks(0) {}
+
+ConstexprInterpreter::~ConstexprInterpreter() {
+  llvm::DeleteContainerSeconds(Functions);
+}
+
+ConstexprInterpreter::Function *
+ConstexprInterpreter::getFunction(const FunctionDecl *FD) {
+  llvm::DenseMap<const FunctionDecl *, Function *>::iterator Known =
+    Functions.find(FD);
+  if (Known != Functions.end())
+    return Known->second;
+
+  // Register the function first, so that recursive calls find it.
+  Function *F = new Function();
+  Functions[FD] = F;
+  if (BytecodeCompiler(Ctx, *this, *F).compileFunction(FD)) {
+    F->State = Function::Ready;
+    ++NumCompiled;
+  } else {
+    F->State = Function::Unsupported;
+    F->Code.clear();
+    ++NumUnsupported;
+  }
+  return F;
+}
+
+/// Whether \p Value doesn't fit in the signed \p Type.
+static bool overflows(uint64_t Value, unsigned Type) {
+  return normalize(Value, Type) != Value;
+}
+
+/// Perform a signed addition, subtraction or multiplication, and return true
+/// if it overflows.
+static bool signedArithmetic(Opcode Op, uint64_t LHS, uint64_t RHS,
+                             unsigned Type, uint64_t &Result) {
+  if (getTypeWidth(Type) <= 32) {
+    // The exact result of any of these fits in 64 bits.
+    int64_t L = LHS, R = RHS;
+    Result = Op == OP_Add ? L + R : Op == OP_Sub ? L - R : L * R;
+    return overflows(Result, Type);
+  }
+
+  llvm::APInt L(64, LHS), R(64, RHS);
+  bool Overflow;
+  llvm::APInt Value = Op == OP_Add ? L.sadd_ov(R, Overflow)
+                    : Op == OP_Sub ? L.ssub_ov(R, Overflow)
+                    : L.smul_ov(R, Overflow);
+  Result = Value.getZExtValue();
+  return Overflow || overflows(Result, Type);
+}
+
+/// Check the shift amount of a shift of a value of type \p LHSType, and
+/// return it.
+static bool getShiftAmount(uint64_t RHS, unsigned LHSType, unsigned RHSType,
+                           unsigned &Amount) {
+  if (isSignedType(RHSType) && int64_t(RHS) < 0)
+    return false;
+  if (RHS >= getTypeWidth(LHSType))
+    return false;
+  Amount = RHS;
+  return true;
+}
+
+bool ConstexprInterpreter::run(const Function &F, const uint64_t *Args,
+                               unsigned Depth, unsigned MaxDepth,
+                               unsigned &MaxDepthReached, unsigned &StepsLeft,
+                               uint64_t &Result) {
+  MaxDepthReached = std::max(MaxDepthReached, Depth);
+  SmallVector<uint64_t, 16> Registers(F.NumRegisters);
+  uint64_t *Regs = Registers.data();
+  std::copy(Args, Args + F.ParamTypes.size(), Regs);
+
+  const uint32_t *Code = F.Code.data();
+  const uint32_t *PC = Code;
+  for (;;) {
+    switch (PC[0]) {
+    case OP_Step:
+      if (!StepsLeft)
+        return false;
+      --StepsLeft;
+      PC += 1;
+      break;
+
+    case OP_Const:
+      Regs[PC[1]] = F.Constants[PC[2]];
+      PC += 3;
+      break;
+
+    case OP_Move:
+      Regs[PC[1]] = Regs[PC[2]];
+      PC += 3;
+      break;
+
+    case OP_Add:
+    case OP_Sub:
+    case OP_Mul: {
+      uint64_t L = Regs[PC[2]], R = Regs[PC[3]];
+      unsigned Type = PC[4];
+      if (isSignedType(Type)) {
+        if (signedArithmetic(Opcode(PC[0]), L, R, Type, Regs[PC[1]]))
+          return false;
+      } else {
+        // Unsigned arithmetic wraps around.
+        Regs[PC[1]] = normalize(PC[0] == OP_Add ? L + R :
+                                PC[0] == OP_Sub ? L - R : L * R, Type);
+      }
+      PC += 5;
+      break;
+    }
+
+    case OP_Div:
+    case OP_Rem: {
+      uint64_t L = Regs[PC[2]], R = Regs[PC[3]];
+      unsigned Type = PC[4];
+      if (R == 0)
+        return false;
+      if (isSignedType(Type)) {
+        if (int64_t(R) == -1 && isMinSignedValue(L, Type))
+          return false;
+        Regs[PC[1]] = PC[0] == OP_Div ? int64_t(L) / int64_t(R)
+                                      : int64_t(L) % int64_t(R);
+      } else {
+        Regs[PC[1]] = PC[0] == OP_Div ? L / R : L % R;
+      }
+      PC += 5;
+      break;
+    }
+
+    case OP_And:
+      Regs[PC[1]] = Regs[PC[2]] & Regs[PC[3]];
+      PC += 4;
+      break;
+
+    case OP_Or:
+      Regs[PC[1]] = Regs[PC[2]] | Regs[PC[3]];
+      PC += 4;
+      break;
+
+    case OP_Xor:
+      Regs[PC[1]] = Regs[PC[2]] ^ Regs[PC[3]];
+      PC += 4;
+      break;
+
+    case OP_Shl: {
+      uint64_t L = Regs[PC[2]];
+      unsigned LType = PC[4], Amount;
+      if (!getShiftAmount(Regs[PC[3]], LType, PC[5], Amount))
+        return false;
+      // A signed left shift must not shift out any set bits.
+      if (isSignedType(LType) &&
+          (int64_t(L) < 0 ||
+           (Amount && (L >> (getTypeWidth(LType) - Amount)) != 0)))
+        return false;
+      Regs[PC[1]] = normalize(L << Amount, LType);
+      PC += 6;
+      break;
+    }
+
+    case OP_Shr: {
+      uint64_t L = Regs[PC[2]];
+      unsigned LType = PC[4], Amount;
+      if (!getShiftAmount(Regs[PC[3]], LType, PC[5], Amount))
+        return false;
+      Regs[PC[1]] = isSignedType(LType) ? uint64_t(int64_t(L) >> Amount)
+                                        : L >> Amount;
+      PC += 6;
+      break;
+    }
+
+    case OP_EQ:
+      Regs[PC[1]] = Regs[PC[2]] == Regs[PC[3]];
+      PC += 4;
+      break;
+
+    case OP_NE:
+      Regs[PC[1]] = Regs[PC[2]] != Regs[PC[3]];
+      PC += 4;
+      break;
+
+    case OP_LT:
+    case OP_LE: {
+      uint64_t L = Regs[PC[2]], R = Regs[PC[3]];
+      bool Less, Equal = L == R;
+      if (isSignedType(PC[4]))
+        Less = int64_t(L) < int64_t(R);
+      else
+        Less = L < R;
+      Regs[PC[1]] = PC[0] == OP_LT ? Less : Less || Equal;
+      PC += 5;
+      break;
+    }
+
+    case OP_Neg: {
+      uint64_t Value = Regs[PC[2]];
+      unsigned Type = PC[3];
+      if (isSignedType(Type) && isMinSignedValue(Value, Type))
+        return false;
+      Regs[PC[1]] = normalize(-Value, Type);
+      PC += 4;
+      break;
+    }
+
+    case OP_Not:
+      Regs[PC[1]] = normalize(~Regs[PC[2]], PC[3]);
+      PC += 4;
+      break;
+
+    case OP_Convert:
+      Regs[PC[1]] = normalize(Regs[PC[2]], PC[3]);
+      PC += 4;
+      break;
+
+    case OP_LNot:
+      Regs[PC[1]] = Regs[PC[2]] == 0;
+      PC += 3;
+      break;
+
+    case OP_ToBool:
+      Regs[PC[1]] = Regs[PC[2]] != 0;
+      PC += 3;
+      break;
+
+    case OP_Inc:
+    case OP_Dec: {
+      uint64_t Value = Regs[PC[1]];
+      unsigned Type = PC[2];
+      uint64_t NewValue = normalize(PC[0] == OP_Inc ? Value + 1 : Value - 1,
+                                    Type);
+      // Leave any signed overflow to the tree walker to diagnose.
+      if (isSignedType(Type) &&
+          (PC[0] == OP_Inc ? int64_t(NewValue) < int64_t(Value)
+                           : int64_t(NewValue) > int64_t(Value)))
+        return false;
+      Regs[PC[1]] = NewValue;
+      PC += 3;
+      break;
+    }
+
+    case OP_Jump:
+      PC = Code + PC[1];
+      break;
+
+    case OP_JumpIfZero:
+      PC = Regs[PC[1]] == 0 ? Code + PC[2] : PC + 3;
+      break;
+
+    case OP_JumpIfNonZero:
+      PC = Regs[PC[1]] != 0 ? Code + PC[2] : PC + 3;
+      break;
+
+    case OP_Call: {
+      const Function &Callee = *F.Callees[PC[2]];
+      if (Callee.State != Function::Ready || Depth > MaxDepth)
+        return false;
+      if (!run(Callee, Regs + PC[3], Depth + 1, MaxDepth, MaxDepthReached,
+               StepsLeft, Regs[PC[1]]))
+        return false;
+      PC += 4;
+      break;
+    }
+
+    case OP_Return:
+      Result = Regs[PC[1]];
+      return true;
+
+    case OP_Trap:
+      return false;
+
+    default:
+      llvm_unreachable("invalid opcode");
+    }
+  }
+}
+
+bool ConstexprInterpreter::evaluateCall(const FunctionDecl *FD,
+                                        ArrayRef<APValue> Args,
+                                        unsigned MaxDepth,
+                                        unsigned &StepsLeft,
+                                        unsigned &Depth,
+                                        APValue &Result) {
+  const Function *F = getFunction(FD);
+  if (F->State != Function::Ready || Args.size() != F->ParamTypes.size())
+    return false;
+
+  SmallVector<uint64_t, 8> ArgValues;
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    unsigned Type = F->ParamTypes[I];
+    if (!Args[I].isInt() ||
+        Args[I].getInt().getBitWidth() != getTypeWidth(Type))
+      return false;
+    ArgValues.push_back(normalize(Args[I].getInt().getZExtValue(), Type));
+  }
+
+  unsigned Steps = StepsLeft, MaxDepthReached = 0;
+  uint64_t Value;
+  if (!run(*F, ArgValues.data(), 1, MaxDepth, MaxDepthReached, Steps, Value)) {
+    ++NumFallbacks;
+    return false;
+  }
+  ++NumEvaluated;
+  StepsLeft = Steps;
+  Depth = MaxDepthReached;
+  Result = APValue(llvm::APSInt(llvm::APInt(getTypeWidth(F->ResultType), Value),
+                                !isSignedType(F->ResultType)));
+  return true;
+}
+
+void ConstexprInterpreter::PrintStats() const {
+  llvm::errs() << "*** Constexpr Bytecode Stats:\n";
+  llvm::errs() << "  " << NumCompiled << " functions compiled, "
+               << NumUnsupported << " not supported.\n";
+  llvm::errs() << "  " << NumEvaluated << " calls evaluated, "
+               << NumFallbacks << " left to the tree walker.\n";
+}
@@ -0,0 +1,89 @@
+//===--- ConstexprInterpreter.h - Bytecode for constexpr calls --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This provides the bytecode interpreter used by the constant evaluator for
+// calls to constexpr functions when -fconstexpr-bytecode is enabled.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_AST_CONSTEXPRINTERPRETER_H
+#define LLVM_CLANG_AST_CONSTEXPRINTERPRETER_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace clang {
+
+class APValue;
+class ASTContext;
+class FunctionDecl;
+
+/// \brief Evaluates calls to constexpr functions that compute on integers by
+/// compiling each body to bytecode once, and running that on a register
+/// machine instead of walking the AST of the body on every call.
+///
+/// A function is compiled if its parameters, local variables and result are
+/// integers, and its body only uses the statements and operators on them
+/// that are allowed in a constexpr function, and calls to other such
+/// functions. Anything else is left to the tree walker in ExprConstant.cpp.
+///
+/// The interpreter also gives up on anything the tree walker would diagnose,
+/// such as an overflow, a division by zero, an invalid shift, or exceeding
+/// the call depth or step limit, so that the call can be evaluated again by
+/// the tree walker to produce the diagnostic.
+class ConstexprInterpreter {
+public:
+  class Function;
+
+private:
+  ASTContext &Ctx;
+
+  /// \brief The bytecode of each function definition that has been seen,
+  /// including those that couldn't be compiled.
+  llvm::DenseMap<const FunctionDecl *, Function *> Functions;
+
+  unsigned NumCompiled, NumUnsupported, NumEvaluated, NumFallbacks;
+
+  bool run(const Function &F, const uint64_t *Args, unsigned Depth,
+           unsigned MaxDepth, unsigned &MaxDepthReached, unsigned &StepsLeft,
+           uint64_t &Result);
+
+  ConstexprInterpreter(const ConstexprInterpreter &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConstexprInterpreter &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit ConstexprInterpreter(ASTContext &Ctx);
+  ~ConstexprInterpreter();
+
+  /// \brief Returns the bytecode of the function definition \p FD, compiling
+  /// it on first use.
+  Function *getFunction(const FunctionDecl *FD);
+
+  /// \brief Evaluate a call to the constexpr function definition \p FD.
+  ///
+  /// \param MaxDepth The number of nested calls, including this one, that
+  /// may be active at once.
+  /// \param StepsLeft The number of statements that may be evaluated;
+  /// decremented by the number that were.
+  /// \param Depth Set to the number of nested calls, including this one,
+  /// that were active at once.
+  ///
+  /// \returns false, without changing \p StepsLeft, \p Depth or \p Result,
+  /// if the call can't be evaluated by the interpreter.
+  bool evaluateCall(const FunctionDecl *FD, ArrayRef<APValue> Args,
+                    unsigned MaxDepth, unsigned &StepsLeft, unsigned &Depth,
+                    APValue &Result);
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
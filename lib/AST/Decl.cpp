@@ -3596,7 +3596,8 @@ CapturedDecl *CapturedDecl::CreateDeserialized(ASTContext &C, unsigned ID,
 }
 
 CilkSpawnDecl::CilkSpawnDecl(DeclContext *DC, CapturedStmt *Spawn) :
-  Decl(CilkSpawn, DC, Spawn->getLocStart()), CapturedSpawn(Spawn) {
+  Decl(CilkSpawn, DC, Spawn->getLocStart()), CapturedSpawn(Spawn),
+  Priority(0), DependentPriority(0) {
 }
 
 CilkSpawnDecl *CilkSpawnDecl::Create(ASTContext &C, DeclContext *DC,
@@ -69,6 +69,11 @@ Module *Decl::getOwningModuleSlow() const {
   return getASTContext().getExternalSource()->getModule(getOwningModuleID());
 }
 
+void Decl::loadRedeclChain() const {
+  assert(LazyRedeclChain && isFromASTFile() && "No chain to load?");
+  getASTContext().getExternalSource()->CompleteRedeclChain(this);
+}
+
 const char *Decl::getDeclKindName() const {
   switch (DeclKind) {
   default: llvm_unreachable("Declaration not in DeclNodes.inc!");
@@ -1430,6 +1435,8 @@ void DeclContext::makeDeclVisibleInContextWithFlags(NamedDecl *D, bool Internal,
   if (shouldBeHidden(D))
     return;
 
+  getParentASTContext().addedVisibleDecl();
+
   // If we already have a lookup data structure, perform the insertion into
   // it. If we might have externally-stored decls with this name, look them
   // up and perform the insertion. If this decl was declared outside its
@@ -33,6 +33,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "ConstexprCallCache.h"
+#include "ConstexprInterpreter.h"
 #include "clang/AST/APValue.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ASTDiagnostic.h"
@@ -424,6 +426,10 @@ namespace {
     /// CallStackDepth - The number of calls in the call stack right now.
     unsigned CallStackDepth;
 
+    /// MaxCallStackDepth - The greatest CallStackDepth reached since the
+    /// start of the innermost call being memoized.
+    unsigned MaxCallStackDepth;
+
     /// NextCallIndex - The next call index to assign.
     unsigned NextCallIndex;
 
@@ -452,6 +458,15 @@ namespace {
     /// notes attached to it will also be stored, otherwise they will not be.
     bool HasActiveDiagnostic;
 
+    /// NumDiagnosed - The number of diagnostics issued so far, including those
+    /// that were not stored. A call that issues none can be memoized.
+    unsigned NumDiagnosed;
+
+    /// NumEvaluatingDeclAccesses - The number of times the in-flight value of
+    /// EvaluatingDecl has been accessed. A call that does so depends on more
+    /// than its arguments, and can't be memoized.
+    unsigned NumEvaluatingDeclAccesses;
+
     enum EvaluationMode {
       /// Evaluate as a constant expression. Stop if we find that the expression
       /// is not a constant expression.
@@ -490,11 +505,12 @@ namespace {
 
     EvalInfo(const ASTContext &C, Expr::EvalStatus &S, EvaluationMode Mode)
       : Ctx(const_cast<ASTContext&>(C)), EvalStatus(S), CurrentCall(0),
-        CallStackDepth(0), NextCallIndex(1),
+        CallStackDepth(0), MaxCallStackDepth(0), NextCallIndex(1),
         StepsLeft(getLangOpts().ConstexprStepLimit),
         BottomFrame(*this, SourceLocation(), 0, 0, 0),
         EvaluatingDecl((const ValueDecl*)0), EvaluatingDeclValue(0),
-        HasActiveDiagnostic(false), EvalMode(Mode) {}
+        HasActiveDiagnostic(false), NumDiagnosed(0),
+        NumEvaluatingDeclAccesses(0), EvalMode(Mode) {}
 
     void setEvaluatingDecl(APValue::LValueBase Base, APValue &Value) {
       EvaluatingDecl = Base;
@@ -555,6 +571,7 @@ namespace {
     OptionalDiagnostic Diag(SourceLocation Loc, diag::kind DiagId
                               = diag::note_invalid_subexpr_in_const_expr,
                             unsigned ExtraNotes = 0) {
+      ++NumDiagnosed;
       if (EvalStatus.Diag) {
         // If we have a prior diagnostic, it will be noting that the expression
         // isn't a constant expression. This diagnostic is more important,
@@ -602,6 +619,7 @@ namespace {
                             unsigned ExtraNotes = 0) {
       if (EvalStatus.Diag)
         return Diag(E->getExprLoc(), DiagId, ExtraNotes);
+      ++NumDiagnosed;
       HasActiveDiagnostic = false;
       return OptionalDiagnostic();
     }
@@ -618,6 +636,7 @@ namespace {
       // Don't override a previous diagnostic. Don't bother collecting
       // diagnostics if we're evaluating for overflow.
       if (!EvalStatus.Diag || !EvalStatus.Diag->empty()) {
+        ++NumDiagnosed;
         HasActiveDiagnostic = false;
         return OptionalDiagnostic();
       }
@@ -797,6 +816,8 @@ CallStackFrame::CallStackFrame(EvalInfo &Info, SourceLocation CallLoc,
       Index(Info.NextCallIndex++), This(This), Arguments(Arguments) {
   Info.CurrentCall = this;
   ++Info.CallStackDepth;
+  Info.MaxCallStackDepth = std::max(Info.MaxCallStackDepth,
+                                    Info.CallStackDepth);
 }
 
 CallStackFrame::~CallStackFrame() {
@@ -1918,6 +1939,7 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   // If we're currently evaluating the initializer of this declaration, use that
   // in-flight value.
   if (Info.EvaluatingDecl.dyn_cast<const ValueDecl*>() == VD) {
+    ++Info.NumEvaluatingDeclAccesses;
     Result = Info.EvaluatingDeclValue;
     return true;
   }
@@ -2447,6 +2469,7 @@ CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E, AccessKinds AK,
         // OK, we can read and modify an object if we're in the process of
         // evaluating its initializer, because its lifetime began in this
         // evaluation.
+        ++Info.NumEvaluatingDeclAccesses;
       } else if (AK != AK_Read) {
         // All the remaining cases only permit reading.
         Info.Diag(E, diag::note_constexpr_modify_global);
@@ -2519,6 +2542,8 @@ CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E, AccessKinds AK,
           Info.Note(MTE->getExprLoc(), diag::note_constexpr_temporary_here);
           return CompleteObject();
         }
+        if (VD && VD->getCanonicalDecl() == ED->getCanonicalDecl())
+          ++Info.NumEvaluatingDeclAccesses;
 
         BaseVal = Info.Ctx.getMaterializedTemporaryValue(MTE, false);
         assert(BaseVal && "got reference to unevaluated temporary");
@@ -3557,6 +3582,109 @@ static bool EvaluateArgs(ArrayRef<const Expr*> Args, ArgVector &ArgValues,
   return Success;
 }
 
+namespace {
+/// Memoizes the result of a call to a constexpr function in the ASTContext,
+/// if its evaluation depended on nothing but the callee and its arguments.
+class CallMemoizer {
+  EvalInfo &Info;
+  const FunctionDecl *Callee;
+  ArrayRef<APValue> Args;
+  bool Enabled;
+
+  /// The state of the evaluation at the start of the call.
+  unsigned CallStackDepth;
+  unsigned SavedMaxCallStackDepth;
+  unsigned StepsLeft;
+  unsigned NumDiagnosed;
+  unsigned NumEvaluatingDeclAccesses;
+
+  bool canMemoize(const LValue *This) const {
+    // A member function can depend on the object it is called on.
+    if (This || !ConstexprCallCache::canMemoizeArgs(Args))
+      return false;
+    // In the other modes, and after a side-effect, evaluation doesn't stop
+    // at the first problem, and can't read the variables of a call.
+    switch (Info.EvalMode) {
+    case EvalInfo::EM_ConstantExpression:
+    case EvalInfo::EM_ConstantFold:
+    case EvalInfo::EM_IgnoreSideEffects:
+      return !Info.EvalStatus.HasSideEffects;
+    case EvalInfo::EM_PotentialConstantExpression:
+    case EvalInfo::EM_EvaluateForOverflow:
+      return false;
+    }
+    llvm_unreachable("Missed EvalMode case");
+  }
+
+public:
+  CallMemoizer(EvalInfo &Info, const FunctionDecl *Callee, const LValue *This,
+               ArrayRef<APValue> Args)
+    : Info(Info), Callee(Callee), Args(Args), Enabled(canMemoize(This)),
+      CallStackDepth(Info.CallStackDepth),
+      SavedMaxCallStackDepth(Info.MaxCallStackDepth),
+      StepsLeft(Info.StepsLeft), NumDiagnosed(Info.NumDiagnosed),
+      NumEvaluatingDeclAccesses(Info.NumEvaluatingDeclAccesses) {
+    Info.MaxCallStackDepth = CallStackDepth;
+  }
+
+  ~CallMemoizer() {
+    Info.MaxCallStackDepth = std::max(SavedMaxCallStackDepth,
+                                      Info.MaxCallStackDepth);
+  }
+
+  /// Find the result of the call, if it has been memoized.
+  bool lookup(APValue &Result) {
+    unsigned Depth;
+    // The innermost call must pass CheckCallLimit.
+    if (!Enabled ||
+        !Info.Ctx.getConstexprCallCache().lookup(
+            Callee, Args, Info.getLangOpts().ConstexprCallDepth + 1 -
+                              CallStackDepth,
+            Info.StepsLeft, Depth, Result))
+      return false;
+    Info.MaxCallStackDepth = CallStackDepth + Depth;
+    return true;
+  }
+
+  /// Memoize the result of the call, which has been evaluated successfully,
+  /// if it depended on nothing else.
+  void store(const APValue &Result) {
+    if (!Enabled || Info.NumDiagnosed != NumDiagnosed ||
+        Info.NumEvaluatingDeclAccesses != NumEvaluatingDeclAccesses ||
+        Info.EvalStatus.HasSideEffects ||
+        !ConstexprCallCache::canMemoizeResult(Result))
+      return;
+    Info.Ctx.getConstexprCallCache().insert(
+        Callee, Args, Result, StepsLeft - Info.StepsLeft,
+        Info.MaxCallStackDepth - CallStackDepth);
+  }
+};
+}
+
+/// Try to evaluate a call to the constexpr function \p Callee, whose arguments
+/// have been evaluated, with the bytecode interpreter. Returns false, without
+/// any effect, if the interpreter can't evaluate it.
+static bool HandleFunctionCallWithBytecode(EvalInfo &Info,
+                                           const FunctionDecl *Callee,
+                                           ArrayRef<APValue> ArgValues,
+                                           APValue &Result) {
+  // The interpreter doesn't produce diagnostics, so leave checking whether
+  // a function can be constant to the tree walker.
+  if (!Info.getLangOpts().ConstexprBytecode ||
+      Info.checkingPotentialConstantExpression())
+    return false;
+
+  unsigned MaxDepth =
+    Info.getLangOpts().ConstexprCallDepth - Info.CallStackDepth;
+  unsigned Depth;
+  if (!Info.Ctx.getConstexprInterpreter().evaluateCall(
+          Callee, ArgValues, MaxDepth, Info.StepsLeft, Depth, Result))
+    return false;
+  Info.MaxCallStackDepth = std::max(Info.MaxCallStackDepth,
+                                    Info.CallStackDepth + Depth);
+  return true;
+}
+
 /// Evaluate a function call.
 static bool HandleFunctionCall(SourceLocation CallLoc,
                                const FunctionDecl *Callee, const LValue *This,
@@ -3569,6 +3697,16 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
   if (!Info.CheckCallLimit(CallLoc))
     return false;
 
+  CallMemoizer Memo(Info, Callee, This, ArgValues);
+  if (Memo.lookup(Result))
+    return true;
+
+  if (!This &&
+      HandleFunctionCallWithBytecode(Info, Callee, ArgValues, Result)) {
+    Memo.store(Result);
+    return true;
+  }
+
   CallStackFrame Frame(Info, CallLoc, Callee, This, ArgValues.data());
 
   // For a trivial copy or move assignment, perform an APValue copy. This is
@@ -3597,7 +3735,10 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
       return true;
     Info.Diag(Callee->getLocEnd(), diag::note_constexpr_no_return);
   }
-  return ESR == ESR_Returned;
+  if (ESR != ESR_Returned)
+    return false;
+  Memo.store(Result);
+  return true;
 }
 
 /// Evaluate a constructor call.
@@ -51,7 +51,7 @@ static StmtClassNameTable &getStmtInfoTableEntry(Stmt::StmtClass E) {
 
 void *Stmt::operator new(size_t bytes, const ASTContext &C,
                          unsigned alignment) {
-  return ::operator new(bytes, C, alignment);
+  return C.AllocateStmt(bytes, alignment);
 }
 
 const char *Stmt::getStmtClassName() const {
@@ -271,7 +271,8 @@ CompoundStmt::CompoundStmt(const ASTContext &C, ArrayRef<Stmt *> Stmts,
     return;
   }
 
-  Body = new (C) Stmt *[Stmts.size()];
+  Body = static_cast<Stmt **>(
+      C.AllocateStmt(sizeof(Stmt *) * Stmts.size()));
   std::copy(Stmts.begin(), Stmts.end(), Body);
 }
 
@@ -865,7 +866,8 @@ void IfStmt::setConditionVariable(const ASTContext &C, VarDecl *V) {
 ForStmt::ForStmt(const ASTContext &C, Stmt *Init, Expr *Cond, VarDecl *condVar,
                  Expr *Inc, Stmt *Body, SourceLocation FL, SourceLocation LP,
                  SourceLocation RP)
-    : Stmt(ForStmtClass), ForLoc(FL), LParenLoc(LP), RParenLoc(RP) {
+    : Stmt(ForStmtClass), ForLoc(FL), LParenLoc(LP), RParenLoc(RP),
+      SpawnLoopCount(0) {
   SubExprs[INIT] = Init;
   setConditionVariable(C, condVar);
   SubExprs[COND] = Cond;
@@ -2068,6 +2068,8 @@ void StmtPrinter::VisitCilkForGrainsizeStmt(CilkForGrainsizeStmt *Node) {
 }
 
 void StmtPrinter::VisitCilkForStmt(CilkForStmt *Node) {
+  if (Node->hasAffinity())
+    Indent() << "#pragma cilk affinity\n";
   Indent() << "_Cilk_for (";
   if (Node->getInit()) {
     if (DeclStmt *DS = dyn_cast<DeclStmt>(Node->getInit()))
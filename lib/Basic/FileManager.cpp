@@ -26,6 +26,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <ctime>
 #include <map>
 #include <set>
 #include <string>
@@ -105,7 +106,8 @@ FileManager::FileManager(const FileSystemOptions &FSO)
   : FileSystemOpts(FSO),
     UniqueRealDirs(*new UniqueDirContainer()),
     UniqueRealFiles(*new UniqueFileContainer()),
-    SeenDirEntries(64), SeenFileEntries(64), NextFileUID(0) {
+    SeenDirEntries(64), SeenFileEntries(64), NextFileUID(0),
+    LookupGeneration(0) {
   NumDirLookups = NumFileLookups = 0;
   NumDirCacheMisses = NumFileCacheMisses = 0;
 }
@@ -230,9 +232,10 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
 
   // See if there was already an entry in the map.  Note that the map
   // contains both virtual and real directories.
-  if (NamedDirEnt.getValue())
-    return NamedDirEnt.getValue() == NON_EXISTENT_DIR
-              ? 0 : NamedDirEnt.getValue();
+  DirectoryEntry *CachedDir = NamedDirEnt.getValue();
+  bool Stale = isStaleLookup(DirLookupGenerations, DirName);
+  if (CachedDir && !Stale)
+    return CachedDir == NON_EXISTENT_DIR ? 0 : CachedDir;
 
   ++NumDirCacheMisses;
 
@@ -266,6 +269,22 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
     UDE.Name  = InterndDirName;
   }
 
+  // Remember when the directory was modified, to tell later whether the
+  // files that weren't found in it may have been created since.
+  std::pair<llvm::DenseMap<const DirectoryEntry *, RealDirStatus>::iterator,
+            bool> Known = RealDirStatuses.insert(
+                            std::make_pair(&UDE, RealDirStatus()));
+  RealDirStatus &Status = Known.first->second;
+  if (Known.second || Stale) {
+    if (Stale && (Known.second || CachedDir != &UDE ||
+                  Status.ModTime != Data.ModTime || Status.ModTimeIsRacy))
+      Status.ChangedGeneration = LookupGeneration;
+    else if (Known.second)
+      Status.ChangedGeneration = 0;
+    Status.ModTime = Data.ModTime;
+    Status.ModTimeIsRacy = Data.ModTime + 1 >= std::time(0);
+  }
+
   return &UDE;
 }
 
@@ -277,10 +296,16 @@ const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
   llvm::StringMapEntry<FileEntry *> &NamedFileEnt =
     SeenFileEntries.GetOrCreateValue(Filename);
 
-  // See if there is already an entry in the map.
-  if (NamedFileEnt.getValue())
-    return NamedFileEnt.getValue() == NON_EXISTENT_FILE
-                 ? 0 : NamedFileEnt.getValue();
+  // See if there is already an entry in the map. A file that was found by
+  // an earlier compilation is stat'ed again; one that wasn't is only looked
+  // for again if its directory has changed.
+  FileEntry *CachedFile = NamedFileEnt.getValue();
+  bool Stale = isStaleLookup(FileLookupGenerations, Filename);
+  if (CachedFile == NON_EXISTENT_FILE && Stale &&
+      isMissingFileUnchanged(Filename))
+    Stale = false;
+  if (CachedFile && !Stale)
+    return CachedFile == NON_EXISTENT_FILE ? 0 : CachedFile;
 
   ++NumFileCacheMisses;
 
@@ -336,6 +361,11 @@ const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
     if (FileDescriptor != -1)
       close(FileDescriptor);
 
+    // The file may have been modified since an earlier compilation saw it.
+    if (Stale) {
+      UFE.Size = Data.Size;
+      UFE.ModTime = Data.ModTime;
+    }
     return &UFE;
   }
 
@@ -529,6 +559,37 @@ void FileManager::invalidateCache(const FileEntry *Entry) {
   UniqueRealFiles.erase(Entry);
 }
 
+bool FileManager::isStaleLookup(
+    llvm::StringMap<unsigned, llvm::BumpPtrAllocator> &Gens, StringRef Name) {
+  if (!LookupGeneration)
+    return false;
+  unsigned &Gen = Gens.GetOrCreateValue(Name).getValue();
+  if (Gen == LookupGeneration)
+    return false;
+  Gen = LookupGeneration;
+  return true;
+}
+
+bool FileManager::isMissingFileUnchanged(StringRef Filename) {
+  // This checks the directory itself again, once per revalidation.
+  const DirectoryEntry *Dir = getDirectoryFromFile(*this, Filename,
+                                                   /*CacheFailure=*/true);
+  // No file can have been created in a directory that still doesn't exist.
+  if (!Dir)
+    return true;
+
+  llvm::DenseMap<const DirectoryEntry *, RealDirStatus>::const_iterator
+    Known = RealDirStatuses.find(Dir);
+  return Known != RealDirStatuses.end() &&
+         Known->second.ChangedGeneration != LookupGeneration;
+}
+
+bool FileManager::revalidateLookups() {
+  if (!VirtualFileEntries.empty() || !VirtualDirectoryEntries.empty())
+    return false;
+  ++LookupGeneration;
+  return true;
+}
 
 void FileManager::GetUniqueIDMapping(
                    SmallVectorImpl<const FileEntry *> &UIDToFiles) const {
@@ -0,0 +1,290 @@
+//===--- PersistentStatCache.cpp - On-disk cache of 'stat' calls ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PersistentStatCache used by -fstat-cache.
+//
+//  The cache file consists of a 4-byte signature, an OnDiskChainedHashTable
+//  mapping lookup keys to entries, and the 32-bit offset of the table's
+//  buckets. A key is 'F' or 'D', depending on whether a file or a directory
+//  was looked up, followed by the absolute path.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PersistentStatCache.h"
+#include "clang/Basic/OnDiskHashTable.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cstring>
+using namespace clang;
+
+/// \brief The signature at the start of a cache file. The last character is
+/// the format version.
+static const char StatCacheSignature[4] = { 'C', 'S', 'C', '1' };
+
+namespace {
+
+class StatCacheTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+  typedef PersistentStatCache::Entry data_type;
+  typedef const PersistentStatCache::Entry &data_type_ref;
+  typedef StringRef internal_key_type;
+  typedef StringRef external_key_type;
+
+  static unsigned ComputeHash(StringRef Key) {
+    return llvm::HashString(Key);
+  }
+
+  static std::pair<unsigned, unsigned>
+  EmitKeyDataLength(raw_ostream &Out, StringRef Key, data_type_ref Data) {
+    unsigned DataLen = 8 + 1 + (Data.Exists ? 4 * 8 : 0);
+    io::Emit16(Out, Key.size());
+    io::Emit8(Out, DataLen);
+    return std::make_pair((unsigned)Key.size(), DataLen);
+  }
+
+  static void EmitKey(raw_ostream &Out, StringRef Key, unsigned) {
+    Out << Key;
+  }
+
+  static void EmitData(raw_ostream &Out, StringRef, data_type_ref Data,
+                       unsigned) {
+    io::Emit64(Out, Data.ParentStamp);
+    io::Emit8(Out, Data.Exists);
+    if (!Data.Exists)
+      return;
+    io::Emit64(Out, Data.Data.UniqueID.getDevice());
+    io::Emit64(Out, Data.Data.UniqueID.getFile());
+    io::Emit64(Out, Data.Data.Size);
+    io::Emit64(Out, Data.Data.ModTime);
+  }
+
+  static StringRef GetInternalKey(StringRef Key) { return Key; }
+  static StringRef GetExternalKey(StringRef Key) { return Key; }
+
+  static bool EqualKey(StringRef A, StringRef B) { return A == B; }
+
+  static std::pair<unsigned, unsigned>
+  ReadKeyDataLength(const unsigned char *&D) {
+    unsigned KeyLen = io::ReadUnalignedLE16(D);
+    unsigned DataLen = *D++;
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  static StringRef ReadKey(const unsigned char *D, unsigned N) {
+    return StringRef((const char *)D, N);
+  }
+
+  static data_type ReadData(StringRef, const unsigned char *D, unsigned) {
+    data_type Result;
+    Result.ParentStamp = io::ReadUnalignedLE64(D);
+    Result.Exists = *D++;
+    if (!Result.Exists)
+      return Result;
+    uint64_t Device = io::ReadUnalignedLE64(D);
+    uint64_t File = io::ReadUnalignedLE64(D);
+    Result.Data.UniqueID = llvm::sys::fs::UniqueID(Device, File);
+    Result.Data.Size = io::ReadUnalignedLE64(D);
+    Result.Data.ModTime = io::ReadUnalignedLE64(D);
+    // Only successful directory lookups are cached; see getStat.
+    Result.Data.IsDirectory = true;
+    Result.Data.IsNamedPipe = false;
+    Result.Data.InPCH = false;
+    return Result;
+  }
+};
+
+typedef OnDiskChainedHashTable<StatCacheTrait> StatCacheTable;
+
+} // end anonymous namespace
+
+PersistentStatCache::PersistentStatCache(StringRef Path, StringRef WD)
+  : CachePath(Path), WorkingDir(WD), Table(0), NumHits(0), NumMisses(0) {
+  if (WorkingDir.empty())
+    llvm::sys::fs::current_path(WorkingDir);
+
+  // Directories modified in the last couple of seconds may still change
+  // within the granularity of their timestamps.
+  StableBefore = llvm::sys::TimeValue::now().toEpochTime() - 2;
+
+  // A missing or malformed cache is simply treated as empty; write() will
+  // replace it.
+  if (llvm::MemoryBuffer::getFile(CachePath, Buffer) != llvm::errc::success)
+    return;
+
+  const unsigned char *Start =
+    (const unsigned char *)Buffer->getBufferStart();
+  size_t Size = Buffer->getBufferSize();
+  if (Size < sizeof(StatCacheSignature) + 3 * 4 ||
+      memcmp(Start, StatCacheSignature, sizeof(StatCacheSignature)) != 0) {
+    Buffer.reset();
+    return;
+  }
+
+  const unsigned char *TableOffsetPtr = Start + Size - 4;
+  uint32_t TableOffset = io::ReadUnalignedLE32(TableOffsetPtr);
+  if ((TableOffset & 0x3) != 0 || TableOffset < sizeof(StatCacheSignature) ||
+      TableOffset + 2 * 4 > Size - 4) {
+    Buffer.reset();
+    return;
+  }
+
+  const unsigned char *Buckets = Start + TableOffset;
+  const unsigned char *Header = Buckets;
+  uint64_t NumBuckets = io::ReadUnalignedLE32(Header);
+  if (TableOffset + 2 * 4 + NumBuckets * 4 > Size - 4) {
+    Buffer.reset();
+    return;
+  }
+
+  Table = StatCacheTable::Create(Buckets, Start);
+}
+
+PersistentStatCache::~PersistentStatCache() {
+  delete (StatCacheTable *)Table;
+}
+
+uint64_t PersistentStatCache::getDirectoryStamp(StringRef Dir) {
+  llvm::StringMapEntry<uint64_t> &Stamp =
+    DirStamps.GetOrCreateValue(Dir, ~0ULL);
+  if (Stamp.getValue() != ~0ULL)
+    return Stamp.getValue();
+
+  llvm::sys::fs::file_status Status;
+  uint64_t ModTime = 0;
+  if (!llvm::sys::fs::status(Dir, Status) && is_directory(Status))
+    ModTime = Status.getLastModificationTime().toEpochTime();
+
+  Stamp.setValue(ModTime && ModTime < StableBefore ? ModTime + 1 : 0);
+  return Stamp.getValue();
+}
+
+PersistentStatCache::LookupResult
+PersistentStatCache::getStat(const char *Path, FileData &Data, bool isFile,
+                             int *FileDescriptor) {
+  // The same path can be both a failed file lookup and a successful directory
+  // lookup, so the kind of lookup is part of the key.
+  SmallString<256> Key;
+  Key += isFile ? 'F' : 'D';
+  if (llvm::sys::path::is_relative(Path))
+    Key += WorkingDir;
+  llvm::sys::path::append(Key, Path);
+
+  StringRef AbsPath = Key.str().substr(1);
+  StringRef Parent = llvm::sys::path::parent_path(AbsPath);
+  uint64_t ParentStamp = Parent.empty() ? 0 : getDirectoryStamp(Parent);
+  if (!ParentStamp || Key.size() > 0xFFFF)
+    return statChained(Path, Data, isFile, FileDescriptor);
+
+  if (Table) {
+    StatCacheTable *T = (StatCacheTable *)Table;
+    StatCacheTable::iterator I = T->find(Key.str());
+    if (I != T->end()) {
+      Entry E = *I;
+      if (E.ParentStamp == ParentStamp) {
+        ++NumHits;
+        if (!E.Exists)
+          return CacheMissing;
+        Data = E.Data;
+        return CacheExists;
+      }
+    }
+  }
+
+  LookupResult Result = statChained(Path, Data, isFile, FileDescriptor);
+  if (Result == CacheExists && (isFile || !Data.IsDirectory))
+    return Result;
+
+  ++NumMisses;
+  Entry &E = NewEntries[Key.str()];
+  E.ParentStamp = ParentStamp;
+  E.Exists = Result == CacheExists;
+  if (E.Exists)
+    E.Data = Data;
+  return Result;
+}
+
+bool PersistentStatCache::write(std::string &ErrorInfo) {
+  if (NewEntries.empty())
+    return false;
+
+  OnDiskChainedHashTableGenerator<StatCacheTrait> Generator;
+  for (llvm::StringMap<Entry>::iterator I = NewEntries.begin(),
+                                        E = NewEntries.end();
+       I != E; ++I)
+    Generator.insert(I->getKey(), I->getValue());
+
+  // Carry over the entries of the old file that weren't replaced, unless this
+  // process has seen that they are out of date.
+  if (Table) {
+    StatCacheTable *T = (StatCacheTable *)Table;
+    for (StatCacheTable::key_iterator I = T->key_begin(), E = T->key_end();
+         I != E; ++I) {
+      StringRef Key = *I;
+      if (NewEntries.count(Key))
+        continue;
+
+      Entry Old = *T->find(Key);
+      StringRef Parent = llvm::sys::path::parent_path(Key.substr(1));
+      llvm::StringMap<uint64_t>::iterator Stamp = DirStamps.find(Parent);
+      if (Stamp != DirStamps.end() && Stamp->getValue() != Old.ParentStamp)
+        continue;
+
+      Generator.insert(Key, Old);
+    }
+  }
+
+  SmallString<4096> Contents;
+  {
+    llvm::raw_svector_ostream Out(Contents);
+    Out.write(StatCacheSignature, sizeof(StatCacheSignature));
+    io::Offset TableOffset = Generator.Emit(Out);
+    io::Emit32(Out, TableOffset);
+  }
+
+  // Write to a temporary file and rename it over the cache, so concurrent
+  // readers see either the old or the new cache in full.
+  SmallString<128> TmpPath;
+  int TmpFD;
+  if (llvm::error_code EC = llvm::sys::fs::createUniqueFile(
+          CachePath + "-%%%%%%%%", TmpFD, TmpPath)) {
+    ErrorInfo = EC.message();
+    return true;
+  }
+
+  {
+    llvm::raw_fd_ostream Out(TmpFD, /*shouldClose=*/true);
+    Out << Contents.str();
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      ErrorInfo = "error writing '" + TmpPath.str().str() + "'";
+      bool Existed;
+      llvm::sys::fs::remove(TmpPath.str(), Existed);
+      return true;
+    }
+  }
+
+  if (llvm::error_code EC = llvm::sys::fs::rename(TmpPath.str(), CachePath)) {
+    ErrorInfo = EC.message();
+    bool Existed;
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    return true;
+  }
+
+  NewEntries.clear();
+  return false;
+}
@@ -418,6 +418,7 @@ void SourceManager::clearIDTables() {
   LastLineNoFileIDQuery = FileID();
   LastLineNoContentCache = 0;
   LastFileIDLookup = FileID();
+  NumCreatedFIDs.clear();
 
   if (LineTable)
     LineTable->clear();
@@ -1854,8 +1855,8 @@ void SourceManager::computeMacroArgsCache(MacroArgsMap *&CachePtr,
 
       // Skip the files/macros of the #include'd file, we only care about macros
       // that lexed macro arguments from our file.
-      if (Entry.getFile().NumCreatedFIDs)
-        ID += Entry.getFile().NumCreatedFIDs - 1/*because of next ++ID*/;
+      if (unsigned NumFIDs = getNumCreatedFIDsForFileID(FileID::get(ID)))
+        ID += NumFIDs - 1/*because of next ++ID*/;
       continue;
     }
 
@@ -2156,18 +2157,56 @@ void SourceManager::PrintStats() const {
                << " loaded SLocEntries allocated, "
                << MaxLoadedOffset - CurrentLoadedOffset
                << "B of Sloc address space used.\n";
+
+  // Break the local entries down by kind; macro argument expansions tend to
+  // dominate in macro-heavy code. Entry #0 is the dummy expansion.
+  unsigned NumFileEntries = 0, NumMacroBodyEntries = 0, NumMacroArgEntries = 0;
+  for (unsigned I = 1, N = LocalSLocEntryTable.size(); I < N; ++I) {
+    const SrcMgr::SLocEntry &Entry = LocalSLocEntryTable[I];
+    if (Entry.isFile())
+      ++NumFileEntries;
+    else if (Entry.getExpansion().isMacroArgExpansion())
+      ++NumMacroArgEntries;
+    else
+      ++NumMacroBodyEntries;
+  }
+  llvm::errs() << "Local SLocEntry's: " << NumFileEntries << " files, "
+               << NumMacroBodyEntries << " macro expansions, "
+               << NumMacroArgEntries << " macro argument expansions, "
+               << sizeof(SrcMgr::SLocEntry) << " bytes each.\n";
   
   unsigned NumLineNumsComputed = 0;
   unsigned NumFileBytesMapped = 0;
+  size_t LineCacheBytes = 0;
   for (fileinfo_iterator I = fileinfo_begin(), E = fileinfo_end(); I != E; ++I){
     NumLineNumsComputed += I->second->SourceLineCache != 0;
     NumFileBytesMapped  += I->second->getSizeBytesMapped();
+    if (I->second->SourceLineCache)
+      LineCacheBytes += I->second->NumLines * sizeof(unsigned);
   }
   unsigned NumMacroArgsComputed = MacroArgsCacheMap.size();
+  unsigned NumMacroArgChunks = 0;
+  for (llvm::DenseMap<FileID, MacroArgsMap *>::const_iterator
+         I = MacroArgsCacheMap.begin(), E = MacroArgsCacheMap.end();
+       I != E; ++I)
+    NumMacroArgChunks += I->second->size();
 
   llvm::errs() << NumFileBytesMapped << " bytes of files mapped, "
                << NumLineNumsComputed << " files with line #'s computed, "
                << NumMacroArgsComputed << " files with macro args computed.\n";
+
+  // The memory used by the tables and caches, other than file contents.
+  size_t SLocTableBytes = llvm::capacity_in_bytes(LocalSLocEntryTable) +
+                          llvm::capacity_in_bytes(LoadedSLocEntryTable) +
+                          SLocEntryLoaded.capacity() / 8;
+  size_t LookupCacheBytes = llvm::capacity_in_bytes(IncludedLocMap) +
+                            llvm::capacity_in_bytes(IBTUCache) +
+                            llvm::capacity_in_bytes(MacroArgsCacheMap) +
+                            llvm::capacity_in_bytes(NumCreatedFIDs);
+  llvm::errs() << "Memory: " << SLocTableBytes << " bytes of SLocEntry tables, "
+               << LineCacheBytes << " bytes of line caches, "
+               << LookupCacheBytes << " bytes of lookup caches, "
+               << NumMacroArgChunks << " macro argument chunks cached.\n";
   llvm::errs() << "FileID scans: " << NumLinearScans << " linear, "
                << NumBinaryProbes << " binary.\n";
 }
@@ -2199,7 +2238,8 @@ size_t SourceManager::getDataStructureSizes() const {
     + llvm::capacity_in_bytes(LocalSLocEntryTable)
     + llvm::capacity_in_bytes(LoadedSLocEntryTable)
     + llvm::capacity_in_bytes(SLocEntryLoaded)
-    + llvm::capacity_in_bytes(FileInfos);
+    + llvm::capacity_in_bytes(FileInfos)
+    + llvm::capacity_in_bytes(NumCreatedFIDs);
   
   if (OverriddenFilesInfo)
     size += llvm::capacity_in_bytes(OverriddenFilesInfo->OverriddenFiles);
@@ -0,0 +1,191 @@
+//===--- ThreadPool.cpp - Fixed-size pool of worker threads ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ThreadPool class on top of pthreads. Hosts
+//  without them run every task synchronously.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/ThreadPool.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Threading.h"
+#include <deque>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define CLANG_THREADPOOL_USE_PTHREADS 1
+#endif
+
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
+using namespace clang;
+
+/// \brief The stack size of worker threads, which matches the one libclang
+/// uses for parsing on a separate thread.
+static const size_t WorkerStackSize = 8 << 20;
+
+#ifdef CLANG_THREADPOOL_USE_PTHREADS
+
+class ThreadPool::Impl {
+  pthread_mutex_t Lock;
+  /// \brief Signalled when a task is queued or the pool is stopping.
+  pthread_cond_t QueueChanged;
+  /// \brief Signalled when the last running task finishes.
+  pthread_cond_t AllDone;
+
+  std::deque<std::pair<TaskFn, void *> > Tasks;
+  unsigned NumRunning;
+  bool Stopping;
+  std::vector<pthread_t> Threads;
+
+  static void *workerMain(void *Arg) {
+    static_cast<Impl *>(Arg)->work();
+    return 0;
+  }
+
+  void work() {
+    pthread_mutex_lock(&Lock);
+    for (;;) {
+      while (Tasks.empty() && !Stopping)
+        pthread_cond_wait(&QueueChanged, &Lock);
+      if (Tasks.empty())
+        break;
+
+      std::pair<TaskFn, void *> Task = Tasks.front();
+      Tasks.pop_front();
+      ++NumRunning;
+      pthread_mutex_unlock(&Lock);
+
+      Task.first(Task.second);
+
+      pthread_mutex_lock(&Lock);
+      --NumRunning;
+      if (Tasks.empty() && NumRunning == 0)
+        pthread_cond_broadcast(&AllDone);
+    }
+    pthread_mutex_unlock(&Lock);
+  }
+
+public:
+  Impl() : NumRunning(0), Stopping(false) {
+    pthread_mutex_init(&Lock, 0);
+    pthread_cond_init(&QueueChanged, 0);
+    pthread_cond_init(&AllDone, 0);
+  }
+
+  ~Impl() {
+    pthread_mutex_lock(&Lock);
+    Stopping = true;
+    pthread_cond_broadcast(&QueueChanged);
+    pthread_mutex_unlock(&Lock);
+    for (unsigned I = 0, N = Threads.size(); I != N; ++I)
+      pthread_join(Threads[I], 0);
+
+    pthread_cond_destroy(&AllDone);
+    pthread_cond_destroy(&QueueChanged);
+    pthread_mutex_destroy(&Lock);
+  }
+
+  /// \brief Start up to \p NumThreads workers, and return how many started.
+  unsigned start(unsigned NumThreads) {
+    pthread_attr_t Attr;
+    if (pthread_attr_init(&Attr) != 0)
+      return 0;
+    pthread_attr_setstacksize(&Attr, WorkerStackSize);
+    for (unsigned I = 0; I != NumThreads; ++I) {
+      pthread_t Thread;
+      if (pthread_create(&Thread, &Attr, workerMain, this) != 0)
+        break;
+      Threads.push_back(Thread);
+    }
+    pthread_attr_destroy(&Attr);
+    return Threads.size();
+  }
+
+  void async(TaskFn Fn, void *Data) {
+    pthread_mutex_lock(&Lock);
+    Tasks.push_back(std::make_pair(Fn, Data));
+    pthread_cond_signal(&QueueChanged);
+    pthread_mutex_unlock(&Lock);
+  }
+
+  void wait() {
+    pthread_mutex_lock(&Lock);
+    while (!Tasks.empty() || NumRunning != 0)
+      pthread_cond_wait(&AllDone, &Lock);
+    pthread_mutex_unlock(&Lock);
+  }
+};
+
+#else
+
+class ThreadPool::Impl {
+public:
+  unsigned start(unsigned) { return 0; }
+  void async(TaskFn, void *) {}
+  void wait() {}
+};
+
+#endif
+
+ThreadPool::ThreadPool(unsigned NumThreads, bool Background)
+  : TheImpl(0), NumThreads(NumThreads ? NumThreads : getHardwareConcurrency()) {
+  if (this->NumThreads <= 1 && !Background) {
+    this->NumThreads = 1;
+    return;
+  }
+
+  // LLVM's global state is only protected once it knows that there are
+  // several threads.
+  if (!llvm::llvm_is_multithreaded() && !llvm::llvm_start_multithreaded()) {
+    this->NumThreads = 1;
+    return;
+  }
+
+  TheImpl = new Impl();
+  if (unsigned Started = TheImpl->start(this->NumThreads)) {
+    this->NumThreads = Started;
+    return;
+  }
+  delete TheImpl;
+  TheImpl = 0;
+  this->NumThreads = 1;
+}
+
+ThreadPool::~ThreadPool() {
+  if (TheImpl) {
+    TheImpl->wait();
+    delete TheImpl;
+  }
+}
+
+void ThreadPool::async(TaskFn Fn, void *Data) {
+  if (!TheImpl) {
+    Fn(Data);
+    return;
+  }
+  TheImpl->async(Fn, Data);
+}
+
+void ThreadPool::wait() {
+  if (TheImpl)
+    TheImpl->wait();
+}
+
+unsigned ThreadPool::getHardwareConcurrency() {
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  long N = sysconf(_SC_NPROCESSORS_ONLN);
+  if (N > 0)
+    return N;
+#endif
+  return 1;
+}
@@ -0,0 +1,195 @@
+//===--- TimeTrace.cpp - Hierarchical compile-time trace ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the scoped event recorder behind -ftime-trace.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/TimeTrace.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+using namespace clang;
+
+namespace {
+
+struct TimeTraceEntry {
+  uint64_t Start;
+  uint64_t Duration;
+  std::string Name;
+  std::string Detail;
+};
+
+struct TimeTraceTotal {
+  unsigned Count;
+  uint64_t Duration;
+
+  TimeTraceTotal() : Count(0), Duration(0) { }
+};
+
+} // end anonymous namespace
+
+namespace clang {
+
+struct TimeTraceProfiler {
+  uint64_t BeginTime;
+  unsigned Granularity;
+
+  /// \brief The scopes that are still open, innermost last.
+  SmallVector<TimeTraceEntry, 16> Stack;
+
+  /// \brief The completed events, in order of completion.
+  std::vector<TimeTraceEntry> Entries;
+
+  /// \brief Time spent per event name, not counting nested occurrences of
+  /// the same name twice.
+  llvm::StringMap<TimeTraceTotal> Totals;
+};
+
+} // end namespace clang
+
+/// \brief The trace that the current thread records its events into.
+static llvm::ManagedStatic<llvm::sys::ThreadLocal<TimeTraceProfiler> >
+  CurrentProfiler;
+
+static uint64_t getTimeInMicroseconds() {
+  llvm::sys::TimeValue Now = llvm::sys::TimeValue::now();
+  return uint64_t(Now.seconds()) * 1000000 + Now.microseconds();
+}
+
+static void writeEscaped(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (StringRef::iterator I = Str.begin(), E = Str.end(); I != E; ++I) {
+    unsigned char C = *I;
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << "\\u00" << "0123456789abcdef"[C >> 4]
+         << "0123456789abcdef"[C & 0xF];
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void clang::timeTraceProfilerBegin(unsigned GranularityUS) {
+  assert(!CurrentProfiler->get() && "time trace already being recorded");
+  TimeTraceProfiler *Profiler = new TimeTraceProfiler();
+  Profiler->Granularity = GranularityUS;
+  Profiler->BeginTime = getTimeInMicroseconds();
+  CurrentProfiler->set(Profiler);
+}
+
+bool clang::isTimeTraceEnabled() {
+  return CurrentProfiler->get() != 0;
+}
+
+TimeTraceProfiler *clang::getTimeTraceProfiler() {
+  return CurrentProfiler->get();
+}
+
+void clang::setTimeTraceProfiler(TimeTraceProfiler *Profiler) {
+  CurrentProfiler->set(Profiler);
+}
+
+void clang::timeTraceBeginEvent(StringRef Name, StringRef Detail) {
+  TimeTraceProfiler *Profiler = CurrentProfiler->get();
+  if (!Profiler)
+    return;
+
+  TimeTraceEntry E;
+  E.Start = getTimeInMicroseconds() - Profiler->BeginTime;
+  E.Duration = 0;
+  E.Name = Name;
+  E.Detail = Detail;
+  Profiler->Stack.push_back(E);
+}
+
+void clang::timeTraceEndEvent() {
+  // The trace may have been written out while this event was open.
+  TimeTraceProfiler *Profiler = CurrentProfiler->get();
+  if (!Profiler || Profiler->Stack.empty())
+    return;
+
+  TimeTraceEntry E = Profiler->Stack.pop_back_val();
+  E.Duration = getTimeInMicroseconds() - Profiler->BeginTime - E.Start;
+
+  bool Nested = false;
+  for (unsigned I = 0, N = Profiler->Stack.size(); I != N && !Nested; ++I)
+    Nested = Profiler->Stack[I].Name == E.Name;
+  if (!Nested) {
+    TimeTraceTotal &Total = Profiler->Totals[E.Name];
+    ++Total.Count;
+    Total.Duration += E.Duration;
+  }
+
+  if (E.Duration >= Profiler->Granularity)
+    Profiler->Entries.push_back(E);
+}
+
+TimeTraceScope::TimeTraceScope(StringRef Name, StringRef Detail)
+  : Depth(~0U) {
+  if (TimeTraceProfiler *Profiler = CurrentProfiler->get())
+    Depth = Profiler->Stack.size();
+  timeTraceBeginEvent(Name, Detail);
+}
+
+TimeTraceScope::~TimeTraceScope() {
+  if (Depth == ~0U)
+    return;
+
+  // Close this scope along with any event opened inside it and left open,
+  // e.g. by an #include whose end of file was never reached.
+  TimeTraceProfiler *Profiler = CurrentProfiler->get();
+  while (Profiler && Profiler->Stack.size() > Depth)
+    timeTraceEndEvent();
+}
+
+void clang::timeTraceProfilerEnd(raw_ostream &OS) {
+  TimeTraceProfiler *Profiler = CurrentProfiler->get();
+  assert(Profiler && "no time trace being recorded");
+
+  OS << "{\"traceEvents\":[\n";
+  for (unsigned I = 0, N = Profiler->Entries.size(); I != N; ++I) {
+    const TimeTraceEntry &E = Profiler->Entries[I];
+    OS << "{\"pid\":1,\"tid\":0,\"ph\":\"X\",\"ts\":" << E.Start
+       << ",\"dur\":" << E.Duration << ",\"name\":";
+    writeEscaped(OS, E.Name);
+    if (!E.Detail.empty()) {
+      OS << ",\"args\":{\"detail\":";
+      writeEscaped(OS, E.Detail);
+      OS << '}';
+    }
+    OS << "},\n";
+  }
+
+  // Totals are shown as one track per event name, below the main thread.
+  unsigned Tid = 1;
+  for (llvm::StringMap<TimeTraceTotal>::const_iterator
+         I = Profiler->Totals.begin(), E = Profiler->Totals.end();
+       I != E; ++I, ++Tid) {
+    OS << "{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"X\",\"ts\":0,\"dur\":"
+       << I->getValue().Duration << ",\"name\":";
+    writeEscaped(OS, ("Total " + I->getKey()).str());
+    OS << ",\"args\":{\"count\":" << I->getValue().Count << "}},\n";
+  }
+
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\","
+        "\"args\":{\"name\":\"clang\"}}\n";
+  OS << "]}\n";
+
+  delete Profiler;
+  CurrentProfiler->set(0);
+}
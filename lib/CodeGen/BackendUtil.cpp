@@ -11,19 +11,29 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Basic/ThreadPool.h"
 #include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/SchedulerRegistry.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/Timer.h"
@@ -36,6 +46,8 @@
 #include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 using namespace clang;
 using namespace llvm;
 
@@ -98,11 +110,17 @@ private:
   /// the requested target.
   TargetMachine *CreateTargetMachine(bool MustCreateTM);
 
-  /// AddEmitPasses - Add passes necessary to emit assembly or LLVM IR.
+  /// AddEmitPasses - Add passes necessary to emit assembly or LLVM IR to
+  /// \p PM.
   ///
   /// \return True on success.
-  bool AddEmitPasses(BackendAction Action, formatted_raw_ostream &OS,
-                     TargetMachine *TM);
+  bool AddEmitPasses(PassManager &PM, BackendAction Action,
+                     formatted_raw_ostream &OS, TargetMachine *TM);
+
+  /// EmitObjectInParallel - Split the module into parts, and generate the
+  /// code of the first part into the output file and that of each other
+  /// part into one of the ParallelCodeGenOutputs, on as many threads.
+  void EmitObjectInParallel(TargetMachine *TM);
 
 public:
   EmitAssemblyHelper(DiagnosticsEngine &_Diags,
@@ -514,22 +532,18 @@ TargetMachine *EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
   return TM;
 }
 
-bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
+bool EmitAssemblyHelper::AddEmitPasses(PassManager &PM, BackendAction Action,
                                        formatted_raw_ostream &OS,
                                        TargetMachine *TM) {
-
-  // Create the code generator passes.
-  PassManager *PM = getCodeGenPasses(TM);
-
   // Add LibraryInfo.
   llvm::Triple TargetTriple(TheModule->getTargetTriple());
   TargetLibraryInfo *TLI = new TargetLibraryInfo(TargetTriple);
   if (!CodeGenOpts.SimplifyLibCalls)
     TLI->disableAllFunctions();
-  PM->add(TLI);
+  PM.add(TLI);
 
   // Add Target specific analysis passes.
-  TM->addAnalysisPasses(*PM);
+  TM->addAnalysisPasses(PM);
 
   // Normal mode, emit a .s or .o file by running the code generator. Note,
   // this also adds codegenerator level optimization passes.
@@ -546,9 +560,9 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
   // inlining happening.
   if (LangOpts.ObjCAutoRefCount &&
       CodeGenOpts.OptimizationLevel > 0)
-    PM->add(createObjCARCContractPass());
+    PM.add(createObjCARCContractPass());
 
-  if (TM->addPassesToEmitFile(*PM, OS, CGFT,
+  if (TM->addPassesToEmitFile(PM, OS, CGFT,
                               /*DisableVerify=*/!CodeGenOpts.VerifyModule)) {
     Diags.Report(diag::err_fe_unable_to_interface_with_target);
     return false;
@@ -557,6 +571,339 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+// Parallel code generation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The part of the module each global definition is generated in. Those that
+/// aren't listed are generated in part 0.
+typedef DenseMap<const GlobalValue *, unsigned> PartitionMap;
+
+/// The part of a definition that is copied into every part.
+const unsigned AllPartitions = ~0U;
+
+/// A part of the module whose code is generated on a worker thread.
+struct CodeGenPartition {
+  /// The bitcode of the part, which is read into a context of the thread's
+  /// own, as an LLVMContext can't be used by two threads at once.
+  std::string Bitcode;
+  OwningPtr<TargetMachine> TM;
+  OwningPtr<raw_fd_ostream> OS;
+  OwningPtr<formatted_raw_ostream> FormattedOS;
+  OwningPtr<PassManager> Passes;
+  std::string Error;
+};
+}
+
+static unsigned getPartition(const PartitionMap &Partitions,
+                             const GlobalValue *GV) {
+  PartitionMap::const_iterator I = Partitions.find(GV);
+  return I == Partitions.end() ? 0 : I->second;
+}
+
+/// Add the globals that \p C refers to to \p Globals.
+static void
+collectReferencedGlobals(const Constant *C,
+                         SmallPtrSet<const GlobalValue *, 16> &Globals) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+    Globals.insert(GV);
+    return;
+  }
+  for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    if (const Constant *Op = dyn_cast<Constant>(*I))
+      collectReferencedGlobals(Op, Globals);
+}
+
+/// Whether \p F must be generated in the same part as the rest of the module:
+/// its inline assembly may define or refer to local symbols, and the
+/// addresses of its blocks can't be taken from another object file.
+static bool mustStayInFirstPartition(const Function &F, unsigned &Size) {
+  bool Pinned = false;
+  Size = 0;
+  for (Function::const_iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    Size += BB->size();
+    if (BB->hasAddressTaken())
+      Pinned = true;
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I)
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        if (isa<InlineAsm>(*OI) || isa<BlockAddress>(*OI))
+          Pinned = true;
+  }
+  return Pinned;
+}
+
+/// Assign the function definitions of \p M to \p NumPartitions parts of about
+/// the same number of instructions.
+static void partitionModule(const Module &M, unsigned NumPartitions,
+                            PartitionMap &Partitions) {
+  // Aliases, module-level inline assembly and the special globals such as
+  // llvm.used and llvm.global_ctors stay in part 0, along with what they
+  // refer to.
+  SmallPtrSet<const GlobalValue *, 16> Pinned;
+  for (Module::const_alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (const GlobalValue *Aliasee = I->getAliasedGlobal())
+      Pinned.insert(Aliasee);
+  for (Module::const_global_iterator I = M.global_begin(),
+         E = M.global_end(); I != E; ++I) {
+    if (I->hasAppendingLinkage() && I->hasInitializer())
+      collectReferencedGlobals(I->getInitializer(), Pinned);
+    // Copy local constants such as string literals into each part that uses
+    // them rather than making their names visible to the linker.
+    else if (!I->isDeclaration() && I->hasLocalLinkage() &&
+             I->hasUnnamedAddr() && I->isConstant())
+      Partitions[I] = AllPartitions;
+  }
+
+  std::vector<uint64_t> Sizes(NumPartitions);
+  std::vector<const Function *> Functions;
+  SmallVector<std::pair<unsigned, unsigned>, 64> FunctionSizes;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    unsigned Size;
+    if (mustStayInFirstPartition(*I, Size) || Pinned.count(I)) {
+      Sizes[0] += Size;
+      continue;
+    }
+    FunctionSizes.push_back(std::make_pair(Size, Functions.size()));
+    Functions.push_back(I);
+  }
+
+  // Place the largest functions first, each in the smallest part so far.
+  std::sort(FunctionSizes.begin(), FunctionSizes.end(),
+            std::greater<std::pair<unsigned, unsigned> >());
+  for (unsigned I = 0, N = FunctionSizes.size(); I != N; ++I) {
+    unsigned Smallest = 0;
+    for (unsigned P = 1; P != NumPartitions; ++P)
+      if (Sizes[P] < Sizes[Smallest])
+        Smallest = P;
+    Sizes[Smallest] += FunctionSizes[I].first;
+    if (Smallest)
+      Partitions[Functions[FunctionSizes[I].second]] = Smallest;
+  }
+}
+
+/// Whether \p V, which is in part \p Partition, is used from another part.
+static bool isUsedOutsidePartition(const Value *V, unsigned Partition,
+                                   const PartitionMap &Partitions,
+                                   SmallPtrSet<const Value *, 16> &Visited) {
+  for (Value::const_use_iterator I = V->use_begin(), E = V->use_end(); I != E;
+       ++I) {
+    const User *U = *I;
+    if (!Visited.insert(U))
+      continue;
+    const GlobalValue *UserGV = 0;
+    if (const Instruction *Inst = dyn_cast<Instruction>(U))
+      UserGV = Inst->getParent()->getParent();
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U))
+      UserGV = GV;
+    else if (isUsedOutsidePartition(U, Partition, Partitions, Visited))
+      return true;
+    if (UserGV && getPartition(Partitions, UserGV) != Partition)
+      return true;
+  }
+  return false;
+}
+
+/// Give the local definitions of \p M that are used from another part than
+/// their own a name that the parts can be linked by. \p Object is the object
+/// file that the parts are linked into.
+static void
+externalizeCrossPartitionReferences(Module &M, StringRef Object,
+                                    const PartitionMap &Partitions) {
+  // The new names must not clash with those of another object file, even one
+  // that was compiled from the same source the same way, so derive them from
+  // the object file as well as from what the module defines.
+  hash_code Hash = hash_combine(hash_value(Object),
+                                hash_value(StringRef(M.getModuleIdentifier())));
+  SmallVector<GlobalValue *, 64> Locals;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+    else
+      Hash = hash_combine(Hash, I->getName());
+  }
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+    else
+      Hash = hash_combine(Hash, I->getName());
+  }
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+  std::string Suffix = ".pcg." + utohexstr(size_t(Hash));
+
+  for (unsigned I = 0, N = Locals.size(); I != N; ++I) {
+    GlobalValue *GV = Locals[I];
+    unsigned Partition = getPartition(Partitions, GV);
+    if (Partition == AllPartitions)
+      continue;
+    SmallPtrSet<const Value *, 16> Visited;
+    if (!isUsedOutsidePartition(GV, Partition, Partitions, Visited))
+      continue;
+    GV->setName(Twine(GV->hasName() ? GV->getName() : "pcg") + Suffix);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+}
+
+/// Turn the definitions of \p M that aren't generated in part \p Partition
+/// into declarations.
+static void extractPartition(Module &M, unsigned Partition,
+                             const PartitionMap &Partitions) {
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    unsigned P = getPartition(Partitions, I);
+    if (!I->isDeclaration() && P != Partition && P != AllPartitions)
+      I->deleteBody();
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E;) {
+    GlobalVariable *GV = I++;
+    unsigned P = getPartition(Partitions, GV);
+    if (GV->isDeclaration() || P == Partition || P == AllPartitions)
+      continue;
+    if (GV->hasAppendingLinkage()) {
+      GV->eraseFromParent();
+      continue;
+    }
+    GV->setInitializer(0);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  if (Partition != 0) {
+    // An alias is defined in part 0, along with what it refers to.
+    for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+         I != E;) {
+      GlobalAlias *GA = I++;
+      PointerType *Ty = GA->getType();
+      GlobalValue *Decl;
+      if (FunctionType *FTy = dyn_cast<FunctionType>(Ty->getElementType()))
+        Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+      else
+        Decl = new GlobalVariable(M, Ty->getElementType(), false,
+                                  GlobalValue::ExternalLinkage, 0, "", 0,
+                                  GlobalVariable::NotThreadLocal,
+                                  Ty->getAddressSpace());
+      Decl->setVisibility(GA->getVisibility());
+      Decl->takeName(GA);
+      GA->replaceAllUsesWith(Decl);
+      GA->eraseFromParent();
+    }
+    M.setModuleInlineAsm("");
+  }
+
+  PassManager PM;
+  PM.add(createGlobalDCEPass());
+  PM.run(M);
+}
+
+/// Create another target machine like \p TM, for use on another thread.
+static TargetMachine *CloneTargetMachine(TargetMachine *TM) {
+  TargetMachine *Clone = TM->getTarget().createTargetMachine(
+      TM->getTargetTriple(), TM->getTargetCPU(), TM->getTargetFeatureString(),
+      TM->Options, TM->getRelocationModel(), TM->getCodeModel(),
+      TM->getOptLevel());
+  Clone->setMCRelaxAll(TM->hasMCRelaxAll());
+  Clone->setMCSaveTempLabels(TM->hasMCSaveTempLabels());
+  Clone->setMCUseCFI(TM->hasMCUseCFI());
+  Clone->setMCUseDwarfDirectory(TM->hasMCUseDwarfDirectory());
+  Clone->setMCNoExecStack(TM->hasMCNoExecStack());
+  return Clone;
+}
+
+/// Generate the code of a part on a worker thread.
+static void generatePartition(void *Data) {
+  CodeGenPartition &Part = *static_cast<CodeGenPartition *>(Data);
+  LLVMContext Context;
+  OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(Part.Bitcode, "", false));
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context, &Part.Error));
+  if (!M)
+    return;
+  Part.Passes->run(*M);
+  Part.FormattedOS->flush();
+}
+
+void EmitAssemblyHelper::EmitObjectInParallel(TargetMachine *TM) {
+  const std::vector<std::string> &Outputs = CodeGenOpts.ParallelCodeGenOutputs;
+  unsigned NumPartitions = Outputs.size() + 1;
+
+  PartitionMap Partitions;
+  partitionModule(*TheModule, NumPartitions, Partitions);
+  externalizeCrossPartitionReferences(*TheModule,
+                                      CodeGenOpts.ParallelCodeGenObject,
+                                      Partitions);
+
+  // Split off the other parts, and set up their code generators, on this
+  // thread; the target machines and the diagnostics aren't thread-safe. Each
+  // part keeps the debug information of the functions it generates, so the
+  // linked object has a DWARF compile unit per part, all for the same source.
+  std::vector<CodeGenPartition *> Parts;
+  for (unsigned I = 1; I != NumPartitions; ++I) {
+    CodeGenPartition *Part = new CodeGenPartition();
+    Parts.push_back(Part);
+
+    std::string ErrorInfo;
+    const std::string &Path = Outputs[I - 1];
+    Part->OS.reset(new raw_fd_ostream(Path.c_str(), ErrorInfo,
+                                      sys::fs::F_Binary));
+    if (!ErrorInfo.empty()) {
+      Diags.Report(diag::err_fe_unable_to_open_output) << Path << ErrorInfo;
+      DeleteContainerPointers(Parts);
+      return;
+    }
+    Part->FormattedOS.reset(new formatted_raw_ostream(*Part->OS));
+    Part->TM.reset(CloneTargetMachine(TM));
+    Part->Passes.reset(new PassManager());
+    Part->Passes->add(new DataLayout(TheModule));
+    if (!AddEmitPasses(*Part->Passes, Backend_EmitObj, *Part->FormattedOS,
+                       Part->TM.get())) {
+      DeleteContainerPointers(Parts);
+      return;
+    }
+
+    ValueToValueMapTy VMap;
+    OwningPtr<Module> Clone(CloneModule(TheModule, VMap));
+    PartitionMap ClonePartitions;
+    for (PartitionMap::iterator PI = Partitions.begin(),
+           PE = Partitions.end(); PI != PE; ++PI) {
+      Value *V = VMap[PI->first];
+      ClonePartitions[cast<GlobalValue>(V)] = PI->second;
+    }
+    extractPartition(*Clone, I, ClonePartitions);
+
+    raw_string_ostream BitcodeOS(Part->Bitcode);
+    WriteBitcodeToFile(Clone.get(), BitcodeOS);
+    BitcodeOS.flush();
+  }
+  extractPartition(*TheModule, 0, Partitions);
+
+  {
+    ThreadPool Pool(NumPartitions - 1);
+    for (unsigned I = 0, N = Parts.size(); I != N; ++I)
+      Pool.async(generatePartition, Parts[I]);
+    CodeGenPasses->run(*TheModule);
+    Pool.wait();
+  }
+
+  for (unsigned I = 0, N = Parts.size(); I != N; ++I)
+    if (!Parts[I]->Error.empty())
+      Diags.Report(diag::err_fe_error_backend) << Parts[I]->Error;
+  DeleteContainerPointers(Parts);
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action, raw_ostream *OS) {
   TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : 0);
   llvm::formatted_raw_ostream FormattedOS;
@@ -584,7 +931,7 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action, raw_ostream *OS) {
 
   default:
     FormattedOS.setStream(*OS, formatted_raw_ostream::PRESERVE_STREAM);
-    if (!AddEmitPasses(Action, FormattedOS, TM))
+    if (!AddEmitPasses(*getCodeGenPasses(TM), Action, FormattedOS, TM))
       return;
   }
 
@@ -612,7 +959,11 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action, raw_ostream *OS) {
 
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses->run(*TheModule);
+    if (Action == Backend_EmitObj &&
+        !CodeGenOpts.ParallelCodeGenOutputs.empty())
+      EmitObjectInParallel(TM);
+    else
+      CodeGenPasses->run(*TheModule);
   }
 }
 
@@ -20,6 +20,7 @@
 #include "clang/AST/ParentMap.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/AST/Stmt.h"
+#include "clang/Basic/TimeTrace.h"
 #include "llvm/Analysis/RegionInfo.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/InlineAsm.h"
@@ -35,8 +36,15 @@ namespace {
 
 typedef void *__CILK_JUMP_BUFFER[5];
 
+/// The compact frame only keeps the slots the runtime resumes from: frame
+/// pointer, resume address and stack pointer. llvm.eh.sjlj.setjmp spills the
+/// callee-saved registers the continuation needs, so they are not kept.
+typedef void *__CILK_COMPACT_JUMP_BUFFER[3];
+
 struct __cilkrts_pedigree {};
 struct __cilkrts_stack_frame {};
+struct __cilkrts_compact_stack_frame {};
+struct __cilkrts_compact_stack_frame_core {};
 struct __cilkrts_pending_frame {};
 struct __cilkrts_worker {};
 struct __cilkrts_task_list_node {};
@@ -57,8 +65,16 @@ enum {
     CILK_OBJ_GROUP_NOT_WRITE = 15 - (int)CILK_OBJ_GROUP_WRITE
 };
 
+/// Dependence kinds on queues. These do not denote groups of the object
+/// metadata; see GetDataflowGroup for the groups their tasks join.
+enum {
+    CILK_OBJ_QUEUE_PUSH = 16,
+    CILK_OBJ_QUEUE_POP = 32
+};
+
 enum {
-  __CILKRTS_ABI_VERSION = 1
+  __CILKRTS_ABI_VERSION = 1,
+  __CILKRTS_ABI_VERSION_COMPACT = 2
 };
 
 enum {
@@ -76,6 +92,7 @@ enum {
 };
 
 #define CILK_FRAME_VERSION (__CILKRTS_ABI_VERSION << 24)
+#define CILK_FRAME_VERSION_COMPACT (__CILKRTS_ABI_VERSION_COMPACT << 24)
 #define CILK_FRAME_VERSION_MASK  0xFF000000
 #define CILK_FRAME_FLAGS_MASK    0x00FFFFFF
 #define CILK_FRAME_VERSION_VALUE(_flags) (((_flags) & CILK_FRAME_VERSION_MASK) >> 24)
@@ -144,9 +161,23 @@ typedef void (__cilkrts_obj_metadata_add_pending_to_ready_list)(
 typedef void (__cilkrts_obj_version_add_ref)(__cilkrts_obj_version *);
 typedef void (__cilkrts_obj_version_del_ref)(__cilkrts_obj_version *);
 typedef void (__cilkrts_obj_version_destroy)(__cilkrts_obj_version *);
+// Queue segments. push_segment links a new segment into the queue and
+// returns it; the caller owns its only reference. segment_release completes
+// a segment, drops that reference and returns the queue. Given the queue
+// itself, it returns it unchanged. pop_segment returns the oldest segment of
+// the queue that is still being filled, with a reference for the caller, or
+// null if there is none.
+typedef __cilkrts_obj_version *(__cilkrts_queue_push_segment)(
+    __cilkrts_obj_version *);
+typedef __cilkrts_obj_version *(__cilkrts_queue_segment_release)(
+    __cilkrts_obj_version *);
+typedef __cilkrts_obj_version *(__cilkrts_queue_pop_segment)(
+    __cilkrts_obj_version *);
 
 typedef void (__cilkrts_move_to_ready_list)(
     __cilkrts_worker *, __cilkrts_ready_list *);
+typedef void (__cilkrts_ready_list_insert)(
+    __cilkrts_ready_list *, __cilkrts_pending_frame *);
 typedef void (__cilkrts_detach_pending)(__cilkrts_pending_frame *sf);
 typedef __cilkrts_pending_frame * (__cilkrts_ini_ready_fn_ty)(void *);
 typedef void (__cilkrts_issue_fn_ty)(__cilkrts_pending_frame *, void *);
@@ -179,6 +210,9 @@ DEFAULT_GET_CILKRTS_FUNC(detach_pending)
 DEFAULT_GET_CILKRTS_FUNC(obj_metadata_wakeup_hard)
 DEFAULT_GET_CILKRTS_FUNC(obj_metadata_add_task) // tmp - errors - leave it and hide mutex; requires some re-arranging of obj_version contents and/or just padding where the mutex would be.
 DEFAULT_GET_CILKRTS_FUNC(obj_version_destroy)
+DEFAULT_GET_CILKRTS_FUNC(queue_push_segment)
+DEFAULT_GET_CILKRTS_FUNC(queue_segment_release)
+DEFAULT_GET_CILKRTS_FUNC(queue_pop_segment)
 
 #define DEFAULT_GET_CILKRTS_ANON_FUNC(name) \
 static llvm::Function *Get__cilkrts_##name(clang::CodeGen::CodeGenFunction &CGF) { \
@@ -199,6 +233,8 @@ namespace llvm {
 ///   __cilkrts_ready_list,
 ///   __cilkrts_worker,
 ///   __cilkrts_stack_frame,
+///   __cilkrts_compact_stack_frame,
+///   __cilkrts_compact_stack_frame_core,
 ///   spin_mutex,
 ///   __cilkrts_task_list_node,
 ///   __cilkrts_task_list,
@@ -341,6 +377,107 @@ public:
   };
 };
 
+/// The compact layout of __cilkrts_stack_frame (CILK_FRAME_VERSION_COMPACT),
+/// whose jump buffer only has the three slots written by EmitCilkSetJmp and
+/// llvm.eh.sjlj.setjmp. Frames are passed around as __cilkrts_stack_frame
+/// pointers; the fields before ctx are at the same offsets in both layouts.
+template <bool X>
+class TypeBuilder<__cilkrts_compact_stack_frame, X> {
+public:
+  static StructType *get(LLVMContext &C) {
+    static TypeBuilderCache cache;
+    TypeBuilderCache::iterator I = cache.find(&C);
+    if (I != cache.end())
+      return I->second;
+    StructType *Ty = StructType::create(C, "__cilkrts_compact_stack_frame");
+    cache[&C] = Ty;
+    SmallVector<llvm::Type *, 14> Elements;
+    getCoreElements(C, Elements);
+    Elements.push_back(TypeBuilder<__cilkrts_issue_fn_ty *,X>::get(C)); // df_issue_fn
+    Elements.push_back(TypeBuilder<void *,                 X>::get(C)); // args_tags
+    Elements.push_back(TypeBuilder<__cilkrts_stack_frame *,X>::get(C)); // df_issue_child
+    Elements.push_back(TypeBuilder<__cilkrts_stack_frame*volatile*,X>::get(C)); // df_issue_me_ptr
+    Ty->setBody(Elements);
+    return Ty;
+  }
+
+  /// \brief Collects the fields preceding the dataflow extension.
+  static void getCoreElements(LLVMContext &C,
+                              SmallVectorImpl<llvm::Type *> &Elements) {
+    Elements.push_back(TypeBuilder<uint32_t,               X>::get(C)); // flags
+    Elements.push_back(TypeBuilder<int32_t,                X>::get(C)); // size
+    Elements.push_back(TypeBuilder<__cilkrts_stack_frame*, X>::get(C)); // call_parent
+    Elements.push_back(TypeBuilder<__cilkrts_worker*,      X>::get(C)); // worker
+    Elements.push_back(TypeBuilder<void*,                  X>::get(C)); // except_data
+    Elements.push_back(TypeBuilder<__CILK_COMPACT_JUMP_BUFFER, X>::get(C)); // ctx
+    Elements.push_back(TypeBuilder<uint32_t,               X>::get(C)); // mxcsr
+    Elements.push_back(TypeBuilder<uint16_t,               X>::get(C)); // fpcsr
+    Elements.push_back(TypeBuilder<uint16_t,               X>::get(C)); // reserved
+    Elements.push_back(TypeBuilder<__cilkrts_pedigree,     X>::get(C)); // parent_pedigree
+  }
+
+  enum {
+    flags,
+    size,
+    call_parent,
+    worker,
+    except_data,
+    ctx,
+    mxcsr,
+    fpcsr,
+    reserved,
+    parent_pedigree,
+    df_issue_fn,
+    args_tags,
+    df_issue_child,
+    df_issue_me_ptr
+  };
+
+  /// \brief Maps a field of __cilkrts_stack_frame to the same field of the
+  /// compact layout.
+  static int getField(int StackFrameField) {
+    typedef TypeBuilder<__cilkrts_stack_frame, X> StackFrame;
+    switch (StackFrameField) {
+    case StackFrame::flags:           return flags;
+    case StackFrame::size:            return size;
+    case StackFrame::call_parent:     return call_parent;
+    case StackFrame::worker:          return worker;
+    case StackFrame::except_data:     return except_data;
+    case StackFrame::ctx:             return ctx;
+    case StackFrame::mxcsr:           return mxcsr;
+    case StackFrame::fpcsr:           return fpcsr;
+    case StackFrame::reserved:        return reserved;
+    case StackFrame::parent_pedigree: return parent_pedigree;
+    case StackFrame::df_issue_fn:     return df_issue_fn;
+    case StackFrame::args_tags:       return args_tags;
+    case StackFrame::df_issue_child:  return df_issue_child;
+    case StackFrame::df_issue_me_ptr: return df_issue_me_ptr;
+    }
+    llvm_unreachable("field not in the compact frame");
+  }
+};
+
+/// The compact __cilkrts_stack_frame without the dataflow extension. With the
+/// compact ABI, frames that never take part in a dataflow spawn are allocated
+/// with this type.
+template <bool X>
+class TypeBuilder<__cilkrts_compact_stack_frame_core, X> {
+public:
+  static StructType *get(LLVMContext &C) {
+    static TypeBuilderCache cache;
+    TypeBuilderCache::iterator I = cache.find(&C);
+    if (I != cache.end())
+      return I->second;
+    StructType *Ty =
+      StructType::create(C, "__cilkrts_compact_stack_frame_core");
+    cache[&C] = Ty;
+    SmallVector<llvm::Type *, 10> Elements;
+    TypeBuilder<__cilkrts_compact_stack_frame, X>::getCoreElements(C, Elements);
+    Ty->setBody(Elements);
+    return Ty;
+  }
+};
+
 template <bool X>
 class TypeBuilder<__cilkrts_pending_frame, X> {
 public:
@@ -358,6 +495,10 @@ public:
       TypeBuilder<__cilkrts_pending_call_fn *, X>::get(C), // call_fn
       TypeBuilder<void *,                      X>::get(C), // args_tags
       TypeBuilder<int,                         X>::get(C), // incoming_count
+      // Only read and written with -fcilk-spawn-priority. Older runtimes
+      // allocate pending frames without it, and pending frames are only
+      // ever allocated by the runtime.
+      TypeBuilder<uint32_t,                    X>::get(C), // priority
       NULL);
     return Ty;
   }
@@ -367,7 +508,8 @@ public:
     frame_ff,
     call_fn,
     args_tags,
-    incoming_count
+    incoming_count,
+    priority
   };
 };
 
@@ -563,6 +705,10 @@ using namespace llvm;
 
 /// Helper typedefs for cilk struct TypeBuilders.
 typedef llvm::TypeBuilder<__cilkrts_stack_frame, false> StackFrameBuilder;
+typedef llvm::TypeBuilder<__cilkrts_compact_stack_frame, false>
+  CompactStackFrameBuilder;
+typedef llvm::TypeBuilder<__cilkrts_compact_stack_frame_core, false>
+  CompactStackFrameCoreBuilder;
 typedef llvm::TypeBuilder<__cilkrts_worker, false> WorkerBuilder;
 typedef llvm::TypeBuilder<__cilkrts_pedigree, false> PedigreeBuilder;
 typedef llvm::TypeBuilder<__cilkrts_obj_metadata, false> ObjMetadataBuilder;
@@ -587,9 +733,42 @@ static llvm::LoadInst *LoadField(CGBuilderTy &B, Value *Src, int field) {
   return B.CreateLoad(GEP(B, Src, field));
 }
 
+/// \brief Returns the version bits stored in the flags of every Cilk frame
+/// emitted for this module.
+static uint32_t GetCilkFrameVersion(CodeGenFunction &CGF) {
+  return CGF.CGM.getCodeGenOpts().CilkCompactFrame ? CILK_FRAME_VERSION_COMPACT
+                                                   : CILK_FRAME_VERSION;
+}
+
+/// \brief Returns the address of \p field of the frame \p SF, in the layout
+/// used by this module.
+///
+/// The fields before ctx can be accessed with GEP in both layouts; ctx and
+/// the ones after it have to be accessed with FrameGEP.
+static Value *FrameGEP(CodeGenFunction &CGF, CGBuilderTy &B, Value *SF,
+                       int field) {
+  if (!CGF.CGM.getCodeGenOpts().CilkCompactFrame)
+    return GEP(B, SF, field);
+  llvm::Type *CompactTy =
+    CompactStackFrameBuilder::get(CGF.getLLVMContext())->getPointerTo();
+  return GEP(B, B.CreateBitCast(SF, CompactTy),
+             CompactStackFrameBuilder::getField(field));
+}
+
+static void StoreFrameField(CodeGenFunction &CGF, CGBuilderTy &B, Value *Val,
+                            Value *SF, int field) {
+  B.CreateStore(Val, FrameGEP(CGF, B, SF, field));
+}
+
+static llvm::LoadInst *LoadFrameField(CodeGenFunction &CGF, CGBuilderTy &B,
+                                      Value *SF, int field) {
+  return B.CreateLoad(FrameGEP(CGF, B, SF, field));
+}
+
 /// \brief Emit inline assembly code to save the floating point
 /// state, for x86 Only.
-static void EmitSaveFloatingPointState(CGBuilderTy &B, Value *SF) {
+static void EmitSaveFloatingPointState(CodeGenFunction &CGF, CGBuilderTy &B,
+                                       Value *SF) {
   typedef void (AsmPrototype)(uint32_t*, uint16_t*);
   llvm::FunctionType *FTy =
     TypeBuilder<AsmPrototype, false>::get(B.getContext());
@@ -599,8 +778,8 @@ static void EmitSaveFloatingPointState(CGBuilderTy &B, Value *SF) {
                               "*m,*m,~{dirflag},~{fpsr},~{flags}",
                               /*sideeffects*/ true);
 
-  Value *mxcsrField = GEP(B, SF, StackFrameBuilder::mxcsr);
-  Value *fpcsrField = GEP(B, SF, StackFrameBuilder::fpcsr);
+  Value *mxcsrField = FrameGEP(CGF, B, SF, StackFrameBuilder::mxcsr);
+  Value *fpcsrField = FrameGEP(CGF, B, SF, StackFrameBuilder::fpcsr);
 
   B.CreateCall2(Asm, mxcsrField, fpcsrField);
 }
@@ -660,14 +839,14 @@ static CallInst *EmitCilkSetJmp(CGBuilderTy &B, Value *SF,
   LLVMContext &Ctx = CGF.getLLVMContext();
 
   // We always want to save the floating point state too
-  EmitSaveFloatingPointState(B, SF);
+  EmitSaveFloatingPointState(CGF, B, SF);
 
   llvm::Type *Int32Ty = llvm::Type::getInt32Ty(Ctx);
   llvm::Type *Int8PtrTy = llvm::Type::getInt8PtrTy(Ctx);
 
   // Get the buffer to store program state
   // Buffer is a void**.
-  Value *Buf = GEP(B, SF, StackFrameBuilder::ctx);
+  Value *Buf = FrameGEP(CGF, B, SF, StackFrameBuilder::ctx);
 
   // Store the frame pointer in the 0th slot
   Value *FrameAddr =
@@ -800,7 +979,7 @@ static Function *Get__cilkrts_pop_frame_df(CodeGenFunction &CGF) {
 		 SF, StackFrameBuilder::call_parent);
 
       // if( sf->df_issue_me_ptr ) {
-      MePtr = LoadField(B, SF, StackFrameBuilder::df_issue_me_ptr);
+      MePtr = LoadFrameField(CGF, B, SF, StackFrameBuilder::df_issue_me_ptr);
       Value *Cmp = B.CreateICmpNE( MePtr, ConstantPointerNull::get(SFPtrPtrTy));
       B.CreateCondBr(Cmp, CAS, Release);
   }
@@ -852,7 +1031,8 @@ static Function *Get__cilkrts_pop_frame_df(CodeGenFunction &CGF) {
   {
       CGBuilderTy B(Release);
       Value *ReleaseFn = ++Fn->arg_begin(); // 2nd argument
-      B.CreateCall(ReleaseFn, LoadField(B, SF, StackFrameBuilder::args_tags));
+      B.CreateCall(ReleaseFn,
+                   LoadFrameField(CGF, B, SF, StackFrameBuilder::args_tags));
       B.CreateBr(Exit);
   }
 
@@ -906,15 +1086,15 @@ static Function *Get__cilkrts_detach(CodeGenFunction &CGF) {
   Value *Tail = LoadField(B, W, WorkerBuilder::tail);
 
   // sf->spawn_helper_pedigree = w->pedigree;
-  StoreField(B,
-             LoadField(B, W, WorkerBuilder::pedigree),
-             SF, StackFrameBuilder::parent_pedigree);
+  StoreFrameField(CGF, B,
+                  LoadField(B, W, WorkerBuilder::pedigree),
+                  SF, StackFrameBuilder::parent_pedigree);
 
   // sf->call_parent->parent_pedigree = w->pedigree;
-  StoreField(B,
-             LoadField(B, W, WorkerBuilder::pedigree),
-             LoadField(B, SF, StackFrameBuilder::call_parent),
-             StackFrameBuilder::parent_pedigree);
+  StoreFrameField(CGF, B,
+                  LoadField(B, W, WorkerBuilder::pedigree),
+                  LoadField(B, SF, StackFrameBuilder::call_parent),
+                  StackFrameBuilder::parent_pedigree);
 
   // w->pedigree.rank = 0;
   {
@@ -928,7 +1108,7 @@ static Function *Get__cilkrts_detach(CodeGenFunction &CGF) {
 
   // w->pedigree.next = &sf->spawn_helper_pedigree;
   StoreField(B,
-             GEP(B, SF, StackFrameBuilder::parent_pedigree),
+             FrameGEP(CGF, B, SF, StackFrameBuilder::parent_pedigree),
              GEP(B, W, WorkerBuilder::pedigree),
              PedigreeBuilder::next);
 
@@ -1131,7 +1311,7 @@ static Function *GetCilkSyncFn(CodeGenFunction &CGF) {
     CGBuilderTy B(SaveState);
 
     // sf.parent_pedigree = sf.worker->pedigree;
-    StoreField(B,
+    StoreFrameField(CGF, B,
       LoadField(B, LoadField(B, SF, StackFrameBuilder::worker),
                 WorkerBuilder::pedigree),
       SF, StackFrameBuilder::parent_pedigree);
@@ -1282,7 +1462,7 @@ static Function *Get__cilkrts_enter_frame_1(CodeGenFunction &CGF) {
     Wslow = B.CreateCall(CILKRTS_FUNC(bind_thread_1, CGF));
     llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
     StoreField(B,
-      ConstantInt::get(Ty, CILK_FRAME_LAST | CILK_FRAME_VERSION),
+      ConstantInt::get(Ty, CILK_FRAME_LAST | GetCilkFrameVersion(CGF)),
       SF, StackFrameBuilder::flags);
     B.CreateBr(Cont);
   }
@@ -1291,7 +1471,7 @@ static Function *Get__cilkrts_enter_frame_1(CodeGenFunction &CGF) {
     CGBuilderTy B(FastPath);
     llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
     StoreField(B,
-      ConstantInt::get(Ty, CILK_FRAME_VERSION),
+      ConstantInt::get(Ty, GetCilkFrameVersion(CGF)),
       SF, StackFrameBuilder::flags);
     B.CreateBr(Cont);
   }
@@ -1374,7 +1554,7 @@ static Function *Get__cilkrts_enter_frame_df(CodeGenFunction &CGF) {
     Wslow = B.CreateCall(CILKRTS_FUNC(bind_thread_1, CGF));
     llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
     StoreField(B,
-      ConstantInt::get(Ty, CILK_FRAME_LAST | CILK_FRAME_VERSION
+      ConstantInt::get(Ty, CILK_FRAME_LAST | GetCilkFrameVersion(CGF)
 		       | CILK_FRAME_DATAFLOW),
       SF, StackFrameBuilder::flags);
     B.CreateBr(Cont);
@@ -1384,7 +1564,7 @@ static Function *Get__cilkrts_enter_frame_df(CodeGenFunction &CGF) {
     CGBuilderTy B(FastPath);
     llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
     StoreField(B,
-      ConstantInt::get(Ty, CILK_FRAME_VERSION | CILK_FRAME_DATAFLOW),
+      ConstantInt::get(Ty, GetCilkFrameVersion(CGF) | CILK_FRAME_DATAFLOW),
       SF, StackFrameBuilder::flags);
     B.CreateBr(Cont);
   }
@@ -1411,9 +1591,10 @@ static Function *Get__cilkrts_enter_frame_df(CodeGenFunction &CGF) {
 
   {
       CGBuilderTy B(SetIssue);
-      StoreField(B, SF, CP, StackFrameBuilder::df_issue_child);
-      StoreField(B, GEP(B, CP, StackFrameBuilder::df_issue_child), SF,
-		 StackFrameBuilder::df_issue_me_ptr);
+      StoreFrameField(CGF, B, SF, CP, StackFrameBuilder::df_issue_child);
+      StoreFrameField(CGF, B,
+                      FrameGEP(CGF, B, CP, StackFrameBuilder::df_issue_child),
+                      SF, StackFrameBuilder::df_issue_me_ptr);
       B.CreateRetVoid();
   }
 
@@ -1458,7 +1639,7 @@ static Function *Get__cilkrts_enter_frame_fast_1(CodeGenFunction &CGF) {
   llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
 
   StoreField(B,
-    ConstantInt::get(Ty, CILK_FRAME_VERSION),
+    ConstantInt::get(Ty, GetCilkFrameVersion(CGF)),
     SF, StackFrameBuilder::flags);
   StoreField(B,
     LoadField(B, W, WorkerBuilder::current_stack_frame),
@@ -1506,16 +1687,17 @@ static Function *Get__cilkrts_enter_frame_fast_df(CodeGenFunction &CGF) {
   llvm::Type *Ty = SFTy->getElementType(StackFrameBuilder::flags);
 
   StoreField(B,
-    ConstantInt::get(Ty, CILK_FRAME_VERSION | CILK_FRAME_DATAFLOW),
+    ConstantInt::get(Ty, GetCilkFrameVersion(CGF) | CILK_FRAME_DATAFLOW),
     SF, StackFrameBuilder::flags);
   Value *CP = LoadField(B, W, WorkerBuilder::current_stack_frame);
   StoreField(B, CP, SF, StackFrameBuilder::call_parent);
   StoreField(B, W, SF, StackFrameBuilder::worker);
   StoreField(B, SF, W, WorkerBuilder::current_stack_frame);
 
-  StoreField(B, SF, CP, StackFrameBuilder::df_issue_child);
-  StoreField(B, GEP(B, CP, StackFrameBuilder::df_issue_child), SF,
-	     StackFrameBuilder::df_issue_me_ptr);
+  StoreFrameField(CGF, B, SF, CP, StackFrameBuilder::df_issue_child);
+  StoreFrameField(CGF, B,
+                  FrameGEP(CGF, B, CP, StackFrameBuilder::df_issue_child),
+                  SF, StackFrameBuilder::df_issue_me_ptr);
 
   B.CreateRetVoid();
 
@@ -1588,7 +1770,7 @@ static Function *GetCilkParentEpilogue(CodeGenFunction &CGF) {
     // if (sf->flags != CILK_FRAME_VERSION)
     Value *Flags = LoadField(B, SF, StackFrameBuilder::flags);
     Value *Cond = B.CreateICmpNE(Flags,
-      ConstantInt::get(Flags->getType(), CILK_FRAME_VERSION));
+      ConstantInt::get(Flags->getType(), GetCilkFrameVersion(CGF)));
     B.CreateCondBr(Cond, B1, Exit);
   }
 
@@ -1692,8 +1874,8 @@ static llvm::Function *GetCilkDataflowHelperPrologue(CodeGenFunction &CGF) {
 
   // sf->df_issue_fn = issue_fn;
   // sf->args_tags = (char *)at;
-  StoreField(B, IF, SF, StackFrameBuilder::df_issue_fn);
-  StoreField(B, AT, SF, StackFrameBuilder::args_tags);
+  StoreFrameField(CGF, B, IF, SF, StackFrameBuilder::df_issue_fn);
+  StoreFrameField(CGF, B, AT, SF, StackFrameBuilder::args_tags);
 
   // if( !PARENT_SYNCED ) {
   Value *Cond = B.CreateICmpNE(PARENT_SYNCED,
@@ -1717,19 +1899,20 @@ static llvm::Function *GetCilkDataflowHelperPrologue(CodeGenFunction &CGF) {
   B.CreateCall2(IF, SFNull, AT);
 
   //    sf->df_issue_me_ptr = 0;
-  StoreField(B, ConstantPointerNull::get(
-		 TypeBuilder<__cilkrts_stack_frame**, false>::get(Ctx)),
-	     SF, StackFrameBuilder::df_issue_me_ptr);
+  StoreFrameField(CGF, B, ConstantPointerNull::get(
+		      TypeBuilder<__cilkrts_stack_frame**, false>::get(Ctx)),
+		  SF, StackFrameBuilder::df_issue_me_ptr);
 
   B.CreateBr(Exit);
 
   B.SetInsertPoint(Unsync);
   //	sf->call_parent->df_issue_child = sf;
   Value *CP = LoadField(B, SF, StackFrameBuilder::call_parent);
-  StoreField(B, SF, CP, StackFrameBuilder::df_issue_child);
+  StoreFrameField(CGF, B, SF, CP, StackFrameBuilder::df_issue_child);
   //    sf->df_issue_me_ptr = &sf->call_parent->df_issue_child;
-  StoreField(B, GEP(B, CP, StackFrameBuilder::df_issue_child), SF,
-	     StackFrameBuilder::df_issue_me_ptr);
+  StoreFrameField(CGF, B,
+                  FrameGEP(CGF, B, CP, StackFrameBuilder::df_issue_child),
+                  SF, StackFrameBuilder::df_issue_me_ptr);
   B.CreateBr(Exit);
 
   // __cilkrts_detach(sf);
@@ -2036,6 +2219,137 @@ static Function *Get__cilkrts_obj_metadata_wakeup(CodeGenFunction &CGF) {
   return Fn;
 }
 
+/// \brief Get or create a LLVM function for __cilkrts_ready_list_insert.
+/// Ready lists are kept sorted by decreasing priority. Frames without a
+/// priority are appended in FIFO order, others are queued ahead of all frames
+/// with a lower priority. The caller holds the lock on the list.
+/// Without -fcilk-spawn-priority, pending frames have no priority and are
+/// always appended.
+/// It is equivalent to the following C code
+///
+/// void __cilkrts_ready_list_insert(struct __cilkrts_ready_list *rlist,
+///                                  __cilkrts_pending_frame *pf) {
+///     pf->next_ready_frame = 0;
+///     if( pf->priority == 0 ) {
+///         rlist->tail->next_ready_frame = pf;
+///         rlist->tail = pf;
+///     } else {
+///         __cilkrts_pending_frame **pos = &rlist->head_next_ready_frame;
+///         while( *pos && (*pos)->priority >= pf->priority )
+///             pos = &(*pos)->next_ready_frame;
+///         pf->next_ready_frame = *pos;
+///         *pos = pf;
+///         if( !pf->next_ready_frame )
+///             rlist->tail = pf;
+///     }
+/// }
+static Function *Get__cilkrts_ready_list_insert(CodeGenFunction &CGF) {
+  Function *Fn = 0;
+
+  if (GetOrCreateFunction<__cilkrts_ready_list_insert>(
+	  "__cilkrts_ready_list_insert", CGF, Fn))
+    return Fn;
+
+  // If we get here we need to add the function body
+  LLVMContext &Ctx = CGF.getLLVMContext();
+
+  Value *RL = Fn->arg_begin();
+  Value *PF = ++Fn->arg_begin();
+
+  bool HasPriority = CGF.CGM.getCodeGenOpts().CilkSpawnPriority;
+  Fn->addFnAttr(Attribute::InlineHint);
+
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Fn);
+  BasicBlock *Append = BasicBlock::Create(Ctx, "append", Fn);
+  BasicBlock *Search =
+    HasPriority ? BasicBlock::Create(Ctx, "search", Fn) : 0;
+
+  Value *Prio = 0;
+  {
+      CGBuilderTy B(Entry);
+      StoreField(B, ConstantPointerNull::get(
+		     cast<llvm::PointerType>(PF->getType())),
+		 PF, PendingFrameBuilder::next_ready_frame);
+      if (HasPriority) {
+	  Prio = LoadField(B, PF, PendingFrameBuilder::priority);
+	  Value *Comp = B.CreateICmpEQ(Prio,
+				       ConstantInt::get(Prio->getType(), 0));
+	  B.CreateCondBr(Comp, Append, Search);
+      } else
+	  B.CreateBr(Append);
+  }
+
+  {
+      CGBuilderTy B(Append);
+      Value *Tail = LoadField(B, RL, ReadyListBuilder::tail);
+      StoreField(B, PF, Tail, PendingFrameBuilder::next_ready_frame);
+      StoreField(B, PF, RL, ReadyListBuilder::tail);
+      B.CreateRetVoid();
+  }
+
+  if (!HasPriority)
+    return Fn;
+
+  BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", Fn);
+  BasicBlock *Compare = BasicBlock::Create(Ctx, "compare", Fn);
+  BasicBlock *Advance = BasicBlock::Create(Ctx, "advance", Fn);
+  BasicBlock *Insert = BasicBlock::Create(Ctx, "insert", Fn);
+  BasicBlock *SetTail = BasicBlock::Create(Ctx, "set_tail", Fn);
+  BasicBlock *Return = BasicBlock::Create(Ctx, "return", Fn);
+
+  Value *Head;
+  {
+      CGBuilderTy B(Search);
+      Head = GEP(B, RL, ReadyListBuilder::head_next_ready_frame);
+      B.CreateBr(Loop);
+  }
+
+  PHINode *Pos;
+  Value *Cur, *AtEnd;
+  {
+      CGBuilderTy B(Loop);
+      Pos = B.CreatePHI(Head->getType(), 2);
+      Pos->addIncoming(Head, Search);
+      Cur = B.CreateLoad(Pos);
+      AtEnd = B.CreateIsNull(Cur);
+      B.CreateCondBr(AtEnd, Insert, Compare);
+  }
+
+  {
+      CGBuilderTy B(Compare);
+      Value *CurPrio = LoadField(B, Cur, PendingFrameBuilder::priority);
+      Value *Comp = B.CreateICmpUGE(CurPrio, Prio);
+      B.CreateCondBr(Comp, Advance, Insert);
+  }
+
+  {
+      CGBuilderTy B(Advance);
+      Value *Next = GEP(B, Cur, PendingFrameBuilder::next_ready_frame);
+      Pos->addIncoming(Next, Advance);
+      B.CreateBr(Loop);
+  }
+
+  {
+      CGBuilderTy B(Insert);
+      StoreField(B, Cur, PF, PendingFrameBuilder::next_ready_frame);
+      B.CreateStore(PF, Pos);
+      B.CreateCondBr(AtEnd, SetTail, Return);
+  }
+
+  {
+      CGBuilderTy B(SetTail);
+      StoreField(B, PF, RL, ReadyListBuilder::tail);
+      B.CreateRetVoid();
+  }
+
+  {
+      CGBuilderTy B(Return);
+      B.CreateRetVoid();
+  }
+
+  return Fn;
+}
+
 /// \brief Get or create a LLVM function for __cilkrts_move_to_ready_list.
 /// It is equivalent to the following C code
 ///
@@ -2048,6 +2362,19 @@ static Function *Get__cilkrts_obj_metadata_wakeup(CodeGenFunction &CGF) {
 ///         __cilkrts_worker_unlock(w);
 ///     }
 /// }
+///
+/// With -fcilk-spawn-priority, the frames are instead inserted one by one,
+/// such that frames with a priority overtake the ones already queued on the
+/// worker:
+///
+///         __cilkrts_pending_frame *pf = rlist->head_next_ready_frame;
+///         __cilkrts_pending_frame *tail = rlist->tail, *next;
+///         __cilkrts_worker_lock(w);
+///         do {
+///             next = pf->next_ready_frame;
+///             __cilkrts_ready_list_insert(&w->ready_list, pf);
+///         } while( pf != tail && (pf = next) );
+///         __cilkrts_worker_unlock(w);
 static Function *Get__cilkrts_move_to_ready_list(CodeGenFunction &CGF) {
   Function *Fn = 0;
 
@@ -2075,6 +2402,15 @@ static Function *Get__cilkrts_move_to_ready_list(CodeGenFunction &CGF) {
   }
 
   {
+      CGBuilderTy B(Return);
+      B.CreateRetVoid();
+  }
+
+  Fn->addFnAttr(Attribute::InlineHint);
+
+  // Without priorities, splice the list onto the worker's ready list, so
+  // that moving any number of frames holds the lock for the same short time.
+  if (!CGF.CGM.getCodeGenOpts().CilkSpawnPriority) {
       CGBuilderTy B(NotEmpty);
       B.CreateCall(CILKRTS_FUNC(worker_lock, CGF), W);
       Value *WRL = GEP(B, W, WorkerBuilder::ready_list);
@@ -2084,15 +2420,39 @@ static Function *Get__cilkrts_move_to_ready_list(CodeGenFunction &CGF) {
       StoreField(B, Tail, WRL, ReadyListBuilder::tail);
       B.CreateCall(CILKRTS_FUNC(worker_unlock, CGF), W);
       B.CreateRetVoid();
+      return Fn;
   }
 
+  BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", Fn);
+  BasicBlock *Unlock = BasicBlock::Create(Ctx, "unlock", Fn);
+
+  Value *Tail, *WRL;
   {
-      CGBuilderTy B(Return);
+      CGBuilderTy B(NotEmpty);
+      Tail = LoadField(B, RL, ReadyListBuilder::tail);
+      B.CreateCall(CILKRTS_FUNC(worker_lock, CGF), W);
+      WRL = GEP(B, W, WorkerBuilder::ready_list);
+      B.CreateBr(Loop);
+  }
+
+  {
+      CGBuilderTy B(Loop);
+      PHINode *PF = B.CreatePHI(HNRF->getType(), 2);
+      PF->addIncoming(HNRF, NotEmpty);
+      // Read the link before the insertion overwrites it.
+      Value *Next = LoadField(B, PF, PendingFrameBuilder::next_ready_frame);
+      B.CreateCall2(CILKRTS_FUNC(ready_list_insert, CGF), WRL, PF);
+      PF->addIncoming(Next, Loop);
+      Value *Done = B.CreateOr(B.CreateICmpEQ(PF, Tail), B.CreateIsNull(Next));
+      B.CreateCondBr(Done, Unlock, Loop);
+  }
+
+  {
+      CGBuilderTy B(Unlock);
+      B.CreateCall(CILKRTS_FUNC(worker_unlock, CGF), W);
       B.CreateRetVoid();
   }
 
-  Fn->addFnAttr(Attribute::InlineHint);
- 
   return Fn;
 }
 
@@ -2102,9 +2462,7 @@ static Function *Get__cilkrts_move_to_ready_list(CodeGenFunction &CGF) {
 /// void __cilkrts_obj_metadata_add_pending_to_ready_list(
 ///             __cilkrts_worker *w, __cilkrts_pending_frame *pf) {
 ///    __cilkrts_worker_lock(w);
-///    pf->next_ready_frame = 0;
-///    w->ready_list.tail->next_ready_frame = pf;
-///    w->ready_list.tail = pf;
+///    __cilkrts_ready_list_insert(&w->ready_list, pf);
 ///    __cilkrts_worker_unlock(w);
 /// }
 static Function *
@@ -2124,13 +2482,8 @@ Get__cilkrts_obj_metadata_add_pending_to_ready_list(CodeGenFunction &CGF) {
   BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Fn);
   CGBuilderTy B(Entry);
   B.CreateCall(CILKRTS_FUNC(worker_lock, CGF), W);
-  StoreField(B, ConstantPointerNull::get(
-		 cast<llvm::PointerType>(PF->getType())),
-	     PF, PendingFrameBuilder::next_ready_frame);
   Value *RL = GEP(B, W, WorkerBuilder::ready_list);
-  Value *Tail = LoadField(B, RL, ReadyListBuilder::tail);
-  StoreField(B, PF, Tail, PendingFrameBuilder::next_ready_frame);
-  StoreField(B, PF, RL, ReadyListBuilder::tail);
+  B.CreateCall2(CILKRTS_FUNC(ready_list_insert, CGF), RL, PF);
   B.CreateCall(CILKRTS_FUNC(worker_unlock, CGF), W);
   B.CreateRetVoid();
 
@@ -2440,6 +2793,19 @@ IsDataflowType(const clang::Type * type) {
     return false;
 }
 
+/// \brief Whether any argument of the spawned call \p Spawn has a dataflow
+/// type. Note: could do this in two ways: either analyse types alone, or
+/// analyse values. Adding keywords to the type would probably be safer as
+/// the values themselves could be passed to calls without proper effects.
+static bool HasDataflowArgument(const CallExpr *Spawn) {
+  for (unsigned i = 0, e = Spawn->getNumArgs(); i != e; ++i)
+    if (IsDataflowType(Spawn->getArg(i)->getType().getTypePtr()))
+      return true;
+  return false;
+}
+
+/// \brief Returns the dependence kind of a dataflow argument. This is a group
+/// of the object metadata, or one of the queue kinds.
 static int
 GetDataflowKind(const clang::Type * type) {
     if( type->isRecordType() ) {
@@ -2459,6 +2825,10 @@ GetDataflowKind(const clang::Type * type) {
 			return CILK_OBJ_GROUP_WRITE;
 		    else if( id->isStr( "__Cilk_is_dataflow_cinoutdep_type" ) )
 			return CILK_OBJ_GROUP_COMMUT;
+		    else if( id->isStr( "__Cilk_is_dataflow_pushdep_type" ) )
+			return CILK_OBJ_QUEUE_PUSH;
+		    else if( id->isStr( "__Cilk_is_dataflow_popdep_type" ) )
+			return CILK_OBJ_QUEUE_POP;
 		}
 	    }
 	}
@@ -2466,6 +2836,42 @@ GetDataflowKind(const clang::Type * type) {
     return CILK_OBJ_GROUP_EMPTY;
 }
 
+/// \brief Returns the group of the object metadata that a task joins for a
+/// dataflow argument. For a queue, this is the metadata of the queue itself.
+///
+/// Pops join it as writes, so that they are serialised with each other. A
+/// pending push doesn't join it: it fills a segment of its own, and joins the
+/// metadata of that segment as a write. A pop waits for the segment it reads
+/// first, the oldest one that is still being filled when the pop is issued,
+/// by joining its metadata as a read. So a push never waits for a pop, and a
+/// pop only waits for earlier pops and for the push that fills its segment.
+/// A push that is issued late has been pushing onto the queue itself, and
+/// joins the queue's metadata as a write.
+static int
+GetDataflowGroup(int Kind) {
+    switch( Kind ) {
+    case CILK_OBJ_QUEUE_PUSH:
+    case CILK_OBJ_QUEUE_POP:
+	return CILK_OBJ_GROUP_WRITE;
+    default:
+	return Kind;
+    }
+}
+
+/// \brief Returns the number of dataflow arguments of a spawned call. The
+/// tags of its saved state hold a task list node for each of them, followed
+/// by a task list node and a segment for each pop, with which the pop waits
+/// for the segment it reads first.
+static unsigned
+CountDataflowArgs(CallExpr::const_arg_iterator ArgBeg,
+		  CallExpr::const_arg_iterator ArgEnd) {
+    unsigned N = 0;
+    for( CallExpr::const_arg_iterator I=ArgBeg, E=ArgEnd; I != E; ++I )
+	if( IsDataflowType( I->getType().getTypePtr() ) )
+	    ++N;
+    return N;
+}
+
 static llvm::Function *
 CreateCallFn(CodeGenFunction &CGF, llvm::Function * HelperF) {
     llvm::Module &Module = CGF.CGM.getModule();
@@ -2496,7 +2902,8 @@ CreateCallFn(CodeGenFunction &CGF, llvm::Function * HelperF) {
 	 I != E && i < NumArgs; ++I, ++i ) {
 	if( llvm::PointerType * PTy = dyn_cast<llvm::PointerType>(I->getType()) ) {
 	    if( i > 0 && i == NumArgs-1 ) { // return value
-		Value *AT = LoadField(B, CallFn->arg_begin(), StackFrameBuilder::args_tags); 
+		Value *AT = LoadFrameField(CGF, B, CallFn->arg_begin(),
+					   StackFrameBuilder::args_tags);
 		Value *SS = B.CreateBitCast(AT, llvm::PointerType::getUnqual(Info->getSavedStateTy()));
 		Value *ATArgs = GEP(B, SS, 0);
 		Args.push_back(LoadField(B, ATArgs, Info->getSavedStateArgStart()-1));
@@ -2619,6 +3026,8 @@ CompleteIniReadyFn(CodeGenFunction &CGF,
   for( CallExpr::const_arg_iterator I=ArgBeg, E=ArgEnd; I != E; ++I, ++i ) {
       const clang::Type * type = I->getType().getTypePtr();
       if( IsDataflowType( type ) ) {
+	  int Kind = GetDataflowKind( type );
+	  int Group = GetDataflowGroup( Kind );
 	  CGBuilderTy B(bb_ready);
 
 	  // Recovering the value from the struct anon is hard because we
@@ -2638,14 +3047,32 @@ CompleteIniReadyFn(CodeGenFunction &CGF,
 
 	  Value *MetaRaw = GEP(B, Version, ObjVersionBuilder::meta);
 	  Value *Meta = MetaRaw;
-	  Value *Group
-	      = ConstantInt::get(llvm::Type::getInt32Ty(Ctx),
-				 GetDataflowKind(type));
-	  Value *IReady = B.CreateCall2( ObjIniReadyFn, Meta, Group);
+	  Value *IReady
+	      = B.CreateCall2( ObjIniReadyFn, Meta,
+			       ConstantInt::get(Int32Ty, Group) );
 	  Value *Cond = B.CreateICmpNE(IReady,
 				       ConstantInt::get(IReady->getType(), 0));
-	  bb_ready = BasicBlock::Create(Ctx, "check_arg1", Fn, bb_not_ready);
-	  B.CreateCondBr(Cond, bb_ready, bb_not_ready);
+	  if( Kind == CILK_OBJ_QUEUE_POP ) {
+	      // A pop is not ready either while a segment it would read is
+	      // still being filled.
+	      BasicBlock *bb_segment
+		  = BasicBlock::Create(Ctx, "check_pop_segment", Fn,
+				       bb_not_ready);
+	      B.CreateCondBr(Cond, bb_segment, bb_not_ready);
+	      B.SetInsertPoint(bb_segment);
+	      Value *Segment
+		  = B.CreateCall(CILKRTS_FUNC(queue_pop_segment, CGF), Version);
+	      BasicBlock *bb_filling
+		  = BasicBlock::Create(Ctx, "segment_filling", Fn, bb_not_ready);
+	      bb_ready = BasicBlock::Create(Ctx, "check_arg1", Fn, bb_not_ready);
+	      B.CreateCondBr(B.CreateIsNull(Segment), bb_ready, bb_filling);
+	      B.SetInsertPoint(bb_filling);
+	      B.CreateCall(CILKRTS_FUNC(obj_version_del_ref, CGF), Segment);
+	      B.CreateBr(bb_not_ready);
+	  } else {
+	      bb_ready = BasicBlock::Create(Ctx, "check_arg1", Fn, bb_not_ready);
+	      B.CreateCondBr(Cond, bb_ready, bb_not_ready);
+	  }
       }
   }
 
@@ -2680,6 +3107,11 @@ CompleteIniReadyFn(CodeGenFunction &CGF,
       Value *CallFn = CreateCallFn(CGF, CGF.CurFn);
       StoreField(B, CallFn, PF, PendingFrameBuilder::call_fn);
 
+      // pf->priority = <priority>;
+      if (CGF.CGM.getCodeGenOpts().CilkSpawnPriority)
+	  StoreField(B, ConstantInt::get(Int32Ty, Info->getPriority()), PF,
+		     PendingFrameBuilder::priority);
+
       // Note: detach before issue. Issue may move the pending_frame on the
       // ready list, so we need to complete initialisation of the pending frame
       // and the associated full frame prior to issue.
@@ -2750,6 +3182,8 @@ CreateIssueFn(CodeGenFunction &CGF,
   BasicBlock *BBAdd = BasicBlock::Create(Ctx, "bbadd", Fn);
   BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", Fn);
   Value *PF, *Args, *Tags;
+  SmallVector<unsigned, 4> PushArgs, PopArgs;
+  unsigned NumDataflowArgs = CountDataflowArgs(ArgBeg, ArgEnd);
 
   llvm::Type *Int32Ty = llvm::Type::getInt32Ty(Ctx);
 
@@ -2775,12 +3209,28 @@ CreateIssueFn(CodeGenFunction &CGF,
 	      // Increment reference counter of object version. Only necessary
 	      // in concurrent operation, so we do it as part of issue.
 	      B.CreateCall(CILKRTS_FUNC(obj_version_add_ref, CGF), Var);
+	      int Kind = GetDataflowKind( type );
+	      if( Kind == CILK_OBJ_QUEUE_PUSH ) {
+		  // Registered below, with the segment it fills.
+		  PushArgs.push_back(i);
+		  ++i;
+		  continue;
+	      }
+	      if( Kind == CILK_OBJ_QUEUE_POP ) {
+		  // No segment to wait for, unless one is found below.
+		  Value *SegmentPtr
+		      = GEP(B, Tags, NumDataflowArgs + 2 * PopArgs.size() + 1);
+		  B.CreateStore(ConstantPointerNull::get(
+				    cast<llvm::PointerType>(Var->getType())),
+				SegmentPtr);
+		  PopArgs.push_back(i);
+	      }
 	      Value *Meta = GEP(B, Var, ObjVersionBuilder::meta);
 	      // struct.__cilkrts_obj_metadata != __cilkrts_obj_metadata
 	      // Value *CMeta = B.CreatePointerCast(Meta, (++WrFn->arg_begin())->getType());
 	      Value *CMeta = Meta;
 	      Value *Tag = GEP(B, Tags, i);
-	      switch( GetDataflowKind( type ) ) {
+	      switch( GetDataflowGroup( Kind ) ) {
 	      case CILK_OBJ_GROUP_READ:
 		  B.CreateCall3(CILKRTS_FUNC(obj_metadata_add_task_read, CGF),
 				PF, CMeta, Tag);
@@ -2800,7 +3250,71 @@ CreateIssueFn(CodeGenFunction &CGF,
 
       Value *PFNZ = B.CreateICmpNE(PF, ConstantPointerNull::get(
 				       cast<llvm::PointerType>(PF->getType())));
-      B.CreateCondBr(PFNZ, BBFAA, Exit);
+      if( PushArgs.empty() && PopArgs.empty() ) {
+	  B.CreateCondBr(PFNZ, BBFAA, Exit);
+      } else {
+	  BasicBlock *BBSeg
+	      = BasicBlock::Create(Ctx, "queue_segments", Fn, BBFAA);
+	  BasicBlock *BBLate = BasicBlock::Create(Ctx, "issued_late", Fn, BBFAA);
+	  B.CreateCondBr(PFNZ, BBSeg, BBLate);
+
+	  // A pending push task fills a segment of its own, and registers
+	  // with it rather than with the queue, so it doesn't wait for the
+	  // pops on the queue. Tasks are issued in program order, so the
+	  // segments are linked into the queue in program order too. The task
+	  // owns the only reference to its segment, and hands it back in the
+	  // release function.
+	  B.SetInsertPoint(BBSeg);
+	  Function * WrFn = CILKRTS_FUNC(obj_metadata_add_task_write, CGF);
+	  for( unsigned j=0, e=PushArgs.size(); j != e; ++j ) {
+	      Value *VarPtr = GEP(B, GEP(B, Args, PushArgs[j]),
+				  ObjDepBuilder::instance);
+	      Value *Queue = LoadField(B, VarPtr, ObjInstanceBuilder::version);
+	      Value *Segment
+		  = B.CreateCall(CILKRTS_FUNC(queue_push_segment, CGF), Queue);
+	      StoreField(B, Segment, VarPtr, ObjInstanceBuilder::version);
+	      B.CreateCall3(WrFn, PF, GEP(B, Segment, ObjVersionBuilder::meta),
+			    GEP(B, Tags, PushArgs[j]));
+	  }
+
+	  // A pending pop waits for the oldest segment that is still being
+	  // filled, which it reads first. The pushes that are issued after it
+	  // fill later segments, so it doesn't wait for them.
+	  Function * RdFn = CILKRTS_FUNC(obj_metadata_add_task_read, CGF);
+	  for( unsigned j=0, e=PopArgs.size(); j != e; ++j ) {
+	      Value *Queue
+		  = LoadField(B, GEP(B, GEP(B, Args, PopArgs[j]),
+				     ObjDepBuilder::instance),
+			      ObjInstanceBuilder::version);
+	      Value *Segment
+		  = B.CreateCall(CILKRTS_FUNC(queue_pop_segment, CGF), Queue);
+	      StoreField(B, Segment, Tags, NumDataflowArgs + 2 * j + 1);
+	      BasicBlock *BBWait
+		  = BasicBlock::Create(Ctx, "pop_segment", Fn, BBLate);
+	      BasicBlock *BBNext
+		  = BasicBlock::Create(Ctx, "pop_segment_done", Fn, BBLate);
+	      B.CreateCondBr(B.CreateIsNull(Segment), BBNext, BBWait);
+	      B.SetInsertPoint(BBWait);
+	      B.CreateCall3(RdFn, PF, GEP(B, Segment, ObjVersionBuilder::meta),
+			    GEP(B, Tags, NumDataflowArgs + 2 * j));
+	      B.CreateBr(BBNext);
+	      B.SetInsertPoint(BBNext);
+	  }
+	  B.CreateBr(BBFAA);
+
+	  // A push that is issued late has already started pushing onto the
+	  // queue itself, and a pop that is issued late is already reading.
+	  B.SetInsertPoint(BBLate);
+	  for( unsigned j=0, e=PushArgs.size(); j != e; ++j ) {
+	      Value *Queue
+		  = LoadField(B, GEP(B, GEP(B, Args, PushArgs[j]),
+				     ObjDepBuilder::instance),
+			      ObjInstanceBuilder::version);
+	      B.CreateCall3(WrFn, PF, GEP(B, Queue, ObjVersionBuilder::meta),
+			    GEP(B, Tags, PushArgs[j]));
+	  }
+	  B.CreateBr(Exit);
+      }
   }
 
   //   if( __sync_fetch_and_add( &pf->incoming_count, -1 ) == 1 )
@@ -2878,7 +3392,9 @@ CreateReleaseFn(CodeGenFunction &CGF,
       = B.CreateBitCast(SVoid,
 			llvm::PointerType::getUnqual(Info->getSavedStateTy()));
   Value *Args = GEP(B, S, 0);
-  // Value *Tags = GEP(B, S, 1);
+  Value *Tags = GEP(B, S, 1);
+  unsigned NumDataflowArgs = CountDataflowArgs(ArgBeg, ArgEnd);
+  unsigned NumPops = 0;
 
   // Call __cilkrts_obj_metadata_wakeup for every dataflow argument
   // TODO: this should not be done under writer lock while move_to_ready_list
@@ -2893,10 +3409,34 @@ CreateReleaseFn(CodeGenFunction &CGF,
 	  Value *Meta = GEP(B, Var, ObjVersionBuilder::meta);
 	  // struct.__cilkrts_obj_metadata != __cilkrts_obj_metadata
 	  Value *CMeta = Meta; // B.CreatePointerCast(Meta, (++WakeFn->arg_begin())->getType());
-	  // TODO: This call could be slightly more efficient if we knew it was
-	  // read or write because with write you know that the generation
-	  // (should) drop empty.
+	  // TODO: This call could be slightly more efficient if we knew it
+	  // was read or write because with write you know that the
+	  // generation (should) drop empty.
 	  B.CreateCall2(WakeFn, RList, CMeta);
+	  int Kind = GetDataflowKind( type );
+	  if( Kind == CILK_OBJ_QUEUE_PUSH ) {
+	      // The segment is complete: pops may consume it entirely. This
+	      // drops the task's reference to the segment and returns the
+	      // queue. The del_ref below drops the reference to the queue
+	      // taken by the issue function.
+	      Var = B.CreateCall(CILKRTS_FUNC(queue_segment_release, CGF), Var);
+	  } else if( Kind == CILK_OBJ_QUEUE_POP ) {
+	      // Wake up the tasks waiting for the segment the pop read first,
+	      // if it waited for one, and drop the reference to it.
+	      Value *Segment
+		  = LoadField(B, Tags, NumDataflowArgs + 2 * NumPops + 1);
+	      BasicBlock *BBWake = BasicBlock::Create(Ctx, "pop_segment", Fn);
+	      BasicBlock *BBNext
+		  = BasicBlock::Create(Ctx, "pop_segment_done", Fn);
+	      B.CreateCondBr(B.CreateIsNull(Segment), BBNext, BBWake);
+	      B.SetInsertPoint(BBWake);
+	      B.CreateCall2(WakeFn, RList,
+			    GEP(B, Segment, ObjVersionBuilder::meta));
+	      B.CreateCall(CILKRTS_FUNC(obj_version_del_ref, CGF), Segment);
+	      B.CreateBr(BBNext);
+	      B.SetInsertPoint(BBNext);
+	      ++NumPops;
+	  }
 	  // We are done with this object version. Decrement reference counter.
 	  // TODO: Could we move del_ref and destroy into WakeFn in order not
 	  //       to expose the payload to the ABI?
@@ -2963,11 +3503,28 @@ static llvm::Value *LookupParentSynced(CodeGenFunction &CGF) {
 }
 
 /// \brief Create the __cilkrts_stack_frame for the spawning function.
-static llvm::Value *CreateStackFrame(CodeGenFunction &CGF) {
+///
+/// With the compact frame ABI the frame is allocated with the compact layout,
+/// and accessed through a __cilkrts_stack_frame pointer. Its dataflow
+/// extension is only allocated if \p NeedsDataflowExt is set; the dataflow
+/// fields of other frames are never touched.
+static llvm::Value *CreateStackFrame(CodeGenFunction &CGF,
+                                     bool NeedsDataflowExt) {
   assert(!LookupStackFrame(CGF) && "already created the stack frame");
 
   llvm::LLVMContext &Ctx = CGF.getLLVMContext();
   llvm::Type *SFTy = StackFrameBuilder::get(Ctx);
+
+  if (CGF.CGM.getCodeGenOpts().CilkCompactFrame) {
+    llvm::Type *CompactTy = NeedsDataflowExt
+      ? CompactStackFrameBuilder::get(Ctx)
+      : CompactStackFrameCoreBuilder::get(Ctx);
+    llvm::AllocaInst *Compact =
+      CGF.CreateTempAlloca(CompactTy, "__cilkrts_sf_compact");
+    return new llvm::BitCastInst(Compact, llvm::PointerType::getUnqual(SFTy),
+                                 stack_frame_name, CGF.AllocaInsertPt);
+  }
+
   llvm::AllocaInst *SF = CGF.CreateTempAlloca(SFTy);
   SF->setName(stack_frame_name);
 
@@ -3017,6 +3574,33 @@ public:
   bool TraverseBlockExpr(BlockExpr *) { return true; }
 };
 
+/// \brief Helper to find out if a spawning function contains a dataflow spawn,
+/// in which case the dataflow helpers store into its frame.
+class FindDataflowSpawn : public RecursiveASTVisitor<FindDataflowSpawn> {
+public:
+  bool Found;
+
+  explicit FindDataflowSpawn(Stmt *Body) : Found(false) {
+    TraverseStmt(Body);
+  }
+
+  bool VisitCallExpr(CallExpr *E) {
+    if (E->isCilkSpawnCall() && HasDataflowArgument(E)) {
+      Found = true;
+      return false; // exit
+    }
+
+    return true;
+  }
+
+  bool VisitCilkSpawnDecl(CilkSpawnDecl *D) {
+    return TraverseStmt(D->getSpawnStmt());
+  }
+
+  bool TraverseLambdaExpr(LambdaExpr *) { return true; }
+  bool TraverseBlockExpr(BlockExpr *) { return true; }
+};
+
 /// \brief Set attributes for the helper function.
 ///
 /// The DoesNotThrow attribute should NOT be set during the semantic
@@ -3069,36 +3653,9 @@ bool isDataFlowSpawn(CodeGenFunction &CGF,
   FindSpawnCallExpr Finder(const_cast<Stmt *>(S));
   assert(Finder.Spawn && "spawn call expected");
 
-  // Walk list of arguments. Note: could do this in two ways: either
-  // analyse types alone, or analyse values.
-  // Note: adding keywords to the type would probably be safer as the values
-  // themselves could be passed to calls without proper effects.
-  const Expr * const * args = Finder.Spawn->getArgs();
-  unsigned num_args = Finder.Spawn->getNumArgs();
-
   the_spawn = Finder.Spawn;
 
-  // Is any of the arguments a dataflow type?
-  for( unsigned i=0; i < num_args; ++i ) {
-      const clang::Type * type = args[i]->getType().getTypePtr();
-      if( type->isRecordType() ) {
-	  if( const CXXRecordDecl * rdecl = type->getAsCXXRecordDecl() ) {
-	      // Does any of the methods of the struct/union/class have a
-	      // signature method name?
-	      for( CXXRecordDecl::method_iterator
-		       I=rdecl->method_begin(),
-		       E=rdecl->method_end(); I != E; ++I ) {
-		  FunctionDecl * m = *I;
-		  if( IdentifierInfo * id = m->getIdentifier() ) {
-		      if( id->isStr( "__Cilk_is_dataflow_type" ) )
-			  return true;
-		  }
-	      }
-	  }
-      }
-  }
-
-  return false;
+  return HasDataflowArgument(Finder.Spawn);
 }
 
 } // anonymous
@@ -3143,7 +3700,8 @@ void CodeGenFunction::EmitCilkSpawnDecl(const CilkSpawnDecl *D) {
     }
 
     // Emit call to the helper function
-    Function *Helper = EmitSpawnCapturedStmt(*D->getCapturedStmt(), VD);
+    Function *Helper = EmitSpawnCapturedStmt(*D->getCapturedStmt(), VD,
+                                             D->getPriority());
 
     // Register the spawn helper function.
     registerSpawnFunction(*this, Helper);
@@ -3184,7 +3742,8 @@ static void maybeCleanupBoundTemporary(CodeGenFunction &CGF,
 /// captured variables into the captured struct, and call the outlined function.
 llvm::Function *
 CodeGenFunction::EmitSpawnCapturedStmt(const CapturedStmt &S,
-                                       VarDecl *ReceiverDecl) {
+                                       VarDecl *ReceiverDecl,
+                                       unsigned Priority) {
   // llvm::errs() << " *** EmitSpawnCapturedStmt ***\n";
 
   const CapturedDecl *CD = S.getCapturedDecl();
@@ -3213,11 +3772,19 @@ CodeGenFunction::EmitSpawnCapturedStmt(const CapturedStmt &S,
   // errs() << "is dataflow? " << ( IsDataflow ? "yes" : "no" ) << "\n";
 
   CodeGenFunction CGF(CGM, true);
-  if( IsDataflow )
-      CGF.CapturedStmtInfo = new CGCilkDataflowSpawnInfo(S, ReceiverDecl, 0);
-  else
+  if( IsDataflow ) {
+      CGCilkDataflowSpawnInfo *Info
+	  = new CGCilkDataflowSpawnInfo(S, ReceiverDecl, 0);
+      Info->setPriority(Priority);
+      CGF.CapturedStmtInfo = Info;
+  } else
       CGF.CapturedStmtInfo = new CGCilkSpawnInfo(S, ReceiverDecl);
-  llvm::Function *F = CGF.GenerateCapturedStmtFunction(CD, RD, S.getLocStart());
+  llvm::Function *F;
+  {
+    TimeTraceScope TraceScope(IsDataflow ? "CilkDataflowSpawnHelper"
+                                         : "CilkSpawnHelper");
+    F = CGF.GenerateCapturedStmtFunction(CD, RD, S.getLocStart());
+  }
   if( IsDataflow ) {
       // Intended to catch use in destructor call for spawn fn argument,
       // but too indiscriminate...
@@ -3270,6 +3837,7 @@ ConstructCilkDataflowSavedState(CallExpr::const_arg_iterator ArgBeg,
 
     std::vector<llvm::Type *> SavedStateTypes;
     std::vector<llvm::Type *> TagTypes;
+    unsigned NumPops = 0;
     // llvm::errs() << "CGF === dump new alloca's:\n";
     CallExpr::const_arg_iterator Arg = ArgBeg;
     unsigned field = 0;
@@ -3290,6 +3858,9 @@ ConstructCilkDataflowSavedState(CallExpr::const_arg_iterator ArgBeg,
 	    if( IsDataflowType( Arg->getType().getTypePtr() ) ) {
 		TagTypes.push_back( TaskListNodeBuilder::get(Ctx) );
 		SavedStateTypes.push_back( ObjDepBuilder::get(Ctx) );
+		if( GetDataflowKind( Arg->getType().getTypePtr() )
+		    == CILK_OBJ_QUEUE_POP )
+		    ++NumPops;
 	    } else
 		SavedStateTypes.push_back( PTy->getContainedType(0) );
 	    ++Arg;
@@ -3297,6 +3868,14 @@ ConstructCilkDataflowSavedState(CallExpr::const_arg_iterator ArgBeg,
 	    SavedStateTypes.push_back( PTy->getContainedType(0) );
     }
 
+    // A pop waits for the segment it reads first with a task list node of
+    // its own; see GetDataflowGroup.
+    for( unsigned i=0; i != NumPops; ++i ) {
+	TagTypes.push_back( TaskListNodeBuilder::get(Ctx) );
+	TagTypes.push_back(
+	    TypeBuilder<__cilkrts_obj_version*, false>::get(Ctx) );
+    }
+
 /*
     llvm::errs() << "CGF === Args types:\n";
     for( std::vector<llvm::Type *>::const_iterator
@@ -3613,7 +4192,14 @@ public:
 /// release it in the end. This function should be only called once prior to
 /// processing function parameters.
 void CGCilkPlusRuntime::EmitCilkParentStackFrame(CodeGenFunction &CGF) {
-  llvm::Value *SF = CreateStackFrame(CGF);
+  bool NeedsDataflowExt = true;
+  if (CGF.CGM.getCodeGenOpts().CilkCompactFrame) {
+    const Decl *D = CGF.CurCodeDecl;
+    assert(D && D->getBody() && "spawning function without a body");
+    NeedsDataflowExt = FindDataflowSpawn(D->getBody()).Found;
+  }
+
+  llvm::Value *SF = CreateStackFrame(CGF, NeedsDataflowExt);
 
   // Need to initialize it by adding the prologue
   // to the top of the spawning function
@@ -3644,7 +4230,7 @@ void CGCilkPlusRuntime::EmitCilkHelperStackFrame(CodeGenFunction &CGF) {
     // (save arguments, call if ini_ready).
     // If a second call is used (call_fn), the runtime has already constructed
     // a stack frame for us.
-    llvm::Value *SF1 = CreateStackFrame(CGF);
+    llvm::Value *SF1 = CreateStackFrame(CGF, /*NeedsDataflowExt=*/true);
     llvm::Value *SFPtr = CreateStackFramePointer(CGF);
 
     llvm::AllocaInst *SavedStatePtr = CGF.CreateTempAlloca(Int8PtrTy, "");
@@ -3686,7 +4272,7 @@ void CGCilkPlusRuntime::EmitCilkHelperStackFrame(CodeGenFunction &CGF) {
 	Value *SFArg = B.CreatePointerCast(LookupStackFrameArg(CGF),
 					   llvm::PointerType::getUnqual(SFTy));
 	B.CreateStore(SFArg, SFPtr);
-	Value *AT = LoadField(B, SFArg, StackFrameBuilder::args_tags);
+	Value *AT = LoadFrameField(CGF, B, SFArg, StackFrameBuilder::args_tags);
 	B.CreateStore(AT, SavedStatePtr);
 	B.CreateBr(ReloadBB);
     }
@@ -3715,7 +4301,7 @@ void CGCilkPlusRuntime::EmitCilkHelperStackFrame(CodeGenFunction &CGF) {
     // -- both should be addressed now
     CGF.EHStack.pushCleanup<SpawnHelperStackFrameCleanup>(NormalAndEHCleanup, SFPtr, true);
   } else {
-    llvm::Value *SF = CreateStackFrame(CGF);
+    llvm::Value *SF = CreateStackFrame(CGF, /*NeedsDataflowExt=*/false);
 
     // Initialize the worker to null. If this worker is still null on exit,
     // then there is no stack frame constructed for spawning and there is no
@@ -21,6 +21,7 @@
 #include "clang/Sema/SemaDiagnostic.h"
 #include "clang/Basic/PrettyStackTrace.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TimeTrace.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/InlineAsm.h"
@@ -645,6 +646,9 @@ void CodeGenFunction::EmitDoStmt(const DoStmt &S) {
 }
 
 void CodeGenFunction::EmitForStmt(const ForStmt &S) {
+  if (S.getSpawnLoopCount())
+    return EmitCilkSpawnLoop(S);
+
   JumpDest LoopExit = getJumpDestInCurrentScope("for.end");
 
   RunCleanupsScope ForScope(*this);
@@ -1935,6 +1939,41 @@ CodeGenFunction::EmitCilkForGrainsizeStmt(const CilkForGrainsizeStmt &S) {
   EmitCilkForStmt(*cast<CilkForStmt>(S.getCilkFor()), Grainsize);
 }
 
+/// \brief Get or insert the cilk_for runtime entry matching the size of the
+/// loop count type. The affinity variants take an additional per-loop-site
+/// handle through which the runtime replays the chunk-to-worker mapping of
+/// the previous execution of the loop.
+static llvm::Constant *GetCilkForABIFunction(CodeGenModule &CGM,
+                                             QualType LoopCountTy,
+                                             llvm::FunctionType *&FTy,
+                                             bool Affinity = false) {
+  llvm::LLVMContext &Ctx = CGM.getLLVMContext();
+  llvm::Module &M = CGM.getModule();
+  uint64_t SizeInBits = CGM.getContext().getTypeSize(LoopCountTy);
+  if (SizeInBits <= 32u) {
+    if (Affinity) {
+      FTy = llvm::TypeBuilder<void(void(void *, uint32_t, uint32_t),
+                                   void *, uint32_t, int, void **),
+                              false>::get(Ctx);
+      return M.getOrInsertFunction("__cilkrts_cilk_for_affinity_32", FTy);
+    }
+    FTy = llvm::TypeBuilder<void(void(void *, uint32_t, uint32_t),
+                                 void *, uint32_t, int), false>::get(Ctx);
+    return M.getOrInsertFunction("__cilkrts_cilk_for_32", FTy);
+  } else if (SizeInBits <= 64u) {
+    if (Affinity) {
+      FTy = llvm::TypeBuilder<void(void(void *, uint64_t, uint64_t),
+                                   void *, uint64_t, int, void **),
+                              false>::get(Ctx);
+      return M.getOrInsertFunction("__cilkrts_cilk_for_affinity_64", FTy);
+    }
+    FTy = llvm::TypeBuilder<void(void(void *, uint64_t, uint64_t),
+                                 void *, uint64_t, int), false>::get(Ctx);
+    return M.getOrInsertFunction("__cilkrts_cilk_for_64", FTy);
+  }
+  llvm_unreachable("unexpected loop count type size");
+}
+
 void
 CodeGenFunction::EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize) {
   // if (cond) {
@@ -1943,6 +1982,11 @@ CodeGenFunction::EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize) {
   //   initialize context
   //   __cilkrts_cilk_for_32(helper, captures, count, gs);
   // }
+  //
+  // or, with '#pragma cilk affinity',
+  //
+  //   static void *site;
+  //   __cilkrts_cilk_for_affinity_32(helper, captures, count, gs, &site);
   RunCleanupsScope CilkForScope(*this);
 
   CGDebugInfo *DI = getDebugInfo();
@@ -1960,7 +2004,11 @@ CodeGenFunction::EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize) {
   CodeGenFunction CGF(CGM, true);
   CGF.CapturedStmtInfo = &CSInfo;
 
-  llvm::Function *Helper = CGF.GenerateCapturedStmtFunction(CD, RD, S.getLocStart());
+  llvm::Function *Helper;
+  {
+    TimeTraceScope TraceScope("CilkForHelper");
+    Helper = CGF.GenerateCapturedStmtFunction(CD, RD, S.getLocStart());
+  }
 
   llvm::BasicBlock *ThenBlock = createBasicBlock("if.then");
   llvm::BasicBlock *ContBlock = createBasicBlock("if.end");
@@ -1976,28 +2024,13 @@ CodeGenFunction::EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize) {
     // Initialize the captured struct.
     LValue CapStruct = InitCapturedStruct(*S.getBody());
 
-    llvm::LLVMContext &Ctx = CGM.getLLVMContext();
-
     // Get or insert the cilk_for abi function.
-    llvm::Constant *CilkForABI = 0;
     llvm::FunctionType *FTy = 0;
-    {
-      llvm::Module &M = CGM.getModule();
-      uint64_t SizeInBits = getContext().getTypeSize(LoopCountExpr->getType());
-      if (SizeInBits <= 32u) {
-        FTy = llvm::TypeBuilder<void(void(void *, uint32_t, uint32_t),
-                                     void *, uint32_t, int), false>::get(Ctx);
-        CilkForABI = M.getOrInsertFunction("__cilkrts_cilk_for_32", FTy);
-      } else if (SizeInBits <= 64u) {
-        FTy = llvm::TypeBuilder<void(void(void *, uint64_t, uint64_t),
-                                     void *, uint64_t, int), false>::get(Ctx);
-        CilkForABI = M.getOrInsertFunction("__cilkrts_cilk_for_64", FTy);
-      } else
-        llvm_unreachable("unexpected loop count type size");
-    }
+    llvm::Constant *CilkForABI = GetCilkForABIFunction(
+        CGM, LoopCountExpr->getType(), FTy, S.hasAffinity());
 
     // Call __cilkrts_cilk_for_*(helper, captures, count, grainsize);
-    SmallVector<llvm::Value *, 4> Args(4);
+    SmallVector<llvm::Value *, 5> Args(4);
     Args[0] = Builder.CreateBitCast(Helper, FTy->getParamType(0));
     Args[1] =
         Builder.CreatePointerCast(CapStruct.getAddress(), FTy->getParamType(1));
@@ -2005,6 +2038,17 @@ CodeGenFunction::EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize) {
     Args[3] = Grainsize ? Grainsize
                         : llvm::Constant::getNullValue(FTy->getParamType(3));
 
+    // Each loop site owns a handle, initially null, in which the runtime
+    // keeps the chunk-to-worker mapping across executions of the loop.
+    if (S.hasAffinity()) {
+      llvm::Type *SiteTy =
+          cast<llvm::PointerType>(FTy->getParamType(4))->getElementType();
+      Args.push_back(new llvm::GlobalVariable(
+          CGM.getModule(), SiteTy, /*isConstant=*/false,
+          llvm::GlobalValue::InternalLinkage,
+          llvm::Constant::getNullValue(SiteTy), "__cilk_for_affinity_site"));
+    }
+
     EmitCallOrInvoke(CilkForABI, Args);
 
     // Update the Loop Control Variable
@@ -2177,6 +2221,258 @@ void CodeGenFunction::EmitCilkForHelperBody(const Stmt *S) {
   EmitBlock(LoopExit.getBlock(), true);
 }
 
+/// \brief Returns the spawn forming the body of a loop with a spawn loop
+/// count.
+static const CilkSpawnExpr *getSpawnLoopSpawn(const ForStmt &S) {
+  const Stmt *Body = S.getBody();
+  if (const CompoundStmt *CS = dyn_cast<CompoundStmt>(Body))
+    Body = CS->body_back();
+  return cast<CilkSpawnExpr>(cast<Expr>(Body)->IgnoreImplicit());
+}
+
+/// \brief Returns the context passed to the helper of a spawn loop, i.e.
+/// \code
+/// struct {
+///   captures *spawn_captures;
+///   var_t var;
+///   var_t stride;
+/// };
+/// \endcode
+static llvm::StructType *getSpawnLoopContextType(CodeGenFunction &CGF,
+                                                 const CapturedStmt &CS,
+                                                 const VarDecl *ControlVar) {
+  QualType RecordTy =
+      CGF.getContext().getRecordType(CS.getCapturedRecordDecl());
+  llvm::Type *VarTy = CGF.ConvertTypeForMem(ControlVar->getType());
+  return llvm::StructType::get(CGF.ConvertType(RecordTy)->getPointerTo(),
+                               VarTy, VarTy, NULL);
+}
+
+void CodeGenFunction::EmitCilkSpawnLoop(const ForStmt &S) {
+  // A loop only spawning a call, recognized by Sema,
+  //
+  // for (var = init; cond; inc)
+  //   _Cilk_spawn f(args);
+  //
+  // is emitted as
+  //
+  // var = init;
+  // if (cond) {
+  //   count = loop_count;
+  //   context = { spawn captures, var, stride };
+  //   __cilkrts_cilk_for_32(helper, &context, count, 0);
+  // }
+  //
+  // so that the iteration space is split recursively by the runtime instead
+  // of being spawned one iteration at a time. All the iterations complete
+  // before the loop exits.
+  RunCleanupsScope ForScope(*this);
+
+  CGDebugInfo *DI = getDebugInfo();
+  if (DI)
+    DI->EmitLexicalBlockStart(Builder, S.getSourceRange().getBegin());
+
+  // Evaluate the first part before the loop.
+  EmitStmt(S.getInit());
+
+  const VarDecl *ControlVar =
+      cast<VarDecl>(cast<DeclStmt>(S.getInit())->getSingleDecl());
+  const CapturedStmt &CS =
+      *getSpawnLoopSpawn(S)->getSpawnDecl()->getCapturedStmt();
+  llvm::StructType *ContextTy = getSpawnLoopContextType(*this, CS, ControlVar);
+
+  // Emit the helper function.
+  CGCapturedStmtInfo CSInfo(CS);
+  CodeGenFunction CGF(CGM, true);
+  CGF.CapturedStmtInfo = &CSInfo;
+  llvm::Function *Helper = CGF.GenerateCilkSpawnLoopHelper(S, ContextTy);
+
+  llvm::BasicBlock *ThenBlock = createBasicBlock("spawn.loop.then");
+  llvm::BasicBlock *ContBlock = createBasicBlock("spawn.loop.end");
+  EmitBranchOnBoolExpr(S.getCond(), ThenBlock, ContBlock);
+
+  EmitBlock(ThenBlock);
+  {
+    RunCleanupsScope Scope(*this);
+
+    const Expr *LoopCountExpr = S.getSpawnLoopCount();
+    llvm::Value *LoopCount = EmitScalarExpr(LoopCountExpr);
+
+    // Evaluate the stride once, before any iteration is spawned.
+    llvm::Value *Base = Builder.CreateLoad(GetAddrOfLocalVar(ControlVar));
+    llvm::Value *Stride = 0;
+    const Expr *IncExpr = S.getInc()->IgnoreParens();
+    if (const UnaryOperator *Inc = dyn_cast<UnaryOperator>(IncExpr)) {
+      Stride = llvm::ConstantInt::get(Base->getType(),
+                                      Inc->isIncrementOp() ? 1 : -1,
+                                      /*isSigned=*/true);
+    } else {
+      const CompoundAssignOperator *Inc = cast<CompoundAssignOperator>(IncExpr);
+      const Expr *RHS = Inc->getRHS();
+      Stride = Builder.CreateIntCast(
+          EmitScalarExpr(RHS), Base->getType(),
+          RHS->getType()->isSignedIntegerOrEnumerationType());
+      if (Inc->getOpcode() == BO_SubAssign)
+        Stride = Builder.CreateNeg(Stride);
+    }
+
+    // Initialize the context.
+    LValue CapStruct = InitCapturedStruct(CS);
+    llvm::Value *Context = CreateTempAlloca(ContextTy, "__spawn_loop.ctx");
+    Builder.CreateStore(CapStruct.getAddress(),
+                        Builder.CreateStructGEP(Context, 0));
+    Builder.CreateStore(Base, Builder.CreateStructGEP(Context, 1));
+    Builder.CreateStore(Stride, Builder.CreateStructGEP(Context, 2));
+
+    // Call __cilkrts_cilk_for_*(helper, context, count, 0);
+    llvm::FunctionType *FTy = 0;
+    llvm::Constant *CilkForABI =
+        GetCilkForABIFunction(CGM, LoopCountExpr->getType(), FTy);
+
+    SmallVector<llvm::Value *, 4> Args(4);
+    Args[0] = Builder.CreateBitCast(Helper, FTy->getParamType(0));
+    Args[1] = Builder.CreatePointerCast(Context, FTy->getParamType(1));
+    Args[2] = LoopCount;
+    Args[3] = llvm::Constant::getNullValue(FTy->getParamType(3));
+
+    EmitCallOrInvoke(CilkForABI, Args);
+
+    EmitBranch(ContBlock);
+  }
+
+  EmitBlock(ContBlock, true);
+
+  if (DI)
+    DI->EmitLexicalBlockEnd(Builder, S.getSourceRange().getEnd());
+}
+
+llvm::Function *
+CodeGenFunction::GenerateCilkSpawnLoopHelper(const ForStmt &S,
+                                             llvm::StructType *ContextTy) {
+  // The helper of a spawn loop runs a chunk of iterations serially:
+  //
+  // void helper(context, low, high) {
+  //   for (index = low; index < high; ++index) {
+  //     var_t var = context->var + index * context->stride;
+  //     f(args);
+  //   }
+  // }
+  //
+  // Any reference to the loop control variable reads the private copy and
+  // every other variable is read through the captures of the spawn.
+  assert(CapturedStmtInfo && "codegen info expected");
+  ASTContext &Ctx = getContext();
+  const CilkSpawnExpr *Spawn = getSpawnLoopSpawn(S);
+  const CapturedStmt &CS = *Spawn->getSpawnDecl()->getCapturedStmt();
+  const CapturedDecl *CD = CS.getCapturedDecl();
+  const RecordDecl *RD = CS.getCapturedRecordDecl();
+  const VarDecl *ControlVar =
+      cast<VarDecl>(cast<DeclStmt>(S.getInit())->getSingleDecl());
+  QualType CountTy = S.getSpawnLoopCount()->getType();
+  SourceLocation Loc = S.getLocStart();
+
+  // Build the argument list.
+  DeclContext *DC = CapturedDecl::castToDeclContext(CD);
+  ImplicitParamDecl *ContextParam =
+      ImplicitParamDecl::Create(Ctx, DC, Loc, &Ctx.Idents.get("__context"),
+                                Ctx.VoidPtrTy);
+  ImplicitParamDecl *LowParam =
+      ImplicitParamDecl::Create(Ctx, DC, Loc, &Ctx.Idents.get("__low"),
+                                CountTy);
+  ImplicitParamDecl *HighParam =
+      ImplicitParamDecl::Create(Ctx, DC, Loc, &Ctx.Idents.get("__high"),
+                                CountTy);
+  FunctionArgList Args;
+  Args.push_back(ContextParam);
+  Args.push_back(LowParam);
+  Args.push_back(HighParam);
+
+  // Create the function declaration.
+  FunctionType::ExtInfo ExtInfo;
+  const CGFunctionInfo &FuncInfo =
+    CGM.getTypes().arrangeFunctionDeclaration(Ctx.VoidTy, Args, ExtInfo,
+                                              /*IsVariadic=*/false);
+  llvm::FunctionType *FuncLLVMTy = CGM.getTypes().GetFunctionType(FuncInfo);
+
+  llvm::Function *F =
+    llvm::Function::Create(FuncLLVMTy, llvm::GlobalValue::InternalLinkage,
+                           "__cilk_spawn_loop_helper", &CGM.getModule());
+  CGM.SetInternalFunctionAttributes(CD, F, FuncInfo);
+
+  // Generate the function.
+  StartFunction(CD, Ctx.VoidTy, F, FuncInfo, Args, Loc);
+
+  llvm::Value *Context =
+      Builder.CreateBitCast(Builder.CreateLoad(LocalDeclMap[ContextParam]),
+                            ContextTy->getPointerTo());
+  CapturedStmtInfo->setContextValue(
+      Builder.CreateLoad(Builder.CreateStructGEP(Context, 0)));
+  llvm::Value *Base = Builder.CreateLoad(Builder.CreateStructGEP(Context, 1));
+  llvm::Value *Stride = Builder.CreateLoad(Builder.CreateStructGEP(Context, 2));
+
+  // If 'this' is captured, load it into CXXThisValue.
+  if (CapturedStmtInfo->isCXXThisExprCaptured()) {
+    FieldDecl *FD = CapturedStmtInfo->getThisFieldDecl();
+    LValue LV = MakeNaturalAlignAddrLValue(CapturedStmtInfo->getContextValue(),
+                                           Ctx.getTagDeclType(RD));
+    LValue ThisLValue = EmitLValueForField(LV, FD);
+    CXXThisValue = EmitLoadOfLValue(ThisLValue, Loc).getScalarVal();
+  }
+
+  for (RecordDecl::field_iterator I = RD->field_begin(),
+                                  E = RD->field_end();
+       I != E; ++I) {
+    if ((*I)->getType()->isVariablyModifiedType()) {
+      EmitVariablyModifiedType((*I)->getType());
+    }
+  }
+
+  // The local copy of the loop control variable takes precedence over the
+  // captured one.
+  llvm::Value *VarAddr =
+      CreateMemTemp(ControlVar->getType(), ControlVar->getName());
+  LocalDeclMap[ControlVar] = VarAddr;
+
+  llvm::Value *Index = CreateTempAlloca(ConvertType(CountTy), "__index.addr");
+  Builder.CreateStore(Builder.CreateLoad(LocalDeclMap[LowParam]), Index);
+  llvm::Value *High = Builder.CreateLoad(LocalDeclMap[HighParam]);
+
+  llvm::BasicBlock *CondBlock = createBasicBlock("loop.cond");
+  llvm::BasicBlock *LoopBody = createBasicBlock("loop.body");
+  llvm::BasicBlock *ExitBlock = createBasicBlock("loop.end");
+
+  EmitBlock(CondBlock);
+  llvm::Value *IndexVal = Builder.CreateLoad(Index);
+  Builder.CreateCondBr(Builder.CreateICmpULT(IndexVal, High), LoopBody,
+                       ExitBlock);
+
+  EmitBlock(LoopBody);
+  {
+    RunCleanupsScope BodyScope(*this);
+
+    llvm::Value *Offset = Builder.CreateMul(
+        Builder.CreateZExtOrTrunc(IndexVal, Base->getType()), Stride);
+    Builder.CreateStore(Builder.CreateAdd(Base, Offset), VarAddr);
+
+    // Emit the spawned call as an ordinary call.
+    const CallExpr *Call =
+        cast<CallExpr>(Spawn->getSpawnExpr()->IgnoreImplicit());
+    llvm::Value *Callee = EmitScalarExpr(Call->getCallee());
+    EmitCall(Call->getCallee()->getType(), Callee, Call->getLocStart(),
+             ReturnValueSlot(), Call->arg_begin(), Call->arg_end(),
+             Call->getCalleeDecl());
+  }
+
+  llvm::Value *One = llvm::ConstantInt::get(IndexVal->getType(), 1);
+  Builder.CreateStore(Builder.CreateAdd(IndexVal, One), Index);
+  EmitBranch(CondBlock);
+
+  EmitBlock(ExitBlock, true);
+  FinishFunction(S.getLocEnd());
+
+  return F;
+}
+
 void
 CodeGenFunction::CGCilkSpawnInfo::EmitBody(CodeGenFunction &CGF, Stmt *S) {
   // If there is a receiver, save its address.
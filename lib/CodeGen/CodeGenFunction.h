@@ -523,7 +523,7 @@ public:
 				       RecordDecl *RD)
 	  : CGCilkSpawnInfo(S, VD, CR_CilkDataflowSpawn), // DataflowState(RD) { }
 	    SavedStateTy(0), SavedState(0), SavedStateArgStart(0), ReloadBB(0),
-	    SaveBB(0), IniReadyFn(0), IssueFn(0), ReleaseFn(0) { }
+	    SaveBB(0), IniReadyFn(0), IssueFn(0), ReleaseFn(0), Priority(0) { }
 
       virtual StringRef getHelperName() const { return "__cilk_df_spawn_helper_multi"; }
 
@@ -552,6 +552,10 @@ public:
 
       void setIniReadyFn(llvm::Function *IRFn) { IniReadyFn = IRFn; }
       llvm::Function *getIniReadyFn() const { return IniReadyFn; }
+
+      /// \brief The priority stored in the pending frame of this spawn.
+      void setPriority(unsigned P) { Priority = P; }
+      unsigned getPriority() const { return Priority; }
       
       void setSavedState(llvm::StructType *STy, llvm::AllocaInst *S,
 			 unsigned Start) {
@@ -598,6 +602,7 @@ public:
       llvm::Function *IssueFn;
       llvm::Function *ReleaseFn;
       llvm::Instruction *CallInst;
+      unsigned Priority;
   };
 
 
@@ -2275,10 +2280,14 @@ public:
                                                const RecordDecl *RD,
                                                SourceLocation Loc);
 
-  llvm::Function *EmitSpawnCapturedStmt(const CapturedStmt &S, VarDecl *VD);
+  llvm::Function *EmitSpawnCapturedStmt(const CapturedStmt &S, VarDecl *VD,
+                                        unsigned Priority = 0);
   void EmitCilkForGrainsizeStmt(const CilkForGrainsizeStmt &S);
   void EmitCilkForStmt(const CilkForStmt &S, llvm::Value *Grainsize = 0);
   void EmitCilkForHelperBody(const Stmt *S);
+  void EmitCilkSpawnLoop(const ForStmt &S);
+  llvm::Function *GenerateCilkSpawnLoopHelper(const ForStmt &S,
+                                              llvm::StructType *ContextTy);
   void EmitPragmaSimd(CGPragmaSimdWrapper &W);
   llvm::Function *EmitSimdFunction(CGPragmaSimdWrapper &W);
   void EmitSIMDForStmt(const SIMDForStmt &S);
@@ -36,6 +36,7 @@
 #include "clang/Basic/Module.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Basic/Version.h"
 #include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Sema/SemaDiagnostic.h"
@@ -1354,6 +1355,11 @@ void CodeGenModule::EmitGlobalDefinition(GlobalDecl GD) {
   PrettyStackTraceDecl CrashInfo(const_cast<ValueDecl *>(D), D->getLocation(), 
                                  Context.getSourceManager(),
                                  "Generating code for declaration");
+
+  std::string TraceDetail;
+  if (isTimeTraceEnabled())
+    TraceDetail = cast<NamedDecl>(D)->getQualifiedNameAsString();
+  TimeTraceScope TraceScope("CodeGen Decl", TraceDetail);
   
   if (isa<FunctionDecl>(D)) {
     // At -O0, don't generate IR for functions with available_externally 
@@ -2204,6 +2210,10 @@ void CodeGenModule::EmitGlobalFunctionDefinition(GlobalDecl GD) {
     AddGlobalDtor(Fn, DA->getPriority());
   if (D->hasAttr<AnnotateAttr>())
     AddGlobalAnnotations(D, Fn);
+
+  // The statements of the body aren't needed any more.
+  if (LangOpts.FreeFunctionBodies)
+    getContext().freeFunctionBody(D);
 }
 
 void CodeGenModule::EmitAliasDefinition(GlobalDecl GD) {
@@ -8,7 +8,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Driver/Compilation.h"
+#include "clang/Basic/ThreadPool.h"
 #include "clang/Driver/Action.h"
+#include "clang/Driver/CompileServer.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/DriverDiagnostic.h"
 #include "clang/Driver/Options.h"
@@ -16,6 +18,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <errno.h>
 #include <sys/stat.h>
@@ -27,7 +30,7 @@ using namespace llvm::opt;
 Compilation::Compilation(const Driver &D, const ToolChain &_DefaultToolChain,
                          InputArgList *_Args, DerivedArgList *_TranslatedArgs)
   : TheDriver(D), DefaultToolChain(_DefaultToolChain), Args(_Args),
-    TranslatedArgs(_TranslatedArgs), Redirects(0) {
+    TranslatedArgs(_TranslatedArgs), Redirects(0), NumParallelJobs(1) {
 }
 
 Compilation::~Compilation() {
@@ -126,39 +129,68 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
-  if ((getDriver().CCPrintOptions ||
-       getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
-    raw_ostream *OS = &llvm::errs();
-
-    // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
-    // output stream.
-    if (getDriver().CCPrintOptions && getDriver().CCPrintOptionsFilename) {
-      std::string Error;
-      OS = new llvm::raw_fd_ostream(getDriver().CCPrintOptionsFilename, Error,
-                                    llvm::sys::fs::F_Append);
-      if (!Error.empty()) {
-        getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
-          << Error;
-        FailingCommand = &C;
-        delete OS;
-        return 1;
-      }
+/// PrintCommand - Print \p C before executing it, for -v and
+/// CC_PRINT_OPTIONS.
+///
+/// \return false if the CC_PRINT_OPTIONS file couldn't be opened.
+static bool PrintCommand(const Compilation &Comp, const Command &C) {
+  const Driver &D = Comp.getDriver();
+  if ((!D.CCPrintOptions && !Comp.getArgs().hasArg(options::OPT_v)) ||
+      D.CCGenDiagnostics)
+    return true;
+
+  raw_ostream *OS = &llvm::errs();
+
+  // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
+  // output stream.
+  if (D.CCPrintOptions && D.CCPrintOptionsFilename) {
+    std::string Error;
+    OS = new llvm::raw_fd_ostream(D.CCPrintOptionsFilename, Error,
+                                  llvm::sys::fs::F_Append);
+    if (!Error.empty()) {
+      D.Diag(clang::diag::err_drv_cc_print_options_failure) << Error;
+      delete OS;
+      return false;
     }
+  }
 
-    if (getDriver().CCPrintOptions)
-      *OS << "[Logging clang options]";
+  if (D.CCPrintOptions)
+    *OS << "[Logging clang options]";
 
-    C.Print(*OS, "\n", /*Quote=*/getDriver().CCPrintOptions);
+  C.Print(*OS, "\n", /*Quote=*/D.CCPrintOptions);
 
-    if (OS != &llvm::errs())
-      delete OS;
+  if (OS != &llvm::errs())
+    delete OS;
+  return true;
+}
+
+int Compilation::ExecuteCommandOnce(const Command &C,
+                                    const StringRef **Redirects,
+                                    std::string *ErrMsg,
+                                    bool *ExecutionFailed) const {
+  // Only the frontend runs in a compile server.
+  const llvm::opt::ArgStringList &Args = C.getArguments();
+  if (!CompileServerPath.empty() && !Args.empty() &&
+      StringRef(Args[0]) == "-cc1") {
+    int Res;
+    if (executeOnCompileServer(CompileServerPath, C, Redirects, Res)) {
+      *ExecutionFailed = false;
+      return Res;
+    }
+  }
+  return C.Execute(Redirects, ErrMsg, ExecutionFailed);
+}
+
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  if (!PrintCommand(*this, C)) {
+    FailingCommand = &C;
+    return 1;
   }
 
   std::string Error;
   bool ExecutionFailed;
-  int Res = C.Execute(Redirects, &Error, &ExecutionFailed);
+  int Res = ExecuteCommandOnce(C, Redirects, &Error, &ExecutionFailed);
   if (!Error.empty()) {
     assert(Res && "Error string set with 0 result code!");
     getDriver().Diag(clang::diag::err_drv_command_failure) << Error;
@@ -205,12 +237,147 @@ void Compilation::ExecuteJob(const Job &J,
       FailingCommands.push_back(std::make_pair(Res, FailingCommand));
   } else {
     const JobList *Jobs = cast<JobList>(&J);
+    // Output redirected for crash diagnostics is shared by all commands, so
+    // they must run one at a time.
+    if (NumParallelJobs > 1 && Jobs->size() > 1 && !Redirects) {
+      ExecuteJobsInParallel(*Jobs, FailingCommands);
+      return;
+    }
     for (JobList::const_iterator it = Jobs->begin(), ie = Jobs->end();
          it != ie; ++it)
       ExecuteJob(**it, FailingCommands);
   }
 }
 
+namespace {
+/// ParallelCommand - A command run by ExecuteJobsInParallel, and its result.
+struct ParallelCommand {
+  const Compilation *Comp;
+  const Command *C;
+
+  /// The commands producing the inputs of this one have a lower level.
+  unsigned Level;
+
+  /// Files receiving the standard output and error of the command, or empty
+  /// if they couldn't be created.
+  SmallString<128> OutPath, ErrPath;
+
+  std::string Error;
+  bool ExecutionFailed;
+  int Result;
+
+  ParallelCommand(const Compilation *Comp, const Command *C)
+    : Comp(Comp), C(C), Level(0), ExecutionFailed(false), Result(0) {}
+};
+}
+
+static void CollectCommands(const Compilation &Comp, const Job &J,
+                            SmallVectorImpl<ParallelCommand> &Commands) {
+  if (const Command *C = dyn_cast<Command>(&J)) {
+    Commands.push_back(ParallelCommand(&Comp, C));
+    return;
+  }
+  const JobList *Jobs = cast<JobList>(&J);
+  for (JobList::const_iterator it = Jobs->begin(), ie = Jobs->end();
+       it != ie; ++it)
+    CollectCommands(Comp, **it, Commands);
+}
+
+/// DependsOn - Whether action \p A consumes the output of \p Input, directly
+/// or through actions that are not commands of their own.
+static bool DependsOn(const Action *A, const Action *Input) {
+  for (Action::const_iterator AI = A->begin(), AE = A->end(); AI != AE; ++AI)
+    if (*AI == Input || DependsOn(*AI, Input))
+      return true;
+  return false;
+}
+
+static void RunParallelCommand(void *Data) {
+  ParallelCommand *PC = static_cast<ParallelCommand *>(Data);
+  StringRef OutPath = PC->OutPath.str(), ErrPath = PC->ErrPath.str();
+  const StringRef *Redirects[] = { 0, 0, 0 };
+  if (!OutPath.empty() && !ErrPath.empty()) {
+    Redirects[1] = &OutPath;
+    Redirects[2] = &ErrPath;
+  }
+  PC->Result = PC->Comp->ExecuteCommandOnce(*PC->C, Redirects, &PC->Error,
+                                            &PC->ExecutionFailed);
+}
+
+/// CopyOutput - Copy the file \p Path to \p OS and remove it.
+static void CopyOutput(StringRef Path, raw_ostream &OS) {
+  if (Path.empty())
+    return;
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (!llvm::MemoryBuffer::getFile(Path, Buffer))
+    OS << Buffer->getBuffer();
+  OS.flush();
+  bool Existed;
+  llvm::sys::fs::remove(Path, Existed);
+}
+
+void Compilation::ExecuteJobsInParallel(const JobList &Jobs,
+                                        FailingCommandList &FailingCommands)
+                                        const {
+  SmallVector<ParallelCommand, 8> Commands;
+  CollectCommands(*this, Jobs, Commands);
+
+  // Commands at the same level don't depend on each other. Since a command
+  // never depends on a later one, one pass assigns all the levels. The
+  // commands of one action, e.g. the objcopy commands that split the debug
+  // info out of an object, run in the order they were added.
+  unsigned MaxLevel = 0;
+  for (unsigned I = 0, N = Commands.size(); I != N; ++I) {
+    const Action *Source = &Commands[I].C->getSource();
+    for (unsigned Prev = 0; Prev != I; ++Prev) {
+      const Action *PrevSource = &Commands[Prev].C->getSource();
+      if (Commands[Prev].Level >= Commands[I].Level &&
+          (Source == PrevSource || DependsOn(Source, PrevSource)))
+        Commands[I].Level = Commands[Prev].Level + 1;
+    }
+    MaxLevel = std::max(MaxLevel, Commands[I].Level);
+  }
+
+  ThreadPool Pool(NumParallelJobs);
+  for (unsigned Level = 0; Level <= MaxLevel; ++Level) {
+    SmallVector<ParallelCommand *, 8> Started;
+    for (unsigned I = 0, N = Commands.size(); I != N; ++I) {
+      ParallelCommand &PC = Commands[I];
+      if (PC.Level != Level || !InputsOk(*PC.C, FailingCommands))
+        continue;
+      if (!PrintCommand(*this, *PC.C)) {
+        FailingCommands.push_back(std::make_pair(1, PC.C));
+        continue;
+      }
+
+      // Buffer the output of the command, so that it comes out in one piece.
+      if (llvm::sys::fs::createTemporaryFile("clang-job", "out", PC.OutPath) ||
+          llvm::sys::fs::createTemporaryFile("clang-job", "err", PC.ErrPath)) {
+        CopyOutput(PC.OutPath, llvm::outs());
+        PC.OutPath.clear();
+        PC.ErrPath.clear();
+      }
+
+      Started.push_back(&PC);
+      Pool.async(RunParallelCommand, &PC);
+    }
+    Pool.wait();
+
+    // Report in the order the commands would have run serially.
+    for (unsigned I = 0, N = Started.size(); I != N; ++I) {
+      ParallelCommand &PC = *Started[I];
+      CopyOutput(PC.OutPath, llvm::outs());
+      CopyOutput(PC.ErrPath, llvm::errs());
+      if (!PC.Error.empty()) {
+        assert(PC.Result && "Error string set with 0 result code!");
+        getDriver().Diag(clang::diag::err_drv_command_failure) << PC.Error;
+      }
+      if (int Res = PC.ExecutionFailed ? 1 : PC.Result)
+        FailingCommands.push_back(std::make_pair(Res, PC.C));
+    }
+  }
+}
+
 void Compilation::initCompilationForDiagnostics() {
   // Free actions and jobs.
   DeleteContainerPointers(Actions);
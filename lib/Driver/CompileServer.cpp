@@ -0,0 +1,332 @@
+//===--- CompileServer.cpp - Running -cc1 jobs in a server ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the messages exchanged with a compile server, and
+//  the driver's side of the protocol. The server is in tools/driver.
+//
+//  The driver sends one request per connection:
+//    version, "compile", executable, working directory, arguments...
+//  and the server answers with either
+//    version, "done", exit code, standard output, standard error
+//  or
+//    version, "unsupported"
+//  or, if the compiler crashed,
+//    version, "crashed"
+//  in which case the driver runs the command itself.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Driver/CompileServer.h"
+#include "clang/Driver/Job.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+#if defined(LLVM_ON_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace clang;
+using namespace clang::driver;
+
+const char clang::driver::CompileServerProtocolVersion[] =
+  "clang-compile-server-1";
+
+#if defined(LLVM_ON_UNIX)
+
+#ifdef MSG_NOSIGNAL
+// Don't die of SIGPIPE if the other side went away.
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0;
+#endif
+
+static bool sendAll(int FD, const char *Data, size_t Size) {
+  while (Size) {
+    ssize_t Sent = ::send(FD, Data, Size, SendFlags);
+    if (Sent < 0) {
+      if (errno == EINTR)
+        continue;
+      return true;
+    }
+    Data += Sent;
+    Size -= Sent;
+  }
+  return false;
+}
+
+static bool receiveAll(int FD, char *Data, size_t Size) {
+  while (Size) {
+    ssize_t Received = ::recv(FD, Data, Size, 0);
+    if (Received < 0 && errno == EINTR)
+      continue;
+    if (Received <= 0)
+      return true;
+    Data += Received;
+    Size -= Received;
+  }
+  return false;
+}
+
+static bool sendSize(int FD, uint32_t Size) {
+  unsigned char Bytes[4] = {
+    (unsigned char)Size, (unsigned char)(Size >> 8),
+    (unsigned char)(Size >> 16), (unsigned char)(Size >> 24)
+  };
+  return sendAll(FD, reinterpret_cast<const char *>(Bytes), 4);
+}
+
+static bool receiveSize(int FD, uint32_t &Size) {
+  unsigned char Bytes[4];
+  if (receiveAll(FD, reinterpret_cast<char *>(Bytes), 4))
+    return true;
+  Size = Bytes[0] | (Bytes[1] << 8) | (Bytes[2] << 16) |
+         ((uint32_t)Bytes[3] << 24);
+  return false;
+}
+
+static bool makeSocketAddress(StringRef Path, sockaddr_un &Addr) {
+  if (Path.size() >= sizeof(Addr.sun_path))
+    return true;
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  memcpy(Addr.sun_path, Path.data(), Path.size());
+  return false;
+}
+
+bool clang::driver::writeCompileServerMessage(int FD,
+                                              ArrayRef<std::string> Fields) {
+  if (sendSize(FD, Fields.size()))
+    return true;
+  for (unsigned I = 0, N = Fields.size(); I != N; ++I)
+    if (sendSize(FD, Fields[I].size()) ||
+        sendAll(FD, Fields[I].data(), Fields[I].size()))
+      return true;
+  return false;
+}
+
+bool clang::driver::readCompileServerMessage(int FD,
+                                             std::vector<std::string> &Fields) {
+  uint32_t NumFields;
+  if (receiveSize(FD, NumFields))
+    return true;
+  Fields.clear();
+  for (uint32_t I = 0; I != NumFields; ++I) {
+    uint32_t Size;
+    if (receiveSize(FD, Size))
+      return true;
+    Fields.push_back(std::string());
+    Fields.back().resize(Size);
+    if (Size && receiveAll(FD, &Fields.back()[0], Size))
+      return true;
+  }
+  return false;
+}
+
+static bool setNonBlocking(int FD, bool NonBlocking) {
+  int Flags = ::fcntl(FD, F_GETFL);
+  if (Flags == -1)
+    return true;
+  Flags = NonBlocking ? (Flags | O_NONBLOCK) : (Flags & ~O_NONBLOCK);
+  return ::fcntl(FD, F_SETFL, Flags) == -1;
+}
+
+int clang::driver::listenOnCompileServerSocket(StringRef Path,
+                                               std::string &Error) {
+  // Bind to a temporary name, and only give the socket its real name once
+  // it accepts connections. Otherwise a driver could find the socket too
+  // early, and run its job itself.
+  SmallString<128> TmpPath(Path);
+  TmpPath += ".tmp";
+  TmpPath += llvm::utostr(::getpid());
+  sockaddr_un Addr, TmpAddr;
+  if (makeSocketAddress(Path, Addr) || makeSocketAddress(TmpPath, TmpAddr)) {
+    Error = "socket path is too long";
+    return -1;
+  }
+
+  int FD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (FD == -1) {
+    Error = strerror(errno);
+    return -1;
+  }
+
+  ::unlink(TmpAddr.sun_path);
+  if (::bind(FD, reinterpret_cast<sockaddr *>(&TmpAddr),
+             sizeof(TmpAddr)) == -1 ||
+      ::listen(FD, 64) == -1 || setNonBlocking(FD, true) ||
+      // Replace the socket of a server that is gone.
+      ::rename(TmpAddr.sun_path, Addr.sun_path) == -1) {
+    Error = strerror(errno);
+    ::unlink(TmpAddr.sun_path);
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+int clang::driver::acceptCompileServerConnection(int ListenFD,
+                                                 unsigned Timeout,
+                                                 bool &TimedOut) {
+  TimedOut = false;
+  for (;;) {
+    pollfd Poll;
+    Poll.fd = ListenFD;
+    Poll.events = POLLIN;
+    Poll.revents = 0;
+    int Ready = ::poll(&Poll, 1, Timeout ? int(Timeout * 1000) : -1);
+    if (Ready == -1) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (Ready == 0) {
+      TimedOut = true;
+      return -1;
+    }
+
+    // Another worker may have taken the connection in the meantime.
+    int FD = ::accept(ListenFD, 0, 0);
+    if (FD == -1) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == ECONNABORTED)
+        continue;
+      return -1;
+    }
+    // Connections inherit the flags of the listening socket on some hosts.
+    if (setNonBlocking(FD, false)) {
+      ::close(FD);
+      continue;
+    }
+    return FD;
+  }
+}
+
+void clang::driver::closeCompileServerSocket(int FD) {
+  ::close(FD);
+}
+
+static int connectToCompileServer(StringRef Path) {
+  sockaddr_un Addr;
+  if (makeSocketAddress(Path, Addr))
+    return -1;
+
+  int FD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (FD == -1)
+    return -1;
+  if (::connect(FD, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) == -1) {
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+/// \brief Write the output \p Data of a command where Command::Execute would
+/// have sent it.
+static void writeOutput(StringRef Data, const StringRef *Redirect,
+                        raw_ostream &Default) {
+  if (!Redirect) {
+    Default << Data;
+    Default.flush();
+    return;
+  }
+  // An empty path stands for /dev/null.
+  if (Redirect->empty())
+    return;
+  std::string ErrorInfo;
+  llvm::raw_fd_ostream OS(Redirect->str().c_str(), ErrorInfo);
+  if (ErrorInfo.empty())
+    OS << Data;
+}
+
+bool clang::driver::executeOnCompileServer(StringRef Path, const Command &C,
+                                           const StringRef **Redirects,
+                                           int &Result) {
+  // The server doesn't read standard input.
+  if (Redirects && Redirects[0])
+    return false;
+
+  SmallString<256> WorkingDir;
+  if (llvm::sys::fs::current_path(WorkingDir))
+    return false;
+
+  int FD = connectToCompileServer(Path);
+  if (FD == -1)
+    return false;
+
+  std::vector<std::string> Request;
+  Request.push_back(CompileServerProtocolVersion);
+  Request.push_back("compile");
+  Request.push_back(C.getExecutable());
+  Request.push_back(WorkingDir.str());
+  const llvm::opt::ArgStringList &Args = C.getArguments();
+  for (unsigned I = 0, N = Args.size(); I != N; ++I)
+    Request.push_back(Args[I]);
+
+  std::vector<std::string> Response;
+  bool Failed = writeCompileServerMessage(FD, Request) ||
+                readCompileServerMessage(FD, Response);
+  ::close(FD);
+
+  // If the server went away in the middle of the command, e.g. because the
+  // compiler crashed, run it again locally to report the problem.
+  if (Failed || Response.size() != 5 ||
+      Response[0] != CompileServerProtocolVersion || Response[1] != "done" ||
+      StringRef(Response[2]).getAsInteger(10, Result))
+    return false;
+
+  writeOutput(Response[3], Redirects ? Redirects[1] : 0, llvm::outs());
+  writeOutput(Response[4], Redirects ? Redirects[2] : 0, llvm::errs());
+  return true;
+}
+
+#else
+
+bool clang::driver::writeCompileServerMessage(int FD,
+                                              ArrayRef<std::string> Fields) {
+  return true;
+}
+
+bool clang::driver::readCompileServerMessage(int FD,
+                                             std::vector<std::string> &Fields) {
+  return true;
+}
+
+int clang::driver::listenOnCompileServerSocket(StringRef Path,
+                                               std::string &Error) {
+  Error = "compile servers are not supported on this host";
+  return -1;
+}
+
+int clang::driver::acceptCompileServerConnection(int ListenFD,
+                                                 unsigned Timeout,
+                                                 bool &TimedOut) {
+  TimedOut = false;
+  return -1;
+}
+
+void clang::driver::closeCompileServerSocket(int FD) {}
+
+bool clang::driver::executeOnCompileServer(StringRef Path, const Command &C,
+                                           const StringRef **Redirects,
+                                           int &Result) {
+  return false;
+}
+
+#endif
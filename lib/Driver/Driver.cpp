@@ -10,6 +10,7 @@
 #include "clang/Driver/Driver.h"
 #include "InputInfo.h"
 #include "ToolChains.h"
+#include "clang/Basic/ThreadPool.h"
 #include "clang/Basic/Version.h"
 #include "clang/Driver/Action.h"
 #include "clang/Driver/Compilation.h"
@@ -370,6 +371,21 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
   // The compilation takes ownership of Args.
   Compilation *C = new Compilation(*this, TC, Args, TranslatedArgs);
 
+  if (const Arg *A = Args->getLastArg(options::OPT_j)) {
+    StringRef Value = A->getValue();
+    unsigned NumJobs = 0;
+    if (Value.empty())
+      C->setNumParallelJobs(ThreadPool::getHardwareConcurrency());
+    else if (Value.getAsInteger(10, NumJobs) || NumJobs == 0)
+      Diag(clang::diag::err_drv_invalid_int_value)
+        << A->getAsString(*Args) << Value;
+    else
+      C->setNumParallelJobs(NumJobs);
+  }
+
+  if (const Arg *A = Args->getLastArg(options::OPT_fcompile_server_EQ))
+    C->setCompileServerPath(A->getValue());
+
   if (!HandleImmediateArgs(*C))
     return C;
 
@@ -2064,9 +2064,10 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   } else if (isa<MigrateJobAction>(JA)) {
     CmdArgs.push_back("-migrate");
   } else if (isa<PreprocessJobAction>(JA)) {
-    if (Output.getType() == types::TY_Dependencies)
+    if (Output.getType() == types::TY_Dependencies) {
       CmdArgs.push_back("-Eonly");
-    else {
+      Args.AddLastArg(CmdArgs, options::OPT_fminimize_dependency_scan);
+    } else {
       CmdArgs.push_back("-E");
       if (Args.hasArg(options::OPT_rewrite_objc) &&
           !Args.hasArg(options::OPT_g_Group))
@@ -2706,6 +2707,10 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   CmdArgs.push_back(D.ResourceDir.c_str());
 
   Args.AddLastArg(CmdArgs, options::OPT_working_directory);
+  Args.AddLastArg(CmdArgs, options::OPT_fstat_cache_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_token_cache_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_access_profile_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_lazy_redecl_chains);
 
   bool ARCMTEnabled = false;
   if (!Args.hasArg(options::OPT_fno_objc_arc, options::OPT_fobjc_arc)) {
@@ -2908,6 +2913,12 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(A->getValue());
   }
 
+  Args.AddLastArg(CmdArgs, options::OPT_fconstexpr_bytecode);
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_instantiate_templates);
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_codegen);
+  Args.AddLastArg(CmdArgs, options::OPT_foverload_resolution_cache);
+  Args.AddLastArg(CmdArgs, options::OPT_ffree_function_bodies);
+
   if (Arg *A = Args.getLastArg(options::OPT_fbracket_depth_EQ)) {
     CmdArgs.push_back("-fbracket-depth");
     CmdArgs.push_back(A->getValue());
@@ -3005,6 +3016,8 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_show_template_tree);
   Args.AddLastArg(CmdArgs, options::OPT_fno_elide_type);
   Args.AddLastArg(CmdArgs, options::OPT_fcilkplus);
+  Args.AddLastArg(CmdArgs, options::OPT_fcilk_compact_frame);
+  Args.AddLastArg(CmdArgs, options::OPT_fcilk_spawn_priority);
 
   if (Args.hasArg(options::OPT_fcilkplus))
     if (getToolChain().getTriple().getOS() != llvm::Triple::Linux &&
@@ -3052,6 +3065,8 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_print_source_range_info);
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_parseable_fixits);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_report);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_granularity_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftrapv);
 
   if (Arg *A = Args.getLastArg(options::OPT_ftrapv_handler_EQ)) {
@@ -3262,6 +3277,12 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_interval);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_after);
 
+  // -fmodules-prebuild builds the missing modules in parallel up front.
+  if (HaveModules) {
+    Args.AddAllArgs(CmdArgs, options::OPT_fmodules_prebuild_EQ);
+    Args.AddLastArg(CmdArgs, options::OPT_fmodules_prebuild_threads_EQ);
+  }
+
   // -faccess-control is default.
   if (Args.hasFlag(options::OPT_fno_access_control,
                    options::OPT_faccess_control,
@@ -3724,8 +3745,41 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
       (*it)->render(Args, CmdArgs);
   }
 
+  // With -fparallel-codegen=N, the code of an object file is generated on N
+  // threads into N temporary objects, which a relocatable link combines.
+  // That isn't possible with split DWARF, with the Windows tools, or when the
+  // object is written to stdout.
+  ArgStringList CodeGenParts;
+  if (Arg *A = Args.getLastArg(options::OPT_fparallel_codegen_EQ)) {
+    unsigned NumParts;
+    if (StringRef(A->getValue()).getAsInteger(10, NumParts) || NumParts == 0)
+      D.Diag(diag::err_drv_invalid_int_value)
+        << A->getAsString(Args) << A->getValue();
+    else if (NumParts > 1 && Output.isFilename() &&
+             StringRef(Output.getFilename()) != "-" &&
+             Output.getType() == types::TY_Object &&
+             !Args.hasArg(options::OPT_gsplit_dwarf) &&
+             !getToolChain().getTriple().isOSWindows()) {
+      StringRef Stem = llvm::sys::path::stem(Output.getFilename());
+      for (unsigned I = 0; I != NumParts; ++I) {
+        const char *Part = C.addTempFile(
+          Args.MakeArgString(D.GetTemporaryPath(Stem, "o")));
+        CodeGenParts.push_back(Part);
+      }
+    }
+  }
+
   if (Output.getType() == types::TY_Dependencies) {
     // Handled with other dependency code.
+  } else if (!CodeGenParts.empty()) {
+    CmdArgs.push_back("-o");
+    CmdArgs.push_back(CodeGenParts[0]);
+    for (unsigned I = 1, N = CodeGenParts.size(); I != N; ++I) {
+      CmdArgs.push_back("-parallel-codegen-output");
+      CmdArgs.push_back(CodeGenParts[I]);
+    }
+    CmdArgs.push_back("-parallel-codegen-object");
+    CmdArgs.push_back(Output.getFilename());
   } else if (Output.isFilename()) {
     CmdArgs.push_back("-o");
     CmdArgs.push_back(Output.getFilename());
@@ -3791,6 +3845,17 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     C.addCommand(new Command(JA, *this, Exec, CmdArgs));
   }
 
+  // Combine the objects generated in parallel into the output.
+  if (!CodeGenParts.empty()) {
+    ArgStringList LinkArgs;
+    LinkArgs.push_back("-r");
+    LinkArgs.push_back("-o");
+    LinkArgs.push_back(Output.getFilename());
+    LinkArgs.append(CodeGenParts.begin(), CodeGenParts.end());
+    const char *Linker =
+      Args.MakeArgString(getToolChain().GetProgramPath("ld"));
+    C.addCommand(new Command(JA, *this, Linker, LinkArgs));
+  }
 
   // Handle the debug info splitting at object creation time if we're
   // creating an object.
@@ -164,6 +164,12 @@ static const std::string &getPreambleFile(const ASTUnit *AU) {
   return getOnDiskData(AU).PreambleFile;  
 }
 
+StringRef ASTUnit::getPreamblePCHFile() const {
+  if (SharedPreamble)
+    return SharedPreamble->getPCHName();
+  return getPreambleFile(this);
+}
+
 void OnDiskData::CleanTemporaryFiles() {
   for (unsigned I = 0, N = TemporaryFiles.size(); I != N; ++I)
     llvm::sys::fs::remove(TemporaryFiles[I]);
@@ -989,11 +995,14 @@ public:
 
 class PrecompilePreambleAction : public ASTFrontendAction {
   ASTUnit &Unit;
+  raw_ostream *Out;
   bool HasEmittedPreamblePCH;
 
 public:
-  explicit PrecompilePreambleAction(ASTUnit &Unit)
-      : Unit(Unit), HasEmittedPreamblePCH(false) {}
+  /// \param Out If non-null, the stream to write the precompiled preamble to,
+  /// instead of the output file.
+  PrecompilePreambleAction(ASTUnit &Unit, raw_ostream *Out)
+      : Unit(Unit), Out(Out), HasEmittedPreamblePCH(false) {}
 
   virtual ASTConsumer *CreateASTConsumer(CompilerInstance &CI,
                                          StringRef InFile);
@@ -1062,9 +1071,11 @@ ASTConsumer *PrecompilePreambleAction::CreateASTConsumer(CompilerInstance &CI,
                                                          StringRef InFile) {
   std::string Sysroot;
   std::string OutputFile;
-  raw_ostream *OS = 0;
-  if (GeneratePCHAction::ComputeASTConsumerArguments(CI, InFile, Sysroot,
-                                                     OutputFile, OS))
+  raw_ostream *OS = Out;
+  if (OS)
+    Sysroot = CI.getHeaderSearchOpts().Sysroot;
+  else if (GeneratePCHAction::ComputeASTConsumerArguments(CI, InFile, Sysroot,
+                                                          OutputFile, OS))
     return 0;
 
   if (!CI.getFrontendOpts().RelocatablePCH)
@@ -1168,6 +1179,11 @@ bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
   Ctx = 0;
   PP = 0;
   Reader = 0;
+
+  // Keep the preamble that the new AST reads alive for as long as the AST.
+  ParsedPreamble = 0;
+  if (OverrideMainBuffer)
+    ParsedPreamble = SharedPreamble;
   
   // Clear out old caches and data.
   TopLevelDecls.clear();
@@ -1193,7 +1209,11 @@ bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
     PreprocessorOpts.PrecompiledPreambleBytes.first = Preamble.size();
     PreprocessorOpts.PrecompiledPreambleBytes.second
                                                     = PreambleEndsAtStartOfLine;
-    PreprocessorOpts.ImplicitPCHInclude = getPreambleFile(this);
+    PreprocessorOpts.ImplicitPCHInclude = getPreamblePCHFile();
+    if (SharedPreamble) {
+      PreprocessorOpts.ImplicitPCHBuffer = SharedPreamble->getPCHBuffer();
+      PreprocessorOpts.PrecompiledPreambleMainFile = OriginalSourceFile;
+    }
     PreprocessorOpts.DisablePCHValidation = true;
     
     // The stored diagnostic has the old source manager in it; update
@@ -1218,7 +1238,7 @@ bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
     goto error;
 
   if (OverrideMainBuffer) {
-    std::string ModName = getPreambleFile(this);
+    std::string ModName = getPreamblePCHFile();
     TranslateStoredDiagnostics(Clang->getModuleManager(), ModName,
                                getSourceManager(), PreambleDiagnostics,
                                StoredDiagnostics);
@@ -1359,6 +1379,82 @@ static llvm::MemoryBuffer *CreatePaddedMainFileBuffer(llvm::MemoryBuffer *Old,
   return Result;
 }
 
+/// \brief Determine whether any of the files used by a precompiled preamble,
+/// \p FilesInPreamble, has changed since the preamble was built, given the
+/// files that \p PPOpts remaps.
+static bool anyFileInPreambleChanged(FileManager &FileMgr,
+                                     PreprocessorOptions &PPOpts,
+         const llvm::StringMap<std::pair<off_t, time_t> > &FilesInPreamble) {
+  // First, make a record of those files that have been overridden via
+  // remapping or unsaved_files.
+  llvm::StringMap<std::pair<off_t, time_t> > OverriddenFiles;
+  for (PreprocessorOptions::remapped_file_iterator
+            R = PPOpts.remapped_file_begin(),
+         REnd = PPOpts.remapped_file_end();
+       R != REnd;
+       ++R) {
+    llvm::sys::fs::file_status Status;
+    if (FileMgr.getNoncachedStatValue(R->second, Status)) {
+      // If we can't stat the file we're remapping to, assume that something
+      // horrible happened.
+      return true;
+    }
+
+    OverriddenFiles[R->first] = std::make_pair(
+        Status.getSize(), Status.getLastModificationTime().toEpochTime());
+  }
+  for (PreprocessorOptions::remapped_file_buffer_iterator
+            R = PPOpts.remapped_file_buffer_begin(),
+         REnd = PPOpts.remapped_file_buffer_end();
+       R != REnd;
+       ++R) {
+    // FIXME: Should we actually compare the contents of file->buffer
+    // remappings?
+    OverriddenFiles[R->first] = std::make_pair(R->second->getBufferSize(), 
+                                               0);
+  }
+   
+  // Check whether anything has changed.
+  for (llvm::StringMap<std::pair<off_t, time_t> >::const_iterator 
+         F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
+       F != FEnd; 
+       ++F) {
+    llvm::StringMap<std::pair<off_t, time_t> >::iterator Overridden
+      = OverriddenFiles.find(F->first());
+    if (Overridden != OverriddenFiles.end()) {
+      // This file was remapped; check whether the newly-mapped file 
+      // matches up with the previous mapping.
+      if (Overridden->second != F->second)
+        return true;
+      continue;
+    }
+    
+    // The file was not remapped; check whether it has changed on disk.
+    llvm::sys::fs::file_status Status;
+    if (FileMgr.getNoncachedStatValue(F->first(), Status)) {
+      // If we can't stat the file, assume that something horrible happened.
+      return true;
+    }
+    if (Status.getSize() != uint64_t(F->second.first) ||
+        Status.getLastModificationTime().toEpochTime() !=
+            uint64_t(F->second.second))
+      return true;
+  }
+  return false;
+}
+
+/// \brief Copy the files used by a precompiled preamble, since StringMap
+/// can't be copied.
+static void
+copyFilesInPreamble(const llvm::StringMap<std::pair<off_t, time_t> > &From,
+                    llvm::StringMap<std::pair<off_t, time_t> > &To) {
+  To.clear();
+  for (llvm::StringMap<std::pair<off_t, time_t> >::const_iterator
+         F = From.begin(), FEnd = From.end();
+       F != FEnd; ++F)
+    To[F->first()] = F->second;
+}
+
 /// \brief Attempt to build or re-use a precompiled preamble when (re-)parsing
 /// the source file.
 ///
@@ -1404,6 +1500,7 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     // preamble, if we have one. It's obviously no good any more.
     Preamble.clear();
     erasePreambleFile(this);
+    SharedPreamble = 0;
 
     // The next time we actually see a preamble, precompile it.
     PreambleRebuildCounter = 1;
@@ -1424,65 +1521,8 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
       // preamble.
 
       // Check that none of the files used by the preamble have changed.
-      bool AnyFileChanged = false;
-          
-      // First, make a record of those files that have been overridden via
-      // remapping or unsaved_files.
-      llvm::StringMap<std::pair<off_t, time_t> > OverriddenFiles;
-      for (PreprocessorOptions::remapped_file_iterator
-                R = PreprocessorOpts.remapped_file_begin(),
-             REnd = PreprocessorOpts.remapped_file_end();
-           !AnyFileChanged && R != REnd;
-           ++R) {
-        llvm::sys::fs::file_status Status;
-        if (FileMgr->getNoncachedStatValue(R->second, Status)) {
-          // If we can't stat the file we're remapping to, assume that something
-          // horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
-
-        OverriddenFiles[R->first] = std::make_pair(
-            Status.getSize(), Status.getLastModificationTime().toEpochTime());
-      }
-      for (PreprocessorOptions::remapped_file_buffer_iterator
-                R = PreprocessorOpts.remapped_file_buffer_begin(),
-             REnd = PreprocessorOpts.remapped_file_buffer_end();
-           !AnyFileChanged && R != REnd;
-           ++R) {
-        // FIXME: Should we actually compare the contents of file->buffer
-        // remappings?
-        OverriddenFiles[R->first] = std::make_pair(R->second->getBufferSize(), 
-                                                   0);
-      }
-       
-      // Check whether anything has changed.
-      for (llvm::StringMap<std::pair<off_t, time_t> >::iterator 
-             F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
-           !AnyFileChanged && F != FEnd; 
-           ++F) {
-        llvm::StringMap<std::pair<off_t, time_t> >::iterator Overridden
-          = OverriddenFiles.find(F->first());
-        if (Overridden != OverriddenFiles.end()) {
-          // This file was remapped; check whether the newly-mapped file 
-          // matches up with the previous mapping.
-          if (Overridden->second != F->second)
-            AnyFileChanged = true;
-          continue;
-        }
-        
-        // The file was not remapped; check whether it has changed on disk.
-        llvm::sys::fs::file_status Status;
-        if (FileMgr->getNoncachedStatValue(F->first(), Status)) {
-          // If we can't stat the file, assume that something horrible happened.
-          AnyFileChanged = true;
-        } else if (Status.getSize() != uint64_t(F->second.first) ||
-                   Status.getLastModificationTime().toEpochTime() !=
-                       uint64_t(F->second.second))
-          AnyFileChanged = true;
-      }
-          
-      if (!AnyFileChanged) {
+      if (!anyFileInPreambleChanged(*FileMgr, PreprocessorOpts,
+                                    FilesInPreamble)) {
         // Okay! We can re-use the precompiled preamble.
 
         // Set the state of the diagnostic object to mimic its state
@@ -1509,6 +1549,7 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     Preamble.clear();
     PreambleDiagnostics.clear();
     erasePreambleFile(this);
+    SharedPreamble = 0;
     PreambleRebuildCounter = 1;
   } else if (!AllowRebuild) {
     // We aren't allowed to rebuild the precompiled preamble; just
@@ -1516,6 +1557,53 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     return 0;
   }
 
+  // Another translation unit may have precompiled the same preamble. Since
+  // that takes no time, use it even if we wouldn't build a preamble yet.
+  StringRef MainFilename = FrontendOpts.Inputs[0].getFile();
+  llvm::FoldingSetNodeID PreambleKey;
+  if (PreambleCache) {
+    StringRef PreambleText(NewPreamble.first->getBufferStart(),
+                           NewPreamble.second.first);
+    PrecompiledPreambleCache::Profile(PreambleKey, *PreambleInvocation,
+                                      MainFilename, PreambleText,
+                                      NewPreamble.second.second);
+    IntrusiveRefCntPtr<PrecompiledPreamble> Cached
+      = PreambleCache->lookup(PreambleKey);
+    if (Cached &&
+        NewPreamble.first->getBufferSize() < Cached->ReservedSize-2 &&
+        !anyFileInPreambleChanged(*FileMgr, PreprocessorOpts,
+                                  Cached->FilesInPreamble)) {
+      Preamble.assign(FileMgr->getFile(MainFilename),
+                      NewPreamble.first->getBufferStart(),
+                      NewPreamble.first->getBufferStart()
+                                                  + NewPreamble.second.first);
+      PreambleEndsAtStartOfLine = NewPreamble.second.second;
+      PreambleReservedSize = Cached->ReservedSize;
+      copyFilesInPreamble(Cached->FilesInPreamble, FilesInPreamble);
+      PreambleDiagnostics = Cached->Diagnostics;
+      NumWarningsInPreamble = Cached->NumWarnings;
+      TopLevelDeclsInPreamble = Cached->TopLevelDecls;
+      SharedPreamble = Cached;
+      PreambleRebuildCounter = 1;
+
+      // Set the state of the diagnostic object to mimic its state
+      // after parsing the preamble.
+      getDiagnostics().Reset();
+      ProcessWarningOptions(getDiagnostics(),
+                            PreambleInvocation->getDiagnosticOpts());
+      getDiagnostics().setNumWarnings(NumWarningsInPreamble);
+
+      CurrentTopLevelHashValue = Cached->TopLevelHashValue;
+      if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+        CompletionCacheTopLevelHashValue = 0;
+        PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+      }
+
+      return CreatePaddedMainFileBuffer(NewPreamble.first,
+                                        PreambleReservedSize, MainFilename);
+    }
+  }
+
   // If the preamble rebuild counter > 1, it's because we previously
   // failed to build a preamble and we're not yet ready to try
   // again. Decrement the counter and return a failure.
@@ -1524,13 +1612,16 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     return 0;
   }
 
-  // Create a temporary file for the precompiled preamble. In rare 
-  // circumstances, this can fail.
-  std::string PreamblePCHPath = GetPreamblePCHPath();
-  if (PreamblePCHPath.empty()) {
-    // Try again next time.
-    PreambleRebuildCounter = 1;
-    return 0;
+  // Create a temporary file for the precompiled preamble, unless it's kept
+  // in memory. In rare circumstances, this can fail.
+  std::string PreamblePCHPath;
+  if (!PreambleCache) {
+    PreamblePCHPath = GetPreamblePCHPath();
+    if (PreamblePCHPath.empty()) {
+      // Try again next time.
+      PreambleRebuildCounter = 1;
+      return 0;
+    }
   }
   
   // We did not previously compute a preamble, or it can't be reused anyway.
@@ -1549,7 +1640,6 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
 
   // Save the preamble text for later; we'll need to compare against it for
   // subsequent reparses.
-  StringRef MainFilename = PreambleInvocation->getFrontendOpts().Inputs[0].getFile();
   Preamble.assign(FileMgr->getFile(MainFilename),
                   NewPreamble.first->getBufferStart(), 
                   NewPreamble.first->getBufferStart() 
@@ -1570,9 +1660,9 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   StringRef MainFilePath = FrontendOpts.Inputs[0].getFile();
   PreprocessorOpts.addRemappedFile(MainFilePath, PreambleBuffer);
 
-  // Tell the compiler invocation to generate a temporary precompiled header.
+  // Tell the compiler invocation to generate a temporary precompiled header,
+  // or one in memory.
   FrontendOpts.ProgramAction = frontend::GeneratePCH;
-  // FIXME: Generate the precompiled header into memory?
   FrontendOpts.OutputFile = PreamblePCHPath;
   PreprocessorOpts.PrecompiledPreambleBytes.first = 0;
   PreprocessorOpts.PrecompiledPreambleBytes.second = false;
@@ -1629,8 +1719,11 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   Clang->setSourceManager(new SourceManager(getDiagnostics(),
                                             Clang->getFileManager()));
   
+  std::string PCHContents;
+  llvm::raw_string_ostream PCHStream(PCHContents);
   OwningPtr<PrecompilePreambleAction> Act;
-  Act.reset(new PrecompilePreambleAction(*this));
+  Act.reset(new PrecompilePreambleAction(*this,
+                                         PreambleCache ? &PCHStream : 0));
   if (!Act->BeginSourceFile(*Clang.get(), Clang->getFrontendOpts().Inputs[0])) {
     llvm::sys::fs::remove(FrontendOpts.OutputFile);
     Preamble.clear();
@@ -1664,7 +1757,8 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   checkAndRemoveNonDriverDiags(StoredDiagnostics);
   
   // Keep track of the preamble we precompiled.
-  setPreambleFile(this, FrontendOpts.OutputFile);
+  if (!PreambleCache)
+    setPreambleFile(this, FrontendOpts.OutputFile);
   NumWarningsInPreamble = getDiagnostics().getNumWarnings();
   
   // Keep track of all of the files that the source manager knows about,
@@ -1696,6 +1790,22 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     CompletionCacheTopLevelHashValue = 0;
     PreambleTopLevelHashValue = CurrentTopLevelHashValue;
   }
+
+  // Share the preamble with the other translation units.
+  if (PreambleCache) {
+    std::string PCHName = MainFilename.str() + ".preamble.pch";
+    PrecompiledPreamble *P
+      = new PrecompiledPreamble(PCHName,
+                                llvm::MemoryBuffer::getMemBufferCopy(
+                                    PCHStream.str(), PCHName));
+    P->ReservedSize = PreambleReservedSize;
+    copyFilesInPreamble(FilesInPreamble, P->FilesInPreamble);
+    P->Diagnostics = PreambleDiagnostics;
+    P->NumWarnings = NumWarningsInPreamble;
+    P->TopLevelDecls = TopLevelDeclsInPreamble;
+    P->TopLevelHashValue = CurrentTopLevelHashValue;
+    SharedPreamble = PreambleCache->insert(PreambleKey, P);
+  }
   
   return CreatePaddedMainFileBuffer(NewPreamble.first, 
                                     PreambleReservedSize,
@@ -1787,7 +1897,8 @@ ASTUnit *ASTUnit::LoadFromCompilerInvocationAction(CompilerInvocation *CI,
                                              bool CacheCodeCompletionResults,
                                     bool IncludeBriefCommentsInCodeCompletion,
                                              bool UserFilesAreVolatile,
-                                             OwningPtr<ASTUnit> *ErrAST) {
+                                             OwningPtr<ASTUnit> *ErrAST,
+                                     PrecompiledPreambleCache *PreambleCache) {
   assert(CI && "A CompilerInvocation is required");
 
   OwningPtr<ASTUnit> OwnAST;
@@ -1804,6 +1915,7 @@ ASTUnit *ASTUnit::LoadFromCompilerInvocationAction(CompilerInvocation *CI,
   }
   AST->OnlyLocalDecls = OnlyLocalDecls;
   AST->CaptureDiagnostics = CaptureDiagnostics;
+  AST->PreambleCache = PreambleCache;
   if (PrecompilePreamble)
     AST->PreambleRebuildCounter = 2;
   AST->TUKind = Action ? Action->getTranslationUnitKind() : TU_Complete;
@@ -1995,7 +2107,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
                                       bool SkipFunctionBodies,
                                       bool UserFilesAreVolatile,
                                       bool ForSerialization,
-                                      OwningPtr<ASTUnit> *ErrAST) {
+                                      OwningPtr<ASTUnit> *ErrAST,
+                                      PrecompiledPreambleCache *PreambleCache) {
   if (!Diags.getPtr()) {
     // No diagnostics engine was provided, so create our own diagnostics object
     // with the default options.
@@ -2053,6 +2166,7 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
   AST->IncludeBriefCommentsInCodeCompletion
     = IncludeBriefCommentsInCodeCompletion;
   AST->UserFilesAreVolatile = UserFilesAreVolatile;
+  AST->PreambleCache = PreambleCache;
   AST->NumStoredDiagnosticsFromDriver = StoredDiagnostics.size();
   AST->StoredDiagnostics.swap(StoredDiagnostics);
   AST->Invocation = CI;
@@ -2112,7 +2226,7 @@ bool ASTUnit::Reparse(RemappedFile *RemappedFiles, unsigned NumRemappedFiles) {
   // If we have a preamble file lying around, or if we might try to
   // build a precompiled preamble, do so now.
   llvm::MemoryBuffer *OverrideMainBuffer = 0;
-  if (!getPreambleFile(this).empty() || PreambleRebuildCounter > 0)
+  if (!getPreamblePCHFile().empty() || PreambleRebuildCounter > 0)
     OverrideMainBuffer = getMainBufferWithPrecompiledPreamble(*Invocation);
     
   // Clear out the diagnostics state.
@@ -2485,7 +2599,7 @@ void ASTUnit::CodeComplete(StringRef File, unsigned Line, unsigned Column,
   // point is within the main file, after the end of the precompiled
   // preamble.
   llvm::MemoryBuffer *OverrideMainBuffer = 0;
-  if (!getPreambleFile(this).empty()) {
+  if (!getPreamblePCHFile().empty()) {
     std::string CompleteFilePath(File);
     llvm::sys::fs::UniqueID CompleteFileID;
 
@@ -2508,7 +2622,11 @@ void ASTUnit::CodeComplete(StringRef File, unsigned Line, unsigned Column,
     PreprocessorOpts.PrecompiledPreambleBytes.first = Preamble.size();
     PreprocessorOpts.PrecompiledPreambleBytes.second
                                                     = PreambleEndsAtStartOfLine;
-    PreprocessorOpts.ImplicitPCHInclude = getPreambleFile(this);
+    PreprocessorOpts.ImplicitPCHInclude = getPreamblePCHFile();
+    if (SharedPreamble) {
+      PreprocessorOpts.ImplicitPCHBuffer = SharedPreamble->getPCHBuffer();
+      PreprocessorOpts.PrecompiledPreambleMainFile = OriginalSourceFile;
+    }
     PreprocessorOpts.DisablePCHValidation = true;
     
     OwnedBuffers.push_back(OverrideMainBuffer);
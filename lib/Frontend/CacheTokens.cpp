@@ -19,7 +19,11 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/OnDiskHashTable.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/Lexer.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
@@ -59,20 +63,25 @@ class PTHEntryKeyVariant {
   union { const FileEntry* FE; const char* Path; };
   enum { IsFE = 0x1, IsDE = 0x2, IsNoExist = 0x0 } Kind;
   FileData *Data;
+  /// The name a file is stored under, if not its own.
+  const char *FEName;
 
 public:
-  PTHEntryKeyVariant(const FileEntry *fe) : FE(fe), Kind(IsFE), Data(0) {}
+  PTHEntryKeyVariant(const FileEntry *fe, const char *name = 0)
+      : FE(fe), Kind(IsFE), Data(0), FEName(name) {}
 
   PTHEntryKeyVariant(FileData *Data, const char *path)
-      : Path(path), Kind(IsDE), Data(new FileData(*Data)) {}
+      : Path(path), Kind(IsDE), Data(new FileData(*Data)), FEName(0) {}
 
   explicit PTHEntryKeyVariant(const char *path)
-      : Path(path), Kind(IsNoExist), Data(0) {}
+      : Path(path), Kind(IsNoExist), Data(0), FEName(0) {}
 
   bool isFile() const { return Kind == IsFE; }
 
   StringRef getString() const {
-    return Kind == IsFE ? FE->getName() : Path;
+    if (Kind == IsFE)
+      return FEName ? FEName : FE->getName();
+    return Path;
   }
 
   unsigned getKind() const { return (unsigned) Kind; }
@@ -179,6 +188,8 @@ class PTHWriter {
   CachedStrsTy CachedStrs;
   Offset CurStrOffset;
   std::vector<llvm::StringMapEntry<OffsetOpt>*> StrEntries;
+  /// Whether a #error or #warning was seen; PTHLexer discards them.
+  bool SawDiagnosticDirective;
 
   //// Get the persistent id for the given IdentifierInfo*.
   uint32_t ResolveID(const IdentifierInfo* II);
@@ -214,12 +225,25 @@ class PTHWriter {
   PTHEntry LexTokens(Lexer& L);
   Offset EmitCachedSpellings();
 
+  /// EmitPrologue - Emit the header of the PTH file, leaving room for the
+  ///  offsets of the tables, whose location is returned.
+  Offset EmitPrologue(StringRef MainFile);
+
+  /// EmitTables - Emit the tables that follow the token data, and
+  ///  backpatch their offsets into the prologue.
+  void EmitTables(Offset PrologueOffset);
+
 public:
   PTHWriter(llvm::raw_fd_ostream& out, Preprocessor& pp)
-    : Out(out), PP(pp), idcount(0), CurStrOffset(0) {}
+    : Out(out), PP(pp), idcount(0), CurStrOffset(0),
+      SawDiagnosticDirective(false) {}
 
   PTHMap &getPM() { return PM; }
   void GeneratePTH(const std::string &MainFile);
+
+  /// GenerateHeaderPTH - Write the tokens of the file of FID alone, stored
+  ///  under the given name.  Returns false if they can't be cached.
+  bool GenerateHeaderPTH(FileID FID, const char *Name);
 };
 } // end anonymous namespace
 
@@ -335,6 +359,11 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
       ParsingPreprocessorDirective = true;
 
       switch (K) {
+      case tok::pp_error:
+      case tok::pp_warning:
+        SawDiagnosticDirective = true;
+        break;
+
       case tok::pp_not_keyword:
         // Invalid directives "#foo" can occur in #if 0 blocks etc, just pass
         // them through.
@@ -444,7 +473,7 @@ Offset PTHWriter::EmitCachedSpellings() {
   return SpellingsOff;
 }
 
-void PTHWriter::GeneratePTH(const std::string &MainFile) {
+Offset PTHWriter::EmitPrologue(StringRef MainFile) {
   // Generate the prologue.
   Out << "cfe-pth" << '\0';
   Emit32(PTHManager::Version);
@@ -463,6 +492,30 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
   }
   Emit8(0);
 
+  return PrologueOffset;
+}
+
+void PTHWriter::EmitTables(Offset PrologueOffset) {
+  // Write out the identifier table.
+  const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
+
+  // Write out the cached strings table.
+  Offset SpellingOff = EmitCachedSpellings();
+
+  // Write out the file table.
+  Offset FileTableOff = EmitFileTable();
+
+  // Finally, write the prologue.
+  Out.seek(PrologueOffset);
+  Emit32(IdTableOff.first);
+  Emit32(IdTableOff.second);
+  Emit32(FileTableOff);
+  Emit32(SpellingOff);
+}
+
+void PTHWriter::GeneratePTH(const std::string &MainFile) {
+  Offset PrologueOffset = EmitPrologue(MainFile);
+
   // Iterate over all the files in SourceManager.  Create a lexer
   // for each file and cache the tokens.
   SourceManager &SM = PP.getSourceManager();
@@ -486,21 +539,28 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
     PM.insert(FE, LexTokens(L));
   }
 
-  // Write out the identifier table.
-  const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
-
-  // Write out the cached strings table.
-  Offset SpellingOff = EmitCachedSpellings();
-
-  // Write out the file table.
-  Offset FileTableOff = EmitFileTable();
+  EmitTables(PrologueOffset);
+}
 
-  // Finally, write the prologue.
-  Out.seek(PrologueOffset);
-  Emit32(IdTableOff.first);
-  Emit32(IdTableOff.second);
-  Emit32(FileTableOff);
-  Emit32(SpellingOff);
+bool PTHWriter::GenerateHeaderPTH(FileID FID, const char *Name) {
+  SourceManager &SM = PP.getSourceManager();
+  bool Invalid = false;
+  const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID, &Invalid);
+  if (Invalid)
+    return false;
+
+  Offset PrologueOffset = EmitPrologue(StringRef());
+
+  // Lex the file again in raw mode; the file has already been entered, so
+  // there is no need for a new FileID.
+  Lexer L(FID, FromFile, SM, PP.getLangOpts());
+  PM.insert(PTHEntryKeyVariant(SM.getFileEntryForID(FID), Name),
+            LexTokens(L));
+  if (SawDiagnosticDirective)
+    return false;
+
+  EmitTables(PrologueOffset);
+  return true;
 }
 
 namespace {
@@ -561,6 +621,103 @@ void clang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS) {
   PW.GeneratePTH(MainFilePath.str());
 }
 
+bool clang::CacheHeaderTokens(Preprocessor &PP, FileID FID, const char *Name,
+                              llvm::raw_fd_ostream *OS) {
+  PTHWriter PW(*OS, PP);
+  return PW.GenerateHeaderPTH(FID, Name);
+}
+
+namespace {
+/// HeaderTokenCacheWriter - Writes the tokens of the guarded headers that
+/// were not found in the preprocessor's HeaderTokenCache to the cache, once
+/// their end is reached and the multiple-include optimization knows whether
+/// they are guarded.
+class HeaderTokenCacheWriter : public PPCallbacks {
+  Preprocessor &PP;
+  HeaderTokenCache &Cache;
+
+public:
+  HeaderTokenCacheWriter(Preprocessor &PP)
+    : PP(PP), Cache(*PP.getHeaderTokenCache()) {}
+
+  virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                           SrcMgr::CharacteristicKind FileType,
+                           FileID PrevFID);
+
+private:
+  void writeHeader(FileID FID, StringRef Key);
+};
+} // end anonymous namespace
+
+void HeaderTokenCacheWriter::FileChanged(SourceLocation Loc,
+                                         FileChangeReason Reason,
+                                         SrcMgr::CharacteristicKind FileType,
+                                         FileID PrevFID) {
+  if (Reason != ExitFile || PrevFID.isInvalid())
+    return;
+
+  std::string Key = Cache.takeMissedKey(PrevFID);
+  if (Key.empty())
+    return;
+
+  const FileEntry *File = PP.getSourceManager().getFileEntryForID(PrevFID);
+  if (!File || !PP.getHeaderSearchInfo().getFileInfo(File).ControllingMacro)
+    return;
+
+  writeHeader(PrevFID, Key);
+}
+
+void HeaderTokenCacheWriter::writeHeader(FileID FID, StringRef Key) {
+  DiagnosticsEngine &Diags = PP.getDiagnostics();
+  std::string Path = Cache.getPath(Key);
+  llvm::sys::fs::create_directories(Cache.getDirectory());
+
+  // Write to a temporary file and rename it over the cache file, so that
+  // concurrent compilations see either no file or all of it.
+  SmallString<128> TmpPath;
+  int TmpFD;
+  if (llvm::error_code EC =
+        llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", TmpFD, TmpPath)) {
+    Diags.Report(diag::warn_fe_header_token_cache_write_failure)
+      << Path << EC.message();
+    return;
+  }
+
+  bool Cacheable;
+  bool Failed;
+  {
+    llvm::raw_fd_ostream Out(TmpFD, /*shouldClose=*/true);
+    Cacheable = CacheHeaderTokens(PP, FID, Key.str().c_str(), &Out);
+    Out.close();
+    Failed = Out.has_error();
+    Out.clear_error();
+  }
+
+  bool Existed;
+  if (!Cacheable) {
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    return;
+  }
+  if (Failed) {
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    Diags.Report(diag::warn_fe_header_token_cache_write_failure)
+      << Path << ("error writing '" + TmpPath.str().str() + "'");
+    return;
+  }
+  if (llvm::error_code EC = llvm::sys::fs::rename(TmpPath.str(), Path)) {
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    Diags.Report(diag::warn_fe_header_token_cache_write_failure)
+      << Path << EC.message();
+    return;
+  }
+
+  Cache.noteWritten();
+}
+
+void clang::AttachHeaderTokenCacheWriter(Preprocessor &PP) {
+  PP.addPPCallbacks(new HeaderTokenCacheWriter(PP));
+}
+
 //===----------------------------------------------------------------------===//
 
 namespace {
@@ -13,8 +13,11 @@
 #include "clang/AST/Decl.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/PersistentStatCache.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/ThreadPool.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Basic/Version.h"
 #include "clang/Frontend/ChainedDiagnosticConsumer.h"
 #include "clang/Frontend/FrontendAction.h"
@@ -26,11 +29,13 @@
 #include "clang/Frontend/Utils.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/PTHManager.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Serialization/ASTReader.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
@@ -50,7 +55,7 @@
 using namespace clang;
 
 CompilerInstance::CompilerInstance()
-  : Invocation(new CompilerInvocation()), ModuleManager(0),
+  : Invocation(new CompilerInvocation()), StatCacheFile(0), ModuleManager(0),
     BuildGlobalModuleIndex(false), ModuleBuildFailed(false) {
 }
 
@@ -78,6 +83,11 @@ void CompilerInstance::setTarget(TargetInfo *Value) {
 }
 
 void CompilerInstance::setFileManager(FileManager *Value) {
+  // The stat cache goes away with the file manager that owns it.
+  if (Value != FileMgr.getPtr()) {
+    writeStatCacheFile();
+    StatCacheFile = 0;
+  }
   FileMgr = Value;
 }
 
@@ -197,7 +207,26 @@ CompilerInstance::createDiagnostics(DiagnosticOptions *Opts,
 // File Manager
 
 void CompilerInstance::createFileManager() {
+  writeStatCacheFile();
+  StatCacheFile = 0;
   FileMgr = new FileManager(getFileSystemOpts());
+
+  const FileSystemOptions &FSOpts = getFileSystemOpts();
+  if (!FSOpts.StatCachePath.empty()) {
+    StatCacheFile = new PersistentStatCache(FSOpts.StatCachePath,
+                                            FSOpts.WorkingDir);
+    FileMgr->addStatCache(StatCacheFile, /*AtBeginning=*/true);
+  }
+}
+
+void CompilerInstance::writeStatCacheFile() {
+  if (!StatCacheFile)
+    return;
+
+  std::string ErrorInfo;
+  if (StatCacheFile->write(ErrorInfo) && hasDiagnostics())
+    getDiagnostics().Report(diag::warn_fe_stat_cache_write_failure)
+      << getFileSystemOpts().StatCachePath << ErrorInfo;
 }
 
 // Source Manager
@@ -235,6 +264,14 @@ void CompilerInstance::createPreprocessor() {
     PP->setPTHManager(PTHMgr);
   }
 
+  // The header token cache can't be combined with a PTH file, which provides
+  // the identifiers of the preprocessor.
+  if (!PPOpts.HeaderTokenCachePath.empty() && !PTHMgr) {
+    PP->setHeaderTokenCache(new HeaderTokenCache(PPOpts.HeaderTokenCachePath,
+                                                 getLangOpts()));
+    AttachHeaderTokenCacheWriter(*PP);
+  }
+
   if (PPOpts.DetailedRecord)
     PP->createPreprocessingRecord();
 
@@ -325,6 +362,16 @@ CompilerInstance::createPCHExternalASTSource(StringRef Path,
 
   Reader->setDeserializationListener(
             static_cast<ASTDeserializationListener *>(DeserializationListener));
+
+  // If the PCH is kept in memory, give the reader its own reference to it.
+  const PreprocessorOptions &PPOpts = PP.getPreprocessorOpts();
+  if (PPOpts.ImplicitPCHBuffer && Path == PPOpts.ImplicitPCHInclude) {
+    StringRef Buffer = PPOpts.ImplicitPCHBuffer->getBuffer();
+    Reader->addInMemoryBuffer(Path,
+        llvm::MemoryBuffer::getMemBuffer(Buffer, Path,
+                                         /*RequiresNullTerminator=*/false));
+  }
+
   switch (Reader->ReadAST(Path,
                           Preamble ? serialization::MK_Preamble
                                    : serialization::MK_PCH,
@@ -662,6 +709,35 @@ bool CompilerInstance::InitializeSourceManager(const FrontendInputFile &Input,
 
 // High-Level Operations
 
+/// \brief Write the events recorded for \p Input to a '.json' file named after
+/// the output file, or after the input if the output goes to stdout.
+static void WriteTimeTrace(CompilerInstance &CI,
+                           const FrontendInputFile &Input) {
+  SmallString<128> Path;
+  StringRef OutputFile = CI.getFrontendOpts().OutputFile;
+  if (!OutputFile.empty() && OutputFile != "-")
+    Path = OutputFile;
+  else if (Input.isFile() && Input.getFile() != "-")
+    Path = llvm::sys::path::filename(Input.getFile());
+  else
+    Path = "clang";
+  llvm::sys::path::replace_extension(Path, "json");
+
+  std::string ErrorInfo;
+  llvm::raw_fd_ostream OS(Path.c_str(), ErrorInfo, llvm::sys::fs::F_Binary);
+  if (!ErrorInfo.empty()) {
+    CI.getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+      << Path.str() << ErrorInfo;
+    // Stop recording anyway.
+    std::string Discarded;
+    llvm::raw_string_ostream Null(Discarded);
+    timeTraceProfilerEnd(Null);
+    return;
+  }
+
+  timeTraceProfilerEnd(OS);
+}
+
 bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
   assert(hasDiagnostics() && "Diagnostics engine is not initialized!");
   assert(!getFrontendOpts().ShowHelp && "Client must handle '-help'!");
@@ -703,12 +779,29 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
     if (hasSourceManager())
       getSourceManager().clearIDTables();
 
-    if (Act.BeginSourceFile(*this, getFrontendOpts().Inputs[i])) {
-      Act.Execute();
-      Act.EndSourceFile();
+    // Modules built on the fly record into the trace of their importer.
+    bool OwnsTimeTrace = getFrontendOpts().TimeTrace && !isTimeTraceEnabled();
+    if (OwnsTimeTrace)
+      timeTraceProfilerBegin(getFrontendOpts().TimeTraceGranularity);
+
+    {
+      TimeTraceScope Scope("ExecuteCompiler",
+                           getFrontendOpts().Inputs[i].isFile()
+                             ? getFrontendOpts().Inputs[i].getFile()
+                             : StringRef());
+      if (Act.BeginSourceFile(*this, getFrontendOpts().Inputs[i])) {
+        Act.Execute();
+        Act.EndSourceFile();
+      }
     }
+
+    if (OwnsTimeTrace)
+      WriteTimeTrace(*this, getFrontendOpts().Inputs[i]);
   }
 
+  // Share the lookups made for these inputs with later compilations.
+  writeStatCacheFile();
+
   // Notify the diagnostic client that all files were processed.
   getDiagnostics().getClient()->finish();
 
@@ -730,6 +823,9 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
 
   if (getFrontendOpts().ShowStats && hasFileManager()) {
     getFileManager().PrintStats();
+    if (StatCacheFile)
+      OS << StatCacheFile->getNumHits() << " stat cache hits, "
+         << StatCacheFile->getNumMisses() << " stat cache misses.\n";
     OS << "\n";
   }
 
@@ -752,6 +848,7 @@ namespace {
   struct CompileModuleMapData {
     CompilerInstance &Instance;
     GenerateModuleAction &CreateModuleAction;
+    TimeTraceProfiler *Profiler;
   };
 }
 
@@ -760,7 +857,10 @@ namespace {
 static void doCompileMapModule(void *UserData) {
   CompileModuleMapData &Data
     = *reinterpret_cast<CompileModuleMapData *>(UserData);
+  // The module records into the trace of its importer, which waits for it.
+  setTimeTraceProfiler(Data.Profiler);
   Data.Instance.ExecuteAction(Data.CreateModuleAction);
+  setTimeTraceProfiler(0);
 }
 
 namespace {
@@ -780,39 +880,17 @@ namespace {
   };
 }
 
-/// \brief Compile a module file for the given module, using the options 
-/// provided by the importing compiler instance.
-static void compileModule(CompilerInstance &ImportingInstance,
-                          SourceLocation ImportLoc,
-                          Module *Module,
-                          StringRef ModuleFileName) {
-  // FIXME: have LockFileManager return an error_code so that we can
-  // avoid the mkdir when the directory already exists.
-  StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
-  llvm::sys::fs::create_directories(Dir);
-
-  llvm::LockFileManager Locked(ModuleFileName);
-  switch (Locked) {
-  case llvm::LockFileManager::LFS_Error:
-    return;
-
-  case llvm::LockFileManager::LFS_Owned:
-    // We're responsible for building the module ourselves. Do so below.
-    break;
-
-  case llvm::LockFileManager::LFS_Shared:
-    // Someone else is responsible for building the module. Wait for them to
-    // finish.
-    Locked.waitForUnlock();
-    return;
-  }
-
+/// \brief Create the invocation that builds the module file for the given
+/// module, using the options provided by the importing compiler instance.
+static CompilerInvocation *
+createModuleInvocation(CompilerInstance &ImportingInstance, Module *Module,
+                       StringRef ModuleFileName) {
   ModuleMap &ModMap 
     = ImportingInstance.getPreprocessor().getHeaderSearchInfo().getModuleMap();
     
   // Construct a compiler invocation for creating this module.
-  IntrusiveRefCntPtr<CompilerInvocation> Invocation
-    (new CompilerInvocation(ImportingInstance.getInvocation()));
+  CompilerInvocation *Invocation
+    = new CompilerInvocation(ImportingInstance.getInvocation());
 
   PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
   
@@ -848,6 +926,7 @@ static void compileModule(CompilerInstance &ImportingInstance,
   FrontendOpts.OutputFile = ModuleFileName.str();
   FrontendOpts.DisableFree = false;
   FrontendOpts.GenerateGlobalModuleIndex = false;
+  FrontendOpts.ModulesPrebuild.clear();
   FrontendOpts.Inputs.clear();
   InputKind IK = getSourceInputKindFromOptions(*Invocation->getLangOpts());
 
@@ -857,14 +936,61 @@ static void compileModule(CompilerInstance &ImportingInstance,
   Invocation->getDiagnosticOpts().VerifyDiagnostics = 0;
   assert(ImportingInstance.getInvocation().getModuleHash() ==
          Invocation->getModuleHash() && "Module hash mismatch!");
-  
+
+  // Use the module map where this module resides. If there is none,
+  // compileModuleWithInvocation infers one from the module.
+  if (const FileEntry *ModuleMapFile =
+          ModMap.getContainingModuleMapFile(Module))
+    FrontendOpts.Inputs.push_back(
+        FrontendInputFile(ModuleMapFile->getName(), IK));
+  else
+    FrontendOpts.Inputs.push_back(
+        FrontendInputFile("__inferred_module.map", IK));
+
+  return Invocation;
+}
+
+/// \brief Compile a module file for the given module with the given
+/// invocation, unless another compiler instance is already doing so, in
+/// which case wait for it to finish.
+///
+/// \param DiagClient The consumer to forward the diagnostics of the module
+/// build to.
+///
+/// \returns true if the module file was built by this call.
+static bool compileModuleWithInvocation(CompilerInstance &ImportingInstance,
+                                        SourceLocation ImportLoc,
+                                        Module *Module,
+                                        StringRef ModuleFileName,
+                                        CompilerInvocation &Invocation,
+                                        DiagnosticConsumer &DiagClient) {
+  // FIXME: have LockFileManager return an error_code so that we can
+  // avoid the mkdir when the directory already exists.
+  StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
+  llvm::sys::fs::create_directories(Dir);
+
+  llvm::LockFileManager Locked(ModuleFileName);
+  switch (Locked) {
+  case llvm::LockFileManager::LFS_Error:
+    return false;
+
+  case llvm::LockFileManager::LFS_Owned:
+    // We're responsible for building the module ourselves. Do so below.
+    break;
+
+  case llvm::LockFileManager::LFS_Shared:
+    // Someone else is responsible for building the module. Wait for them to
+    // finish.
+    Locked.waitForUnlock();
+    return false;
+  }
+
   // Construct a compiler instance that will be used to actually create the
   // module.
   CompilerInstance Instance;
-  Instance.setInvocation(&*Invocation);
+  Instance.setInvocation(&Invocation);
 
-  Instance.createDiagnostics(new ForwardingDiagnosticConsumer(
-                                   ImportingInstance.getDiagnosticClient()),
+  Instance.createDiagnostics(new ForwardingDiagnosticConsumer(DiagClient),
                              /*ShouldOwnClient=*/true);
 
   // Note that this module is part of the module build stack, so that we
@@ -877,23 +1003,18 @@ static void compileModule(CompilerInstance &ImportingInstance,
   SourceMgr.pushModuleBuildStack(Module->getTopLevelModuleName(),
     FullSourceLoc(ImportLoc, ImportingInstance.getSourceManager()));
 
-  // Get or create the module map that we'll use to build this module.
+  // If the module has no module map file, give it one inferred from the
+  // module.
   std::string InferredModuleMapContent;
-  if (const FileEntry *ModuleMapFile =
-          ModMap.getContainingModuleMapFile(Module)) {
-    // Use the module map where this module resides.
-    FrontendOpts.Inputs.push_back(
-        FrontendInputFile(ModuleMapFile->getName(), IK));
-  } else {
+  if (Invocation.getFrontendOpts().Inputs[0].getFile() ==
+        "__inferred_module.map") {
     llvm::raw_string_ostream OS(InferredModuleMapContent);
     Module->print(OS);
     OS.flush();
-    FrontendOpts.Inputs.push_back(
-        FrontendInputFile("__inferred_module.map", IK));
 
     const llvm::MemoryBuffer *ModuleMapBuffer =
         llvm::MemoryBuffer::getMemBuffer(InferredModuleMapContent);
-    ModuleMapFile = Instance.getFileManager().getVirtualFile(
+    const FileEntry *ModuleMapFile = Instance.getFileManager().getVirtualFile(
         "__inferred_module.map", InferredModuleMapContent.size(), 0);
     SourceMgr.overrideFileContents(ModuleMapFile, ModuleMapBuffer);
   }
@@ -905,7 +1026,8 @@ static void compileModule(CompilerInstance &ImportingInstance,
   // thread so that we get a stack large enough.
   const unsigned ThreadStackSize = 8 << 20;
   llvm::CrashRecoveryContext CRC;
-  CompileModuleMapData Data = { Instance, CreateModuleAction };
+  CompileModuleMapData Data = { Instance, CreateModuleAction,
+                                getTimeTraceProfiler() };
   CRC.RunSafelyOnThread(&doCompileMapModule, &Data, ThreadStackSize);
 
   
@@ -914,6 +1036,21 @@ static void compileModule(CompilerInstance &ImportingInstance,
   // be nice to do this with RemoveFileOnSignal when we can. However, that
   // doesn't make sense for all clients, so clean this up manually.
   Instance.clearOutputFiles(/*EraseFiles=*/true);
+  return true;
+}
+
+/// \brief Compile a module file for the given module, using the options 
+/// provided by the importing compiler instance.
+static void compileModule(CompilerInstance &ImportingInstance,
+                          SourceLocation ImportLoc,
+                          Module *Module,
+                          StringRef ModuleFileName) {
+  IntrusiveRefCntPtr<CompilerInvocation> Invocation(
+    createModuleInvocation(ImportingInstance, Module, ModuleFileName));
+  if (!compileModuleWithInvocation(ImportingInstance, ImportLoc, Module,
+                                   ModuleFileName, *Invocation,
+                                   ImportingInstance.getDiagnosticClient()))
+    return;
 
   // We've rebuilt a module. If we're allowed to generate or update the global
   // module index, record that fact in the importing compiler instance.
@@ -1098,6 +1235,258 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
   }
 }
 
+namespace {
+  /// \brief A diagnostic of a module built by
+  /// CompilerInstance::prebuildModules, along with the managers that its
+  /// location refers to.
+  struct PrebuildDiagnostic {
+    StoredDiagnostic Diag;
+    IntrusiveRefCntPtr<FileManager> FileMgr;
+    IntrusiveRefCntPtr<SourceManager> SourceMgr;
+  };
+
+  /// \brief Keeps the diagnostics of a module build on a worker thread, so
+  /// that they can be reported on the main thread once it is done.
+  class PrebuildDiagnosticConsumer : public DiagnosticConsumer {
+    std::vector<PrebuildDiagnostic> &Diags;
+
+  public:
+    explicit PrebuildDiagnosticConsumer(std::vector<PrebuildDiagnostic> &Diags)
+      : Diags(Diags) {}
+
+    virtual void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                                  const Diagnostic &Info) {
+      DiagnosticConsumer::HandleDiagnostic(Level, Info);
+      Diags.push_back(PrebuildDiagnostic());
+      PrebuildDiagnostic &PD = Diags.back();
+      PD.Diag = StoredDiagnostic(Level, Info);
+      if (Info.hasSourceManager()) {
+        PD.SourceMgr = &Info.getSourceManager();
+        PD.FileMgr = &PD.SourceMgr->getFileManager();
+      }
+    }
+  };
+
+  /// \brief A module file built by CompilerInstance::prebuildModules.
+  struct PrebuiltModule {
+    CompilerInstance *ImportingInstance;
+    Module *Mod;
+    std::string ModuleFileName;
+    IntrusiveRefCntPtr<CompilerInvocation> Invocation;
+
+    /// \brief The modules that this one imports, as far as the module maps
+    /// tell.
+    SmallVector<PrebuiltModule *, 4> Dependencies;
+
+    /// \brief The round in which the module is built, which is one more than
+    /// the round of its last dependency.
+    unsigned Round;
+
+    /// \brief Whether Round has been computed, or is being computed.
+    bool HasRound, ComputingRound;
+
+    /// \brief Whether the module file was built by this module's task.
+    bool Built;
+
+    /// \brief The diagnostics of the build.
+    std::vector<PrebuildDiagnostic> Diagnostics;
+
+    /// \brief The trace that the build records its events into, if any.
+    TimeTraceProfiler *Profiler;
+
+    PrebuiltModule()
+      : ImportingInstance(0), Mod(0), Round(0), HasRound(false),
+        ComputingRound(false), Built(false), Profiler(0) {}
+  };
+}
+
+/// \brief Add the top-level module named by the first component of \p Id
+/// to \p Imports, if there is one.
+static void addDeclaredImport(const ModuleId &Id, HeaderSearch &HS,
+                              SmallVectorImpl<Module *> &Imports) {
+  if (Id.empty())
+    return;
+  if (Module *Imported = HS.lookupModule(Id[0].first))
+    Imports.push_back(Imported);
+}
+
+/// \brief Collect the top-level modules that \p Mod, or one of its
+/// submodules, declares that it uses or exports.
+static void collectDeclaredImports(Module *Mod, HeaderSearch &HS,
+                                   SmallVectorImpl<Module *> &Imports) {
+  for (unsigned I = 0, N = Mod->Exports.size(); I != N; ++I)
+    if (Module *Exported = Mod->Exports[I].getPointer())
+      Imports.push_back(Exported->getTopLevelModule());
+  for (unsigned I = 0, N = Mod->UnresolvedExports.size(); I != N; ++I)
+    addDeclaredImport(Mod->UnresolvedExports[I].Id, HS, Imports);
+
+  for (unsigned I = 0, N = Mod->DirectUses.size(); I != N; ++I)
+    Imports.push_back(Mod->DirectUses[I]->getTopLevelModule());
+  for (unsigned I = 0, N = Mod->UnresolvedDirectUses.size(); I != N; ++I)
+    addDeclaredImport(Mod->UnresolvedDirectUses[I], HS, Imports);
+
+  for (Module::submodule_iterator Sub = Mod->submodule_begin(),
+                               SubEnd = Mod->submodule_end();
+       Sub != SubEnd; ++Sub)
+    collectDeclaredImports(*Sub, HS, Imports);
+}
+
+/// \brief Compute the round in which \p PM can be built, after all of its
+/// dependencies. A dependency cycle is broken at the module that closes it;
+/// building the modules of the cycle reports the error.
+static unsigned computePrebuildRound(PrebuiltModule &PM) {
+  if (PM.HasRound || PM.ComputingRound)
+    return PM.Round;
+
+  PM.ComputingRound = true;
+  for (unsigned I = 0, N = PM.Dependencies.size(); I != N; ++I)
+    PM.Round = std::max(PM.Round,
+                        computePrebuildRound(*PM.Dependencies[I]) + 1);
+  PM.ComputingRound = false;
+  PM.HasRound = true;
+  return PM.Round;
+}
+
+/// \brief Build one module for CompilerInstance::prebuildModules, on a
+/// thread of its pool.
+static void doPrebuildModule(void *UserData) {
+  PrebuiltModule &PM = *static_cast<PrebuiltModule *>(UserData);
+
+  // The module may have been built while building a module that imports it
+  // without declaring it.
+  if (llvm::sys::fs::exists(PM.ModuleFileName))
+    return;
+
+  PrebuildDiagnosticConsumer Consumer(PM.Diagnostics);
+  setTimeTraceProfiler(PM.Profiler);
+  PM.Built = compileModuleWithInvocation(*PM.ImportingInstance,
+                                         SourceLocation(), PM.Mod,
+                                         PM.ModuleFileName, *PM.Invocation,
+                                         Consumer);
+  setTimeTraceProfiler(0);
+}
+
+/// \brief Report the diagnostics of a prebuilt module through \p Diags, as
+/// when the module is built on import.
+static void
+reportPrebuildDiagnostics(DiagnosticsEngine &Diags,
+                          const std::vector<PrebuildDiagnostic> &Stored) {
+  // The locations refer to the source manager of the module build.
+  SourceManager *SourceMgr =
+    Diags.hasSourceManager() ? &Diags.getSourceManager() : 0;
+  for (unsigned I = 0, N = Stored.size(); I != N; ++I) {
+    Diags.setSourceManager(Stored[I].SourceMgr.getPtr());
+    Diags.Report(Stored[I].Diag);
+  }
+  Diags.setSourceManager(SourceMgr);
+}
+
+void CompilerInstance::prebuildModules() {
+  HeaderSearch &HS = getPreprocessor().getHeaderSearchInfo();
+
+  // Find the modules to prebuild, and those that they declare that they use
+  // or export.
+  const std::vector<std::string> &Names = getFrontendOpts().ModulesPrebuild;
+  SmallVector<Module *, 16> AllModules;
+  llvm::SmallPtrSet<Module *, 16> Seen;
+  for (unsigned I = 0, N = Names.size(); I != N; ++I) {
+    StringRef Name = StringRef(Names[I]).split('.').first;
+    Module *Mod = HS.lookupModule(Name);
+    if (!Mod) {
+      getDiagnostics().Report(diag::err_prebuild_module_not_found) << Name;
+      continue;
+    }
+    if (Seen.insert(Mod))
+      AllModules.push_back(Mod);
+  }
+  for (unsigned I = 0; I != AllModules.size(); ++I) {
+    SmallVector<Module *, 4> Imports;
+    collectDeclaredImports(AllModules[I], HS, Imports);
+    for (unsigned J = 0, N = Imports.size(); J != N; ++J)
+      if (Seen.insert(Imports[J]))
+        AllModules.push_back(Imports[J]);
+  }
+
+  // Find the modules whose module files are missing. All of the invocations
+  // are created here, since copying the options of this instance isn't
+  // thread-safe. They share the set of failed modules of this instance.
+  std::vector<PrebuiltModule> Modules(AllModules.size());
+  llvm::DenseMap<Module *, PrebuiltModule *> Prebuilt;
+  unsigned NumModules = 0;
+  for (unsigned I = 0, N = AllModules.size(); I != N; ++I) {
+    Module *Mod = AllModules[I];
+    if (!Mod->isAvailable() || Mod->Name == getLangOpts().CurrentModule)
+      continue;
+
+    std::string ModuleFileName = HS.getModuleFileName(Mod);
+    if (llvm::sys::fs::exists(ModuleFileName))
+      continue;
+
+    PrebuiltModule &PM = Modules[NumModules++];
+    PM.ImportingInstance = this;
+    PM.Mod = Mod;
+    PM.ModuleFileName = ModuleFileName;
+    PM.Invocation = createModuleInvocation(*this, Mod, ModuleFileName);
+    Prebuilt[Mod] = &PM;
+  }
+  if (NumModules == 0)
+    return;
+
+  // Group the modules into rounds, where each round only depends on the
+  // modules built in earlier rounds.
+  unsigned NumRounds = 0;
+  for (unsigned I = 0; I != NumModules; ++I) {
+    PrebuiltModule &PM = Modules[I];
+    SmallVector<Module *, 4> Imports;
+    collectDeclaredImports(PM.Mod, HS, Imports);
+    for (unsigned J = 0, N = Imports.size(); J != N; ++J)
+      if (PrebuiltModule *DepPM = Prebuilt.lookup(Imports[J]))
+        if (DepPM != &PM)
+          PM.Dependencies.push_back(DepPM);
+  }
+  for (unsigned I = 0; I != NumModules; ++I)
+    NumRounds = std::max(NumRounds, computePrebuildRound(Modules[I]) + 1);
+
+  // While -ftime-trace is recording, the modules are built one at a time
+  // and record into the trace of this thread, which waits for them.
+  unsigned NumThreads = getFrontendOpts().ModulePrebuildThreads;
+  if (TimeTraceProfiler *Profiler = getTimeTraceProfiler()) {
+    NumThreads = 1;
+    for (unsigned I = 0; I != NumModules; ++I)
+      Modules[I].Profiler = Profiler;
+  }
+  TimeTraceScope TraceScope("PrebuildModules");
+
+  ThreadPool Pool(NumThreads);
+  bool BuiltAny = false;
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    for (unsigned I = 0; I != NumModules; ++I)
+      if (Modules[I].Round == Round)
+        Pool.async(&doPrebuildModule, &Modules[I]);
+    Pool.wait();
+
+    // Report the diagnostics of the modules that were built, in a
+    // deterministic order. A module that failed to build is recorded as
+    // such before the next round, so that neither the modules of later
+    // rounds nor the translation unit try to build it again.
+    for (unsigned I = 0; I != NumModules; ++I) {
+      PrebuiltModule &PM = Modules[I];
+      if (PM.Round != Round || !PM.Built)
+        continue;
+      reportPrebuildDiagnostics(getDiagnostics(), PM.Diagnostics);
+      PM.Diagnostics.clear();
+      if (llvm::sys::fs::exists(PM.ModuleFileName))
+        BuiltAny = true;
+      else
+        getPreprocessorOpts().FailedModules->addFailed(PM.Mod->Name);
+    }
+  }
+
+  // Update the global module index once, after the translation unit.
+  if (BuiltAny && getFrontendOpts().GenerateGlobalModuleIndex)
+    setBuildGlobalModuleIndex(true);
+}
+
 ModuleLoadResult
 CompilerInstance::loadModule(SourceLocation ImportLoc,
                              ModuleIdPath Path,
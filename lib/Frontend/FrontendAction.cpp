@@ -11,6 +11,7 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/DeclGroup.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/ChainedIncludesSource.h"
 #include "clang/Frontend/CompilerInstance.h"
@@ -235,7 +236,8 @@ bool FrontendAction::BeginSourceFile(CompilerInstance &CI,
 
   // If the implicit PCH include is actually a directory, rather than
   // a single file, search for a suitable PCH file in that directory.
-  if (!CI.getPreprocessorOpts().ImplicitPCHInclude.empty()) {
+  if (!CI.getPreprocessorOpts().ImplicitPCHInclude.empty() &&
+      !CI.getPreprocessorOpts().ImplicitPCHBuffer) {
     FileManager &FileMgr = CI.getFileManager();
     PreprocessorOptions &PPOpts = CI.getPreprocessorOpts();
     StringRef PCHInclude = PPOpts.ImplicitPCHInclude;
@@ -363,6 +365,7 @@ bool FrontendAction::BeginSourceFile(CompilerInstance &CI,
 
 bool FrontendAction::Execute() {
   CompilerInstance &CI = getCompilerInstance();
+  TimeTraceScope TraceScope("Frontend");
 
   // Initialize the main file entry. This needs to be delayed until after PCH
   // has loaded.
@@ -371,6 +374,13 @@ bool FrontendAction::Execute() {
       return false;
   }
 
+  // Build the missing modules up front, so that modules that don't import
+  // each other are built in parallel rather than on first import.
+  if (!CI.getFrontendOpts().ModulesPrebuild.empty() &&
+      CI.getLangOpts().Modules &&
+      CI.hasPreprocessor())
+    CI.prebuildModules();
+
   if (CI.hasFrontendTimer()) {
     llvm::TimeRegion Timer(CI.getFrontendTimer());
     ExecuteAction();
@@ -398,6 +408,13 @@ void FrontendAction::EndSourceFile() {
   // Finalize the action.
   EndSourceFileAction();
 
+  // Record which parts of the AST files were read while they are still
+  // loaded.
+  if (CI.hasASTContext())
+    if (ASTReader *Reader = CI.getModuleManager())
+      if (CI.getASTContext().getExternalSource() == Reader)
+        Reader->finishAccessProfile();
+
   // Release the consumer and the AST, in that order since the consumer may
   // perform actions in its destructor which require the context.
   //
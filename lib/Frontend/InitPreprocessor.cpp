@@ -863,8 +863,10 @@ void clang::InitializePreprocessor(Preprocessor &PP,
     AddImplicitIncludeMacros(Builder, InitOpts.MacroIncludes[i],
                              PP.getFileManager());
 
-  // Process -include-pch/-include-pth directives.
-  if (!InitOpts.ImplicitPCHInclude.empty())
+  // Process -include-pch/-include-pth directives. A PCH kept in memory can't
+  // be opened here; it's a precompiled preamble, and the AST reader replaces
+  // these predefines anyway.
+  if (!InitOpts.ImplicitPCHInclude.empty() && !InitOpts.ImplicitPCHBuffer)
     AddImplicitIncludePCH(Builder, PP, InitOpts.ImplicitPCHInclude);
   if (!InitOpts.ImplicitPTHInclude.empty())
     AddImplicitIncludePTH(Builder, PP, InitOpts.ImplicitPTHInclude);
@@ -0,0 +1,165 @@
+//===--- PrecompiledPreambleCache.cpp - Shared preambles ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache of the precompiled preambles of an index.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/PrecompiledPreambleCache.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+using namespace clang;
+
+PrecompiledPreamble::PrecompiledPreamble(StringRef PCHName,
+                                         llvm::MemoryBuffer *PCHBuffer)
+  : RefCount(0), InCache(false), PCHName(PCHName), PCHBuffer(PCHBuffer),
+    ReservedSize(0), NumWarnings(0), TopLevelHashValue(0) {}
+
+PrecompiledPreamble::~PrecompiledPreamble() {}
+
+void PrecompiledPreamble::Retain() {
+  llvm::sys::ScopedLock Guard(Cache->Lock);
+  ++RefCount;
+}
+
+void PrecompiledPreamble::Release() {
+  {
+    // Forget the preamble before anyone can find it again, but don't free
+    // it while holding the lock, since it may own the last reference to the
+    // cache.
+    llvm::sys::ScopedLock Guard(Cache->Lock);
+    assert(RefCount > 0 && "Reference count is already zero.");
+    if (--RefCount)
+      return;
+    if (InCache)
+      Cache->Preambles.RemoveNode(this);
+  }
+  delete this;
+}
+
+PrecompiledPreambleCache::~PrecompiledPreambleCache() {
+  assert(Preambles.empty() && "A preamble outlived its cache");
+}
+
+void PrecompiledPreambleCache::Profile(llvm::FoldingSetNodeID &ID,
+                                       const CompilerInvocation &Invocation,
+                                       StringRef MainFile, StringRef Preamble,
+                                       bool EndsAtStartOfLine) {
+  // The main file of a preamble is mapped onto the main file of the
+  // translation unit that reads it, unless its text names the file.
+  if (Preamble.find("__FILE__") != StringRef::npos ||
+      Preamble.find("__BASE_FILE__") != StringRef::npos)
+    ID.AddString(MainFile);
+  ID.AddString(llvm::sys::path::parent_path(MainFile));
+  ID.AddString(Preamble);
+  ID.AddBoolean(EndsAtStartOfLine);
+  ID.AddInteger(Invocation.getFrontendOpts().Inputs[0].getKind());
+
+  const LangOptions &LangOpts = *Invocation.getLangOpts();
+#define LANGOPT(Name, Bits, Default, Description) \
+  ID.AddInteger(LangOpts.Name);
+#define ENUM_LANGOPT(Name, Type, Bits, Default, Description) \
+  ID.AddInteger(static_cast<unsigned>(LangOpts.get##Name()));
+#include "clang/Basic/LangOptions.def"
+  ID.AddString(LangOpts.ObjCConstantStringClass);
+  ID.AddString(LangOpts.CurrentModule);
+
+  const TargetOptions &TargetOpts = Invocation.getTargetOpts();
+  ID.AddString(TargetOpts.Triple);
+  ID.AddString(TargetOpts.CPU);
+  ID.AddString(TargetOpts.ABI);
+  ID.AddString(TargetOpts.CXXABI);
+  ID.AddString(TargetOpts.LinkerVersion);
+  for (unsigned I = 0, N = TargetOpts.FeaturesAsWritten.size(); I != N; ++I)
+    ID.AddString(TargetOpts.FeaturesAsWritten[I]);
+
+  // The warnings that are enabled decide the diagnostics of the preamble.
+  const DiagnosticOptions &DiagOpts = Invocation.getDiagnosticOpts();
+#define DIAGOPT(Name, Bits, Default) ID.AddInteger(DiagOpts.Name);
+#define ENUM_DIAGOPT(Name, Type, Bits, Default) \
+  ID.AddInteger(static_cast<unsigned>(DiagOpts.get##Name()));
+#include "clang/Basic/DiagnosticOptions.def"
+  for (unsigned I = 0, N = DiagOpts.Warnings.size(); I != N; ++I)
+    ID.AddString(DiagOpts.Warnings[I]);
+
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  ID.AddBoolean(PPOpts.UsePredefines);
+  ID.AddBoolean(PPOpts.DetailedRecord);
+  for (unsigned I = 0, N = PPOpts.Macros.size(); I != N; ++I) {
+    ID.AddString(PPOpts.Macros[I].first);
+    ID.AddBoolean(PPOpts.Macros[I].second);
+  }
+  ID.AddInteger(PPOpts.Includes.size());
+  for (unsigned I = 0, N = PPOpts.Includes.size(); I != N; ++I)
+    ID.AddString(PPOpts.Includes[I]);
+  ID.AddInteger(PPOpts.MacroIncludes.size());
+  for (unsigned I = 0, N = PPOpts.MacroIncludes.size(); I != N; ++I)
+    ID.AddString(PPOpts.MacroIncludes[I]);
+  ID.AddString(PPOpts.ImplicitPCHInclude);
+  ID.AddString(PPOpts.ImplicitPTHInclude);
+
+  // Unsaved files have no modification time to check them by, so they are
+  // part of the key. The main file's is the preamble itself.
+  for (PreprocessorOptions::const_remapped_file_buffer_iterator
+            R = PPOpts.remapped_file_buffer_begin(),
+         REnd = PPOpts.remapped_file_buffer_end();
+       R != REnd; ++R) {
+    if (R->first == MainFile)
+      continue;
+    ID.AddString(R->first);
+    ID.AddInteger(llvm::hash_value(R->second->getBuffer()));
+  }
+
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  ID.AddString(HSOpts.Sysroot);
+  ID.AddString(HSOpts.ResourceDir);
+  ID.AddString(HSOpts.ModuleCachePath);
+  ID.AddBoolean(HSOpts.UseBuiltinIncludes);
+  ID.AddBoolean(HSOpts.UseStandardSystemIncludes);
+  ID.AddBoolean(HSOpts.UseStandardCXXIncludes);
+  ID.AddBoolean(HSOpts.UseLibcxx);
+  for (unsigned I = 0, N = HSOpts.UserEntries.size(); I != N; ++I) {
+    const HeaderSearchOptions::Entry &E = HSOpts.UserEntries[I];
+    ID.AddString(E.Path);
+    ID.AddInteger(E.Group);
+    ID.AddBoolean(E.IsFramework);
+    ID.AddBoolean(E.IgnoreSysRoot);
+  }
+}
+
+IntrusiveRefCntPtr<PrecompiledPreamble>
+PrecompiledPreambleCache::lookup(const llvm::FoldingSetNodeID &Key) {
+  llvm::sys::ScopedLock Guard(Lock);
+  void *InsertPos;
+  // The reference is taken while holding the lock, so that the preamble
+  // can't be freed in between.
+  return Preambles.FindNodeOrInsertPos(Key, InsertPos);
+}
+
+IntrusiveRefCntPtr<PrecompiledPreamble>
+PrecompiledPreambleCache::insert(const llvm::FoldingSetNodeID &Key,
+                                 PrecompiledPreamble *P) {
+  assert(!P->Cache && "Preamble already belongs to a cache");
+  llvm::sys::ScopedLock Guard(Lock);
+  P->Cache = this;
+  P->Key = Key;
+
+  void *InsertPos;
+  PrecompiledPreamble *Old = Preambles.FindNodeOrInsertPos(Key, InsertPos);
+  if (Old) {
+    Preambles.RemoveNode(Old);
+    Old->InCache = false;
+    Preambles.FindNodeOrInsertPos(Key, InsertPos);
+  }
+  Preambles.InsertNode(P, InsertPos);
+  P->InCache = true;
+  return P;
+}
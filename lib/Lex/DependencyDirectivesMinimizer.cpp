@@ -0,0 +1,302 @@
+//===--- DependencyDirectivesMinimizer.cpp - Directive-only sources -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the reduction of source files to their preprocessor
+//  directives for fast dependency scanning.
+//
+//  The scanner only needs to know where each logical line starts and whether
+//  it is a directive, so it recognizes just enough of the language to not be
+//  fooled by comments, string and character literals (including C++11 raw
+//  strings) and escaped newlines.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/DependencyDirectivesMinimizer.h"
+#include "clang/Basic/CharInfo.h"
+#include "clang/Basic/FileManager.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/MemoryBuffer.h"
+using namespace clang;
+
+namespace {
+
+class Minimizer {
+  const char *const Begin;
+  const char *const End;
+  const char *Cur;
+  SmallVectorImpl<char> &Out;
+
+public:
+  Minimizer(StringRef Input, SmallVectorImpl<char> &Out)
+    : Begin(Input.begin()), End(Input.end()), Cur(Input.begin()), Out(Out) {}
+
+  void run();
+
+private:
+  bool startsWith(char C0, char C1) const {
+    return Cur[0] == C0 && Cur + 1 != End && Cur[1] == C1;
+  }
+
+  bool skipNewline();
+  bool skipEscapedNewline();
+  void skipBlockComment();
+  void skipLineComment();
+  bool isRawStringStart(const char *Quote) const;
+  void lexLiteral(bool Copy);
+  void skipLineStart();
+  void skipCodeLine();
+  void copyDirective();
+};
+
+} // end anonymous namespace
+
+/// \brief Consume one newline, if there is one at Cur.
+bool Minimizer::skipNewline() {
+  if (Cur == End || !isVerticalWhitespace(*Cur))
+    return false;
+  char C = *Cur++;
+  // Treat \r\n and \n\r as one newline.
+  if (Cur != End && isVerticalWhitespace(*Cur) && *Cur != C)
+    ++Cur;
+  return true;
+}
+
+/// \brief Consume a backslash, trailing whitespace and a newline, if there
+/// is one at Cur.
+bool Minimizer::skipEscapedNewline() {
+  if (Cur == End || *Cur != '\\')
+    return false;
+  const char *P = Cur + 1;
+  while (P != End && isHorizontalWhitespace(*P))
+    ++P;
+  if (P == End || !isVerticalWhitespace(*P))
+    return false;
+  Cur = P;
+  skipNewline();
+  return true;
+}
+
+void Minimizer::skipBlockComment() {
+  Cur += 2;
+  while (Cur != End && !startsWith('*', '/'))
+    ++Cur;
+  if (Cur != End)
+    Cur += 2;
+}
+
+/// \brief Skip to the newline ending a '//' comment, which escaped newlines
+/// continue.
+void Minimizer::skipLineComment() {
+  Cur += 2;
+  while (Cur != End && !isVerticalWhitespace(*Cur)) {
+    if (!skipEscapedNewline())
+      ++Cur;
+  }
+}
+
+/// \brief Whether \p Quote starts a C++11 raw string literal, i.e. is preceded
+/// by R, LR, uR, UR or u8R.
+bool Minimizer::isRawStringStart(const char *Quote) const {
+  if (Quote == Begin || Quote[-1] != 'R')
+    return false;
+  const char *P = Quote - 1;
+  if (P != Begin && (P[-1] == 'L' || P[-1] == 'u' || P[-1] == 'U'))
+    --P;
+  else if (P - Begin >= 2 && P[-1] == '8' && P[-2] == 'u')
+    P -= 2;
+  return P == Begin || !isIdentifierBody(P[-1]);
+}
+
+/// \brief Lex the string or character literal starting at Cur, and append it
+/// to the output if \p Copy. An unterminated literal ends at the end of the
+/// line, like in the lexer.
+void Minimizer::lexLiteral(bool Copy) {
+  const char *Start = Cur;
+  char Quote = *Cur++;
+
+  // A ' after a digit, other than the 8 of a u8 prefix, is a C++14 digit
+  // separator rather than the start of a character literal.
+  if (Quote == '\'' && Start != Begin && isDigit(Start[-1]) &&
+      !(Start[-1] == '8' && Start - Begin >= 2 && Start[-2] == 'u')) {
+    if (Copy)
+      Out.push_back(Quote);
+    return;
+  }
+
+  if (Quote == '"' && isRawStringStart(Start)) {
+    // R"delim( ... )delim", where delim is at most 16 characters.
+    const char *DelimEnd = Cur;
+    while (DelimEnd != End && DelimEnd - Cur < 16 && *DelimEnd != '(' &&
+           !isWhitespace(*DelimEnd) && *DelimEnd != '\\' && *DelimEnd != ')')
+      ++DelimEnd;
+    if (DelimEnd != End && *DelimEnd == '(') {
+      StringRef Delim(Cur, DelimEnd - Cur);
+      const char *P = DelimEnd + 1;
+      for (; P != End; ++P) {
+        if (*P == ')' && StringRef(P + 1, End - P - 1).startswith(Delim) &&
+            P + 1 + Delim.size() != End && P[1 + Delim.size()] == '"') {
+          P += Delim.size() + 2;
+          break;
+        }
+      }
+      Cur = P;
+      if (Copy)
+        Out.append(Start, Cur);
+      return;
+    }
+  }
+
+  while (Cur != End && *Cur != Quote && !isVerticalWhitespace(*Cur)) {
+    if (skipEscapedNewline())
+      continue;
+    // Skip the backslash of an escape sequence along with the next character.
+    if (*Cur == '\\' && Cur + 1 != End)
+      ++Cur;
+    ++Cur;
+  }
+  if (Cur != End && *Cur == Quote)
+    ++Cur;
+  if (Copy)
+    Out.append(Start, Cur);
+}
+
+/// \brief Skip the whitespace and comments that may precede the '#' of a
+/// directive, including empty lines.
+void Minimizer::skipLineStart() {
+  while (Cur != End) {
+    if (isWhitespace(*Cur))
+      ++Cur;
+    else if (startsWith('/', '*'))
+      skipBlockComment();
+    else if (!skipEscapedNewline())
+      break;
+  }
+}
+
+/// \brief Skip the rest of a logical line that is not a directive.
+void Minimizer::skipCodeLine() {
+  while (Cur != End) {
+    char C = *Cur;
+    if (isVerticalWhitespace(C)) {
+      skipNewline();
+      return;
+    }
+    if (startsWith('/', '*'))
+      skipBlockComment();
+    else if (startsWith('/', '/'))
+      skipLineComment();
+    else if (C == '"' || C == '\'')
+      lexLiteral(/*Copy=*/false);
+    else if (!skipEscapedNewline())
+      ++Cur;
+  }
+}
+
+/// \brief Copy the directive starting at Cur, without comments, followed by
+/// a newline.
+void Minimizer::copyDirective() {
+  // Copy '#' and the directive name. If it names a header, the header name
+  // is copied verbatim: in '#include <a//b.h>' the '//' is not a comment.
+  const char *NameStart = Cur + (*Cur == '#' ? 1 : 2);
+  while (NameStart != End && isHorizontalWhitespace(*NameStart))
+    ++NameStart;
+  const char *NameEnd = NameStart;
+  while (NameEnd != End && isIdentifierBody(*NameEnd))
+    ++NameEnd;
+  bool TakesHeaderName =
+    llvm::StringSwitch<bool>(StringRef(NameStart, NameEnd - NameStart))
+      .Cases("include", "include_next", "import", true)
+      .Default(false);
+  Out.append(Cur, NameEnd);
+  Cur = NameEnd;
+
+  if (TakesHeaderName) {
+    while (Cur != End && isHorizontalWhitespace(*Cur))
+      Out.push_back(*Cur++);
+    if (Cur != End && *Cur == '<') {
+      while (Cur != End && *Cur != '>' && !isVerticalWhitespace(*Cur))
+        Out.push_back(*Cur++);
+    }
+  }
+
+  while (Cur != End) {
+    char C = *Cur;
+    if (isVerticalWhitespace(C)) {
+      skipNewline();
+      break;
+    }
+
+    if (startsWith('/', '*')) {
+      skipBlockComment();
+      Out.push_back(' ');
+    } else if (startsWith('/', '/')) {
+      skipLineComment();
+    } else if (C == '"' || C == '\'') {
+      lexLiteral(/*Copy=*/true);
+    } else {
+      const char *Start = Cur;
+      if (skipEscapedNewline())
+        Out.append(Start, Cur);
+      else
+        Out.push_back(*Cur++);
+    }
+  }
+  Out.push_back('\n');
+}
+
+void Minimizer::run() {
+  while (Cur != End) {
+    skipLineStart();
+    if (Cur == End)
+      break;
+    if (*Cur == '#' || startsWith('%', ':'))
+      copyDirective();
+    else
+      skipCodeLine();
+  }
+}
+
+void clang::minimizeSourceToDependencyDirectives(
+    StringRef Input, SmallVectorImpl<char> &Output) {
+  Minimizer(Input, Output).run();
+}
+
+MinimizedSourceCache::~MinimizedSourceCache() {
+  for (std::map<llvm::sys::fs::UniqueID, Entry>::iterator
+         I = Entries.begin(), E = Entries.end(); I != E; ++I)
+    delete I->second.Buffer;
+}
+
+const llvm::MemoryBuffer *
+MinimizedSourceCache::lookup(const FileEntry *File) const {
+  std::map<llvm::sys::fs::UniqueID, Entry>::const_iterator Known =
+    Entries.find(File->getUniqueID());
+  if (Known == Entries.end() ||
+      Known->second.ModTime != File->getModificationTime() ||
+      Known->second.Size != File->getSize())
+    return 0;
+  return Known->second.Buffer;
+}
+
+const llvm::MemoryBuffer *
+MinimizedSourceCache::insert(const FileEntry *File,
+                             const llvm::MemoryBuffer *Contents) {
+  SmallString<4096> Minimized;
+  minimizeSourceToDependencyDirectives(Contents->getBuffer(), Minimized);
+
+  Entry &E = Entries[File->getUniqueID()];
+  if (E.Buffer)
+    delete E.Buffer;
+  E.ModTime = File->getModificationTime();
+  E.Size = File->getSize();
+  E.Buffer = llvm::MemoryBuffer::getMemBufferCopy(Minimized.str(),
+                                                  File->getName());
+  return E.Buffer;
+}
@@ -0,0 +1,110 @@
+//===--- HeaderTokenCache.cpp - Content-addressed header token cache ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the lookup side of the HeaderTokenCache. The cache
+//  files are written by clang::CacheHeaderTokens in the frontend.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/Version.h"
+#include "clang/Lex/PTHLexer.h"
+#include "clang/Lex/PTHManager.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+HeaderTokenCache::HeaderTokenCache(StringRef Directory,
+                                   const LangOptions &LangOpts)
+  : Directory(Directory), NumHits(0), NumMisses(0), NumWritten(0) {
+  // The kinds of the cached tokens depend on the language options, e.g. for
+  // keywords and digraphs, and their encoding on the compiler version.
+  llvm::hash_code Code =
+    llvm::hash_combine(getClangFullRepositoryVersion(), PTHManager::Version);
+#define LANGOPT(Name, Bits, Default, Description) \
+  Code = llvm::hash_combine(Code, LangOpts.Name);
+#define ENUM_LANGOPT(Name, Type, Bits, Default, Description) \
+  Code = llvm::hash_combine(Code, static_cast<unsigned>(LangOpts.get##Name()));
+#include "clang/Basic/LangOptions.def"
+  ConfigurationHash = llvm::utohexstr(static_cast<size_t>(Code));
+}
+
+HeaderTokenCache::~HeaderTokenCache() {
+  for (unsigned I = 0, N = Managers.size(); I != N; ++I)
+    delete Managers[I];
+}
+
+std::string HeaderTokenCache::getKey(const llvm::MemoryBuffer *Contents) const {
+  llvm::MD5 Hash;
+  Hash.update(Contents->getBuffer());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+  return (Digest.str() + "-" + ConfigurationHash).str();
+}
+
+std::string HeaderTokenCache::getPath(StringRef Key) const {
+  SmallString<256> Path(Directory);
+  llvm::sys::path::append(Path, Key + ".pth");
+  return Path.str();
+}
+
+PTHLexer *HeaderTokenCache::createLexer(Preprocessor &PP, FileID FID,
+                                        const llvm::MemoryBuffer *Contents) {
+  std::string Key = getKey(Contents);
+
+  // A missing or unreadable cache file is a miss, not an error; the file is
+  // rewritten if the header is cacheable.
+  DiagnosticsEngine &Diags = PP.getDiagnostics();
+  bool WasSuppressed = Diags.getSuppressAllDiagnostics();
+  Diags.setSuppressAllDiagnostics(true);
+  PTHManager *PM = PTHManager::Create(getPath(Key), Diags);
+  Diags.setSuppressAllDiagnostics(WasSuppressed);
+
+  if (PM) {
+    PM->setPreprocessor(&PP);
+    PM->setIdentifierTable(&PP.getIdentifierTable());
+    if (PTHLexer *PL = PM->CreateLexer(FID, Key.c_str())) {
+      Managers.push_back(PM);
+      ++NumHits;
+      return PL;
+    }
+    delete PM;
+  }
+
+  ++NumMisses;
+  Missed[FID] = Key;
+  return 0;
+}
+
+std::string HeaderTokenCache::takeMissedKey(FileID FID) {
+  llvm::DenseMap<FileID, std::string>::iterator Known = Missed.find(FID);
+  if (Known == Missed.end())
+    return std::string();
+  std::string Key;
+  Key.swap(Known->second);
+  Missed.erase(Known);
+  return Key;
+}
+
+void HeaderTokenCache::PrintStats() const {
+  llvm::errs() << NumHits << " header token cache hits, " << NumMisses
+               << " header token cache misses, " << NumWritten
+               << " headers written.\n";
+}
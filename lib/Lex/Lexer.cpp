@@ -36,9 +36,18 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ConvertUTF.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "UnicodeCharSets.h"
 #include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
 using namespace clang;
 
 //===----------------------------------------------------------------------===//
@@ -1447,9 +1456,103 @@ static void maybeDiagnoseIDCharCompat(DiagnosticsEngine &Diags, uint32_t C,
   }
  }
 
+//===----------------------------------------------------------------------===//
+// Vectorized scanning helpers
+//===----------------------------------------------------------------------===//
+//
+// Each of these skips a run of "boring" characters 16 bytes at a time and
+// returns a pointer to the first character that the caller must look at, or
+// to the start of the last partial chunk. Callers always finish with their
+// ordinary scalar loop, so these are pure accelerators: they never read past
+// BufferEnd and never skip a character the scalar loop would stop at.
+
+#ifdef __SSE2__
+/// \brief Returns a mask with bit i set if byte i of \p Chunk equals \p C.
+static inline unsigned matchByte(__m128i Chunk, char C) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(Chunk, _mm_set1_epi8(C)));
+}
+
+/// \brief Returns a mask with bit i set if byte i of \p Chunk is in the
+/// ASCII range [\p Lo, \p Hi]. Bytes >= 0x80 compare as negative and never
+/// match.
+static inline unsigned matchRange(__m128i Chunk, char Lo, char Hi) {
+  return _mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpgt_epi8(Chunk, _mm_set1_epi8(Lo - 1)),
+                    _mm_cmplt_epi8(Chunk, _mm_set1_epi8(Hi + 1))));
+}
+#endif
+
+/// \brief Skip [_A-Za-z0-9]*.
+static const char *FastSkipIdentifierBody(const char *CurPtr,
+                                          const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    unsigned Mask = matchRange(Chunk, 'a', 'z') | matchRange(Chunk, 'A', 'Z') |
+                    matchRange(Chunk, '0', '9') | matchByte(Chunk, '_');
+    if (Mask != 0xFFFF)
+      return CurPtr + llvm::countTrailingZeros(~Mask);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// \brief Skip horizontal whitespace (' ', '\t', '\f', '\v').
+static const char *FastSkipHorizontalWhitespace(const char *CurPtr,
+                                                const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    unsigned Mask = matchByte(Chunk, ' ') | matchByte(Chunk, '\t') |
+                    matchByte(Chunk, '\f') | matchByte(Chunk, '\v');
+    if (Mask != 0xFFFF)
+      return CurPtr + llvm::countTrailingZeros(~Mask);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// \brief Skip everything up to a newline or a (potentially EOF) nul.
+static const char *FastSkipToLineEnd(const char *CurPtr,
+                                     const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    unsigned Mask = matchByte(Chunk, '\n') | matchByte(Chunk, '\r') |
+                    matchByte(Chunk, 0);
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// \brief Skip the body of a string or character literal up to the closing
+/// \p Quote or to anything getAndAdvanceChar would not treat as a simple
+/// character: '\\', '?' (trigraphs), newlines and nul.
+static const char *FastSkipLiteralBody(const char *CurPtr,
+                                       const char *BufferEnd, char Quote) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    unsigned Mask = matchByte(Chunk, Quote) | matchByte(Chunk, '\\') |
+                    matchByte(Chunk, '?') | matchByte(Chunk, '\n') |
+                    matchByte(Chunk, '\r') | matchByte(Chunk, 0);
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
 bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
+  CurPtr = FastSkipIdentifierBody(CurPtr, BufferEnd);
   unsigned char C = *CurPtr++;
   while (isIdentifierBody(C))
     C = *CurPtr++;
@@ -1718,6 +1821,10 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
     // getAndAdvanceChar.
     if (C == '\\')
       C = getAndAdvanceChar(CurPtr, Result);
+    else if (isPrintable(C)) {
+      // Skip a run of ordinary characters in one go.
+      CurPtr = FastSkipLiteralBody(CurPtr, BufferEnd, '"');
+    }
     
     if (C == '\n' || C == '\r' ||             // Newline.
         (C == 0 && CurPtr-1 == BufferEnd)) {  // End of file.
@@ -1895,6 +2002,10 @@ bool Lexer::LexCharConstant(Token &Result, const char *CurPtr,
     // Skip escaped characters.
     if (C == '\\')
       C = getAndAdvanceChar(CurPtr, Result);
+    else if (isPrintable(C)) {
+      // Skip a run of ordinary characters in one go.
+      CurPtr = FastSkipLiteralBody(CurPtr, BufferEnd, '\'');
+    }
 
     if (C == '\n' || C == '\r' ||             // Newline.
         (C == 0 && CurPtr-1 == BufferEnd)) {  // End of file.
@@ -1947,6 +2058,8 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
   // Skip consecutive spaces efficiently.
   while (1) {
     // Skip horizontal whitespace very aggressively.
+    CurPtr = FastSkipHorizontalWhitespace(CurPtr, BufferEnd);
+    Char = *CurPtr;
     while (isHorizontalWhitespace(Char))
       Char = *++CurPtr;
 
@@ -2013,6 +2126,7 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    CurPtr = FastSkipToLineEnd(CurPtr, BufferEnd);
     C = *CurPtr;
     // Skip over characters in the fast loop.
     while (C != 0 &&                // Potentially EOF.
@@ -2211,13 +2325,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
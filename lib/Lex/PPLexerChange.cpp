@@ -15,9 +15,12 @@
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/MacroInfo.h"
+#include "clang/Lex/PreprocessorOptions.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -66,6 +69,42 @@ PreprocessorLexer *Preprocessor::getCurrentFileLexer() const {
 // Methods for Entering and Callbacks for leaving various contexts
 //===----------------------------------------------------------------------===//
 
+/// \brief Opens a -ftime-trace event for the time spent in an #included file.
+/// It is closed when the file is popped off the include stack.
+static void BeginTimeTraceForFile(SourceManager &SM, FileID FID) {
+  if (!isTimeTraceEnabled() || SM.getIncludeLoc(FID).isInvalid())
+    return;
+  timeTraceBeginEvent("Source",
+                      SM.getBufferName(SM.getLocForStartOfFile(FID)));
+}
+
+/// \brief For -fminimize-dependency-scan, replace the contents of the file of
+/// \p FID by its preprocessor directives, which are all that is needed to
+/// find its dependencies. The minimized files are cached in the preprocessor
+/// options, which may be shared by several preprocessors.
+static void MinimizeFileContents(Preprocessor &PP, FileID FID) {
+  SourceManager &SM = PP.getSourceManager();
+  const FileEntry *File = SM.getFileEntryForID(FID);
+  // Leave alone buffers that aren't files, files that were remapped, and
+  // files that were already minimized when first entered.
+  if (!File || SM.isFileOverridden(File))
+    return;
+
+  PreprocessorOptions &PPOpts = PP.getPreprocessorOpts();
+  if (!PPOpts.MinimizedSources)
+    PPOpts.MinimizedSources = new MinimizedSourceCache();
+
+  const llvm::MemoryBuffer *Minimized = PPOpts.MinimizedSources->lookup(File);
+  if (!Minimized) {
+    bool Invalid = false;
+    const llvm::MemoryBuffer *Contents = SM.getBuffer(FID, &Invalid);
+    if (Invalid)
+      return;
+    Minimized = PPOpts.MinimizedSources->insert(File, Contents);
+  }
+  SM.overrideFileContents(File, Minimized, /*DoNotFree=*/true);
+}
+
 /// EnterSourceFile - Add a source file to the top of the include stack and
 /// start lexing tokens from it instead of the current buffer.
 void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
@@ -78,11 +117,15 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
 
   if (PTH) {
     if (PTHLexer *PL = PTH->CreateLexer(FID)) {
+      BeginTimeTraceForFile(SourceMgr, FID);
       EnterSourceFileWithPTH(PL, CurDir);
       return;
     }
   }
   
+  if (PPOpts->MinimizeSourceToDependencyDirectives)
+    MinimizeFileContents(*this, FID);
+
   // Get the MemoryBuffer for this FID, if it fails, we fail.
   bool Invalid = false;
   const llvm::MemoryBuffer *InputFile = 
@@ -101,6 +144,20 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
         CodeCompletionFileLoc.getLocWithOffset(CodeCompletionOffset);
   }
 
+  // Take the tokens of an #included file from the header token cache if
+  // they are there. The cache has no comments, and can't stop at the
+  // code-completion point.
+  if (HeaderTokens && CurPPLexer && !KeepComments &&
+      SourceMgr.getFileEntryForID(FID) &&
+      CodeCompletionFileLoc != SourceMgr.getLocForStartOfFile(FID)) {
+    if (PTHLexer *PL = HeaderTokens->createLexer(*this, FID, InputFile)) {
+      BeginTimeTraceForFile(SourceMgr, FID);
+      EnterSourceFileWithPTH(PL, CurDir);
+      return;
+    }
+  }
+
+  BeginTimeTraceForFile(SourceMgr, FID);
   EnterSourceFileWithLexer(new Lexer(FID, InputFile, *this), CurDir);
   return;
 }
@@ -337,6 +394,10 @@ bool Preprocessor::HandleEndOfFile(Token &Result, bool isEndOfMacro) {
           SourceMgr.local_sloc_entry_size() -
           CurPPLexer->getInitialNumSLocEntries() + 1/*#include'd file*/;
       SourceMgr.setNumCreatedFIDsForFileID(CurPPLexer->getFileID(), NumFIDs);
+
+      // Close the event opened by BeginTimeTraceForFile.
+      if (isTimeTraceEnabled())
+        timeTraceEndEvent();
     }
 
     FileID ExitedFID;
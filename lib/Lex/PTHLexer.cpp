@@ -350,6 +350,15 @@ public:
   }
 };
 
+class PTHFileNameLookupTrait : public PTHFileLookupTrait {
+public:
+  typedef const char* external_key_type;
+
+  static internal_key_type GetInternalKey(const char *Name) {
+    return std::make_pair((unsigned char) 0x1, Name);
+  }
+};
+
 class PTHStringLookupTrait {
 public:
   typedef uint32_t
@@ -394,6 +403,7 @@ public:
 } // end anonymous namespace
 
 typedef OnDiskChainedHashTable<PTHFileLookupTrait>   PTHFileLookup;
+typedef OnDiskChainedHashTable<PTHFileNameLookupTrait> PTHFileNameLookup;
 typedef OnDiskChainedHashTable<PTHStringLookupTrait> PTHStringIdLookup;
 
 //===----------------------------------------------------------------------===//
@@ -408,7 +418,7 @@ PTHManager::PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
                        const char* originalSourceFile)
 : Buf(buf), PerIDCache(perIDCache), FileLookup(fileLookup),
   IdDataTable(idDataTable), StringIdLookup(stringIdLookup),
-  NumIds(numIds), PP(0), SpellingBase(spellingBase),
+  NumIds(numIds), PP(0), IdentTable(0), SpellingBase(spellingBase),
   OriginalSourceFile(originalSourceFile) {}
 
 PTHManager::~PTHManager() {
@@ -546,6 +556,13 @@ IdentifierInfo* PTHManager::LazilyCreateIdentifierInfo(unsigned PersistentID) {
     (const unsigned char*)Buf->getBufferStart() + ReadLE32(TableEntry);
   assert(IDData < (const unsigned char*)Buf->getBufferEnd());
 
+  // The names are nul-terminated, so they can be looked up directly.
+  if (IdentTable) {
+    IdentifierInfo *II = &IdentTable->get((const char*) IDData);
+    PerIDCache[PersistentID] = II;
+    return II;
+  }
+
   // Allocate the object.
   std::pair<IdentifierInfo,const unsigned char*> *Mem =
     Alloc.Allocate<std::pair<IdentifierInfo,const unsigned char*> >();
@@ -589,13 +606,32 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
     return 0;
 
   const PTHFileData& FileData = *I;
+  return CreateLexer(FID, FileData.getTokenOffset(),
+                     FileData.getPPCondOffset());
+}
+
+PTHLexer *PTHManager::CreateLexer(FileID FID, const char *Name) {
+  PTHFileLookup& PFL = *((PTHFileLookup*)FileLookup);
+  PTHFileNameLookup NameLookup(PFL.getNumBuckets(), PFL.getNumEntries(),
+                               PFL.getBuckets(), PFL.getBase());
+  PTHFileNameLookup::iterator I = NameLookup.find(Name);
+
+  if (I == NameLookup.end()) // No tokens available?
+    return 0;
+
+  const PTHFileData& FileData = *I;
+  return CreateLexer(FID, FileData.getTokenOffset(),
+                     FileData.getPPCondOffset());
+}
 
+PTHLexer *PTHManager::CreateLexer(FileID FID, uint32_t TokenOff,
+                                  uint32_t PPCondOff) {
   const unsigned char *BufStart = (const unsigned char *)Buf->getBufferStart();
   // Compute the offset of the token data within the buffer.
-  const unsigned char* data = BufStart + FileData.getTokenOffset();
+  const unsigned char* data = BufStart + TokenOff;
 
   // Get the location of pp-conditional table.
-  const unsigned char* ppcond = BufStart + FileData.getPPCondOffset();
+  const unsigned char* ppcond = BufStart + PPCondOff;
   uint32_t Len = ReadLE32(ppcond);
   if (Len == 0) ppcond = 0;
 
@@ -33,6 +33,7 @@
 #include "clang/Lex/CodeCompletionHandler.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/LiteralSupport.h"
 #include "clang/Lex/MacroInfo.h"
@@ -190,6 +191,10 @@ void Preprocessor::setPTHManager(PTHManager* pm) {
   FileMgr.addStatCache(PTH->createStatCache());
 }
 
+void Preprocessor::setHeaderTokenCache(HeaderTokenCache *Cache) {
+  HeaderTokens.reset(Cache);
+}
+
 void Preprocessor::DumpToken(const Token &Tok, bool DumpFlags) const {
   llvm::errs() << tok::getTokenName(Tok.getKind()) << " '"
                << getSpelling(Tok) << "'";
@@ -261,6 +266,9 @@ void Preprocessor::PrintStats() {
                << llvm::capacity_in_bytes(PoisonReasons);
   llvm::errs() << "\n  Comment Handlers: "
                << llvm::capacity_in_bytes(CommentHandlers) << "\n";
+
+  if (HeaderTokens)
+    HeaderTokens->PrintStats();
 }
 
 Preprocessor::macro_iterator
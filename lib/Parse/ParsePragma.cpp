@@ -779,9 +779,11 @@ PragmaOpenCLExtensionHandler::HandlePragma(Preprocessor &PP,
                                                StateLoc, state);
 }
 
-/// \brief Handle Cilk Plus grainsize pragma.
+/// \brief Handle Cilk Plus grainsize, affinity and priority pragmas.
 ///
 /// #pragma 'cilk' 'grainsize' '=' expr new-line
+/// #pragma 'cilk' 'affinity' new-line
+/// #pragma 'cilk' 'priority' '(' expr ')' new-line
 ///
 void PragmaCilkGrainsizeHandler::HandlePragma(Preprocessor &PP,
                                               PragmaIntroducerKind Introducer,
@@ -796,18 +798,41 @@ void PragmaCilkGrainsizeHandler::HandlePragma(Preprocessor &PP,
   IdentifierInfo *Grainsize = Tok.getIdentifierInfo();
   SourceLocation GrainsizeLoc = Tok.getLocation();
 
-  if (!Grainsize->isStr("grainsize")) {
+  if (Grainsize->isStr("affinity")) {
+    PP.Lex(Tok);
+    if (Tok.isNot(tok::eod)) {
+      PP.Diag(Tok, diag::warn_pragma_extra_tokens_at_eol) << "cilk";
+      return;
+    }
+
+    Token *Toks = (Token *) PP.getPreprocessorAllocator().Allocate(
+        sizeof(Token), llvm::alignOf<Token>());
+    Toks[0].startToken();
+    Toks[0].setKind(tok::annot_pragma_cilk_affinity);
+    Toks[0].setLocation(PP.getDirectiveHashLoc());
+    PP.EnterTokenStream(Toks, 1, /*DisableMacroExpansion=*/true,
+                        /*OwnsTokens=*/false);
+    return;
+  }
+
+  bool IsPriority = Grainsize->isStr("priority");
+  if (!IsPriority && !Grainsize->isStr("grainsize")) {
     PP.Diag(Tok, diag::err_cilk_for_expect_grainsize);
     return;
   }
 
   PP.Lex(Tok);
-  if (Tok.isNot(tok::equal)) {
+  if (IsPriority && Tok.isNot(tok::l_paren)) {
+    PP.Diag(Tok, diag::warn_pragma_expected_lparen) << "cilk priority";
+    return;
+  }
+  if (!IsPriority && Tok.isNot(tok::equal)) {
     PP.Diag(Tok, diag::err_cilk_for_expect_assign);
     return;
   }
 
-  // Cache tokens after '=' and store them back to the token stream.
+  // Cache tokens after '=' (or '(') and store them back to the token stream.
+  // The closing parenthesis of a priority is checked by the parser.
   SmallVector<Token, 5> CachedToks;
   while (true) {
     PP.Lex(Tok);
@@ -823,7 +848,8 @@ void PragmaCilkGrainsizeHandler::HandlePragma(Preprocessor &PP,
                                              llvm::alignOf<Token>());
   Token &GsBeginTok = Toks[0];
   GsBeginTok.startToken();
-  GsBeginTok.setKind(tok::annot_pragma_cilk_grainsize_begin);
+  GsBeginTok.setKind(IsPriority ? tok::annot_pragma_cilk_priority_begin
+                                : tok::annot_pragma_cilk_grainsize_begin);
   GsBeginTok.setLocation(PP.getDirectiveHashLoc());
 
   SourceLocation EndLoc = Size ? CachedToks.back().getLocation()
@@ -831,7 +857,8 @@ void PragmaCilkGrainsizeHandler::HandlePragma(Preprocessor &PP,
 
   Token &GsEndTok = Toks[Size + 1];
   GsEndTok.startToken();
-  GsEndTok.setKind(tok::annot_pragma_cilk_grainsize_end);
+  GsEndTok.setKind(IsPriority ? tok::annot_pragma_cilk_priority_end
+                              : tok::annot_pragma_cilk_grainsize_end);
   GsEndTok.setLocation(EndLoc);
 
   for (unsigned i = 0; i < Size; ++i)
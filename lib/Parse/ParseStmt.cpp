@@ -372,6 +372,10 @@ Retry:
     return ParseCilkForStmt();
   case tok::annot_pragma_cilk_grainsize_begin:
     return ParsePragmaCilkGrainsize();
+  case tok::annot_pragma_cilk_affinity:
+    return ParsePragmaCilkAffinity();
+  case tok::annot_pragma_cilk_priority_begin:
+    return ParsePragmaCilkPriority();
 
   case tok::annot_pragma_simd:
     ProhibitAttributes(Attrs);
@@ -419,8 +423,8 @@ StmtResult Parser::ParsePragmaCilkGrainsize() {
     return StmtError();
 
   // NOTE: The following statement is not necessarily a _Cilk_for statement.
-  // It can also be another pragma that appertains to the _Cilk_for. However,
-  // since grainsize is the only pragma supported by _Cilk_for, we require the
+  // It can also be another pragma that appertains to the _Cilk_for. The
+  // affinity pragma marks the _Cilk_for itself, so we still require the
   // following statement to be a _Cilk_for.
   if (!isa<CilkForStmt>(FollowingStmt.get())) {
     Diag(FollowingStmt.get()->getLocStart(),
@@ -431,6 +435,60 @@ StmtResult Parser::ParsePragmaCilkGrainsize() {
   return Actions.ActOnCilkForGrainsizePragma(E.get(), FollowingStmt.get(), HashLoc);
 }
 
+StmtResult Parser::ParsePragmaCilkAffinity() {
+  assert(getLangOpts().CilkPlus && "Cilk Plus extension not enabled");
+  SourceLocation HashLoc = ConsumeToken(); // Eat 'annot_pragma_cilk_affinity'.
+
+  // Parse the following statement.
+  StmtResult FollowingStmt(ParseStatement());
+  if (FollowingStmt.isInvalid())
+    return StmtError();
+
+  // The following statement may be a _Cilk_for with a grainsize pragma.
+  Stmt *S = FollowingStmt.get();
+  if (CilkForGrainsizeStmt *GS = dyn_cast<CilkForGrainsizeStmt>(S))
+    S = GS->getCilkFor();
+  if (!isa<CilkForStmt>(S)) {
+    Diag(FollowingStmt.get()->getLocStart(),
+         diag::warn_cilk_for_following_grainsize);
+    return FollowingStmt;
+  }
+
+  return Actions.ActOnCilkForAffinityPragma(FollowingStmt.get(), HashLoc);
+}
+
+StmtResult Parser::ParsePragmaCilkPriority() {
+  assert(getLangOpts().CilkPlus && "Cilk Plus extension not enabled");
+  SourceLocation HashLoc = ConsumeToken(); // Eat 'annot_pragma_cilk_priority_begin'.
+
+  ExprResult E = ParseExpression();
+  if (E.isInvalid()) {
+    SkipUntil(tok::annot_pragma_cilk_priority_end);
+    return StmtError();
+  }
+
+  if (Tok.isNot(tok::r_paren)) {
+    Diag(Tok, diag::warn_pragma_expected_rparen) << "cilk priority";
+    SkipUntil(tok::annot_pragma_cilk_priority_end);
+    return ParseStatement();
+  }
+  ConsumeParen();
+
+  if (Tok.isNot(tok::annot_pragma_cilk_priority_end)) {
+    Diag(Tok, diag::warn_pragma_extra_tokens_at_eol) << "cilk";
+    SkipUntil(tok::annot_pragma_cilk_priority_end);
+  } else
+    ConsumeToken(); // Eat 'annot_pragma_cilk_priority_end'.
+
+  // Parse the following statement. Sema looks for the spawn in it.
+  StmtResult FollowingStmt(ParseStatement());
+  if (FollowingStmt.isInvalid())
+    return StmtError();
+
+  return Actions.ActOnCilkSpawnPriorityPragma(E.get(), FollowingStmt.get(),
+                                              HashLoc);
+}
+
 /// \brief Parse an expression statement.
 StmtResult Parser::ParseExprStatement() {
   // If a case keyword is missing, this is where it should be inserted.
@@ -113,6 +113,11 @@ void MultiplexExternalSemaSource::FindFileRegionDecls(FileID File,
     Sources[i]->FindFileRegionDecls(File, Offset, Length, Decls);
 }
 
+void MultiplexExternalSemaSource::CompleteRedeclChain(const Decl *D) {
+  for(size_t i = 0; i < Sources.size(); ++i)
+    Sources[i]->CompleteRedeclChain(D);
+}
+
 void MultiplexExternalSemaSource::CompleteType(TagDecl *Tag) {
   for(size_t i = 0; i < Sources.size(); ++i)
     Sources[i]->CompleteType(Tag);
@@ -161,6 +166,16 @@ bool MultiplexExternalSemaSource::layoutRecordType(const RecordDecl *Record,
   return false;
 }
 
+ExternalASTSource::CodeLocation
+MultiplexExternalSemaSource::getCodeLocation(const FunctionDecl *FD) {
+  for(size_t i = 0; i < Sources.size(); ++i) {
+    CodeLocation Loc = Sources[i]->getCodeLocation(FD);
+    if (Loc != CL_Default)
+      return Loc;
+  }
+  return CL_Default;
+}
+
 void MultiplexExternalSemaSource::
 getMemoryBufferSizes(MemoryBufferSizes &sizes) const {
   for(size_t i = 0; i < Sources.size(); ++i)
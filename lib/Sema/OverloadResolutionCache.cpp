@@ -0,0 +1,75 @@
+//===--- OverloadResolutionCache.cpp - Cached overload resolution ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache of the outcomes of overload resolution.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Sema/OverloadResolutionCache.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+/// A cached call.
+class OverloadResolutionCache::Entry : public llvm::FastFoldingSetNode {
+public:
+  Result R;
+
+  /// The visible declaration generation when the outcome was reached.
+  unsigned Generation;
+
+  Entry(const llvm::FoldingSetNodeID &Key, unsigned Generation,
+        const Result &R)
+    : FastFoldingSetNode(Key), R(R), Generation(Generation) {}
+};
+
+OverloadResolutionCache::OverloadResolutionCache()
+  : NumHits(0), NumMisses(0), NumStale(0), NumUncacheable(0) {}
+
+OverloadResolutionCache::~OverloadResolutionCache() {
+  llvm::DeleteContainerPointers(AllEntries);
+}
+
+bool OverloadResolutionCache::lookup(const llvm::FoldingSetNodeID &Key,
+                                     unsigned Generation, Result &R) {
+  void *InsertPos;
+  const Entry *E = Entries.FindNodeOrInsertPos(Key, InsertPos);
+  if (!E) {
+    ++NumMisses;
+    return false;
+  }
+  if (E->R.DependsOnVisibleDecls && E->Generation != Generation) {
+    ++NumStale;
+    return false;
+  }
+  ++NumHits;
+  R = E->R;
+  return true;
+}
+
+void OverloadResolutionCache::insert(const llvm::FoldingSetNodeID &Key,
+                                     unsigned Generation, const Result &R) {
+  void *InsertPos;
+  if (Entry *E = Entries.FindNodeOrInsertPos(Key, InsertPos)) {
+    E->R = R;
+    E->Generation = Generation;
+    return;
+  }
+  Entry *E = new Entry(Key, Generation, R);
+  Entries.InsertNode(E, InsertPos);
+  AllEntries.push_back(E);
+}
+
+void OverloadResolutionCache::PrintStats() const {
+  llvm::errs() << "*** Overload Resolution Cache Stats:\n";
+  llvm::errs() << "  " << AllEntries.size() << " results cached.\n";
+  llvm::errs() << "  " << NumHits << " hits, " << NumMisses << " misses, "
+               << NumStale << " out of date.\n";
+  llvm::errs() << "  " << NumUncacheable << " uncacheable calls.\n";
+}
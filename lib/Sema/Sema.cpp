@@ -32,6 +32,7 @@
 #include "clang/Sema/ExternalSemaSource.h"
 #include "clang/Sema/MultiplexExternalSemaSource.h"
 #include "clang/Sema/ObjCMethodList.h"
+#include "clang/Sema/OverloadResolutionCache.h"
 #include "clang/Sema/PrettyDeclStackTrace.h"
 #include "clang/Sema/Scope.h"
 #include "clang/Sema/ScopeInfo.h"
@@ -86,7 +87,8 @@ Sema::Sema(Preprocessor &pp, ASTContext &ctxt, ASTConsumer &consumer,
     NSDictionaryDecl(0), DictionaryWithObjectsMethod(0),
     GlobalNewDeleteDeclared(false),
     TUKind(TUKind),
-    NumSFINAEErrors(0), InFunctionDeclarator(0),
+    NumSFINAEErrors(0), NumContextDependentAccessChecks(0),
+    InFunctionDeclarator(0),
     AccessCheckingSFINAE(false), InNonInstantiationSFINAEContext(false),
     NonInstantiationEntries(0), ArgumentPackSubstitutionIndex(-1),
     CurrentInstantiationScope(0), DisableTypoCorrection(false),
@@ -107,6 +109,12 @@ Sema::Sema(Preprocessor &pp, ASTContext &ctxt, ASTConsumer &consumer,
   if (getLangOpts().CPlusPlus)
     FieldCollector.reset(new CXXFieldCollector());
 
+  // Overload resolution in CUDA and ARC also depends on the function that
+  // contains the call, and on the argument expressions, respectively.
+  if (getLangOpts().CPlusPlus && getLangOpts().OverloadResolutionCache &&
+      !getLangOpts().CUDA && !getLangOpts().ObjCAutoRefCount)
+    OverloadCache.reset(new OverloadResolutionCache());
+
   // Tell diagnostics how to render things from the AST library.
   PP.getDiagnostics().SetArgToStringFn(&FormatASTNodeDiagnosticArgument,
                                        &Context);
@@ -267,6 +275,8 @@ void Sema::PrintStats() const {
 
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
+  if (OverloadCache)
+    OverloadCache->PrintStats();
 }
 
 /// ImpCastExprToType - If Expr is not of type 'Type', insert an implicit cast.
@@ -606,6 +616,11 @@ void Sema::ActOnEndOfTranslationUnit() {
     // name that was not visible at its first point of instantiation.
     PerformPendingInstantiations();
     CheckDelayedMemberExceptionSpecs();
+  } else if (LangOpts.PCHInstantiateTemplates) {
+    // Instantiate here what every translation unit that includes the PCH
+    // would otherwise instantiate again. This finds the names visible at the
+    // end of the PCH rather than those at the end of the translation unit.
+    PerformPendingInstantiations();
   }
 
   // All delayed member exception specs should be checked or we end up accepting
@@ -818,6 +818,89 @@ StmtResult Sema::ActOnCilkForGrainsizePragma(Expr *GrainsizeExpr, Stmt *CilkFor,
   return new (Context) CilkForGrainsizeStmt(GrainsizeExpr, CilkFor, LocStart);
 }
 
+StmtResult Sema::ActOnCilkForAffinityPragma(Stmt *CilkFor,
+                                            SourceLocation LocStart) {
+  // The affinity pragma does not introduce a statement of its own; it only
+  // marks the _Cilk_for, which may already have a grainsize.
+  Stmt *S = CilkFor;
+  if (CilkForGrainsizeStmt *GS = dyn_cast<CilkForGrainsizeStmt>(S))
+    S = GS->getCilkFor();
+  cast<CilkForStmt>(S)->setAffinityLoc(LocStart);
+  return Owned(CilkFor);
+}
+
+/// \brief Returns the spawn of a statement of the form '_Cilk_spawn f(...);',
+/// 'x = _Cilk_spawn f(...);' or 'T x = _Cilk_spawn f(...);', or null.
+static CilkSpawnDecl *getSpawnDeclOfStmt(Stmt *S) {
+  if (DeclStmt *DS = dyn_cast<DeclStmt>(S)) {
+    if (!DS->isSingleDecl())
+      return 0;
+    return dyn_cast<CilkSpawnDecl>(DS->getSingleDecl());
+  }
+
+  Expr *E = dyn_cast<Expr>(S);
+  if (!E)
+    return 0;
+  if (ExprWithCleanups *EWC = dyn_cast<ExprWithCleanups>(E))
+    E = EWC->getSubExpr();
+  if (CilkSpawnExpr *CSE = dyn_cast<CilkSpawnExpr>(E->IgnoreImplicit()))
+    return CSE->getSpawnDecl();
+  return 0;
+}
+
+StmtResult Sema::ActOnCilkSpawnPriorityPragma(Expr *PriorityExpr, Stmt *Spawn,
+                                              SourceLocation LocStart) {
+  CilkSpawnDecl *D = getSpawnDeclOfStmt(Spawn);
+  if (!D) {
+    Diag(Spawn->getLocStart(), diag::warn_cilk_spawn_priority_ignored);
+    return Owned(Spawn);
+  }
+
+  if (SetCilkSpawnPriority(D, PriorityExpr))
+    return StmtError();
+  return Owned(Spawn);
+}
+
+/// \brief Sets the priority of \p Spawn to the value of \p PriorityExpr. A
+/// value-dependent priority is checked when the template is instantiated.
+///
+/// \returns true on error.
+bool Sema::SetCilkSpawnPriority(CilkSpawnDecl *Spawn, Expr *PriorityExpr) {
+  if (PriorityExpr->isValueDependent()) {
+    Spawn->setDependentPriority(PriorityExpr);
+    return false;
+  }
+
+  // The priority is stored in the pending frame by the dataflow spawn
+  // helper, so it must be known at compile time.
+  llvm::APSInt Result;
+  if (VerifyIntegerConstantExpression(PriorityExpr, &Result).isInvalid())
+    return true;
+
+  if (Result.isNegative() || Result.getActiveBits() > 32) {
+    Diag(PriorityExpr->getLocStart(), diag::err_cilk_spawn_priority_range)
+        << ~0U << PriorityExpr->getSourceRange();
+    return true;
+  }
+
+  Spawn->setPriority(Result.getZExtValue());
+  return false;
+}
+
+/// \brief Gives \p Spawn, an instantiation of \p Pattern, the priority of
+/// \p Pattern. \p Priority is the instantiated dependent priority, if
+/// \p Pattern has one.
+///
+/// \returns true on error.
+bool Sema::SubstCilkSpawnPriority(CilkSpawnDecl *Pattern, CilkSpawnDecl *Spawn,
+                                  ExprResult Priority) {
+  if (!Pattern->getDependentPriority()) {
+    Spawn->setPriority(Pattern->getPriority());
+    return false;
+  }
+  return Priority.isInvalid() || SetCilkSpawnPriority(Spawn, Priority.get());
+}
+
 static void CheckForSignedUnsignedWraparounds(
     const VarDecl *ControlVar, const Expr *ControlVarInit, const Expr *Limit,
     Sema &S, int CondDirection, llvm::APSInt Stride, const Expr *StrideExpr) {
@@ -1337,6 +1420,184 @@ StmtResult Sema::ActOnCilkForStmt(SourceLocation CilkForLoc,
                           Span.isUsable() ? Span.get()->getType() : QualType());
 }
 
+namespace {
+/// \brief Checks that the loop control variable is only read by the
+/// arguments of a call spawned in a loop body.
+class SpawnLoopArgChecker : public RecursiveASTVisitor<SpawnLoopArgChecker> {
+  const VarDecl *ControlVar;
+  unsigned NumUses;
+  unsigned NumReads;
+
+public:
+  explicit SpawnLoopArgChecker(const VarDecl *V)
+      : ControlVar(V), NumUses(0), NumReads(0) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr *E) {
+    if (E->getDecl() == ControlVar)
+      ++NumUses;
+    return true;
+  }
+
+  bool VisitImplicitCastExpr(ImplicitCastExpr *E) {
+    if (E->getCastKind() != CK_LValueToRValue)
+      return true;
+    Expr *Sub = E->getSubExpr()->IgnoreParens();
+    if (DeclRefExpr *DR = dyn_cast<DeclRefExpr>(Sub))
+      if (DR->getDecl() == ControlVar)
+        ++NumReads;
+    return true;
+  }
+
+  bool isReadOnly() const { return NumUses == NumReads; }
+};
+} // namespace
+
+/// \brief Returns the call spawned by a loop body if the body consists of
+/// this spawn only, the spawn has no receiver and each argument is a scalar
+/// without side effects that only reads the loop control variable.
+static CallExpr *getSpawnLoopCall(Sema &S, Stmt *Body,
+                                  const VarDecl *ControlVar) {
+  if (CompoundStmt *CS = dyn_cast<CompoundStmt>(Body)) {
+    if (CS->size() != 1)
+      return 0;
+    Body = CS->body_back();
+  }
+
+  Expr *E = dyn_cast<Expr>(Body);
+  if (!E)
+    return 0;
+
+  CilkSpawnExpr *CSE = dyn_cast<CilkSpawnExpr>(E->IgnoreImplicit());
+  if (!CSE || !CSE->getSpawnExpr())
+    return 0;
+
+  CallExpr *Call = dyn_cast<CallExpr>(CSE->getSpawnExpr()->IgnoreImplicit());
+  if (!Call || !Call->isCilkSpawnCall() || isa<CXXMemberCallExpr>(Call) ||
+      isa<CXXOperatorCallExpr>(Call) || !Call->getDirectCallee())
+    return 0;
+
+  QualType RetTy = Call->getType();
+  if (!RetTy->isVoidType() && !RetTy->isScalarType())
+    return 0;
+
+  const FunctionDecl *FD = Call->getDirectCallee();
+  for (unsigned I = 0, N = FD->getNumParams(); I != N; ++I)
+    if (FD->getParamDecl(I)->getType()->isReferenceType())
+      return 0;
+
+  SpawnLoopArgChecker Checker(ControlVar);
+  for (CallExpr::arg_iterator I = Call->arg_begin(), E = Call->arg_end();
+       I != E; ++I) {
+    Expr *Arg = *I;
+    if (!Arg->getType()->isScalarType() || Arg->HasSideEffects(S.Context))
+      return 0;
+    Checker.TraverseStmt(Arg);
+  }
+
+  return Checker.isReadOnly() ? Call : 0;
+}
+
+void Sema::ActOnCilkSpawnLoop(ForStmt *S) {
+  // A loop of the form
+  //
+  // for (int i = 0; i < n; ++i)
+  //   _Cilk_spawn f(i);
+  //
+  // spawns its iterations one at a time, so that each steal only obtains a
+  // single iteration. If the iterations are independent then the loop is
+  // emitted through the '_Cilk_for' runtime entry instead, which splits the
+  // iteration space recursively. This requires the loop to be in the
+  // canonical '_Cilk_for' form, with the control variable declared in the
+  // initialization clause.
+  DeclStmt *Init = dyn_cast_or_null<DeclStmt>(S->getInit());
+  Expr *Cond = S->getCond();
+  Expr *Inc = S->getInc();
+  if (!Init || !Cond || !Inc || !S->getBody() || S->getConditionVariable() ||
+      CurContext->isDependentContext())
+    return;
+
+  if (!Init->isSingleDecl())
+    return;
+  VarDecl *ControlVar = dyn_cast<VarDecl>(Init->getSingleDecl());
+  if (!ControlVar || ControlVar->isInvalidDecl() ||
+      !ControlVar->getType()->isIntegerType() ||
+      ControlVar->getType()->isBooleanType())
+    return;
+
+  CallExpr *Call = getSpawnLoopCall(*this, S->getBody(), ControlVar);
+  if (!Call)
+    return;
+
+  // Reuse the '_Cilk_for' canonical form checks without issuing any of
+  // their diagnostics; a loop that does not qualify is left untouched.
+  ExprResult LoopCount;
+  {
+    SFINAETrap Trap(*this);
+
+    VarDecl *Var = 0;
+    Expr *VarInit = 0;
+    if (!CheckForInit(*this, Init, Var, VarInit, /*IsCilkFor*/ false))
+      return;
+
+    Expr *Limit = 0;
+    int CondDirection = 0;
+    BinaryOperatorKind Opcode;
+    CheckForCondition(*this, Var, Cond, Limit, CondDirection, Opcode,
+                      /*IsCilkFor*/ false);
+    if (!Limit || Limit->HasSideEffects(Context))
+      return;
+    Limit = Limit->getSubExprAsWritten();
+
+    // The number of iterations is computed before any of them is spawned,
+    // which requires a constant stride whose sign agrees with the condition.
+    bool Decreasing;
+    Expr *IncExpr = Inc->IgnoreParens();
+    if (UnaryOperator *UO = dyn_cast<UnaryOperator>(IncExpr)) {
+      Decreasing = UO->isDecrementOp();
+    } else if (CompoundAssignOperator *CAO =
+                   dyn_cast<CompoundAssignOperator>(IncExpr)) {
+      llvm::APSInt Stride;
+      if (!CAO->getRHS()->isIntegerConstantExpr(Stride, Context) || !Stride)
+        return;
+      Decreasing = Stride.isNegative() != (CAO->getOpcode() == BO_SubAssign);
+    } else {
+      return;
+    }
+    if (CondDirection && Decreasing != (CondDirection < 0))
+      return;
+
+    Expr *StrideExpr = 0;
+    if (!CheckForIncrement(*this, Inc, Limit, Var, VarInit, CondDirection,
+                           StrideExpr, /*IsCilkFor*/ false))
+      return;
+    StrideExpr = StrideExpr->getSubExprAsWritten();
+
+    EnterExpressionEvaluationContext EvalContext(*this, PotentiallyEvaluated);
+
+    Expr *Begin = BuildDeclRefExpr(Var, Var->getType().getNonReferenceType(),
+                                   VK_LValue, Var->getLocation()).release();
+    Expr *End = Limit;
+    if (CondDirection < 0)
+      std::swap(Begin, End);
+
+    ExprResult Span = BuildBinOp(getCurScope(), S->getForLoc(), BO_Sub, End,
+                                 Begin);
+    if (Span.isInvalid() ||
+        !Span.get()->getType()->isIntegralOrEnumerationType())
+      return;
+
+    LoopCount = CalculateCilkForLoopCount(S->getForLoc(), Span.get(), Inc,
+                                          StrideExpr, CondDirection, Opcode);
+    if (LoopCount.isInvalid() || Trap.hasErrorOccurred())
+      return;
+    LoopCount = MakeFullExpr(LoopCount.get()).release();
+  }
+
+  S->setSpawnLoopCount(LoopCount.get());
+  Diag(S->getForLoc(), diag::warn_cilk_spawn_loop_divide_conquer)
+      << Call->getDirectCallee() << S->getSourceRange();
+}
+
 StmtResult Sema::ActOnSIMDForStmt(SourceLocation PragmaLoc,
                                   ArrayRef<Attr *> Attrs, SourceLocation ForLoc,
                                   SourceLocation LParenLoc, Stmt *First,
@@ -9522,6 +9522,83 @@ static void RebuildLambdaScopeInfo(CXXMethodDecl *CallOperator,
   }
 }
 
+/// \brief Whether the statements of the body of the function definition
+/// \p FD may be allocated in an arena that is freed once the function has
+/// been emitted (-ffree-function-bodies).
+///
+/// The body of a function that may be instantiated, inlined or evaluated
+/// after it has been emitted, or whose code is emitted more than once, is
+/// kept.
+static bool mayFreeFunctionBody(Sema &S, const FunctionDecl *FD) {
+  const LangOptions &LangOpts = S.getLangOpts();
+  if (!LangOpts.FreeFunctionBodies || S.TUKind != TU_Complete ||
+      LangOpts.Modules || LangOpts.ObjC1 ||
+      S.PP.isCodeCompletionEnabled())
+    return false;
+  return FD->getTemplatedKind() == FunctionDecl::TK_NonTemplate &&
+         !FD->isDependentContext() && !FD->isInlined() &&
+         !FD->isConstexpr() && !isa<CXXConstructorDecl>(FD) &&
+         !isa<CXXDestructorDecl>(FD) && !FD->getParentFunctionOrMethod();
+}
+
+/// \brief Whether nothing outside the body of a function refers to its
+/// statements through the local declaration \p D.
+static bool isFreeableLocalDecl(const Decl *D) {
+  if (const VarDecl *VD = dyn_cast<VarDecl>(D))
+    return VD->hasLocalStorage();
+
+  // The captures of a captured statement, such as a Cilk spawn.
+  if (const RecordDecl *RD = dyn_cast<RecordDecl>(D)) {
+    const CXXRecordDecl *CXXRD = dyn_cast<CXXRecordDecl>(RD);
+    return RD->isImplicit() && !(CXXRD && CXXRD->isLambda());
+  }
+  if (const CapturedDecl *CD = dyn_cast<CapturedDecl>(D)) {
+    for (DeclContext::decl_iterator I = CD->decls_begin(),
+                                    E = CD->decls_end();
+         I != E; ++I)
+      if (!isFreeableLocalDecl(*I))
+        return false;
+    return true;
+  }
+
+  // Local classes, enumerations and functions, and static locals, can be
+  // used after the function has been emitted.
+  return isa<TypedefNameDecl>(D) || isa<UsingDecl>(D) ||
+         isa<UsingShadowDecl>(D) || isa<UsingDirectiveDecl>(D) ||
+         isa<NamespaceAliasDecl>(D) || isa<StaticAssertDecl>(D) ||
+         isa<LabelDecl>(D) || isa<CilkSpawnDecl>(D) || isa<EmptyDecl>(D);
+}
+
+/// \brief Whether the statement \p S contains a lambda or a block, whose
+/// body can be used after the function containing it has been emitted.
+static bool containsLambdaOrBlock(const Stmt *S) {
+  if (isa<LambdaExpr>(S) || isa<BlockExpr>(S))
+    return true;
+  for (Stmt::const_child_range C = S->children(); C; ++C)
+    if (*C && containsLambdaOrBlock(*C))
+      return true;
+  return false;
+}
+
+/// \brief Whether nothing outside the body \p Body of the function \p FD
+/// refers to the statements in it, so that they can be freed once the
+/// function has been emitted.
+static bool canFreeFunctionBody(const FunctionDecl *FD, const Stmt *Body) {
+  for (DeclContext::decl_iterator I = FD->decls_begin(), E = FD->decls_end();
+       I != E; ++I)
+    if (!isFreeableLocalDecl(*I))
+      return false;
+  return !containsLambdaOrBlock(Body);
+}
+
+void Sema::suspendFunctionBodyArena() {
+  Context.suspendFunctionBodyArena();
+}
+
+void Sema::resumeFunctionBodyArena() {
+  Context.resumeFunctionBodyArena();
+}
+
 Decl *Sema::ActOnStartOfFunctionDef(Scope *FnBodyScope, Decl *D) {
   // Clear the last template instantiation error context.
   LastTemplateInstantiationErrorContext = ActiveTemplateInstantiation();
@@ -9691,6 +9768,9 @@ Decl *Sema::ActOnStartOfFunctionDef(Scope *FnBodyScope, Decl *D) {
   // We want to attach documentation to original Decl (which might be
   // a function template).
   ActOnDocumentableDecl(D);
+
+  if (mayFreeFunctionBody(*this, FD))
+    Context.startFunctionBodyArena(FD);
   return D;
 }
 
@@ -9921,6 +10001,10 @@ Decl *Sema::ActOnFinishFunctionBody(Decl *dcl, Stmt *Body,
     DiscardCleanupsInEvaluationContext();
   }
 
+  if (FD && Context.getFunctionBodyArenaOwner() == FD)
+    Context.finishFunctionBodyArena(FD, Body && !FD->isInvalidDecl() &&
+                                            canFreeFunctionBody(FD, Body));
+
   return dcl;
 }
 
@@ -25,6 +25,7 @@
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/Initialization.h"
 #include "clang/Sema/Lookup.h"
+#include "clang/Sema/OverloadResolutionCache.h"
 #include "clang/Sema/SemaInternal.h"
 #include "clang/Sema/Template.h"
 #include "clang/Sema/TemplateDeduction.h"
@@ -10406,6 +10407,243 @@ static ExprResult FinishOverloadedCallExpr(Sema &SemaRef, Scope *S, Expr *Fn,
   return ExprError();
 }
 
+/// \brief Whether the classes that \p T is built from are complete, so that
+/// the conversions to and from \p T can't change once more classes are
+/// complete.
+static bool involvesOnlyCompleteClasses(QualType T) {
+  while (true) {
+    if (const ReferenceType *Ref = T->getAs<ReferenceType>())
+      T = Ref->getPointeeType();
+    else if (const PointerType *Ptr = T->getAs<PointerType>())
+      T = Ptr->getPointeeType();
+    else if (const MemberPointerType *MemPtr
+               = T->getAs<MemberPointerType>()) {
+      if (!involvesOnlyCompleteClasses(QualType(MemPtr->getClass(), 0)))
+        return false;
+      T = MemPtr->getPointeeType();
+    } else if (const ArrayType *Array = T->getAsArrayTypeUnsafe())
+      T = Array->getElementType();
+    else
+      break;
+  }
+  return !T->isRecordType() || !T->isIncompleteType();
+}
+
+/// \brief Compute the key of a call in the overload resolution cache: the
+/// functions \p Fns that lookup found for it, those that argument-dependent
+/// lookup finds, and the canonical types and value kinds of the arguments.
+///
+/// \param Kind Distinguishes calls to named functions from each overloaded
+/// operator.
+///
+/// \returns false if the outcome of overload resolution for the call may
+/// depend on more than its key.
+static bool profileOverloadedCall(Sema &S, llvm::FoldingSetNodeID &ID,
+                                  unsigned Kind, UnresolvedSetIterator Begin,
+                                  UnresolvedSetIterator End,
+                                  DeclarationName Name, bool PerformADL,
+                                  bool Operator, SourceLocation Loc,
+                                  ArrayRef<Expr *> Args) {
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    Expr *Arg = Args[I];
+    QualType T = Arg->getType();
+
+    // Null pointer constants, string literals, overloaded function names,
+    // initializer lists and bit-fields have conversions that other
+    // expressions of their type don't.
+    if (Arg->isValueDependent() || T->isPlaceholderType() ||
+        Arg->getObjectKind() != OK_Ordinary ||
+        isa<InitListExpr>(Arg->IgnoreParens()) ||
+        isa<StringLiteral>(Arg->IgnoreParens()))
+      return false;
+    if ((T->isIntegralOrEnumerationType() || T->isNullPtrType()) &&
+        Arg->isNullPointerConstant(S.Context,
+                                   Expr::NPC_ValueDependentIsNotNull))
+      return false;
+
+    // Completing a class may give argument-dependent lookup more to find.
+    if (!involvesOnlyCompleteClasses(T))
+      return false;
+
+    ID.AddPointer(S.Context.getCanonicalType(T).getAsOpaquePtr());
+    ID.AddInteger(Arg->getValueKind());
+  }
+
+  ID.AddInteger(Kind);
+  ID.AddPointer(Name.getAsOpaquePtr());
+  ID.AddInteger(End - Begin);
+  for (UnresolvedSetIterator I = Begin; I != End; ++I) {
+    ID.AddPointer(I.getDecl());
+    ID.AddInteger(I.getAccess());
+  }
+
+  // A function declared after the last call in an associated namespace or
+  // class changes the key of the next one.
+  if (PerformADL) {
+    ADLResult ADLFns;
+    S.ArgumentDependentLookup(Name, Operator, Loc, Args, ADLFns);
+    SmallVector<NamedDecl *, 8> Found(ADLFns.begin(), ADLFns.end());
+    llvm::array_pod_sort(Found.begin(), Found.end());
+    ID.AddInteger(Found.size());
+    for (unsigned I = 0, N = Found.size(); I != N; ++I)
+      ID.AddPointer(Found[I]);
+  }
+  return true;
+}
+
+/// \brief Resolve a call with the key \p Key to the function it resolved to
+/// when it was added to the overload resolution cache, by adding only that
+/// function to \p CandidateSet.
+///
+/// \param HadMultipleCandidates If non-null, set to whether the call had more
+/// than one candidate when it was resolved in full.
+///
+/// \returns false, leaving \p CandidateSet empty, if the call isn't cached.
+static bool resolveToCachedFunction(Sema &S, const llvm::FoldingSetNodeID &Key,
+                                    ArrayRef<Expr *> Args, bool Operator,
+                                    SourceLocation Loc,
+                                    OverloadCandidateSet &CandidateSet,
+                                    OverloadCandidateSet::iterator &Best,
+                                    bool *HadMultipleCandidates) {
+  OverloadResolutionCache::Result Cached;
+  if (!S.OverloadCache->lookup(Key, S.Context.getVisibleDeclGeneration(),
+                               Cached))
+    return false;
+
+  CXXMethodDecl *Method = dyn_cast<CXXMethodDecl>(Cached.Function);
+  if (Operator && Method) {
+    NamedDecl *D = Cached.FoundDecl.getDecl();
+    S.AddMethodCandidate(Method, Cached.FoundDecl,
+                         cast<CXXRecordDecl>(D->getDeclContext()),
+                         Args[0]->getType(), Args[0]->Classify(S.Context),
+                         Args.slice(1), CandidateSet);
+  } else {
+    S.AddOverloadCandidate(Cached.Function, Cached.FoundDecl, Args,
+                           CandidateSet);
+  }
+
+  if (CandidateSet.BestViableFunction(S, Loc, Best) == OR_Success) {
+    if (HadMultipleCandidates)
+      *HadMultipleCandidates = Cached.HadMultipleCandidates;
+    return true;
+  }
+
+  // The function should still be viable; if it isn't, resolve the call in
+  // full to diagnose it.
+  CandidateSet.clear();
+  return false;
+}
+
+/// \brief Whether a conversion to or from \p T may be user-defined, and so
+/// involve constructors or conversion functions that are templates.
+static bool mayConvertThroughClass(QualType T) {
+  if (const ReferenceType *Ref = T->getAs<ReferenceType>())
+    T = Ref->getPointeeType();
+  return T->isRecordType();
+}
+
+/// \brief Whether resolving a call with the arguments \p Args to one of the
+/// candidates in \p CandidateSet may have looked up names that aren't part
+/// of the key of the call, so that the outcome may change once more
+/// declarations are visible.
+///
+/// That is the case when template arguments were deduced for a candidate,
+/// e.g. because a name in its return type is found by argument-dependent
+/// lookup, or when a user-defined conversion may have been considered.
+static bool dependsOnVisibleDecls(ArrayRef<Expr *> Args,
+                                  OverloadCandidateSet &CandidateSet) {
+  for (unsigned I = 0, N = Args.size(); I != N; ++I)
+    if (mayConvertThroughClass(Args[I]->getType()))
+      return true;
+
+  for (OverloadCandidateSet::iterator Cand = CandidateSet.begin(),
+         CandEnd = CandidateSet.end(); Cand != CandEnd; ++Cand) {
+    FunctionDecl *Function = Cand->Function;
+    if (!Function)
+      continue;
+    // A candidate whose deduction failed is the function template's pattern.
+    if (Function->getPrimaryTemplate() ||
+        Function->getDescribedFunctionTemplate())
+      return true;
+    for (unsigned I = 0, N = Function->getNumParams(); I != N; ++I)
+      if (mayConvertThroughClass(Function->getParamDecl(I)->getType()))
+        return true;
+  }
+  return false;
+}
+
+/// \brief Add the function that overload resolution selected from
+/// \p CandidateSet to the overload resolution cache, as the outcome of the
+/// call with the key \p Key.
+static void cacheOverloadResolution(Sema &S, const llvm::FoldingSetNodeID &Key,
+                                    ArrayRef<Expr *> Args,
+                                    OverloadCandidateSet &CandidateSet,
+                                    OverloadCandidateSet::iterator Best) {
+  if (!Best->Function)
+    return;
+
+  // Completing a class may give it conversions, or let it be converted to a
+  // base class, so the outcome may change unless every class that a
+  // conversion could involve is complete.
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    CXXRecordDecl *Record = Args[I]->getType()->getAsCXXRecordDecl();
+    if (!Record)
+      continue;
+    std::pair<CXXRecordDecl::conversion_iterator,
+              CXXRecordDecl::conversion_iterator>
+      Conversions = Record->getVisibleConversionFunctions();
+    for (CXXRecordDecl::conversion_iterator C = Conversions.first,
+           CEnd = Conversions.second; C != CEnd; ++C) {
+      NamedDecl *D = C.getDecl()->getUnderlyingDecl();
+      if (CXXConversionDecl *Conv = dyn_cast<CXXConversionDecl>(D))
+        if (!involvesOnlyCompleteClasses(Conv->getConversionType()))
+          return;
+    }
+  }
+  for (OverloadCandidateSet::iterator Cand = CandidateSet.begin(),
+         CandEnd = CandidateSet.end(); Cand != CandEnd; ++Cand) {
+    if (!Cand->Function)
+      continue;
+    for (unsigned I = 0, N = Cand->Function->getNumParams(); I != N; ++I)
+      if (!involvesOnlyCompleteClasses(
+             Cand->Function->getParamDecl(I)->getType()))
+        return;
+  }
+
+  OverloadResolutionCache::Result Result;
+  Result.FoundDecl = Best->FoundDecl;
+  Result.Function = Best->Function;
+  Result.HadMultipleCandidates = CandidateSet.size() > 1;
+  Result.DependsOnVisibleDecls = dependsOnVisibleDecls(Args, CandidateSet);
+  // Declarations made visible while the call was resolved, e.g. the implicit
+  // special members of a class, were seen by it.
+  S.OverloadCache->insert(Key, S.Context.getVisibleDeclGeneration(), Result);
+}
+
+namespace {
+/// \brief Notices anything that makes the outcome of overload resolution for
+/// a call depend on more than its key in the overload resolution cache, from
+/// when it is constructed.
+class OverloadResolutionCacheGuard {
+  Sema &S;
+  DiagnosticErrorTrap Trap;
+  unsigned NumAccessChecks;
+
+public:
+  explicit OverloadResolutionCacheGuard(Sema &S)
+    : S(S), Trap(S.Diags),
+      NumAccessChecks(S.NumContextDependentAccessChecks) {}
+
+  /// \brief Whether the outcome depended only on the key of the call, i.e.
+  /// there were no errors and no checks of access to non-public members,
+  /// which depend on where the call is.
+  bool dependedOnlyOnKey() const {
+    return !Trap.hasErrorOccurred() &&
+           NumAccessChecks == S.NumContextDependentAccessChecks;
+  }
+};
+}
+
 /// BuildOverloadedCallExpr - Given the call expression that calls Fn
 /// (which eventually refers to the declaration Func) and the call
 /// arguments Args/NumArgs, attempt to resolve the function call down
@@ -10422,13 +10660,41 @@ ExprResult Sema::BuildOverloadedCallExpr(Scope *S, Expr *Fn,
   OverloadCandidateSet CandidateSet(Fn->getExprLoc());
   ExprResult result;
 
+  // Use the function that the same call resolved to before, if any.
+  llvm::FoldingSetNodeID CacheKey;
+  bool Cacheable = false;
+  OverloadCandidateSet::iterator Best;
+  if (OverloadCache) {
+    Cacheable = !ExecConfig && !ULE->hasExplicitTemplateArgs() &&
+                profileOverloadedCall(*this, CacheKey, /*Kind=*/0,
+                                      ULE->decls_begin(), ULE->decls_end(),
+                                      ULE->getName(), ULE->requiresADL(),
+                                      /*Operator=*/false, ULE->getExprLoc(),
+                                      Args);
+    // FixOverloadedFunctionReference tells the reference to the function
+    // whether it had multiple candidates, from the lookup result.
+    if (!Cacheable)
+      OverloadCache->noteUncacheableCall();
+    else if (resolveToCachedFunction(*this, CacheKey, Args,
+                                     /*Operator=*/false, Fn->getLocStart(),
+                                     CandidateSet, Best,
+                                     /*HadMultipleCandidates=*/0))
+      return FinishOverloadedCallExpr(*this, S, Fn, ULE, LParenLoc, Args,
+                                      RParenLoc, ExecConfig, &CandidateSet,
+                                      &Best, OR_Success,
+                                      AllowTypoCorrection);
+  }
+
+  OverloadResolutionCacheGuard CacheGuard(*this);
   if (buildOverloadedCallSet(S, Fn, ULE, Args, LParenLoc, &CandidateSet,
                              &result))
     return result;
 
-  OverloadCandidateSet::iterator Best;
   OverloadingResult OverloadResult =
       CandidateSet.BestViableFunction(*this, Fn->getLocStart(), Best);
+  if (Cacheable && OverloadResult == OR_Success &&
+      CacheGuard.dependedOnlyOnKey())
+    cacheOverloadResolution(*this, CacheKey, Args, CandidateSet, Best);
 
   return FinishOverloadedCallExpr(*this, S, Fn, ULE, LParenLoc, Args,
                                   RParenLoc, ExecConfig, &CandidateSet,
@@ -10725,27 +10991,56 @@ Sema::CreateOverloadedBinOp(SourceLocation OpLoc,
 
   // Build an empty overload set.
   OverloadCandidateSet CandidateSet(OpLoc);
+  OverloadCandidateSet::iterator Best;
+  OverloadingResult OverloadResult;
+  bool HadMultipleCandidates;
+
+  // Use the operator function that the same operation resolved to before,
+  // if any. The member operator candidates are those of the class of the
+  // first argument, which is complete if the operation has a key.
+  llvm::FoldingSetNodeID CacheKey;
+  bool Cacheable = false;
+  if (OverloadCache) {
+    Cacheable = profileOverloadedCall(*this, CacheKey, /*Kind=*/1 + Opc,
+                                      Fns.begin(), Fns.end(), OpName,
+                                      /*PerformADL=*/true, /*Operator=*/true,
+                                      OpLoc, Args);
+    if (!Cacheable)
+      OverloadCache->noteUncacheableCall();
+  }
+
+  if (Cacheable &&
+      resolveToCachedFunction(*this, CacheKey, Args, /*Operator=*/true, OpLoc,
+                              CandidateSet, Best, &HadMultipleCandidates)) {
+    OverloadResult = OR_Success;
+  } else {
+    OverloadResolutionCacheGuard CacheGuard(*this);
 
-  // Add the candidates from the given function set.
-  AddFunctionCandidates(Fns, Args, CandidateSet, false);
+    // Add the candidates from the given function set.
+    AddFunctionCandidates(Fns, Args, CandidateSet, false);
 
-  // Add operator candidates that are member functions.
-  AddMemberOperatorCandidates(Op, OpLoc, Args, CandidateSet);
+    // Add operator candidates that are member functions.
+    AddMemberOperatorCandidates(Op, OpLoc, Args, CandidateSet);
 
-  // Add candidates from ADL.
-  AddArgumentDependentLookupCandidates(OpName, /*Operator*/ true,
-                                       OpLoc, Args,
-                                       /*ExplicitTemplateArgs*/ 0,
-                                       CandidateSet);
+    // Add candidates from ADL.
+    AddArgumentDependentLookupCandidates(OpName, /*Operator*/ true,
+                                         OpLoc, Args,
+                                         /*ExplicitTemplateArgs*/ 0,
+                                         CandidateSet);
 
-  // Add builtin operator candidates.
-  AddBuiltinOperatorCandidates(Op, OpLoc, Args, CandidateSet);
+    // Add builtin operator candidates.
+    AddBuiltinOperatorCandidates(Op, OpLoc, Args, CandidateSet);
 
-  bool HadMultipleCandidates = (CandidateSet.size() > 1);
+    HadMultipleCandidates = (CandidateSet.size() > 1);
 
-  // Perform overload resolution.
-  OverloadCandidateSet::iterator Best;
-  switch (CandidateSet.BestViableFunction(*this, OpLoc, Best)) {
+    // Perform overload resolution.
+    OverloadResult = CandidateSet.BestViableFunction(*this, OpLoc, Best);
+    if (Cacheable && OverloadResult == OR_Success &&
+        CacheGuard.dependedOnlyOnKey())
+      cacheOverloadResolution(*this, CacheKey, Args, CandidateSet, Best);
+  }
+
+  switch (OverloadResult) {
     case OR_Success: {
       // We found a built-in operator or an overloaded operator.
       FunctionDecl *FnDecl = Best->Function;
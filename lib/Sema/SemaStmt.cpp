@@ -1591,10 +1591,14 @@ Sema::ActOnForStmt(SourceLocation ForLoc, SourceLocation LParenLoc,
   if (isa<NullStmt>(Body))
     getCurCompoundScope().setHasEmptyLoopBodies();
 
-  return Owned(new (Context) ForStmt(Context, First,
-                                     SecondResult.take(), ConditionVar,
-                                     Third, Body, ForLoc, LParenLoc,
-                                     RParenLoc));
+  ForStmt *Result = new (Context) ForStmt(Context, First,
+                                          SecondResult.take(), ConditionVar,
+                                          Third, Body, ForLoc, LParenLoc,
+                                          RParenLoc);
+  if (getLangOpts().CilkPlus)
+    ActOnCilkSpawnLoop(Result);
+
+  return Owned(Result);
 }
 
 /// In an Objective C collection iteration statement:
@@ -18,6 +18,7 @@
 #include "clang/AST/Expr.h"
 #include "clang/AST/ExprCXX.h"
 #include "clang/AST/TypeLoc.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/Lookup.h"
 #include "clang/Sema/PrettyDeclStackTrace.h"
@@ -2306,7 +2307,16 @@ Decl *TemplateDeclInstantiator::VisitCilkSpawnDecl(CilkSpawnDecl *D) {
   VarDecl *VD = D->getReceiverDecl();
   assert(VD && "Cilk spawn receiver expected");
   Decl *NewDecl = SemaRef.SubstDecl(VD, Owner, TemplateArgs);
-  return SemaRef.BuildCilkSpawnDecl(NewDecl);
+  CilkSpawnDecl *Spawn = SemaRef.BuildCilkSpawnDecl(NewDecl);
+  if (!Spawn)
+    return 0;
+
+  ExprResult Priority;
+  if (Expr *E = D->getDependentPriority())
+    Priority = SemaRef.SubstExpr(E, TemplateArgs);
+  if (SemaRef.SubstCilkSpawnPriority(D, Spawn, Priority))
+    Spawn->setInvalidDecl();
+  return Spawn;
 }
 
 Decl *TemplateDeclInstantiator::VisitFunctionDecl(FunctionDecl *D) {
@@ -3359,6 +3369,11 @@ void Sema::InstantiateFunctionDefinition(SourceLocation PointOfInstantiation,
   if (Inst.isInvalid())
     return;
 
+  std::string TraceDetail;
+  if (isTimeTraceEnabled())
+    TraceDetail = Function->getQualifiedNameAsString();
+  TimeTraceScope TraceScope("InstantiateFunction", TraceDetail);
+
   // Copy the inner loc start from the pattern.
   Function->setInnerLocStart(PatternDecl->getInnerLocStart());
 
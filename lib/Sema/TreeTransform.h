@@ -9730,7 +9730,18 @@ TreeTransform<Derived>::TransformCilkSpawnExpr(CilkSpawnExpr *E) {
   if (NewSpawn.isInvalid())
     return ExprError();
 
-  return getSema().BuildCilkSpawnExpr(NewSpawn.get());
+  ExprResult Res = getSema().BuildCilkSpawnExpr(NewSpawn.get());
+  if (Res.isInvalid())
+    return ExprError();
+
+  CilkSpawnDecl *Pattern = E->getSpawnDecl();
+  ExprResult Priority;
+  if (Expr *P = Pattern->getDependentPriority())
+    Priority = getDerived().TransformExpr(P);
+  if (getSema().SubstCilkSpawnPriority(
+          Pattern, cast<CilkSpawnExpr>(Res.get())->getSpawnDecl(), Priority))
+    return ExprError();
+  return Res;
 }
 
 template<typename Derived>
@@ -10315,6 +10326,10 @@ TreeTransform<Derived>::TransformCilkForStmt(CilkForStmt *S) {
     return StmtError();
   }
 
+  if (S->hasAffinity())
+    return getSema().ActOnCilkForAffinityPragma(Result.take(),
+                                                S->getAffinityLoc());
+
   return Result;
 }
 
@@ -0,0 +1,206 @@
+//===--- ASTAccessProfile.cpp - Prefetching of AST files --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ASTAccessProfile and ASTPrefetcher classes.
+//
+//===----------------------------------------------------------------------===//
+#include "ASTAccessProfile.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Serialization/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace serialization;
+
+bool ASTAccessProfile::read(StringRef Path) {
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(Path, Buffer))
+    return false;
+
+  FileProfile *Current = 0;
+  StringRef Rest = Buffer->getBuffer();
+  while (!Rest.empty()) {
+    StringRef Line;
+    llvm::tie(Line, Rest) = Rest.split('\n');
+
+    if (Line.startswith("file ")) {
+      StringRef Size, ModTime, Name;
+      llvm::tie(Size, Line) = Line.substr(5).split(' ');
+      llvm::tie(ModTime, Name) = Line.split(' ');
+      unsigned long long SizeValue, ModTimeValue;
+      Current = 0;
+      if (Size.getAsInteger(10, SizeValue) ||
+          ModTime.getAsInteger(10, ModTimeValue) || Name.empty())
+        continue;
+
+      Current = &Files[Name];
+      Current->Size = SizeValue;
+      Current->ModTime = ModTimeValue;
+      Current->Ranges.clear();
+      continue;
+    }
+
+    StringRef First, Last;
+    llvm::tie(First, Last) = Line.split('-');
+    unsigned FirstBlock, LastBlock;
+    if (!Current || First.getAsInteger(10, FirstBlock) ||
+        Last.getAsInteger(10, LastBlock) || LastBlock < FirstBlock)
+      continue;
+    Current->Ranges.push_back(std::make_pair(FirstBlock, LastBlock));
+  }
+  return true;
+}
+
+const ASTAccessProfile::FileProfile *
+ASTAccessProfile::lookup(const ModuleFile &M) const {
+  if (!M.File)
+    return 0;
+
+  llvm::StringMap<FileProfile>::const_iterator Known = Files.find(M.FileName);
+  if (Known == Files.end() || Known->second.Size != M.File->getSize() ||
+      Known->second.ModTime != M.File->getModificationTime())
+    return 0;
+  return &Known->second;
+}
+
+void ASTAccessProfile::add(const ModuleFile &M) {
+  if (M.AccessedBlocks.empty() || !M.File)
+    return;
+
+  FileProfile &Profile = Files[M.FileName];
+  Profile.Size = M.File->getSize();
+  Profile.ModTime = M.File->getModificationTime();
+  Profile.Ranges.clear();
+
+  const llvm::BitVector &Blocks = M.AccessedBlocks;
+  int First = Blocks.find_first();
+  while (First != -1) {
+    int Last = First;
+    int Next = Blocks.find_next(Last);
+    while (Next == Last + 1) {
+      Last = Next;
+      Next = Blocks.find_next(Last);
+    }
+    Profile.Ranges.push_back(std::make_pair(unsigned(First), unsigned(Last)));
+    First = Next;
+  }
+}
+
+llvm::error_code ASTAccessProfile::write(StringRef Path) const {
+  SmallString<128> TmpPath;
+  int TmpFD;
+  if (llvm::error_code EC =
+        llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", TmpFD, TmpPath))
+    return EC;
+
+  bool Failed;
+  {
+    llvm::raw_fd_ostream Out(TmpFD, /*shouldClose=*/true);
+    for (llvm::StringMap<FileProfile>::const_iterator I = Files.begin(),
+                                                      E = Files.end();
+         I != E; ++I) {
+      const FileProfile &Profile = I->second;
+      Out << "file " << (unsigned long long)Profile.Size << ' '
+          << (unsigned long long)Profile.ModTime << ' ' << I->getKey() << '\n';
+      for (unsigned R = 0, N = Profile.Ranges.size(); R != N; ++R)
+        Out << Profile.Ranges[R].first << '-' << Profile.Ranges[R].second
+            << '\n';
+    }
+    Out.close();
+    Failed = Out.has_error();
+    Out.clear_error();
+  }
+
+  bool Existed;
+  if (Failed) {
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    return llvm::make_error_code(llvm::errc::io_error);
+  }
+  if (llvm::error_code EC = llvm::sys::fs::rename(TmpPath.str(), Path)) {
+    llvm::sys::fs::remove(TmpPath.str(), Existed);
+    return EC;
+  }
+  return llvm::error_code::success();
+}
+
+ASTPrefetcher::ASTPrefetcher()
+  : Stopping(false), NumBlocksRead(0), Thread(1, /*Background=*/true) { }
+
+ASTPrefetcher::~ASTPrefetcher() {
+  stop();
+  llvm::DeleteContainerPointers(Jobs);
+}
+
+void ASTPrefetcher::prefetch(const llvm::MemoryBuffer &Buffer,
+                             const ASTAccessProfile::FileProfile &Profile) {
+  // Without a background thread the blocks would be read before the AST
+  // reader gets to do anything else, which only delays it.
+  if (!Thread.runsInBackground())
+    return;
+
+  Job *J = new Job;
+  J->Prefetcher = this;
+  J->Start = Buffer.getBufferStart();
+  J->Size = Buffer.getBufferSize();
+  J->Ranges = Profile.Ranges;
+  Jobs.push_back(J);
+  Thread.async(&ASTPrefetcher::run, J);
+}
+
+void ASTPrefetcher::stop() {
+  {
+    llvm::sys::ScopedLock Guard(Lock);
+    Stopping = true;
+  }
+  Thread.wait();
+}
+
+bool ASTPrefetcher::isStopping() {
+  llvm::sys::ScopedLock Guard(Lock);
+  return Stopping;
+}
+
+unsigned ASTPrefetcher::getNumBlocksRead() {
+  Thread.wait();
+  llvm::sys::ScopedLock Guard(Lock);
+  return NumBlocksRead;
+}
+
+void ASTPrefetcher::run(void *Data) {
+  Job *J = static_cast<Job *>(Data);
+  const uint64_t BlockSize = ModuleFile::AccessBlockSize;
+
+  // Reading one byte of a block makes the OS read in its page, if the file
+  // is mapped. Check now and then whether the reader is done.
+  unsigned NumRead = 0;
+  char Sum = 0;
+  bool Stopped = false;
+  for (unsigned I = 0, N = J->Ranges.size(); I != N && !Stopped; ++I) {
+    for (uint64_t Block = J->Ranges[I].first; Block <= J->Ranges[I].second;
+         ++Block) {
+      if (Block * BlockSize >= J->Size)
+        break;
+      if (NumRead % 16 == 0 && J->Prefetcher->isStopping()) {
+        Stopped = true;
+        break;
+      }
+      Sum += *static_cast<const volatile char *>(J->Start + Block * BlockSize);
+      ++NumRead;
+    }
+  }
+  (void)Sum;
+
+  llvm::sys::ScopedLock Guard(J->Prefetcher->Lock);
+  J->Prefetcher->NumBlocksRead += NumRead;
+}
@@ -0,0 +1,134 @@
+//===--- ASTAccessProfile.h - Prefetching of AST files ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ASTAccessProfile class, which records the parts of
+//  the AST files that a compilation read, and the ASTPrefetcher class, which
+//  reads those parts ahead of the AST reader in a later compilation.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_CLANG_SERIALIZATION_ASTACCESSPROFILE_H
+#define LLVM_CLANG_SERIALIZATION_ASTACCESSPROFILE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/ThreadPool.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/system_error.h"
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+  class MemoryBuffer;
+}
+
+namespace clang {
+namespace serialization {
+
+class ModuleFile;
+
+/// \brief The parts of a set of AST files that one compilation read.
+///
+/// The profile is a text file that lists, for each AST file, its size,
+/// modification time and name, followed by the inclusive ranges of the
+/// blocks of ModuleFile::AccessBlockSize bytes that were read, e.g.
+///
+/// \code
+/// file 1048576 1381234567 /path/to/prefix.pch
+/// 0-3
+/// 17-17
+/// \endcode
+class ASTAccessProfile {
+public:
+  /// \brief The blocks of one AST file that were read.
+  struct FileProfile {
+    off_t Size;
+    time_t ModTime;
+    std::vector<std::pair<unsigned, unsigned> > Ranges;
+
+    FileProfile() : Size(0), ModTime(0) { }
+  };
+
+private:
+  llvm::StringMap<FileProfile> Files;
+
+public:
+  /// \brief Read the profile in the file \p Path.
+  ///
+  /// \returns false if there is no such file. Lines that can't be parsed
+  /// are ignored, since a profile only affects performance.
+  bool read(StringRef Path);
+
+  /// \brief Find the blocks of the AST file \p M that were read, provided
+  /// that the file hasn't changed since.
+  const FileProfile *lookup(const ModuleFile &M) const;
+
+  /// \brief Add the blocks of \p M that the AST reader noted were read.
+  void add(const ModuleFile &M);
+
+  /// \brief Write the profile to the file \p Path, replacing it atomically,
+  /// since other compilations may be reading it.
+  llvm::error_code write(StringRef Path) const;
+};
+
+/// \brief Reads the blocks of AST files that an access profile lists on a
+/// background thread, so that the pages of AST files that are mapped into
+/// memory are already loaded when the AST reader gets to them.
+class ASTPrefetcher {
+  struct Job {
+    ASTPrefetcher *Prefetcher;
+    const char *Start;
+    size_t Size;
+    std::vector<std::pair<unsigned, unsigned> > Ranges;
+  };
+
+  std::vector<Job *> Jobs;
+
+  llvm::sys::Mutex Lock;
+
+  /// \brief Whether the remaining blocks are no longer needed.
+  bool Stopping;
+
+  /// \brief The number of blocks that were read.
+  unsigned NumBlocksRead;
+
+  /// \brief The thread that reads the blocks, which is stopped before the
+  /// jobs are freed.
+  ThreadPool Thread;
+
+  static void run(void *Data);
+
+  bool isStopping();
+
+  ASTPrefetcher(const ASTPrefetcher &) LLVM_DELETED_FUNCTION;
+  void operator=(const ASTPrefetcher &) LLVM_DELETED_FUNCTION;
+
+public:
+  ASTPrefetcher();
+  ~ASTPrefetcher();
+
+  /// \brief Queue the blocks of \p Buffer that \p Profile lists.
+  ///
+  /// The buffer must outlive the prefetcher, or the call to stop().
+  void prefetch(const llvm::MemoryBuffer &Buffer,
+                const ASTAccessProfile::FileProfile &Profile);
+
+  /// \brief Give up on the blocks that haven't been read yet, and wait for
+  /// the thread to finish.
+  void stop();
+
+  /// \brief The number of blocks read, once the queued blocks have been
+  /// read or given up on.
+  unsigned getNumBlocksRead();
+};
+
+} // end namespace serialization
+} // end namespace clang
+
+#endif
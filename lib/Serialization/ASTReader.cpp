@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Serialization/ASTReader.h"
+#include "ASTAccessProfile.h"
 #include "ASTCommon.h"
 #include "ASTReaderInternals.h"
 #include "clang/AST/ASTConsumer.h"
@@ -491,6 +492,7 @@ IdentifierInfo *ASTIdentifierLookupTrait::ReadData(const internal_key_type& k,
                                                    const unsigned char* d,
                                                    unsigned DataLen) {
   using namespace clang::io;
+  F.noteDataAccess(d);
   unsigned RawID = ReadUnalignedLE32(d);
   bool IsInteresting = RawID & 0x01;
 
@@ -709,6 +711,7 @@ ASTDeclContextNameLookupTrait::ReadData(internal_key_type,
                                         const unsigned char* d,
                                         unsigned DataLen) {
   using namespace clang::io;
+  F.noteDataAccess(d);
   unsigned NumDecls = ReadUnalignedLE16(d);
   LE32DeclID *Start = reinterpret_cast<LE32DeclID *>(
                         const_cast<unsigned char *>(d));
@@ -947,9 +950,21 @@ bool ASTReader::ReadSLocEntry(int ID) {
     // We will detect whether a file changed and return 'Failure' for it, but
     // we will also try to fail gracefully by setting up the SLocEntry.
     unsigned InputID = Record[4];
-    InputFile IF = getInputFile(*F, InputID);
-    const FileEntry *File = IF.getFile();
-    bool OverriddenBuffer = IF.isOverridden();
+    SourceLocation IncludeLoc = ReadSourceLocation(*F, Record[1]);
+    const FileEntry *File = 0;
+    bool OverriddenBuffer = false;
+    const std::string &PreambleMainFile
+      = PP.getPreprocessorOpts().PrecompiledPreambleMainFile;
+    if (F->Kind == MK_Preamble && IncludeLoc.isInvalid() &&
+        !PreambleMainFile.empty()) {
+      // The main file of a precompiled preamble is the main file of the
+      // translation unit, which may not be the file it was built for.
+      File = FileMgr.getFile(PreambleMainFile);
+    } else {
+      InputFile IF = getInputFile(*F, InputID);
+      File = IF.getFile();
+      OverriddenBuffer = IF.isOverridden();
+    }
 
     // Note that we only check if a File was returned. If it was out-of-date
     // we have complained but we will continue creating a FileID to recover
@@ -957,7 +972,6 @@ bool ASTReader::ReadSLocEntry(int ID) {
     if (!File)
       return true;
 
-    SourceLocation IncludeLoc = ReadSourceLocation(*F, Record[1]);
     if (IncludeLoc.isInvalid() && F->Kind != MK_MainFile) {
       // This is the module's main file.
       IncludeLoc = getImportLocation(F);
@@ -968,7 +982,7 @@ bool ASTReader::ReadSLocEntry(int ID) {
                                         ID, BaseOffset + Record[0]);
     SrcMgr::FileInfo &FileInfo =
           const_cast<SrcMgr::FileInfo&>(SourceMgr.getSLocEntry(FID).getFile());
-    FileInfo.NumCreatedFIDs = Record[5];
+    SourceMgr.setNumCreatedFIDsForFileID(FID, Record[5]);
     if (Record[3])
       FileInfo.setHasLineDirectives();
 
@@ -2242,6 +2256,17 @@ bool ASTReader::ReadASTBlock(ModuleFile &F) {
         ExternalDefinitions.push_back(getGlobalDeclID(F, Record[I]));
       break;
 
+    case PCH_CODEGEN_DECLS:
+      for (unsigned I = 0, N = Record.size(); I != N; ++I) {
+        serialization::DeclID ID = getGlobalDeclID(F, Record[I]);
+        // Compiling the AST file itself generates the code of all of them.
+        bool ThisObject = F.Kind == MK_MainFile;
+        PCHCodegenDecls[ID] = ThisObject;
+        if (ThisObject)
+          ExternalDefinitions.push_back(ID);
+      }
+      break;
+
     case SPECIAL_TYPES:
       if (SpecialTypes.empty()) {
         for (unsigned I = 0, N = Record.size(); I != N; ++I)
@@ -2936,6 +2961,9 @@ ASTReader::ASTReadResult ASTReader::ReadAST(const std::string &FileName,
     break;
   }
 
+  if (!AccessProfilePath.empty())
+    startPrefetching(Loaded);
+
   // Here comes stuff that we only do once the entire chain is loaded.
 
   // Load the AST blocks of all of the modules that we loaded.
@@ -3060,6 +3088,51 @@ ASTReader::ASTReadResult ASTReader::ReadAST(const std::string &FileName,
   return Success;
 }
 
+/// \brief Start recording which parts of the newly-loaded AST files are read,
+/// and prefetch the parts that the access profile says an earlier
+/// compilation read.
+void ASTReader::startPrefetching(SmallVectorImpl<ImportedModule> &Loaded) {
+  ASTAccessProfile Profile;
+  bool HaveProfile = Profile.read(AccessProfilePath);
+
+  const unsigned BlockSize = ModuleFile::AccessBlockSize;
+  for (unsigned I = 0, N = Loaded.size(); I != N; ++I) {
+    ModuleFile &F = *Loaded[I].Mod;
+    F.AccessedBlocks.resize(
+        (F.Buffer->getBufferSize() + BlockSize - 1) / BlockSize);
+
+    if (!HaveProfile)
+      continue;
+    if (const ASTAccessProfile::FileProfile *FP = Profile.lookup(F)) {
+      if (!Prefetcher)
+        Prefetcher.reset(new ASTPrefetcher);
+      Prefetcher->prefetch(*F.Buffer, *FP);
+    }
+  }
+}
+
+void ASTReader::finishAccessProfile() {
+  if (AccessProfilePath.empty())
+    return;
+
+  if (Prefetcher)
+    Prefetcher->stop();
+
+  // Start from the existing profile, so that the AST files that this
+  // translation unit didn't load keep their entries.
+  ASTAccessProfile Profile;
+  Profile.read(AccessProfilePath);
+  for (ModuleManager::ModuleIterator M = ModuleMgr.begin(),
+                                     MEnd = ModuleMgr.end();
+       M != MEnd; ++M)
+    Profile.add(**M);
+
+  if (llvm::error_code EC = Profile.write(AccessProfilePath))
+    Diag(diag::warn_pch_access_profile_write_failure)
+      << AccessProfilePath << EC.message();
+  AccessProfilePath.clear();
+}
+
 ASTReader::ASTReadResult
 ASTReader::ReadASTCore(StringRef FileName,
                        ModuleKind Type,
@@ -4504,6 +4577,7 @@ QualType ASTReader::readTypeRecord(unsigned Index) {
   Deserializing AType(this);
 
   unsigned Idx = 0;
+  Loc.F->noteBitAccess(Loc.Offset);
   DeclsCursor.JumpToBit(Loc.Offset);
   RecordData Record;
   unsigned Code = DeclsCursor.ReadCode();
@@ -5544,6 +5618,7 @@ Stmt *ASTReader::GetExternalDeclStmt(uint64_t Offset) {
 
   // Offset here is a global offset across the entire chain.
   RecordLocation Loc = getLocalBitOffset(Offset);
+  Loc.F->noteBitAccess(Loc.Offset);
   Loc.F->DeclsCursor.JumpToBit(Loc.Offset);
   return ReadStmtFromStream(*Loc.F);
 }
@@ -5965,6 +6040,18 @@ void ASTReader::StartTranslationUnit(ASTConsumer *Consumer) {
   PassInterestingDeclsToConsumer();
 }
 
+ExternalASTSource::CodeLocation
+ASTReader::getCodeLocation(const FunctionDecl *FD) {
+  const FunctionDecl *Canon = FD->getCanonicalDecl();
+  if (PCHCodegenDecls.empty() || !Canon->isFromASTFile())
+    return CL_Default;
+  llvm::DenseMap<serialization::DeclID, bool>::const_iterator I
+    = PCHCodegenDecls.find(Canon->getGlobalID());
+  if (I == PCHCodegenDecls.end())
+    return CL_Default;
+  return I->second ? CL_ThisObject : CL_OtherObject;
+}
+
 void ASTReader::PrintStats() {
   std::fprintf(stderr, "*** AST File Statistics:\n");
 
@@ -6054,6 +6141,18 @@ void ASTReader::PrintStats() {
                  (double)NumIdentifierLookupHits*100.0/NumIdentifierLookups);
   }
 
+  if (NumLazyRedeclChains) {
+    std::fprintf(stderr,
+                 "  %u/%u lazy redeclaration chains loaded (%f%%)\n",
+                 NumLazyRedeclChainsLoaded, NumLazyRedeclChains,
+                 ((float)NumLazyRedeclChainsLoaded/NumLazyRedeclChains
+                  * 100));
+  }
+  if (Prefetcher) {
+    std::fprintf(stderr, "  %u AST file blocks prefetched\n",
+                 Prefetcher->getNumBlocksRead());
+  }
+
   if (GlobalIndex) {
     std::fprintf(stderr, "\n");
     GlobalIndex->printStats();
@@ -7361,12 +7460,32 @@ void ASTReader::finishPendingActions() {
       SetGloballyVisibleDecls(II, DeclIDs, &TopLevelDecls[II]);
     }
   
-    // Load pending declaration chains.
+    // The chains of the top-level declarations are needed to push the most
+    // recent declarations into scope.
+    if (LazyRedeclChains) {
+      for (TopLevelDeclsMap::iterator TLD = TopLevelDecls.begin(),
+             TLDEnd = TopLevelDecls.end(); TLD != TLDEnd; ++TLD) {
+        for (unsigned I = 0, N = TLD->second.size(); I != N; ++I) {
+          Decl *Canon = TLD->second[I]->getCanonicalDecl();
+          if (Canon->isFromASTFile())
+            PendingDeclChainsNeeded.insert(Canon->getGlobalID());
+        }
+      }
+    }
+
+    // Load pending declaration chains, or leave them to be loaded when they
+    // are needed.
     for (unsigned I = 0; I != PendingDeclChains.size(); ++I) {
-      loadPendingDeclChain(PendingDeclChains[I]);
+      if (canDeferDeclChain(PendingDeclChains[I])) {
+        GetDecl(PendingDeclChains[I])->LazyRedeclChain = true;
+        ++NumLazyRedeclChains;
+      } else {
+        loadPendingDeclChain(PendingDeclChains[I]);
+      }
       PendingDeclChainsKnown.erase(PendingDeclChains[I]);
     }
     PendingDeclChains.clear();
+    PendingDeclChainsNeeded.clear();
 
     // Make the most recent of the top-level declarations visible.
     for (TopLevelDeclsMap::iterator TLD = TopLevelDecls.begin(),
@@ -7571,6 +7690,25 @@ void ASTReader::FinishedDeserializing() {
   }
 }
 
+void ASTReader::CompleteRedeclChain(const Decl *D) {
+  if (!D->LazyRedeclChain)
+    return;
+
+  serialization::GlobalDeclID ID = D->getGlobalID();
+
+  // While a declaration is being read, the chains aren't complete anyway;
+  // load this one with the other pending chains.
+  if (NumCurrentElementsDeserializing) {
+    if (PendingDeclChainsKnown.insert(ID))
+      PendingDeclChains.push_back(ID);
+    PendingDeclChainsNeeded.insert(ID);
+    return;
+  }
+
+  Deserializing AChain(this);
+  loadPendingDeclChain(ID);
+}
+
 void ASTReader::pushExternalDeclIntoScope(NamedDecl *D, DeclarationName Name) {
   D = D->getMostRecentDecl();
 
@@ -7608,12 +7746,19 @@ ASTReader::ASTReader(Preprocessor &PP, ASTContext &Context,
     NumVisibleDeclContextsRead(0), TotalVisibleDeclContexts(0),
     TotalModulesSizeInBits(0), NumCurrentElementsDeserializing(0),
     PassingDeclsToConsumer(false),
-    NumCXXBaseSpecifiersLoaded(0), ReadingKind(Read_None)
+    NumCXXBaseSpecifiersLoaded(0),
+    LazyRedeclChains(PP.getPreprocessorOpts().LazyPCHRedeclChains),
+    NumLazyRedeclChains(0), NumLazyRedeclChainsLoaded(0),
+    AccessProfilePath(PP.getPreprocessorOpts().PCHAccessProfile),
+    ReadingKind(Read_None)
 {
   SourceMgr.setExternalSLocEntrySource(this);
 }
 
 ASTReader::~ASTReader() {
+  // Stop reading the AST files before they are freed.
+  Prefetcher.reset();
+
   for (DeclContextVisibleUpdatesPending::iterator
            I = PendingVisibleUpdates.begin(),
            E = PendingVisibleUpdates.end();
@@ -1824,6 +1824,13 @@ ASTDeclReader::VisitRedeclarable(Redeclarable<T> *D) {
     // which is the one that matters and mark the real previous DeclID to be
     // loaded & attached later on.
     D->RedeclLink = Redeclarable<T>::PreviousDeclLink(FirstDecl);
+
+    // This declaration can be found without its first declaration, so the
+    // chain must be hooked up before it is handed out, even if it was left
+    // to be loaded when it is needed.
+    Reader.PendingDeclChainsNeeded.insert(FirstDeclID);
+    if (FirstDecl->LazyRedeclChain)
+      Reader.CompleteRedeclChain(FirstDecl);
   }    
   
   // Note that this declaration has been deserialized.
@@ -2368,6 +2375,7 @@ Decl *ASTReader::ReadDeclRecord(DeclID ID) {
   // Note that we are loading a declaration record.
   Deserializing ADecl(this);
 
+  Loc.F->noteBitAccess(Loc.Offset);
   DeclsCursor.JumpToBit(Loc.Offset);
   RecordData Record;
   unsigned Code = DeclsCursor.ReadCode();
@@ -2767,6 +2775,12 @@ namespace {
 void ASTReader::loadPendingDeclChain(serialization::GlobalDeclID ID) {
   Decl *D = GetDecl(ID);  
   Decl *CanonDecl = D->getCanonicalDecl();
+
+  // The chain is loaded now, even if it was left to be loaded when needed.
+  if (CanonDecl->LazyRedeclChain) {
+    CanonDecl->LazyRedeclChain = false;
+    ++NumLazyRedeclChainsLoaded;
+  }
   
   // Determine the set of declaration IDs we'll be searching for.
   SmallVector<DeclID, 1> SearchDecls;
@@ -2801,6 +2815,39 @@ void ASTReader::loadPendingDeclChain(serialization::GlobalDeclID ID) {
   ASTDeclReader::attachLatestDecl(CanonDecl, MostRecent);  
 }
 
+/// \brief Determine whether the redeclaration chain of the declaration with
+/// the given ID can be left to be loaded when it is needed.
+///
+/// Only chains of which nothing but the first declaration has been read can
+/// be deferred, since the other declarations would not be linked into the
+/// chain otherwise.
+bool ASTReader::canDeferDeclChain(serialization::GlobalDeclID ID) {
+  // Modules merge declarations into chains, and an AST writer that chains
+  // onto this reader needs the complete chains.
+  if (!LazyRedeclChains || Context.getLangOpts().Modules ||
+      DeserializationListener)
+    return false;
+
+  if (PendingDeclChainsNeeded.count(ID))
+    return false;
+
+  Decl *D = GetDecl(ID);
+  Decl *CanonDecl = D->getCanonicalDecl();
+  if (D != CanonDecl)
+    return false;
+
+  // The declarations of a tag, an Objective-C class or a protocol share the
+  // data of its definition, which only reaches the first declaration when
+  // the definition is read; hasDefinition() and data() would miss it.
+  if (isa<TagDecl>(CanonDecl) || isa<ObjCInterfaceDecl>(CanonDecl) ||
+      isa<ObjCProtocolDecl>(CanonDecl))
+    return false;
+
+  // The redeclarations are pointed at the definition once the chain is
+  // loaded.
+  return !PendingDefinitions.count(CanonDecl);
+}
+
 namespace {
   struct CompareObjCCategoriesInfo {
     bool operator()(const ObjCCategoriesInfo &X, DeclID Y) {
@@ -244,6 +244,7 @@ void ASTStmtReader::VisitForStmt(ForStmt *S) {
   S->setForLoc(ReadSourceLocation(Record, Idx));
   S->setLParenLoc(ReadSourceLocation(Record, Idx));
   S->setRParenLoc(ReadSourceLocation(Record, Idx));
+  S->setSpawnLoopCount(Reader.ReadSubExpr());
 }
 
 void ASTStmtReader::VisitGotoStmt(GotoStmt *S) {
@@ -1884,6 +1885,22 @@ Expr *ASTReader::ReadSubExpr() {
   return cast_or_null<Expr>(ReadSubStmt());
 }
 
+namespace {
+  /// \brief RAII object that allocates the statements read from an AST file
+  /// in the ASTContext's own allocator, since they are not part of the
+  /// function body being parsed, if any.
+  class FunctionBodyArenaSuspension {
+    ASTContext &Context;
+
+  public:
+    explicit FunctionBodyArenaSuspension(ASTContext &Context)
+      : Context(Context) {
+      Context.suspendFunctionBodyArena();
+    }
+    ~FunctionBodyArenaSuspension() { Context.resumeFunctionBodyArena(); }
+  };
+}
+
 // Within the bitstream, expressions are stored in Reverse Polish
 // Notation, with each of the subexpressions preceding the
 // expression they are stored in. Subexpressions are stored from last to first.
@@ -1894,6 +1911,7 @@ Expr *ASTReader::ReadSubExpr() {
 Stmt *ASTReader::ReadStmtFromStream(ModuleFile &F) {
 
   ReadingKindTracker ReadingKind(Read_Stmt, *this);
+  FunctionBodyArenaSuspension SuspendArena(Context);
   llvm::BitstreamCursor &Cursor = F.DeclsCursor;
   
   // Map of offset to previously deserialized stmt. The offset points
@@ -1824,6 +1824,15 @@ static bool isRequiredDecl(const Decl *D, ASTContext &Context) {
   return Context.DeclMustBeEmitted(D);
 }
 
+/// \brief Whether the code of \p FD is generated in the object file compiled
+/// from a PCH built with -fpch-codegen, rather than in every translation unit
+/// that uses it.
+static bool isGeneratedWithPCH(const FunctionDecl *FD) {
+  return FD->getTemplateSpecializationKind() == TSK_ImplicitInstantiation &&
+         FD->doesThisDeclarationHaveABody() &&
+         !FD->isDependentContext() && FD->isExternallyVisible();
+}
+
 void ASTWriter::WriteDecl(ASTContext &Context, Decl *D) {
   // Switch case IDs are per Decl.
   ClearSwitchCaseIDs();
@@ -1912,4 +1921,11 @@ void ASTWriter::WriteDecl(ASTContext &Context, Decl *D) {
   // FIXME: This should be renamed, the predicate is much more complicated.
   if (isRequiredDecl(D, Context))
     ExternalDefinitions.push_back(ID);
+
+  // Note the instantiations whose code is generated with the PCH. They are
+  // found by their canonical declaration.
+  if (Context.getLangOpts().PCHCodegen && !WritingModule)
+    if (FunctionDecl *FD = dyn_cast<FunctionDecl>(D))
+      if (isGeneratedWithPCH(FD))
+        PCHCodegenDecls.push_back(GetDeclRef(FD->getCanonicalDecl()));
 }
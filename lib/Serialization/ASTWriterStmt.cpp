@@ -171,6 +171,7 @@ void ASTStmtWriter::VisitForStmt(ForStmt *S) {
   Writer.AddSourceLocation(S->getForLoc(), Record);
   Writer.AddSourceLocation(S->getLParenLoc(), Record);
   Writer.AddSourceLocation(S->getRParenLoc(), Record);
+  Writer.AddStmt(S->getSpawnLoopCount());
   Code = serialization::STMT_FOR;
 }
 
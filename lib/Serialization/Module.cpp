@@ -72,6 +72,14 @@ dumpLocalRemap(StringRef Name,
   }
 }
 
+uint64_t ModuleFile::getBitOffset(const unsigned char *Data) const {
+  const char *Start = Buffer->getBufferStart();
+  assert(reinterpret_cast<const char *>(Data) >= Start &&
+         reinterpret_cast<const char *>(Data) <= Buffer->getBufferEnd() &&
+         "Data is not in the buffer of this file");
+  return uint64_t(reinterpret_cast<const char *>(Data) - Start) * 8;
+}
+
 void ModuleFile::dump() {
   llvm::errs() << "\nModule: " << FileName << "\n";
   if (!Imports.empty()) {
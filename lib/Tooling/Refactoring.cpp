@@ -109,8 +109,12 @@ void Replacement::setFromSourceLocation(SourceManager &Sources,
     // Make FilePath absolute so replacements can be applied correctly when
     // relative paths for files are used.
     llvm::SmallString<256> FilePath(Entry->getName());
-    llvm::error_code EC = llvm::sys::fs::make_absolute(FilePath);
-    this->FilePath = EC ? FilePath.c_str() : Entry->getName();
+    // Names of files found relative to the working directory of the
+    // FileManager, rather than the current directory, only make sense with it.
+    Sources.getFileManager().FixupRelativePath(FilePath);
+    llvm::SmallString<256> AbsolutePath(FilePath);
+    llvm::error_code EC = llvm::sys::fs::make_absolute(AbsolutePath);
+    this->FilePath = EC ? AbsolutePath.c_str() : FilePath.c_str();
   } else {
     this->FilePath = InvalidLocation;
   }
@@ -275,11 +279,69 @@ RefactoringTool::RefactoringTool(const CompilationDatabase &Compilations,
 
 Replacements &RefactoringTool::getReplacements() { return Replace; }
 
+RefactoringActionFactory::~RefactoringActionFactory() {}
+
 int RefactoringTool::runAndSave(FrontendActionFactory *ActionFactory) {
   if (int Result = run(ActionFactory)) {
     return Result;
   }
 
+  return applyAndSaveReplacements();
+}
+
+namespace {
+
+/// \brief The action created by a RefactoringActionFactory for one
+/// translation unit, and the replacements it found.
+class TranslationUnitRefactoringAction : public ToolAction {
+public:
+  Replacements Replace;
+  OwningPtr<ToolAction> Action;
+
+  explicit TranslationUnitRefactoringAction(RefactoringActionFactory &Factory)
+    : Action(Factory.create(Replace)) {}
+
+  virtual bool runInvocation(CompilerInvocation *Invocation, FileManager *Files,
+                             DiagnosticConsumer *DiagConsumer) {
+    return Action->runInvocation(Invocation, Files, DiagConsumer);
+  }
+};
+
+/// \brief Merges the replacements found in each translation unit into the
+/// replacements of the RefactoringTool.
+class ReplacementsMerger : public ToolActionFactory {
+  RefactoringActionFactory &Factory;
+  Replacements &Replace;
+
+public:
+  ReplacementsMerger(RefactoringActionFactory &Factory, Replacements &Replace)
+    : Factory(Factory), Replace(Replace) {}
+
+  virtual ToolAction *create() {
+    return new TranslationUnitRefactoringAction(Factory);
+  }
+
+  virtual void finish(ToolAction *Action, bool Succeeded) {
+    TranslationUnitRefactoringAction *TUAction =
+      static_cast<TranslationUnitRefactoringAction *>(Action);
+    Replace.insert(TUAction->Replace.begin(), TUAction->Replace.end());
+    delete TUAction;
+  }
+};
+
+}
+
+int RefactoringTool::runAndSaveInParallel(
+    RefactoringActionFactory *ActionFactory, unsigned NumThreads) {
+  ReplacementsMerger Merger(*ActionFactory, Replace);
+  if (int Result = runInParallel(&Merger, NumThreads)) {
+    return Result;
+  }
+
+  return applyAndSaveReplacements();
+}
+
+int RefactoringTool::applyAndSaveReplacements() {
   LangOptions DefaultLangOptions;
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
   TextDiagnosticPrinter DiagnosticPrinter(llvm::errs(), &*DiagOpts);
@@ -14,6 +14,7 @@
 
 #include "clang/Tooling/Tooling.h"
 #include "clang/AST/ASTConsumer.h"
+#include "clang/Basic/ThreadPool.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/Tool.h"
@@ -28,6 +29,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 
 // For chdir, see the comment in ClangTool::run for more information.
@@ -42,6 +44,12 @@ namespace tooling {
 
 ToolAction::~ToolAction() {}
 
+ToolActionFactory::~ToolActionFactory() {}
+
+void ToolActionFactory::finish(ToolAction *Action, bool Succeeded) {
+  delete Action;
+}
+
 FrontendActionFactory::~FrontendActionFactory() {}
 
 // FIXME: This file contains structural duplication with other parts of the
@@ -319,7 +327,9 @@ void ClangTool::clearArgumentsAdjusters() {
   ArgsAdjusters.clear();
 }
 
-int ClangTool::run(ToolAction *Action) {
+/// \brief Returns the path of the tool's executable, from which the driver
+/// finds the builtin headers.
+static std::string getMainExecutable() {
   // Exists solely for the purpose of lookup of the resource path.
   // This just needs to be some symbol in the binary.
   static int StaticSymbol;
@@ -328,8 +338,11 @@ int ClangTool::run(ToolAction *Action) {
   // FIXME: On linux, GetMainExecutable is independent of the value of the
   // first argument, thus allowing ClangTool and runToolOnCode to just
   // pass in made-up names here. Make sure this works on other platforms.
-  std::string MainExecutable =
-      llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+  return llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+}
+
+int ClangTool::run(ToolAction *Action) {
+  std::string MainExecutable = getMainExecutable();
 
   bool ProcessingFailed = false;
   for (unsigned I = 0; I < CompileCommands.size(); ++I) {
@@ -371,6 +384,159 @@ int ClangTool::run(ToolAction *Action) {
 
 namespace {
 
+/// \brief Forwards diagnostics to a consumer shared by several threads, one
+/// call at a time.
+class LockedDiagnosticConsumer : public DiagnosticConsumer {
+  DiagnosticConsumer &Target;
+  llvm::sys::Mutex &Lock;
+
+public:
+  LockedDiagnosticConsumer(DiagnosticConsumer &Target, llvm::sys::Mutex &Lock)
+    : Target(Target), Lock(Lock) {}
+
+  virtual void BeginSourceFile(const LangOptions &LangOpts,
+                               const Preprocessor *PP) {
+    llvm::sys::ScopedLock L(Lock);
+    Target.BeginSourceFile(LangOpts, PP);
+  }
+
+  virtual void EndSourceFile() {
+    llvm::sys::ScopedLock L(Lock);
+    Target.EndSourceFile();
+  }
+
+  virtual void finish() {
+    llvm::sys::ScopedLock L(Lock);
+    Target.finish();
+  }
+
+  virtual bool IncludeInDiagnosticCounts() const {
+    return Target.IncludeInDiagnosticCounts();
+  }
+
+  virtual void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
+                                const Diagnostic &Info) {
+    DiagnosticConsumer::HandleDiagnostic(DiagLevel, Info);
+    llvm::sys::ScopedLock L(Lock);
+    Target.HandleDiagnostic(DiagLevel, Info);
+  }
+};
+
+/// \brief Runs the same action on every translation unit.
+class SharedToolActionFactory : public ToolActionFactory {
+  ToolAction *Action;
+
+public:
+  explicit SharedToolActionFactory(ToolAction *Action) : Action(Action) {}
+
+  virtual ToolAction *create() { return Action; }
+  virtual void finish(ToolAction *, bool) {}
+};
+
+/// \brief One translation unit processed by ClangTool::runInParallel.
+struct ParallelToolTask {
+  std::string File;
+  std::string Directory;
+  std::vector<std::string> CommandLine;
+  const std::vector< std::pair<StringRef, StringRef> > *MappedFileContents;
+  ToolActionFactory *Factory;
+
+  /// \brief The consumer set on the ClangTool and its lock, if any.
+  DiagnosticConsumer *SharedDiagConsumer;
+  llvm::sys::Mutex *DiagLock;
+
+  ToolAction *Action;
+  bool Succeeded;
+
+  /// \brief The diagnostics printed while processing the translation unit.
+  std::string Output;
+};
+
+}
+
+static void runParallelToolTask(void *Data) {
+  ParallelToolTask &Task = *static_cast<ParallelToolTask *>(Data);
+  llvm::raw_string_ostream OS(Task.Output);
+
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticPrinter DiagnosticPrinter(OS, &*DiagOpts);
+  OwningPtr<LockedDiagnosticConsumer> LockedConsumer;
+  if (Task.SharedDiagConsumer)
+    LockedConsumer.reset(new LockedDiagnosticConsumer(*Task.SharedDiagConsumer,
+                                                      *Task.DiagLock));
+
+  // Relative paths are resolved by the FileManager, and by the driver through
+  // -working-directory, which also sets the FileManager options of the
+  // CompilerInvocation for actions that create their own.
+  FileSystemOptions FileSystemOpts;
+  FileSystemOpts.WorkingDir = Task.Directory;
+  IntrusiveRefCntPtr<FileManager> Files(new FileManager(FileSystemOpts));
+  Task.CommandLine.push_back("-working-directory");
+  Task.CommandLine.push_back(Task.Directory);
+
+  Task.Action = Task.Factory->create();
+  ToolInvocation Invocation(Task.CommandLine, Task.Action, Files.getPtr());
+  if (LockedConsumer)
+    Invocation.setDiagnosticConsumer(LockedConsumer.get());
+  else
+    Invocation.setDiagnosticConsumer(&DiagnosticPrinter);
+  for (unsigned I = 0, E = Task.MappedFileContents->size(); I != E; ++I) {
+    Invocation.mapVirtualFile((*Task.MappedFileContents)[I].first,
+                              (*Task.MappedFileContents)[I].second);
+  }
+
+  Task.Succeeded = Invocation.run();
+  if (!Task.Succeeded)
+    OS << "Error while processing " << Task.File << ".\n";
+  OS.flush();
+}
+
+int ClangTool::runInParallel(ToolActionFactory *Factory, unsigned NumThreads) {
+  std::string MainExecutable = getMainExecutable();
+  llvm::sys::Mutex DiagLock;
+
+  std::vector<ParallelToolTask> Tasks(CompileCommands.size());
+  for (unsigned I = 0, E = CompileCommands.size(); I != E; ++I) {
+    ParallelToolTask &Task = Tasks[I];
+    Task.File = CompileCommands[I].first;
+    Task.Directory = CompileCommands[I].second.Directory;
+    Task.CommandLine = CompileCommands[I].second.CommandLine;
+    for (unsigned J = 0, F = ArgsAdjusters.size(); J != F; ++J)
+      Task.CommandLine = ArgsAdjusters[J]->Adjust(Task.CommandLine);
+    assert(!Task.CommandLine.empty());
+    Task.CommandLine[0] = MainExecutable;
+    Task.MappedFileContents = &MappedFileContents;
+    Task.Factory = Factory;
+    Task.SharedDiagConsumer = DiagConsumer;
+    Task.DiagLock = &DiagLock;
+    Task.Action = 0;
+    Task.Succeeded = false;
+  }
+
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0, E = Tasks.size(); I != E; ++I)
+      Pool.async(runParallelToolTask, &Tasks[I]);
+    Pool.wait();
+  }
+
+  bool ProcessingFailed = false;
+  for (unsigned I = 0, E = Tasks.size(); I != E; ++I) {
+    llvm::errs() << Tasks[I].Output;
+    Factory->finish(Tasks[I].Action, Tasks[I].Succeeded);
+    if (!Tasks[I].Succeeded)
+      ProcessingFailed = true;
+  }
+  return ProcessingFailed ? 1 : 0;
+}
+
+int ClangTool::runInParallel(ToolAction *Action, unsigned NumThreads) {
+  SharedToolActionFactory Factory(Action);
+  return runInParallel(&Factory, NumThreads);
+}
+
+namespace {
+
 class ASTBuilderAction : public ToolAction {
   std::vector<ASTUnit *> &ASTs;
 
@@ -0,0 +1,19 @@
+// RUN: %clang_cc1 -fcilkplus -emit-llvm %s -o - | FileCheck %s
+
+// CHECK: @[[SITE1:__cilk_for_affinity_site[0-9]*]] = internal global i8* null
+// CHECK: @[[SITE2:__cilk_for_affinity_site[0-9]*]] = internal global i8* null
+
+void test_affinity(int n, long long m) {
+  #pragma cilk affinity
+  _Cilk_for(int i = 0; i < n; ++i);
+  // CHECK: call void @__cilkrts_cilk_for_affinity_32({{.*}}, i32 %{{[A-Za-z0-9]+}}, i32 0, i8** @[[SITE1]])
+
+  #pragma cilk grainsize = 8
+  #pragma cilk affinity
+  _Cilk_for(long long i = 0; i < m; ++i);
+  // CHECK: call void @__cilkrts_cilk_for_affinity_64({{.*}}, i64 %{{[A-Za-z0-9]+}}, i32 8, i8** @[[SITE2]])
+
+  // Without affinity, the default entry is used.
+  _Cilk_for(int i = 0; i < n; ++i);
+  // CHECK: call void @__cilkrts_cilk_for_32({{.*}}, i32 %{{[A-Za-z0-9]+}}, i32 0)
+}
@@ -0,0 +1,51 @@
+// RUN: %clang_cc1 -fcilkplus -emit-llvm %s -o - | FileCheck -check-prefix=DEFAULT %s
+// RUN: %clang_cc1 -fcilkplus -fcilk-compact-frame -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -fcilkplus -fcilk-compact-frame -emit-llvm %s -o - | FileCheck -check-prefix=CHECK-HELPER %s
+// RUN: %clang_cc1 -fcilkplus -fcilk-compact-frame -emit-llvm %s -o - | FileCheck -check-prefix=CHECK-FLAGS %s
+// RUN: %clang_cc1 -fcilkplus -fcilk-compact-frame -emit-llvm %s -o - | FileCheck -check-prefix=CHECK-FIELDS %s
+// RUN: %clang_cc1 -fcilkplus -fcilk-compact-frame -emit-llvm %s -o - | FileCheck -check-prefix=CHECK-SETJMP %s
+
+// DEFAULT: %__cilkrts_stack_frame = type { i32, i32, %__cilkrts_stack_frame*, %__cilkrts_worker*, i8*, [5 x i8*], i32, i16, i16, %__cilkrts_pedigree, void (%__cilkrts_pending_frame*, i8*)*, i8*, %__cilkrts_stack_frame*, %__cilkrts_stack_frame** }
+// DEFAULT-NOT: __cilkrts_compact_stack_frame
+// DEFAULT: stmxcsr
+
+// The frames of the module have the compact layout, but are passed around as
+// __cilkrts_stack_frame pointers.
+// CHECK-DAG: %__cilkrts_stack_frame = type { i32, i32, %__cilkrts_stack_frame*, %__cilkrts_worker*, i8*, [5 x i8*], i32, i16, i16, %__cilkrts_pedigree, void (%__cilkrts_pending_frame*, i8*)*, i8*, %__cilkrts_stack_frame*, %__cilkrts_stack_frame** }
+// CHECK-DAG: %__cilkrts_compact_stack_frame_core = type { i32, i32, %__cilkrts_stack_frame*, %__cilkrts_worker*, i8*, [3 x i8*], i32, i16, i16, %__cilkrts_pedigree }
+// CHECK-DAG: %__cilkrts_compact_stack_frame = type { i32, i32, %__cilkrts_stack_frame*, %__cilkrts_worker*, i8*, [3 x i8*], i32, i16, i16, %__cilkrts_pedigree, void (%__cilkrts_pending_frame*, i8*)*, i8*, %__cilkrts_stack_frame*, %__cilkrts_stack_frame** }
+
+void foo(void);
+
+void test() {
+  _Cilk_spawn foo();
+  // CHECK: define void @test()
+  // CHECK: %__cilkrts_sf_compact = alloca %__cilkrts_compact_stack_frame_core
+  // CHECK: %__cilkrts_sf = bitcast %__cilkrts_compact_stack_frame_core* %__cilkrts_sf_compact to %__cilkrts_stack_frame*
+  // CHECK: call void @__cilk_parent_prologue(%__cilkrts_stack_frame* %__cilkrts_sf)
+  // CHECK: call void @__cilk_parent_epilogue(%__cilkrts_stack_frame* %__cilkrts_sf)
+}
+
+// CHECK-HELPER: define internal void @__cilk_spawn_helper
+// CHECK-HELPER: alloca %__cilkrts_compact_stack_frame_core
+
+// The version stored in the frame flags identifies the compact layout.
+// CHECK-FLAGS: define available_externally void @__cilkrts_enter_frame_1
+// CHECK-FLAGS: store i32 33554560
+// CHECK-FLAGS: store i32 33554432
+
+// The fields from ctx on are accessed through the compact layout.
+// CHECK-FIELDS: define internal void @__cilkrts_detach
+// CHECK-FIELDS: bitcast %__cilkrts_stack_frame* %{{.*}} to %__cilkrts_compact_stack_frame*
+// CHECK-FIELDS: getelementptr inbounds %__cilkrts_compact_stack_frame* %{{.*}}, i32 0, i32 9
+
+// The floating point control words are saved with the continuation, and the
+// jump buffer only holds the frame pointer, resume address and stack pointer.
+// CHECK-SETJMP: define void @test()
+// CHECK-SETJMP: getelementptr inbounds %__cilkrts_compact_stack_frame* %{{.*}}, i32 0, i32 6
+// CHECK-SETJMP: getelementptr inbounds %__cilkrts_compact_stack_frame* %{{.*}}, i32 0, i32 7
+// CHECK-SETJMP: call void asm sideeffect "stmxcsr $0\0A\09fnstcw $1"
+// CHECK-SETJMP: getelementptr inbounds %__cilkrts_compact_stack_frame* %{{.*}}, i32 0, i32 5
+// CHECK-SETJMP: getelementptr inbounds [3 x i8*]* %{{.*}}, i32 0, i32 0
+// CHECK-SETJMP: getelementptr inbounds [3 x i8*]* %{{.*}}, i32 0, i32 2
+// CHECK-SETJMP: call i32 @llvm.eh.sjlj.setjmp
@@ -0,0 +1,61 @@
+// RUN: %clang_cc1 -fcilkplus -emit-llvm %s -o %t
+// RUN: FileCheck -input-file=%t -check-prefix=CHECK1 %s
+// RUN: FileCheck -input-file=%t -check-prefix=CHECK2 %s
+// RUN: FileCheck -input-file=%t -check-prefix=CHECK3 %s
+
+void f(int);
+void g(long long, int);
+
+void test1(int n) {
+  // CHECK1: define void @test1
+  for (int i = 0; i < n; ++i)
+    _Cilk_spawn f(i);
+  // CHECK1: [[Ctx:%[a-zA-Z0-9_\.]*]] = alloca { %{{.*}}*, i32, i32 }
+  // CHECK1: icmp slt i32
+  // CHECK1: br i1
+  //
+  // Context: captures, i, stride
+  // CHECK1: getelementptr inbounds { %{{.*}}*, i32, i32 }* [[Ctx]], i32 0, i32 1
+  // CHECK1: store i32 1, i32*
+  // CHECK1: call void @__cilkrts_cilk_for_32(void (i8*, i32, i32)* [[helper1:@__cilk_spawn_loop_helper[0-9]*]], i8* {{.*}}, i32 {{.*}}, i32 0)
+  // CHECK1-NOT: call void @__cilk_spawn_helper
+  // CHECK1: ret void
+  //
+  // CHECK1: define internal void [[helper1]](i8*
+  // CHECK1: icmp ult i32
+  // CHECK1: mul i32
+  // CHECK1: add i32
+  // CHECK1: call void @f(i32
+  // CHECK1: ret void
+}
+
+void test2(long long n, int k) {
+  // CHECK2: define void @test2
+  for (long long i = n; i > 0; i -= 2) {
+    _Cilk_spawn g(i, k);
+  }
+  // CHECK2: store i64 -2, i64*
+  // CHECK2: call void @__cilkrts_cilk_for_64(
+  //
+  // CHECK2: define internal void @__cilk_spawn_loop_helper
+  // CHECK2: mul i64
+  // CHECK2: call void @g(i64
+}
+
+int h(int);
+int *p(int);
+
+void test3(int n, int *a) {
+  // CHECK3: define void @test3
+  // A receiver, a side effect or an address of the loop control variable
+  // keeps the loop serial.
+  for (int i = 0; i < n; ++i) {
+    int x = _Cilk_spawn h(i);
+  }
+  for (int i = 0; i < n; ++i)
+    _Cilk_spawn f(a[i]++);
+  for (int i = 0; i < n; ++i)
+    _Cilk_spawn p(&i);
+  // CHECK3-NOT: __cilkrts_cilk_for
+  // CHECK3: ret void
+}
@@ -0,0 +1,44 @@
+// Check that -parallel-codegen-output splits the module between the object
+// files, and that a local function called from another part is given a name
+// that the parts can be linked by, which depends on the combined object.
+// REQUIRES: x86-registered-target
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-obj %s \
+// RUN:   -o %t.a0.o -parallel-codegen-output %t.a1.o \
+// RUN:   -parallel-codegen-object a.o
+// RUN: llvm-nm %t.a0.o | FileCheck -check-prefix=PART0 %s
+// RUN: llvm-nm %t.a1.o | FileCheck -check-prefix=PART1 %s
+//
+// PART0: T big
+// PART0-NEXT: U helper.pcg.{{[0-9A-F]+}}
+// PART0-NOT: small
+//
+// PART1-NOT: big
+// PART1: T helper.pcg.{{[0-9A-F]+}}
+// PART1-NEXT: T small
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-obj %s \
+// RUN:   -o %t.b0.o -parallel-codegen-output %t.b1.o \
+// RUN:   -parallel-codegen-object b.o
+// RUN: llvm-nm %t.a1.o > %t.a.nm
+// RUN: llvm-nm %t.b1.o > %t.b.nm
+// RUN: not diff %t.a.nm %t.b.nm
+
+// The functions are placed largest first, each in the smaller part so far:
+// big in part 0, then helper and small in part 1.
+
+static int helper(int x) {
+  return x * 3 + 1;
+}
+
+int big(int x, int y, int z) {
+  int a = x * y + z;
+  int b = a * a - x;
+  int c = b / (y + 1) + a;
+  int d = c * z - b * x;
+  return helper(a + b + c + d);
+}
+
+int small(int x) {
+  return x;
+}
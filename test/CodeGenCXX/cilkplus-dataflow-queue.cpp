@@ -0,0 +1,78 @@
+// RUN: %clang_cc1 -std=c++11 -fcilkplus -triple x86_64-unknown-linux-gnu -emit-llvm %s -o - | FileCheck %s
+
+struct version;
+
+template <typename T>
+struct pushdep {
+  version *v;
+  void __Cilk_is_dataflow_type();
+  void __Cilk_is_dataflow_pushdep_type();
+};
+
+template <typename T>
+struct popdep {
+  version *v;
+  void __Cilk_is_dataflow_type();
+  void __Cilk_is_dataflow_popdep_type();
+};
+
+void produce(pushdep<int> q);
+void consume(popdep<int> q);
+
+void pipeline(pushdep<int> out, popdep<int> in) {
+  _Cilk_spawn produce(out);
+  _Cilk_spawn consume(in);
+  _Cilk_spawn produce(out);
+  _Cilk_sync;
+}
+
+// A push that is not ready when spawned fills a segment of its own, and
+// registers with that segment rather than with the queue. So it doesn't wait
+// for the pops before it.
+// CHECK: define internal %__cilkrts_pending_frame* @__cilkrts_df_spawn_helper_ini_ready_fn
+// CHECK-NOT: __cilkrts_queue_pop_segment
+// CHECK: call i32 @__cilkrts_obj_metadata_ini_ready({{.*}}, i32 4)
+// CHECK: define internal void @__cilk_df_spawn_helper_issue_fn
+// CHECK-NOT: call void @__cilkrts_obj_metadata_add_task
+// CHECK: queue_segments:
+// CHECK: [[SEG:%[0-9]+]] = call %__cilkrts_obj_version* @__cilkrts_queue_push_segment(
+// CHECK: [[META:%[0-9]+]] = getelementptr inbounds %__cilkrts_obj_version* [[SEG]]
+// CHECK: call void @__cilkrts_obj_metadata_add_task_write({{.*}} [[META]],
+// CHECK: issued_late:
+// CHECK: call void @__cilkrts_obj_metadata_add_task_write(
+// CHECK: define internal void @__cilk_df_spawn_helper_release_fn
+// CHECK: call void @__cilkrts_obj_metadata_wakeup(
+// CHECK: call %__cilkrts_obj_version* @__cilkrts_queue_segment_release(
+// CHECK: call void @__cilkrts_obj_version_del_ref(
+
+// Pops are serialised on the queue, and wait for the oldest segment that is
+// still being filled when they are issued. Pushes issued later fill later
+// segments, so the pop doesn't wait for them.
+// CHECK: define internal %__cilkrts_pending_frame* @__cilkrts_df_spawn_helper_ini_ready_fn
+// CHECK: call i32 @__cilkrts_obj_metadata_ini_ready({{.*}}, i32 4)
+// CHECK: check_pop_segment:
+// CHECK: call %__cilkrts_obj_version* @__cilkrts_queue_pop_segment(
+// CHECK: define internal void @__cilk_df_spawn_helper_issue_fn
+// CHECK-NOT: __cilkrts_queue_push_segment
+// CHECK: call void @__cilkrts_obj_metadata_add_task_write(
+// CHECK: queue_segments:
+// CHECK: [[POPSEG:%[0-9]+]] = call %__cilkrts_obj_version* @__cilkrts_queue_pop_segment(
+// CHECK: pop_segment:
+// CHECK: [[POPMETA:%[0-9]+]] = getelementptr inbounds %__cilkrts_obj_version* [[POPSEG]]
+// CHECK: call void @__cilkrts_obj_metadata_add_task_read({{.*}} [[POPMETA]],
+// CHECK: issued_late:
+// CHECK-NEXT: br label %exit
+// CHECK: define internal void @__cilk_df_spawn_helper_release_fn
+// CHECK: call void @__cilkrts_obj_metadata_wakeup(
+// CHECK: pop_segment:
+// CHECK: call void @__cilkrts_obj_metadata_wakeup(
+// CHECK: call void @__cilkrts_obj_version_del_ref(
+
+// The push after the pop again registers only with a segment of its own.
+// CHECK: define internal void @__cilk_df_spawn_helper_issue_fn
+// CHECK-NOT: call void @__cilkrts_obj_metadata_add_task
+// CHECK: queue_segments:
+// CHECK: call %__cilkrts_obj_version* @__cilkrts_queue_push_segment(
+// CHECK-NOT: __cilkrts_queue_pop_segment
+// CHECK: call void @__cilkrts_obj_metadata_add_task_write(
+// CHECK: define internal void @__cilk_df_spawn_helper_release_fn
@@ -0,0 +1,40 @@
+// RUN: %clang_cc1 -std=c++11 -fcilkplus -triple x86_64-unknown-linux-gnu -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -std=c++11 -fcilkplus -fcilk-spawn-priority -triple x86_64-unknown-linux-gnu -emit-llvm %s -o - | FileCheck -check-prefix=PRIORITY %s
+
+struct version;
+
+template <typename T>
+struct indep {
+  version *v;
+  void __Cilk_is_dataflow_type();
+  void __Cilk_is_dataflow_indep_type();
+};
+
+void consume(indep<int> x);
+
+void run(indep<int> x) {
+  #pragma cilk priority(3)
+  _Cilk_spawn consume(x);
+  _Cilk_sync;
+}
+
+// Without -fcilk-spawn-priority, the pending frames of the runtime have no
+// priority field, so it is not written.
+// CHECK: define internal %__cilkrts_pending_frame* @__cilkrts_df_spawn_helper_ini_ready_fn
+// CHECK-NOT: store i32 3, i32* %{{.*}}
+// CHECK: ret %__cilkrts_pending_frame*
+
+// PRIORITY: define internal %__cilkrts_pending_frame* @__cilkrts_df_spawn_helper_ini_ready_fn
+// PRIORITY: [[FIELD:%.*]] = getelementptr inbounds %__cilkrts_pending_frame* %{{.*}}, i32 0, i32 6
+// PRIORITY: store i32 3, i32* [[FIELD]]
+
+// Without priorities, the frames that become ready are spliced onto the
+// worker's ready list at once; with them, they are inserted one by one.
+// CHECK: define {{.*}}void @__cilkrts_move_to_ready_list(
+// CHECK-NOT: __cilkrts_ready_list_insert
+// CHECK: call void @__cilkrts_worker_unlock(
+// CHECK-NEXT: ret void
+
+// PRIORITY: define {{.*}}void @__cilkrts_move_to_ready_list(
+// PRIORITY: loop:
+// PRIORITY: call void @__cilkrts_ready_list_insert(
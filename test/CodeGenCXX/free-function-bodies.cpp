@@ -0,0 +1,65 @@
+// RUN: %clang_cc1 -std=c++11 -triple x86_64-unknown-unknown -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -std=c++11 -triple x86_64-unknown-unknown -emit-llvm -o - %s -ffree-function-bodies | FileCheck %s
+// RUN: %clang_cc1 -std=c++11 -triple x86_64-unknown-unknown -emit-llvm -o - %s -ffree-function-bodies | FileCheck -check-prefix=CTOR %s
+// RUN: %clang_cc1 -std=c++11 -triple x86_64-unknown-unknown -emit-llvm-only %s -ffree-function-bodies \
+// RUN:   -print-stats 2>&1 | FileCheck -check-prefix=STATS %s
+// RUN: %clang_cc1 -std=c++11 -triple x86_64-unknown-unknown -emit-llvm-only %s -ffree-function-bodies \
+// RUN:   -verify -DREDEFINITION
+
+template<typename T> T twice(T t) { return t + t; }
+
+struct S {
+  int n = 7;
+  int get() const;
+};
+
+int S::get() const { return twice(n); }
+// CHECK-LABEL: define i32 @_ZNK1S3getEv(
+// CHECK: call i32 @_Z5twiceIiET_S0_(
+
+static int helper(int x) { return x * 3; }
+
+// The implicit constructor of S is defined while this body is parsed, and
+// emitted after it has been freed.
+int use(int x) { // expected-note {{previous definition is here}}
+  S s;
+  s.n = helper(x);
+  return s.get() + twice(x);
+}
+// CHECK-LABEL: define i32 @_Z3usei(
+// CHECK: call void @_ZN1SC1Ev(
+// CHECK: call i32 @_ZL6helperi(
+
+// The bodies of functions with static locals or lambdas are kept.
+int counter() {
+  static int n = 0;
+  return ++n;
+}
+// CHECK-LABEL: define i32 @_Z7counterv(
+
+int lambda(int x) {
+  auto f = [x](int y) { return x + y; };
+  return f(1);
+}
+// CHECK-LABEL: define i32 @_Z6lambdai(
+
+inline int inl(int x) { return x - 1; }
+int callinl(int x) { return inl(x); }
+// CHECK-LABEL: define i32 @_Z7callinli(
+// CHECK: call i32 @_Z3inli(
+
+// CHECK-LABEL: define linkonce_odr i32 @_Z5twiceIiET_S0_(
+// CHECK: add nsw i32
+// CHECK-LABEL: define internal i32 @_ZL6helperi(
+// CHECK: mul nsw i32 {{.*}}, 3
+
+// CTOR-LABEL: define linkonce_odr void @_ZN1SC2Ev(
+// CTOR: store i32 7
+
+// STATS: *** Function Body Arena Stats:
+// STATS-NEXT: 4 bodies freed, {{[0-9]+}} bytes.
+// STATS-NEXT: 0 bodies not emitted, 2 bodies kept.
+
+#ifdef REDEFINITION
+int use(int x) { return x; } // expected-error {{redefinition of 'use'}}
+#endif
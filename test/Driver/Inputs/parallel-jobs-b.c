@@ -0,0 +1,2 @@
+#warning second file
+#error stop
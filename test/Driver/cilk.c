@@ -6,3 +6,9 @@
 //
 // RUN: %clang %s -### 2>&1 | FileCheck %s
 // CHECK-NOT: -lcilkrts
+//
+// RUN: %clang -fcilkplus -fcilk-compact-frame -target x86_64-unknown-linux %s -### 2>&1 | FileCheck -check-prefix=CHECK3 %s
+// CHECK3: "-fcilkplus" "-fcilk-compact-frame"
+//
+// RUN: %clang -fcilkplus -fcilk-spawn-priority -target x86_64-unknown-linux %s -### 2>&1 | FileCheck -check-prefix=CHECK4 %s
+// CHECK4: "-fcilkplus" "-fcilk-spawn-priority"
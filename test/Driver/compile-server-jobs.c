@@ -0,0 +1,31 @@
+// A server runs the jobs sent to it, and sees the files created between them.
+// REQUIRES: shell
+// RUN: rm -rf %t.dir
+// RUN: mkdir -p %t.dir/first %t.dir/second
+// RUN: echo 'int in_second;' > %t.dir/second/a.h
+// RUN: { %clang -cc1server -j 1 -idle-timeout 3 -v %t.dir/sock \
+// RUN:     > %t.dir/log 2>&1 & }
+// RUN: for i in 1 2 3 4 5 6 7 8 9 10; do \
+// RUN:   test -S %t.dir/sock && break; sleep 1; done
+// RUN: cd %t.dir && %clang -fcompile-server=%t.dir/sock -E -DSERVER \
+// RUN:   -I first -I second %s -o %t.dir/out1
+// RUN: FileCheck -check-prefix=FIRST %s < %t.dir/out1
+// RUN: echo 'int in_first;' > %t.dir/first/a.h
+// RUN: cd %t.dir && %clang -fcompile-server=%t.dir/sock -E -DSERVER \
+// RUN:   -I first -I second %s -o %t.dir/out2
+// RUN: FileCheck -check-prefix=SECOND %s < %t.dir/out2
+// RUN: wait
+// RUN: FileCheck -check-prefix=LOG %s < %t.dir/log
+
+// FIRST: int in_second;
+// FIRST-NOT: in_first
+// SECOND: int in_first;
+// SECOND-NOT: in_second
+
+// LOG: job 1: exit code 0
+// LOG-NOT: reused
+// LOG: job 2: exit code 0 (reused file lookups)
+
+#ifdef SERVER
+#include "a.h"
+#endif
@@ -0,0 +1,11 @@
+// Without a server listening on the socket, the driver runs the jobs itself.
+// RUN: rm -f %t.sock
+// RUN: %clang -fcompile-server=%t.sock -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: compile-server.c:[[@LINE+1]]:2: warning: compiled locally
+#warning compiled locally
+
+// RUN: %clang -### -fcompile-server=%t.sock -c %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=NOT-FORWARDED %s
+// NOT-FORWARDED: "-cc1"
+// NOT-FORWARDED-NOT: "-fcompile-server
@@ -0,0 +1,8 @@
+// RUN: %clang -### -M -fminimize-dependency-scan %s 2>&1 | FileCheck %s
+// CHECK: "-Eonly"
+// CHECK: "-fminimize-dependency-scan"
+
+// RUN: %clang -### -c -fminimize-dependency-scan %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=COMPILE %s
+// COMPILE: argument unused during compilation: '-fminimize-dependency-scan'
+// COMPILE-NOT: "-fminimize-dependency-scan"
@@ -0,0 +1,26 @@
+// Check that -fparallel-codegen=N generates an object file in N parts that
+// are combined by a relocatable link.
+//
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=3 -c %s \
+// RUN:   -o %t.o -### 2>&1 | FileCheck %s
+//
+// CHECK: "-cc1"
+// CHECK: "-o" "[[PART0:[^"]*\.o]]" "-parallel-codegen-output" "[[PART1:[^"]*\.o]]" "-parallel-codegen-output" "[[PART2:[^"]*\.o]]" "-parallel-codegen-object" "[[OBJECT:[^"]*\.o]]"
+// CHECK: ld{{(.exe)?}}" "-r" "-o" "[[OBJECT]]" "[[PART0]]" "[[PART1]]" "[[PART2]]"
+
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=1 -c %s \
+// RUN:   -### 2>&1 | FileCheck -check-prefix=CHECK-NONE %s
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=4 -S %s \
+// RUN:   -### 2>&1 | FileCheck -check-prefix=CHECK-NONE %s
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=4 -c %s \
+// RUN:   -g -gsplit-dwarf -### 2>&1 | FileCheck -check-prefix=CHECK-NONE %s
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=4 -c %s \
+// RUN:   -o - -### 2>&1 | FileCheck -check-prefix=CHECK-NONE %s
+//
+// CHECK-NONE-NOT: "-parallel-codegen-output"
+// CHECK-NONE-NOT: "-r"
+
+// RUN: %clang -target x86_64-unknown-linux-gnu -fparallel-codegen=0 -c %s \
+// RUN:   -### 2>&1 | FileCheck -check-prefix=CHECK-INVALID %s
+//
+// CHECK-INVALID: error: invalid integral value '0' in '-fparallel-codegen=0'
@@ -0,0 +1,15 @@
+// With -j, the commands of one action still run in order: the relocatable
+// link of a parallel code generation, and the objcopy commands of
+// -gsplit-dwarf, wait for the compiler to write their inputs.
+// REQUIRES: native, x86-registered-target
+// RUN: rm -rf %t.dir && mkdir %t.dir
+// RUN: %clang -j4 -fparallel-codegen=2 -c %s -o %t.dir/parts.o
+// RUN: llvm-nm %t.dir/parts.o | FileCheck -check-prefix=PARTS %s
+// PARTS-DAG: T {{_?}}first
+// PARTS-DAG: T {{_?}}second
+// RUN: %clang -j4 -g -gsplit-dwarf -c %s -o %t.dir/split.o
+// RUN: llvm-nm %t.dir/split.o | FileCheck -check-prefix=SPLIT %s
+// SPLIT: T {{_?}}first
+
+void first(void) {}
+void second(void) {}
@@ -0,0 +1,18 @@
+// Independent jobs run concurrently with -j, but their diagnostics still come
+// out whole and in command-line order.
+// RUN: not %clang -j2 -fsyntax-only %s %S/Inputs/parallel-jobs-b.c \
+// RUN:   %s 2>&1 | FileCheck %s
+// CHECK: parallel-jobs.c:[[@LINE+6]]:2: warning: first file
+// CHECK-NEXT: #warning first file
+// CHECK: parallel-jobs-b.c:1:2: warning: second file
+// CHECK: parallel-jobs-b.c:2:2: error: stop
+// CHECK: parallel-jobs.c:[[@LINE+2]]:2: warning: first file
+// CHECK-NEXT: #warning first file
+#warning first file
+
+// RUN: %clang -### -j4 -c %s 2>&1 | FileCheck -check-prefix=NOT-FORWARDED %s
+// NOT-FORWARDED-NOT: "-j4"
+
+// RUN: not %clang -j0 -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=INVALID %s
+// INVALID: invalid integral value '0' in '-j0'
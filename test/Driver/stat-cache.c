@@ -0,0 +1,3 @@
+// RUN: %clang -### -c -fstat-cache=%t.cache %s 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK: "-fstat-cache={{.*}}.cache"
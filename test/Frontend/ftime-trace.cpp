@@ -0,0 +1,19 @@
+// RUN: %clang_cc1 -triple x86_64-unknown-unknown -emit-llvm -ftime-trace -ftime-trace-granularity=0 -o %t.ll %s
+// RUN: FileCheck < %t.json %s
+
+// Events are listed in the order they complete, followed by the totals.
+// CHECK: "traceEvents"
+// CHECK: "name":"Source","args":{"detail":"{{.*test2.h}}"}
+// CHECK: "name":"Source","args":{"detail":"{{.*test.h}}"}
+// CHECK: "name":"CodeGen Decl","args":{"detail":"f"}
+// CHECK: "name":"InstantiateFunction","args":{"detail":"twice"}
+// CHECK: "name":"Frontend"
+// CHECK: "name":"ExecuteCompiler","args":{"detail":"{{.*ftime-trace.cpp}}"}
+// CHECK: "name":"Total Source","args":{"count":2}
+// CHECK: "process_name"
+
+#include "Inputs/test.h"
+
+template <typename T> T twice(T x) { return x + x; }
+
+int f(int x) { return twice(x); }
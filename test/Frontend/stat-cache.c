@@ -0,0 +1,14 @@
+// RUN: rm -f %t.cache
+// RUN: %clang_cc1 -fsyntax-only -fstat-cache=%t.cache -I %S/Inputs -print-stats %s 2>&1 | FileCheck -check-prefix=COLD %s
+// RUN: %clang_cc1 -fsyntax-only -fstat-cache=%t.cache -I %S/Inputs -print-stats %s 2>&1 | FileCheck -check-prefix=WARM %s
+
+// The first compilation records the failed lookup of test.h next to this
+// file; the second one answers it from the cache.
+// COLD: 0 stat cache hits, {{[1-9][0-9]*}} stat cache misses.
+// WARM: {{[1-9][0-9]*}} stat cache hits, 0 stat cache misses.
+
+// A malformed cache is ignored and rewritten.
+// RUN: echo garbage > %t.cache
+// RUN: %clang_cc1 -fsyntax-only -fstat-cache=%t.cache -I %S/Inputs -print-stats %s 2>&1 | FileCheck -check-prefix=COLD %s
+
+#include "test.h"
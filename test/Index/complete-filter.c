@@ -0,0 +1,42 @@
+// Note: the run lines follow their respective tests, since line/column
+// matter in this test.
+struct Packet { int x; };
+int frobnicate(int);
+int FOOD;
+int food_count;
+int format_packet(struct Packet *);
+
+void test() {
+
+}
+
+// RUN: env CINDEXTEST_COMPLETION_FILTER=food CINDEXTEST_COMPLETION_LIMIT=2 c-index-test -code-completion-at=%s:10:1 %s | FileCheck -check-prefix=CHECK-FOOD %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 CINDEXTEST_COMPLETION_FILTER=food CINDEXTEST_COMPLETION_LIMIT=2 c-index-test -code-completion-at=%s:10:1 %s | FileCheck -check-prefix=CHECK-FOOD %s
+// CHECK-FOOD: VarDecl:{ResultType int}{TypedText food_count}
+// CHECK-FOOD-NEXT: VarDecl:{ResultType int}{TypedText FOOD}
+// CHECK-FOOD-NOT: TypedText
+
+// RUN: env CINDEXTEST_COMPLETION_FILTER=fmtp c-index-test -code-completion-at=%s:10:1 %s | FileCheck -check-prefix=CHECK-FMTP %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 CINDEXTEST_COMPLETION_FILTER=fmtp c-index-test -code-completion-at=%s:10:1 %s | FileCheck -check-prefix=CHECK-FMTP %s
+// CHECK-FMTP-NOT: frobnicate
+// CHECK-FMTP: FunctionDecl:{ResultType int}{TypedText format_packet}{LeftParen (}{Placeholder struct Packet *}{RightParen )}
+// CHECK-FMTP-NOT: frobnicate
+// CHECK-FMTP-NOT: food_count
+
+#define sample_macro_b 1
+#define sample_macro_a 2
+int sample_var_b;
+int sample_var_a;
+void test_same_priority() {
+
+}
+
+// The typed names of macros and declarations are still compared once the
+// preprocessor that owns them is gone.
+// RUN: env CINDEXTEST_COMPLETION_FILTER=sample CINDEXTEST_COMPLETION_LIMIT=4 c-index-test -code-completion-at=%s:31:1 %s | FileCheck -check-prefix=CHECK-SAME-PRIORITY %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 CINDEXTEST_COMPLETION_FILTER=sample CINDEXTEST_COMPLETION_LIMIT=4 c-index-test -code-completion-at=%s:31:1 %s | FileCheck -check-prefix=CHECK-SAME-PRIORITY %s
+// CHECK-SAME-PRIORITY: VarDecl:{ResultType int}{TypedText sample_var_a}
+// CHECK-SAME-PRIORITY-NEXT: VarDecl:{ResultType int}{TypedText sample_var_b}
+// CHECK-SAME-PRIORITY-NEXT: macro definition:{TypedText sample_macro_a}
+// CHECK-SAME-PRIORITY-NEXT: macro definition:{TypedText sample_macro_b}
+// CHECK-SAME-PRIORITY-NOT: TypedText
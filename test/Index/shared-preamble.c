@@ -0,0 +1,29 @@
+#include "shared-preamble.h"
+#define SHARED_VALUE 2
+int value = SHARED_VALUE;
+
+// Two main files that start with the same text share one preamble, whose
+// main file is that of the unit reading it.
+// RUN: rm -rf %t
+// RUN: mkdir -p %t
+// RUN: cp %s %t/first.c
+// RUN: cp %s %t/second.c
+// RUN: env CINDEXTEST_EDITING=1 LIBCLANG_TIMING=1 c-index-test -test-shared-preamble all %t/first.c %t/second.c -I %S/Inputs > %t/out 2> %t/err
+// RUN: FileCheck %s < %t/out
+// RUN: FileCheck -check-prefix=CHECK-ERR %s < %t/err
+
+// CHECK-NOT: first.c
+// CHECK: second.c:1:{{[0-9]+}}: inclusion directive=shared-preamble.h
+// CHECK-NOT: first.c
+// CHECK: second.c:2:9: macro definition=SHARED_VALUE
+// CHECK-NOT: first.c
+// CHECK: second.c:3:5: VarDecl=value:3:5 (Definition)
+// CHECK-NOT: first.c
+
+// CHECK-ERR: first.c:2:9: warning: 'SHARED_VALUE' macro redefined
+// CHECK-ERR: Precompiling preamble
+// CHECK-ERR: Reparsing {{.*}}first.c
+// CHECK-ERR-NOT: Precompiling preamble
+// CHECK-ERR-NOT: first.c
+// CHECK-ERR: second.c:2:9: warning: 'SHARED_VALUE' macro redefined
+// CHECK-ERR-NOT: first.c
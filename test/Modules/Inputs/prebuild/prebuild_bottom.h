@@ -0,0 +1,4 @@
+#include "prebuild_left.h"
+#include "prebuild_right.h"
+
+char bottom(char *);
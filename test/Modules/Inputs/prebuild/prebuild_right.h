@@ -0,0 +1,3 @@
+#include "prebuild_top.h"
+
+double right(double *);
@@ -0,0 +1,40 @@
+// RUN: rm -rf %t
+// Only the given module and those it uses or exports are built.
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -fdisable-module-hash -nobuiltininc -I %S/Inputs/prebuild -fmodules-prebuild=prebuild_bottom -fmodules-prebuild-threads=4 %s -verify
+// RUN: ls %t | FileCheck %s
+// RUN: ls %t | not grep prebuild_broken
+// Everything is prebuilt already, so this doesn't build anything.
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -fdisable-module-hash -nobuiltininc -I %S/Inputs/prebuild -fmodules-prebuild=prebuild_bottom %s -verify
+// The errors of a module that fails to prebuild are reported once, and
+// importing it doesn't build it again.
+// RUN: not %clang_cc1 -fmodules -fmodules-cache-path=%t -fdisable-module-hash -nobuiltininc -I %S/Inputs/prebuild -fmodules-prebuild=prebuild_bottom,prebuild_broken -DIMPORT_BROKEN %s 2>&1 | FileCheck -check-prefix=CHECK-BROKEN %s
+// RUN: not %clang_cc1 -fmodules -fmodules-cache-path=%t -fdisable-module-hash -nobuiltininc -I %S/Inputs/prebuild -fmodules-prebuild=prebuild_missing %s 2>&1 | FileCheck -check-prefix=CHECK-MISSING %s
+// RUN: %clang -fmodules -fmodules-prebuild=prebuild_left,prebuild_right -fmodules-prebuild-threads=2 %s -### 2>&1 | FileCheck -check-prefix=CHECK-DRIVER %s
+
+// CHECK: modules.idx
+// CHECK: prebuild_bottom.pcm
+// CHECK: prebuild_left.pcm
+// CHECK: prebuild_right.pcm
+// CHECK: prebuild_top.pcm
+
+// CHECK-BROKEN: error: use of undeclared identifier 'undeclared_identifier'
+// CHECK-BROKEN-NOT: error: use of undeclared identifier
+// CHECK-BROKEN: could not build module 'prebuild_broken'
+// CHECK-BROKEN-NOT: error: use of undeclared identifier
+
+// CHECK-MISSING: error: no module named 'prebuild_missing' to build with -fmodules-prebuild
+
+// CHECK-DRIVER: "-fmodules-prebuild=prebuild_left,prebuild_right" "-fmodules-prebuild-threads=2"
+
+// expected-no-diagnostics
+#include "prebuild_bottom.h"
+#ifdef IMPORT_BROKEN
+#include "prebuild_broken.h"
+#endif
+
+void test(int i, float f, double d, char c) {
+  top(&i);
+  left(&f);
+  right(&d);
+  bottom(&c);
+}
@@ -0,0 +1,71 @@
+// Test that redeclaration chains that are read from a PCH only when they are
+// needed are complete once they are used.
+
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x c++-header -emit-pch \
+// RUN:   -o %t %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -fpch-lazy-redecl-chains -fsyntax-only -verify %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -fpch-lazy-redecl-chains -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -fpch-lazy-redecl-chains -fsyntax-only -print-stats %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=STATS %s
+
+// A chain was deferred, and was loaded later on.
+// STATS: {{[1-9][0-9]*}}/{{[1-9][0-9]*}} lazy redeclaration chains loaded
+
+#ifndef HEADER
+#define HEADER
+
+// The default argument is only on the second declaration.
+void f(int);
+void f(int = 0);
+
+struct S;
+struct S { int Member; };
+
+template<typename T> struct Wrapper;
+template<typename T> struct Wrapper { T Value; };
+
+extern int v;
+int v = 3;
+
+inline int g() {
+  extern int v;
+  return v;
+}
+
+// Reading HResult reaches the first declaration of h through the type,
+// rather than through a lookup of h, so its chain is deferred. The lookup of
+// h later on finds the second declaration, which needs the chain.
+int h(int);
+typedef __typeof__(h(1)) HResult;
+int h(int = 2);
+
+// Reading TPtr reaches the forward declaration of T through the type. Its
+// definition must still be found.
+struct T;
+typedef T *TPtr;
+struct T { int Member; };
+
+#else
+
+// expected-no-diagnostics
+
+// CHECK-LABEL: define void @_Z4testv
+void test() {
+  // CHECK: call void @_Z1fi(i32 0)
+  f();
+  S s;
+  s.Member = v;
+  Wrapper<int> w;
+  w.Value = g();
+}
+
+// CHECK-LABEL: define i32 @_Z5test2P1T
+HResult test2(TPtr p) {
+  // CHECK: call i32 @_Z1hi(i32 2)
+  return h() + p->Member;
+}
+
+#endif
@@ -0,0 +1,36 @@
+// Test that the parts of a PCH that are read are recorded in the access
+// profile, and that a later compilation can use the profile.
+
+// RUN: rm -f %t.profile
+// RUN: %clang_cc1 -x c-header -emit-pch -o %t.pch %s
+// RUN: %clang_cc1 -include-pch %t.pch -fpch-access-profile=%t.profile \
+// RUN:   -fsyntax-only -verify %s
+// RUN: FileCheck -input-file=%t.profile %s
+// RUN: %clang_cc1 -include-pch %t.pch -fpch-access-profile=%t.profile \
+// RUN:   -fsyntax-only -verify %s
+// RUN: FileCheck -input-file=%t.profile %s
+// RUN: %clang_cc1 -include-pch %t.pch -fpch-access-profile=%t.profile \
+// RUN:   -fsyntax-only -print-stats %s 2>&1 | FileCheck -check-prefix=STATS %s
+
+// CHECK: file {{[0-9]+}} {{[0-9]+}} {{.*}}pch
+// CHECK-NEXT: {{[0-9]+}}-{{[0-9]+}}
+
+// The blocks that the profile lists were prefetched.
+// STATS: {{[1-9][0-9]*}} AST file blocks prefetched
+
+#ifndef HEADER
+#define HEADER
+
+struct Point { int X, Y; };
+int distance(struct Point A, struct Point B);
+
+#else
+
+// expected-no-diagnostics
+
+int test(void) {
+  struct Point Origin = { 0, 0 };
+  return distance(Origin, Origin);
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Test that the code of the instantiations performed in a PCH built with
+// -fpch-codegen is generated once, when compiling the PCH itself.
+
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x c++-header -emit-pch \
+// RUN:   -fpch-instantiate-templates -fpch-codegen -o %t %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x ast -emit-llvm -o - %t \
+// RUN:   | FileCheck -check-prefix=CHECK-PCH %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -emit-llvm -o - %s | FileCheck -check-prefix=CHECK-USE %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -emit-llvm -o - %s | FileCheck -check-prefix=CHECK-NODEF %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -O1 -disable-llvm-optzns -emit-llvm -o - %s \
+// RUN:   | FileCheck -check-prefix=CHECK-OPT %s
+
+// Without -fpch-codegen, each translation unit generates the code it uses.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x c++-header -emit-pch \
+// RUN:   -fpch-instantiate-templates -o %t.noobj %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t.noobj \
+// RUN:   -emit-llvm -o - %s | FileCheck -check-prefix=CHECK-NOOBJ %s
+
+#ifndef HEADER
+#define HEADER
+
+template<typename T> struct Box {
+  T Value;
+  T get() const { return Value; }
+};
+
+template<typename T> T twice(T X) { return X + X; }
+
+inline int useBox(const Box<int> &B) { return twice(B.get()); }
+
+#else
+
+int f(const Box<int> &B) { return B.get() + twice(2); }
+long g(long X) { return twice(X); }
+
+#endif
+
+// CHECK-PCH-DAG: define weak_odr i32 @_ZNK3BoxIiE3getEv(
+// CHECK-PCH-DAG: define weak_odr i32 @_Z5twiceIiET_S0_(
+
+// CHECK-USE-DAG: define i32 @_Z1fRK3BoxIiE(
+// CHECK-USE-DAG: define linkonce_odr i64 @_Z5twiceIlET_S0_(
+// CHECK-USE-DAG: declare i32 @_ZNK3BoxIiE3getEv(
+// CHECK-USE-DAG: declare i32 @_Z5twiceIiET_S0_(
+
+// CHECK-NODEF-NOT: define {{.*}}@_ZNK3BoxIiE3getEv(
+// CHECK-NODEF-NOT: define {{.*}}@_Z5twiceIiET_S0_(
+
+// CHECK-OPT-DAG: define available_externally i32 @_ZNK3BoxIiE3getEv(
+// CHECK-OPT-DAG: define available_externally i32 @_Z5twiceIiET_S0_(
+
+// CHECK-NOOBJ-DAG: define linkonce_odr i32 @_ZNK3BoxIiE3getEv(
+// CHECK-NOOBJ-DAG: define linkonce_odr i32 @_Z5twiceIiET_S0_(
@@ -0,0 +1,14 @@
+// Test that -fpch-instantiate-templates performs the pending template
+// instantiations when the PCH is built.
+
+// RUN: %clang_cc1 -x c++-header -emit-pch -o %t %s -verify
+// RUN: not %clang_cc1 -x c++-header -emit-pch -fpch-instantiate-templates \
+// RUN:   -o %t.inst %s 2>&1 | FileCheck %s
+
+// expected-no-diagnostics
+
+template<typename T> void callMissing(T X) { X.missing(); }
+inline void useInt() { callMissing(1); }
+
+// CHECK: error: member reference base type 'int' is not a structure or union
+// CHECK: note: in instantiation of function template specialization 'callMissing<int>' requested here
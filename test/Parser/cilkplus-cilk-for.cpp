@@ -58,4 +58,24 @@ void f2() {
 
   #pragma cilk grainsize = 4; /* expected-warning {{extra tokens at end of '#pragma cilk' - ignored}} */
   _Cilk_for (int i = 0; i < 10; i++);
+
+  #pragma cilk affinity
+  _Cilk_for (int i = 0; i < 10; i++); // OK
+
+  #pragma cilk grainsize = 4
+  #pragma cilk affinity
+  _Cilk_for (int i = 0; i < 10; i++); // OK
+
+  #pragma cilk affinity
+  #pragma cilk grainsize = 4
+  _Cilk_for (int i = 0; i < 10; i++); // OK
+
+  #pragma cilk affinity
+  for (int i = 0; i < 10; i++); // expected-warning {{'#pragma cilk' ignored}}
+
+  #pragma cilk affinity 4 /* expected-warning {{extra tokens at end of '#pragma cilk' - ignored}} */
+  _Cilk_for (int i = 0; i < 10; i++);
+
+  #pragma cilk vectorlength /* expected-error {{expected 'grainsize', 'affinity' or 'priority' in '#pragma cilk'}} */
+  _Cilk_for (int i = 0; i < 10; i++);
 }
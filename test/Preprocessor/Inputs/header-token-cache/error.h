@@ -0,0 +1,6 @@
+#ifndef ERROR_H
+#define ERROR_H
+#ifdef TRIGGER_ERROR
+#error "triggered"
+#endif
+#endif
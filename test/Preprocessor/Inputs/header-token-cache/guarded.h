@@ -0,0 +1,5 @@
+#ifndef GUARDED_H
+#define GUARDED_H
+int guarded_value = VALUE;
+const char *guarded_string = "guarded";
+#endif
@@ -0,0 +1 @@
+int unguarded_value = VALUE;
@@ -0,0 +1 @@
+#define HAVE_B 1
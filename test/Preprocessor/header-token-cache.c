@@ -0,0 +1,20 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fsyntax-only -fheader-token-cache=%t -DVALUE=1 -I %S/Inputs/header-token-cache -print-stats %s 2>&1 | FileCheck -check-prefix=COLD %s
+// RUN: %clang_cc1 -fsyntax-only -fheader-token-cache=%t -DVALUE=1 -I %S/Inputs/header-token-cache -print-stats %s 2>&1 | FileCheck -check-prefix=WARM %s
+
+// Only guarded.h is written to the cache: unguarded.h has no include guard,
+// and the cached tokens of error.h would drop its #error.
+// COLD: 0 header token cache hits, 3 header token cache misses, 1 headers written.
+// WARM: 1 header token cache hits, 2 header token cache misses, 0 headers written.
+
+// The cached tokens are expanded with the macros of the includer.
+// RUN: %clang_cc1 -E -fheader-token-cache=%t -DVALUE=42 -I %S/Inputs/header-token-cache %s | FileCheck -check-prefix=EXPAND %s
+// EXPAND: int guarded_value = 42;
+// EXPAND: const char *guarded_string = "guarded";
+
+// A cache is only used with the language options it was written with.
+// RUN: %clang_cc1 -x c++ -fsyntax-only -fheader-token-cache=%t -DVALUE=1 -I %S/Inputs/header-token-cache -print-stats %s 2>&1 | FileCheck -check-prefix=COLD %s
+
+#include "guarded.h"
+#include "unguarded.h"
+#include "error.h"
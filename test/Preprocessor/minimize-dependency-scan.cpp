@@ -0,0 +1,43 @@
+// RUN: %clang_cc1 -std=c++11 -Eonly -I %S/Inputs/minimize-dependency-scan \
+// RUN:   -dependency-file %t.full.d -MT out %s
+// RUN: %clang_cc1 -std=c++11 -Eonly -I %S/Inputs/minimize-dependency-scan \
+// RUN:   -fminimize-dependency-scan -dependency-file %t.d -MT out %s
+// RUN: FileCheck %s < %t.d
+// RUN: diff %t.full.d %t.d
+
+// Any attempt to include never.h is an error, since it doesn't exist.
+
+#include "config.h" // #include "never.h"
+/* #include "never.h"
+#include "never.h" */ #include "a.h"
+
+#if HAVE_B
+#include "b.h"
+#endif
+
+#if 0
+#include "never.h"
+don't
+#endif
+
+const char *s = "\
+#include \"never.h\"";
+const char *r = R"x(
+#include "never.h"
+)x";
+char q = '"';
+#include "c.h"
+
+#\
+  include "d.h"
+int x; #include "never.h"
+%: include "e.h"
+
+// CHECK: out: {{.*}}minimize-dependency-scan.cpp
+// CHECK-NEXT: config.h
+// CHECK-NEXT: a.h
+// CHECK-NEXT: b.h
+// CHECK-NEXT: c.h
+// CHECK-NEXT: d.h
+// CHECK-NEXT: e.h
+// CHECK-NOT: never.h
@@ -0,0 +1,9 @@
+// RUN: %clang_cc1 -E -print-stats %s -o /dev/null 2>&1 | FileCheck %s
+
+#define ID(x) x
+#define PAIR(a, b) ID(a) + ID(b)
+PAIR(1, 2)
+
+// CHECK: *** Source Manager Stats:
+// CHECK: Local SLocEntry's: {{[1-9][0-9]*}} files, {{[1-9][0-9]*}} macro expansions, {{[1-9][0-9]*}} macro argument expansions, 16 bytes each.
+// CHECK: Memory: {{[0-9]+}} bytes of SLocEntry tables, {{[0-9]+}} bytes of line caches, {{[0-9]+}} bytes of lookup caches, {{[0-9]+}} macro argument chunks cached.
@@ -0,0 +1,40 @@
+// RUN: %clang_cc1 -fcilkplus -fsyntax-only -Wcilk-spawn-loop -verify %s
+
+void f(int);
+int g(void);
+void q(int *);
+
+void test(int n, int *a, int s) {
+  for (int i = 0; i < n; ++i) // expected-warning {{loop spawning 'f' is lowered to divide-and-conquer spawning as if it were a '_Cilk_for'}}
+    _Cilk_spawn f(i);
+
+  for (int i = n; i != 0; i -= 2) { // expected-warning {{loop spawning 'f' is lowered to divide-and-conquer spawning}}
+    _Cilk_spawn f(a[i]);
+  }
+
+  // Not transformed.
+  int j;
+  for (j = 0; j < n; ++j)
+    _Cilk_spawn f(j);
+  for (int i = 0; i < g(); ++i)
+    _Cilk_spawn f(i);
+  for (int i = 0; i < n; ++i)
+    _Cilk_spawn f(g());
+  for (int i = 0; i < n; ++i)
+    _Cilk_spawn q(&i);
+  for (int i = 0; i < n; i *= 2)
+    _Cilk_spawn f(i);
+  // The stride must be a constant whose sign agrees with the condition.
+  for (int i = n; i != 0; i -= s)
+    _Cilk_spawn f(a[i]);
+  for (int i = 0; i < n; i += s)
+    _Cilk_spawn f(i);
+  for (int i = 0; i < n; i += -1)
+    _Cilk_spawn f(i);
+  for (int i = 0; i < n; ++i) {
+    _Cilk_spawn f(i);
+    f(i);
+  }
+  for (int i = 0; i < n; ++i)
+    f(i);
+}
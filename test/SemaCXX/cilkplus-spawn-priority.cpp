@@ -0,0 +1,55 @@
+// RUN: %clang_cc1 -fcilkplus -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fcilkplus -ast-dump %s | FileCheck %s
+
+int f(int);
+
+void test(int n) {
+  #pragma cilk priority(2)
+  _Cilk_spawn f(n);
+  // CHECK: CilkSpawnDecl {{.*}} priority 2
+
+  int x;
+  #pragma cilk priority(1 + 2)
+  x = _Cilk_spawn f(n);
+  // CHECK: CilkSpawnDecl {{.*}} priority 3
+
+  #pragma cilk priority(4)
+  int y = _Cilk_spawn f(n);
+  // CHECK: CilkSpawnDecl {{.*}} priority 4
+
+  #pragma cilk priority(n) // expected-error {{expression is not an integral constant expression}}
+  _Cilk_spawn f(n);
+
+  #pragma cilk priority(-1) // expected-error {{priority of a '_Cilk_spawn' must be an integer constant between 0 and 4294967295}}
+  _Cilk_spawn f(n);
+
+  #pragma cilk priority(1)
+  f(n); // expected-warning {{'#pragma cilk priority' ignored, because it is not followed by a statement with a '_Cilk_spawn'}}
+
+  #pragma cilk priority 1 // expected-warning {{missing '(' after '#pragma cilk priority' - ignoring}}
+  _Cilk_spawn f(n);
+
+  #pragma cilk priority(1 // expected-warning {{missing ')' after '#pragma cilk priority' - ignoring}}
+  _Cilk_spawn f(n);
+}
+
+template <int P>
+void test_template(int n) {
+  #pragma cilk priority(5)
+  _Cilk_spawn f(n);
+
+  // The priority is checked when the template is instantiated.
+  #pragma cilk priority(P) // expected-error {{priority of a '_Cilk_spawn' must be an integer constant between 0 and 4294967295}}
+  _Cilk_spawn f(n);
+
+  #pragma cilk priority(P + 1)
+  int z = _Cilk_spawn f(n);
+}
+
+template void test_template<1>(int);
+// CHECK: TemplateArgument integral 1
+// CHECK: CilkSpawnDecl {{.*}} priority 5
+// CHECK: CilkSpawnDecl {{.*}} priority 1
+// CHECK: CilkSpawnDecl {{.*}} priority 2
+
+template void test_template<-1>(int); // expected-note {{in instantiation of function template specialization 'test_template<-1>' requested here}}
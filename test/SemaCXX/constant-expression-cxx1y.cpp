@@ -1,4 +1,5 @@
 // RUN: %clang_cc1 -std=c++1y -verify %s -fcxx-exceptions -triple=x86_64-linux-gnu
+// RUN: %clang_cc1 -std=c++1y -verify %s -fcxx-exceptions -triple=x86_64-linux-gnu -fconstexpr-bytecode
 
 struct S {
   // dummy ctor to make this a literal type
@@ -0,0 +1,74 @@
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s -fconstexpr-bytecode
+// RUN: not %clang_cc1 -std=c++1y -fsyntax-only %s -fconstexpr-bytecode \
+// RUN:   -print-stats 2>&1 | FileCheck %s
+
+// The bytecode interpreter computes the same values as the tree walker, and
+// leaves anything it would diagnose to it.
+
+constexpr unsigned crc32(unsigned n) {
+  unsigned crc = ~0u;
+  for (unsigned i = 0; i != n; ++i) {
+    crc ^= '1' + i;
+    for (int k = 0; k < 8; ++k)
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+  }
+  return ~crc;
+}
+static_assert(crc32(9) == 0xCBF43926u, "");
+
+constexpr int fib(int n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+static_assert(fib(20) == 6765, "");
+
+constexpr long long isqrt(long long n) {
+  long long lo = 0, hi = 3037000499LL;
+  while (lo < hi) {
+    long long mid = lo + (hi - lo + 1) / 2;
+    if (mid * mid <= n)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+static_assert(isqrt(1000000007LL * 1000000007LL) == 1000000007LL, "");
+
+constexpr char narrow(char c, int n) { c += n; return c; }
+static_assert(narrow(100, 27) == 127, "");
+constexpr unsigned char wrap(unsigned char c) { return ++c; }
+static_assert(wrap(255) == 0, "");
+
+constexpr int shl(int a, int b) { return a << b; } // expected-note {{left shift of negative value -1}}
+static_assert(shl(1, 31) == -2147483647 - 1, "");
+static_assert(shl(-1, 1) == -2, ""); // expected-error {{constant expression}} expected-note {{in call to 'shl(-1, 1)'}}
+
+enum E { A = 3, B = 5 };
+constexpr int sum(int n, int step = B) {
+  int s = A;
+  do {
+    s += step;
+    if (s % 2)
+      continue;
+    --n;
+  } while (n > 0);
+  return s + sizeof(E);
+}
+static_assert(sum(2) == 18 + sizeof(E), "");
+
+constexpr int twice(int n) { return n * 2; } // expected-note {{value 4294967294 is outside the range}}
+static_assert(twice(2147483647), ""); // expected-error {{constant expression}} expected-note {{in call to 'twice(2147483647)'}}
+
+constexpr int quotient(int a, int b) { return a / b; } // expected-note {{division by zero}}
+static_assert(quotient(1, 0), ""); // expected-error {{constant expression}} expected-note {{in call to 'quotient(1, 0)'}}
+
+constexpr int fallback(int n) {
+  switch (n) {
+  case 0: return 1;
+  default: return n * fallback(n - 1);
+  }
+}
+static_assert(fallback(5) == 120, "");
+
+// CHECK: *** Constexpr Bytecode Stats:
+// CHECK-NEXT: 9 functions compiled, 1 not supported.
+// CHECK-NEXT: {{[0-9]+}} calls evaluated, {{[0-9]+}} left to the tree walker.
@@ -0,0 +1,31 @@
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s -fconstexpr-steps 250 -fconstexpr-depth 16
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s -fconstexpr-steps 250 -fconstexpr-depth 16 -fconstexpr-bytecode
+// RUN: not %clang_cc1 -std=c++1y -fsyntax-only %s -fconstexpr-steps 250 -fconstexpr-depth 16 \
+// RUN:   -print-stats 2>&1 | FileCheck %s
+
+// A memoized call still counts against the step and depth limits.
+
+constexpr int steps(int n) { for (int k = 0; k != n; ++k) {} return n; } // expected-note {{step limit}}
+
+constexpr int a = steps(100);
+constexpr int b = steps(100) + steps(100);
+constexpr int c = steps(100) + steps(100) + steps(100); // expected-error {{constant expression}} expected-note {{in call to 'steps(100)'}}
+
+constexpr int depth(int n) { return n ? depth(n - 1) + 1 : 0; } // expected-note {{exceeded maximum depth of 16 calls}} expected-note +{{}}
+constexpr int deep(int n, int k) { return n ? deep(n - 1, k) : depth(k); } // expected-note +{{in call to}}
+
+static_assert(depth(10) == 10, "");
+static_assert(deep(4, 10) == 10, "");
+static_assert(deep(5, 10) == 10, ""); // expected-error {{constant expression}} expected-note {{in call to 'deep(5, 10)'}}
+
+constexpr int counter(int n) {
+  int k = 0;
+  while (k != n)
+    ++k;
+  return k;
+}
+static_assert(counter(50) == 50 && counter(50) == 50, "");
+
+// CHECK: *** Constexpr Call Cache Stats:
+// CHECK-NEXT: {{[0-9]+}} calls memoized.
+// CHECK-NEXT: {{[1-9][0-9]*}} hits, {{[0-9]+}} misses.
@@ -0,0 +1,82 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s -foverload-resolution-cache
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only %s -foverload-resolution-cache \
+// RUN:   -print-stats 2>&1 | FileCheck %s
+// expected-no-diagnostics
+
+struct One { char c[1]; };
+struct Two { char c[2]; };
+
+namespace N {
+  struct A {};
+  template<typename T> One f(T, int);
+  template<typename T> One operator+(T, int);
+}
+
+void test1(N::A a) {
+  static_assert(sizeof(f(a, 1)) == 1, "");
+  static_assert(sizeof(f(a, 1)) == 1, "");
+  static_assert(sizeof(a + 1) == 1, "");
+  static_assert(sizeof(a + 1) == 1, "");
+}
+
+template<typename T> void test3(T t) {
+  static_assert(sizeof(f(t, 1)) == 2, "");
+}
+
+// A better function found by argument-dependent lookup changes the outcome.
+namespace N {
+  Two f(A, int);
+  Two operator+(A, int);
+}
+
+void test2(N::A a) {
+  static_assert(sizeof(f(a, 1)) == 2, "");
+  static_assert(sizeof(a + 1) == 2, "");
+  static_assert(sizeof(f(a, 0)) == 2, "");
+}
+
+// Instantiations share the outcome with the calls above.
+template void test3(N::A);
+
+// Completing a class can give another class a conversion.
+struct Base {};
+struct B;
+struct C { operator B*(); };
+One g(Base *);
+Two g(...);
+
+void test4(C c) {
+  static_assert(sizeof(g(c)) == 2, "");
+}
+
+struct B : Base {};
+
+void test5(C c) {
+  static_assert(sizeof(g(c)) == 1, "");
+}
+
+// A name that deducing template arguments looks up can be declared after a
+// call was cached.
+namespace M {
+  struct A {};
+  template<typename T> auto k(T t) -> decltype(h(t));
+  Two k(...);
+}
+
+void test6(M::A a) {
+  static_assert(sizeof(k(a)) == 2, "");
+}
+
+namespace M {
+  One h(A);
+}
+
+void test7(M::A a) {
+  static_assert(sizeof(k(a)) == 1, "");
+}
+
+// CHECK: *** Overload Resolution Cache Stats:
+// CHECK-NEXT: 6 results cached.
+// CHECK-NEXT: 3 hits, 7 misses, 1 out of date.
+// CHECK-NEXT: 1 uncacheable calls.
@@ -1473,6 +1473,50 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
   return result;
 }
 
+/* Parse two source files with the same arguments in one index, so that the
+ * second can use the precompiled preamble of the first, and test the second.
+ * The first is reparsed once to precompile its preamble. */
+int perform_test_shared_preamble(int argc, const char **argv,
+                                 const char *filter, CXCursorVisitor Visitor) {
+  CXIndex Idx;
+  CXTranslationUnit First;
+  CXTranslationUnit TU;
+  int result;
+
+  Idx = clang_createIndex(/* excludeDeclsFromPCH */
+                          !strcmp(filter, "local") ? 1 : 0,
+                          /* displayDiagnostics=*/1);
+
+  First = clang_parseTranslationUnit(Idx, argv[0], argv + 2, argc - 2, 0, 0,
+                                     getDefaultParsingOptions());
+  if (!First) {
+    fprintf(stderr, "Unable to load translation unit!\n");
+    clang_disposeIndex(Idx);
+    return 1;
+  }
+  if (clang_reparseTranslationUnit(First, 0, 0,
+                                   clang_defaultReparseOptions(First))) {
+    fprintf(stderr, "Unable to reparse translation unit!\n");
+    clang_disposeTranslationUnit(First);
+    clang_disposeIndex(Idx);
+    return -1;
+  }
+
+  TU = clang_parseTranslationUnit(Idx, argv[1], argv + 2, argc - 2, 0, 0,
+                                  getDefaultParsingOptions());
+  /* The second unit keeps the preamble after the first is gone. */
+  clang_disposeTranslationUnit(First);
+  if (!TU) {
+    fprintf(stderr, "Unable to load translation unit!\n");
+    clang_disposeIndex(Idx);
+    return 1;
+  }
+
+  result = perform_test_load(Idx, TU, filter, NULL, Visitor, NULL, NULL);
+  clang_disposeIndex(Idx);
+  return result;
+}
+
 /******************************************************************************/
 /* Logic for testing clang_getCursor().                                       */
 /******************************************************************************/
@@ -1880,6 +1924,9 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   CXTranslationUnit TU = 0;
   unsigned I, Repeats = 1;
   unsigned completionOptions = clang_defaultCodeCompleteOptions();
+  const char *completionFilter = getenv("CINDEXTEST_COMPLETION_FILTER");
+  const char *completionLimit = getenv("CINDEXTEST_COMPLETION_LIMIT");
+  unsigned maxResults = completionLimit ? (unsigned)atoi(completionLimit) : 0;
   
   if (getenv("CINDEXTEST_CODE_COMPLETE_PATTERNS"))
     completionOptions |= CXCodeComplete_IncludeCodePatterns;
@@ -1918,9 +1965,16 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   }
   
   for (I = 0; I != Repeats; ++I) {
-    results = clang_codeCompleteAt(TU, filename, line, column,
-                                   unsaved_files, num_unsaved_files,
-                                   completionOptions);
+    if (completionFilter || maxResults)
+      results = clang_codeCompleteAtWithFilter(TU, filename, line, column,
+                                               unsaved_files,
+                                               num_unsaved_files,
+                                               completionOptions,
+                                               completionFilter, maxResults);
+    else
+      results = clang_codeCompleteAt(TU, filename, line, column,
+                                     unsaved_files, num_unsaved_files,
+                                     completionOptions);
     if (!results) {
       fprintf(stderr, "Unable to perform code completion!\n");
       return 1;
@@ -1936,8 +1990,10 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
     CXString objCSelector;
     const char *selectorString;
     if (!timing_only) {      
-      /* Sort the code-completion results based on the typed text. */
-      clang_sortCodeCompletionResults(results->Results, results->NumResults);
+      /* Sort the code-completion results based on the typed text, unless
+         they are already ranked. */
+      if (!completionFilter && !maxResults)
+        clang_sortCodeCompletionResults(results->Results, results->NumResults);
 
       for (i = 0; i != n; ++i)
         print_completion_result(results->Results + i, stdout);
@@ -2829,6 +2885,31 @@ static IndexerCallbacks IndexCB = {
   index_indexEntityReference
 };
 
+/* Prints each declaration with a single call, so that the lines of
+ * translation units that are indexed concurrently don't interleave. */
+static void index_indexDeclaration_line(CXClientData client_data,
+                                        const CXIdxDeclInfo *info) {
+  const char *container;
+  if (info->flags & CXIdxDeclFlag_Skipped)
+    container = "skipped";
+  else
+    container = info->isContainer ? "1" : "0";
+  printf("[indexDeclaration]: name: %s | isDef: %d | isContainer: %s\n",
+         info->entityInfo->name ? info->entityInfo->name : "<anonymous>",
+         info->isDefinition, container);
+}
+
+static IndexerCallbacks ConcurrentIndexCB = {
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  index_indexDeclaration_line,
+  0
+};
+
 static unsigned getIndexOptions(void) {
   unsigned index_opts;
   index_opts = 0;
@@ -3102,6 +3183,80 @@ static int index_compile_db(int argc, const char **argv) {
   return errorCode;
 }
 
+static int index_compile_db_threads(int argc, const char **argv) {
+  const char *input = argv[0];
+  unsigned num_threads;
+  CXIndex Idx;
+  CXIndexAction idxAction;
+  CXCompilationDatabase db;
+  CXCompilationDatabase_Error ec;
+  IndexData index_data;
+  char *tmp;
+  char *buildDir;
+  unsigned len;
+  int errorCode = 0;
+
+  input += strlen("-index-compile-db-threads=");
+  num_threads = (unsigned)atoi(input);
+
+  if (argc < 2) {
+    fprintf(stderr, "no compilation database\n");
+    return -1;
+  }
+
+  len = strlen(argv[1]);
+  tmp = (char *) malloc(len+1);
+  memcpy(tmp, argv[1], len+1);
+  buildDir = dirname(tmp);
+
+  db = clang_CompilationDatabase_fromDirectory(buildDir, &ec);
+  if (!db) {
+    printf("database loading failed with error code %d.\n", ec);
+    free(tmp);
+    return -1;
+  }
+
+  if (chdir(buildDir) != 0) {
+    printf("Could not chdir to %s\n", buildDir);
+    clang_CompilationDatabase_dispose(db);
+    free(tmp);
+    return -1;
+  }
+
+  if (!(Idx = clang_createIndex(/* excludeDeclsFromPCH */ 1,
+                                /* displayDiagnostics=*/1))) {
+    fprintf(stderr, "Could not create Index\n");
+    clang_CompilationDatabase_dispose(db);
+    free(tmp);
+    return 1;
+  }
+  idxAction = clang_IndexAction_create(Idx);
+
+  index_data.check_prefix = 0;
+  index_data.first_check_printed = 0;
+  index_data.fail_for_error = 0;
+  index_data.abort = 0;
+  index_data.main_filename = "";
+  index_data.importedASTs = 0;
+
+  /* On a single thread, the output is that of -index-compile-db. */
+  if (clang_indexCompilationDatabase(idxAction, &index_data,
+                                     num_threads == 1 ? &IndexCB
+                                                      : &ConcurrentIndexCB,
+                                     sizeof(IndexCB),
+                                     getIndexOptions(), db, num_threads,
+                                     getDefaultParsingOptions()))
+    errorCode = -1;
+  if (index_data.fail_for_error)
+    errorCode = -1;
+
+  clang_IndexAction_dispose(idxAction);
+  clang_disposeIndex(Idx);
+  clang_CompilationDatabase_dispose(db);
+  free(tmp);
+  return errorCode;
+}
+
 int perform_token_annotation(int argc, const char **argv) {
   const char *input = argv[1];
   char *filename = 0;
@@ -3747,6 +3902,7 @@ static void print_usage(void) {
     "       c-index-test -index-file-full [-check-prefix=<FileCheck prefix>] <compiler arguments>\n"
     "       c-index-test -index-tu [-check-prefix=<FileCheck prefix>] <AST file>\n"
     "       c-index-test -index-compile-db [-check-prefix=<FileCheck prefix>] <compilation database>\n"
+    "       c-index-test -index-compile-db-threads=<N> <compilation database>\n"
     "       c-index-test -test-file-scan <AST file> <source file> "
           "[FileCheck prefix]\n");
   fprintf(stderr,
@@ -3763,6 +3919,8 @@ static void print_usage(void) {
     "       c-index-test -test-load-source-usrs <symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-usrs-memory-usage "
           "<symbol filter> {<args>}*\n"
+    "       c-index-test -test-shared-preamble <symbol filter> <source> "
+          "<source> {<args>}*\n"
     "       c-index-test -test-annotate-tokens=<range> {<args>}*\n"
     "       c-index-test -test-inclusion-stack-source {<args>}*\n"
     "       c-index-test -test-inclusion-stack-tu <AST file>\n");
@@ -3812,6 +3970,8 @@ int cindextest_main(int argc, const char **argv) {
     return index_file(argc - 2, argv + 2, /*full=*/1);
   if (argc > 2 && strcmp(argv[1], "-index-tu") == 0)
     return index_tu(argc - 2, argv + 2);
+  if (argc > 2 && strstr(argv[1], "-index-compile-db-threads=") == argv[1])
+    return index_compile_db_threads(argc - 1, argv + 1);
   if (argc > 2 && strcmp(argv[1], "-index-compile-db") == 0)
     return index_compile_db(argc - 2, argv + 2);
   else if (argc >= 4 && strncmp(argv[1], "-test-load-tu", 13) == 0) {
@@ -3839,6 +3999,9 @@ int cindextest_main(int argc, const char **argv) {
       return perform_test_load_source(argc - 3, argv + 3, argv[2], I,
                                       postVisit);
   }
+  else if (argc >= 5 && strcmp(argv[1], "-test-shared-preamble") == 0)
+    return perform_test_shared_preamble(argc - 3, argv + 3, argv[2],
+                                        FilteredPrintingVisitor);
   else if (argc >= 4 && strcmp(argv[1], "-test-file-scan") == 0)
     return perform_file_scan(argv[2], argv[3],
                              argc >= 5 ? argv[4] : 0);
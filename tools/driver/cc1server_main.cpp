@@ -0,0 +1,565 @@
+//===-- cc1server_main.cpp - Clang CC1 Compile Server ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This is the entry point to clang -cc1server, a long-running process that
+// runs the -cc1 jobs that drivers given -fcompile-server send it, so that the
+// targets are initialized once, and the file system lookups, PCH contents
+// and minimized sources of one job are reused by the next job of the same
+// worker.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/ThreadPool.h"
+#include "clang/Driver/CompileServer.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/TextDiagnosticBuffer.h"
+#include "clang/FrontendTool/Utils.h"
+#include "clang/Lex/DependencyDirectivesMinimizer.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <cstdio>
+
+#if defined(LLVM_ON_UNIX)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace clang;
+using namespace clang::driver;
+
+#if defined(LLVM_ON_UNIX)
+
+namespace {
+/// \brief What the fatal error handler needs to end a job.
+struct FatalErrorInfo {
+  DiagnosticsEngine *Diags;
+
+  /// \brief The exit code of the job, once a fatal error happened.
+  int ExitCode;
+
+  FatalErrorInfo() : Diags(0), ExitCode(0) {}
+};
+}
+
+static void LLVMErrorHandler(void *UserData, const std::string &Message,
+                             bool GenCrashDiag) {
+  FatalErrorInfo &Info = *static_cast<FatalErrorInfo*>(UserData);
+
+  Info.Diags->Report(diag::err_fe_error_backend) << Message;
+  Info.ExitCode = GenCrashDiag ? 70 : 1;
+
+  // Abandon the job, and report the error as its result. The worker is
+  // replaced afterwards, since the compiler may be in an inconsistent state.
+  if (llvm::CrashRecoveryContext *CRC =
+        llvm::CrashRecoveryContext::GetCurrent())
+    CRC->HandleCrash();
+
+  llvm::sys::RunInterruptHandlers();
+  exit(Info.ExitCode);
+}
+
+namespace {
+/// \brief Redirects the standard output or error of the process to a
+/// temporary file for as long as it lives.
+class OutputCapture {
+  int StdFD;
+  int SavedFD;
+  SmallString<128> Path;
+
+public:
+  explicit OutputCapture(int StdFD) : StdFD(StdFD), SavedFD(-1) {
+    int FD;
+    if (llvm::sys::fs::createTemporaryFile("clang-server", "out", FD, Path))
+      return;
+    SavedFD = ::dup(StdFD);
+    if (SavedFD == -1 || ::dup2(FD, StdFD) == -1) {
+      if (SavedFD != -1)
+        ::close(SavedFD);
+      SavedFD = -1;
+    }
+    ::close(FD);
+  }
+
+  ~OutputCapture() {
+    if (SavedFD != -1) {
+      ::dup2(SavedFD, StdFD);
+      ::close(SavedFD);
+    }
+    if (!Path.empty()) {
+      bool Existed;
+      llvm::sys::fs::remove(Path.str(), Existed);
+    }
+  }
+
+  /// \brief Stop capturing, and return what was written.
+  std::string take() {
+    if (SavedFD != -1) {
+      ::dup2(SavedFD, StdFD);
+      ::close(SavedFD);
+      SavedFD = -1;
+    }
+    OwningPtr<llvm::MemoryBuffer> Buffer;
+    if (Path.empty() || llvm::MemoryBuffer::getFile(Path.str(), Buffer))
+      return std::string();
+    return Buffer->getBuffer();
+  }
+};
+
+/// \brief The contents of a PCH file, kept for the jobs that include it.
+struct WarmPCH {
+  llvm::sys::fs::UniqueID UniqueID;
+  off_t Size;
+  time_t ModTime;
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+
+  WarmPCH() : UniqueID(0, 0), Size(0), ModTime(0) {}
+};
+
+/// \brief How a job ended.
+enum JobOutcome {
+  JO_Unsupported,
+  JO_Done,
+  JO_FatalError,
+  JO_Crashed
+};
+
+/// \brief The state of a worker of the server that outlives the jobs it
+/// runs, one at a time.
+class CompileServer {
+  const char *Argv0;
+  void *MainAddr;
+  std::string Executable;
+
+  /// \brief The file manager of the last job, with its lookups, or null if
+  /// it can't be reused.
+  IntrusiveRefCntPtr<FileManager> FileMgr;
+
+  /// \brief The working directory the lookups of FileMgr were made from.
+  std::string FileMgrWorkingDir;
+
+  /// \brief The PCH files included by the jobs, by name.
+  llvm::StringMap<WarmPCH> PCHs;
+
+  /// \brief The minimized contents of the files scanned by the jobs given
+  /// -fminimize-dependency-scan.
+  IntrusiveRefCntPtr<MinimizedSourceCache> MinimizedSources;
+
+  /// \brief The number of jobs run so far.
+  unsigned NumJobs;
+
+  bool canReuseFileManager(const FileSystemOptions &Opts,
+                           StringRef WorkingDir);
+  void useWarmPCH(CompilerInstance &Clang);
+  static void runJob(void *Data);
+
+public:
+  CompileServer(const char *Argv0, void *MainAddr)
+    : Argv0(Argv0), MainAddr(MainAddr),
+      Executable(llvm::sys::fs::getMainExecutable(Argv0, MainAddr)),
+      MinimizedSources(new MinimizedSourceCache()), NumJobs(0) {}
+
+  /// \brief Run the job of \p Request, and describe its result in
+  /// \p Response.
+  ///
+  /// \returns how the job ended. After a fatal error or crash, the worker
+  /// must not run any more jobs.
+  JobOutcome handle(ArrayRef<std::string> Request,
+                    std::vector<std::string> &Response, bool Verbose);
+};
+
+/// \brief A job, and what runJob found out about it.
+struct Job {
+  CompileServer *Server;
+  const char **ArgBegin, **ArgEnd;
+  std::string WorkingDir;
+  FatalErrorInfo FatalError;
+  bool Supported;
+  bool ReusedFileManager;
+  int Result;
+
+  Job() : Server(0), ArgBegin(0), ArgEnd(0), Supported(false),
+          ReusedFileManager(false), Result(1) {}
+};
+}
+
+/// \brief Whether the server can run \p Invocation without affecting the
+/// jobs that follow it or needing the driver's standard input.
+///
+/// The options rejected here set process-wide state that can't be reset:
+/// LLVM's command line options, which the backend options are parsed into,
+/// and the statistics counters, which once enabled would be printed by every
+/// later job. The driver runs such jobs itself.
+static bool isSupported(const CompilerInvocation &Invocation) {
+  const FrontendOptions &Opts = Invocation.getFrontendOpts();
+  // -mllvm options and plugins change the process for good.
+  if (!Opts.LLVMArgs.empty() || !Opts.Plugins.empty() ||
+      !Opts.AddPluginActions.empty() ||
+      Opts.ProgramAction == frontend::PluginAction || Opts.ShowStats)
+    return false;
+  const CodeGenOptions &CGOpts = Invocation.getCodeGenOpts();
+  if (!CGOpts.BackendOptions.empty() || !CGOpts.DebugPass.empty() ||
+      !CGOpts.LimitFloatPrecision.empty() || CGOpts.TimePasses ||
+      CGOpts.NoGlobalMerge)
+    return false;
+  for (unsigned I = 0, N = Opts.Inputs.size(); I != N; ++I)
+    if (!Opts.Inputs[I].isBuffer() && Opts.Inputs[I].getFile() == "-")
+      return false;
+  return true;
+}
+
+bool CompileServer::canReuseFileManager(const FileSystemOptions &Opts,
+                                        StringRef WorkingDir) {
+  if (!FileMgr)
+    return false;
+  // Relative lookups are cached by name. The persistent stat cache is
+  // attached to each new file manager, and written back when it is freed.
+  if (WorkingDir != FileMgrWorkingDir ||
+      Opts.WorkingDir != FileMgr->getFileSystemOptions().WorkingDir ||
+      !Opts.StatCachePath.empty())
+    return false;
+  return FileMgr->revalidateLookups();
+}
+
+/// \brief Whether \p Action reads a PCH with the AST reader, rather than
+/// including its original header.
+static bool readsPCHAsAST(frontend::ActionKind Action) {
+  switch (Action) {
+  case frontend::ParseSyntaxOnly:
+  case frontend::EmitAssembly:
+  case frontend::EmitBC:
+  case frontend::EmitLLVM:
+  case frontend::EmitLLVMOnly:
+  case frontend::EmitCodeGenOnly:
+  case frontend::EmitObj:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// \brief Hand the job the contents of its PCH file that an earlier job read,
+/// if the file hasn't changed since.
+void CompileServer::useWarmPCH(CompilerInstance &Clang) {
+  PreprocessorOptions &PPOpts = Clang.getPreprocessorOpts();
+  if (PPOpts.ImplicitPCHInclude.empty() || PPOpts.ImplicitPCHBuffer ||
+      !readsPCHAsAST(Clang.getFrontendOpts().ProgramAction))
+    return;
+
+  // A directory of PCH files is searched by the job.
+  const FileEntry *File =
+    Clang.getFileManager().getFile(PPOpts.ImplicitPCHInclude);
+  if (!File)
+    return;
+
+  WarmPCH &PCH = PCHs[PPOpts.ImplicitPCHInclude];
+  if (!PCH.Buffer || !(PCH.UniqueID == File->getUniqueID()) ||
+      PCH.Size != File->getSize() ||
+      PCH.ModTime != File->getModificationTime()) {
+    PCH.Buffer.reset(Clang.getFileManager().getBufferForFile(File));
+    if (!PCH.Buffer) {
+      PCHs.erase(PPOpts.ImplicitPCHInclude);
+      return;
+    }
+    PCH.UniqueID = File->getUniqueID();
+    PCH.Size = File->getSize();
+    PCH.ModTime = File->getModificationTime();
+  }
+  PPOpts.ImplicitPCHBuffer = PCH.Buffer.get();
+}
+
+void CompileServer::runJob(void *Data) {
+  Job &J = *static_cast<Job*>(Data);
+  CompileServer &Server = *J.Server;
+
+  OwningPtr<CompilerInstance> Clang(new CompilerInstance());
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticBuffer *DiagsBuffer = new TextDiagnosticBuffer;
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagsBuffer);
+  bool Success = CompilerInvocation::CreateFromArgs(Clang->getInvocation(),
+                                                    J.ArgBegin, J.ArgEnd,
+                                                    Diags);
+  J.Supported = isSupported(Clang->getInvocation());
+  if (!J.Supported)
+    return;
+
+  if (Clang->getHeaderSearchOpts().UseBuiltinIncludes &&
+      Clang->getHeaderSearchOpts().ResourceDir.empty())
+    Clang->getHeaderSearchOpts().ResourceDir =
+      CompilerInvocation::GetResourcesPath(Server.Argv0, Server.MainAddr);
+
+  // Everything must be freed for the next job.
+  Clang->getFrontendOpts().DisableFree = false;
+
+  J.ReusedFileManager =
+    canReuseFileManager(Clang->getFileSystemOpts(), J.WorkingDir);
+  if (J.ReusedFileManager)
+    Clang->setFileManager(Server.FileMgr.getPtr());
+  else
+    Clang->createFileManager();
+  Server.FileMgr = 0;
+
+  Clang->createDiagnostics();
+  if (!Clang->hasDiagnostics())
+    return;
+
+  J.FatalError.Diags = &Clang->getDiagnostics();
+  llvm::install_fatal_error_handler(LLVMErrorHandler,
+                                    static_cast<void*>(&J.FatalError));
+
+  DiagsBuffer->FlushDiagnostics(Clang->getDiagnostics());
+  if (Success) {
+    Server.useWarmPCH(*Clang);
+    if (Clang->getPreprocessorOpts().MinimizeSourceToDependencyDirectives)
+      Clang->getPreprocessorOpts().MinimizedSources = Server.MinimizedSources;
+    Success = ExecuteCompilerInvocation(Clang.get());
+  }
+
+  llvm::TimerGroup::printAll(llvm::errs());
+  llvm::remove_fatal_error_handler();
+
+  // Keep the lookups for the next job. The stat caches belong to this one,
+  // e.g. to its PTH file.
+  if (Clang->hasFileManager()) {
+    Server.FileMgr = &Clang->getFileManager();
+    Server.FileMgr->clearStatCaches();
+    Server.FileMgrWorkingDir = J.WorkingDir;
+  }
+
+  J.Result = !Success;
+}
+
+JobOutcome CompileServer::handle(ArrayRef<std::string> Request,
+                                 std::vector<std::string> &Response,
+                                 bool Verbose) {
+  Response.push_back(CompileServerProtocolVersion);
+
+  // Only run the jobs of this very compiler.
+  bool SameExecutable = false;
+  if (Request.size() < 5 || Request[0] != CompileServerProtocolVersion ||
+      Request[1] != "compile" || Request[4] != "-cc1" ||
+      llvm::sys::fs::equivalent(Request[2], Executable, SameExecutable) ||
+      !SameExecutable || ::chdir(Request[3].c_str()) != 0) {
+    Response.push_back("unsupported");
+    return JO_Unsupported;
+  }
+
+  std::vector<const char *> Args;
+  for (unsigned I = 5, N = Request.size(); I != N; ++I)
+    Args.push_back(Request[I].c_str());
+
+  Job J;
+  J.Server = this;
+  J.ArgBegin = Args.data();
+  J.ArgEnd = Args.data() + Args.size();
+  J.WorkingDir = Request[3];
+
+  llvm::outs().flush();
+  llvm::errs().flush();
+  fflush(stdout);
+  fflush(stderr);
+  OutputCapture Out(STDOUT_FILENO), Err(STDERR_FILENO);
+
+  // Recover from crashes and fatal errors in the job, so that the driver
+  // hears about them rather than finding the server gone.
+  llvm::CrashRecoveryContext CRC;
+  bool Completed = CRC.RunSafely(runJob, &J);
+  llvm::remove_fatal_error_handler();
+
+  llvm::outs().flush();
+  llvm::outs().clear_error();
+  llvm::errs().flush();
+  fflush(stdout);
+  fflush(stderr);
+  std::string OutData = Out.take(), ErrData = Err.take();
+
+  ++NumJobs;
+  JobOutcome Outcome = JO_Done;
+  if (!Completed) {
+    // The file manager may be in the middle of an update.
+    FileMgr = 0;
+    Outcome = J.FatalError.ExitCode ? JO_FatalError : JO_Crashed;
+    J.Result = J.FatalError.ExitCode;
+  } else if (!J.Supported) {
+    Outcome = JO_Unsupported;
+  }
+
+  if (Verbose) {
+    llvm::errs() << "clang -cc1server: job " << NumJobs << ": ";
+    switch (Outcome) {
+    case JO_Unsupported: llvm::errs() << "unsupported"; break;
+    case JO_Done: llvm::errs() << "exit code " << J.Result; break;
+    case JO_FatalError: llvm::errs() << "fatal error"; break;
+    case JO_Crashed: llvm::errs() << "crashed"; break;
+    }
+    if (J.ReusedFileManager)
+      llvm::errs() << " (reused file lookups)";
+    llvm::errs() << "\n";
+  }
+
+  switch (Outcome) {
+  case JO_Unsupported:
+    Response.push_back("unsupported");
+    break;
+  case JO_Crashed:
+    // The driver runs the job again, and reports the crash.
+    Response.push_back("crashed");
+    break;
+  case JO_Done:
+  case JO_FatalError:
+    Response.push_back("done");
+    Response.push_back(llvm::utostr(J.Result));
+    Response.push_back(OutData);
+    Response.push_back(ErrData);
+    break;
+  }
+  return Outcome;
+}
+
+/// \brief The exit code of a worker that stopped because it was idle, as
+/// opposed to one that must be replaced.
+static const int IdleWorkerExitCode = 0;
+
+/// \brief Run jobs from connections to \p ListenFD until no connection comes
+/// for \p IdleTimeout seconds, or until a job leaves the process in a state
+/// that later jobs can't use.
+static int runWorker(int ListenFD, unsigned IdleTimeout, bool Verbose,
+                     const char *Argv0, void *MainAddr) {
+  CompileServer Server(Argv0, MainAddr);
+  for (;;) {
+    bool TimedOut;
+    int FD = acceptCompileServerConnection(ListenFD, IdleTimeout, TimedOut);
+    if (FD == -1)
+      return TimedOut ? IdleWorkerExitCode : 1;
+
+    std::vector<std::string> Request, Response;
+    JobOutcome Outcome = JO_Done;
+    if (!readCompileServerMessage(FD, Request)) {
+      Outcome = Server.handle(Request, Response, Verbose);
+      writeCompileServerMessage(FD, Response);
+    }
+    closeCompileServerSocket(FD);
+
+    if (Outcome == JO_FatalError || Outcome == JO_Crashed)
+      return 1;
+  }
+}
+
+/// \brief Start a worker process.
+///
+/// \returns its process ID, or -1 on error.
+static pid_t startWorker(int ListenFD, unsigned IdleTimeout, bool Verbose,
+                         const char *Argv0, void *MainAddr) {
+  pid_t Pid = ::fork();
+  if (Pid == 0)
+    ::_exit(runWorker(ListenFD, IdleTimeout, Verbose, Argv0, MainAddr));
+  return Pid;
+}
+
+int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                   const char *Argv0, void *MainAddr) {
+  unsigned NumWorkers = 0, IdleTimeout = 0;
+  bool Verbose = false;
+  const char *SocketPath = 0;
+  for (const char **Arg = ArgBegin; Arg != ArgEnd; ++Arg) {
+    StringRef A(*Arg);
+    if ((A == "-j" || A == "-idle-timeout") && Arg + 1 != ArgEnd) {
+      unsigned &Value = A == "-j" ? NumWorkers : IdleTimeout;
+      if (StringRef(*++Arg).getAsInteger(10, Value))
+        SocketPath = 0, Arg = ArgEnd - 1;
+    } else if (A == "-v") {
+      Verbose = true;
+    } else if (!SocketPath && !A.startswith("-")) {
+      SocketPath = *Arg;
+    } else {
+      SocketPath = 0;
+      break;
+    }
+  }
+  if (!SocketPath) {
+    llvm::errs() << "usage: clang -cc1server [-j <workers>] "
+                    "[-idle-timeout <seconds>] [-v] <socket>\n";
+    return 1;
+  }
+  if (!NumWorkers)
+    NumWorkers = ThreadPool::getHardwareConcurrency();
+
+  std::string Error;
+  int ListenFD = listenOnCompileServerSocket(SocketPath, Error);
+  if (ListenFD == -1) {
+    llvm::errs() << "error: unable to listen on '" << SocketPath << "': "
+                 << Error << "\n";
+    return 1;
+  }
+
+  // Done once, before the workers are forked.
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::InitializeAllAsmParsers();
+  llvm::CrashRecoveryContext::Enable();
+
+  // Each worker runs one job at a time, so that the jobs of parallel builds
+  // run in parallel, while the process-wide state of a job (the working
+  // directory, standard output and error, error handlers) stays its own.
+  unsigned NumRunning = 0;
+  for (unsigned I = 0; I != NumWorkers; ++I)
+    if (startWorker(ListenFD, IdleTimeout, Verbose, Argv0, MainAddr) != -1)
+      ++NumRunning;
+
+  // Replace the workers that stopped because of a failed job, until all of
+  // them are idle.
+  while (NumRunning) {
+    int Status;
+    pid_t Pid = ::waitpid(-1, &Status, 0);
+    if (Pid == -1) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    --NumRunning;
+    if (WIFEXITED(Status) && WEXITSTATUS(Status) == IdleWorkerExitCode)
+      continue;
+    if (startWorker(ListenFD, IdleTimeout, Verbose, Argv0, MainAddr) != -1)
+      ++NumRunning;
+  }
+
+  ::unlink(SocketPath);
+  closeCompileServerSocket(ListenFD);
+  return 0;
+}
+
+#else
+
+int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                   const char *Argv0, void *MainAddr) {
+  llvm::errs() << "error: compile servers are not supported on this host\n";
+  return 1;
+}
+
+#endif
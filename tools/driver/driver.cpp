@@ -190,6 +190,8 @@ extern int cc1_main(const char **ArgBegin, const char **ArgEnd,
                     const char *Argv0, void *MainAddr);
 extern int cc1as_main(const char **ArgBegin, const char **ArgEnd,
                       const char *Argv0, void *MainAddr);
+extern int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                          const char *Argv0, void *MainAddr);
 
 static void ParseProgName(SmallVectorImpl<const char *> &ArgVector,
                           std::set<std::string> &SavedStrings,
@@ -316,6 +318,9 @@ int main(int argc_, const char **argv_) {
     if (Tool == "as")
       return cc1as_main(argv.data()+2, argv.data()+argv.size(), argv[0],
                       (void*) (intptr_t) GetExecutablePath);
+    if (Tool == "server")
+      return cc1server_main(argv.data()+2, argv.data()+argv.size(), argv[0],
+                            (void*) (intptr_t) GetExecutablePath);
 
     // Reject unknown tools.
     llvm::errs() << "error: unknown integrated tool '" << Tool << "'\n";
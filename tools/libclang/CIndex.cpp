@@ -2762,7 +2762,8 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
                                  SkipFunctionBodies,
                                  /*UserFilesAreVolatile=*/true,
                                  ForSerialization,
-                                 &ErrUnit));
+                                 &ErrUnit,
+                                 CXXIdx->getPreambleCache()));
 
   if (NumErrors != Diags->getClient()->getNumErrors()) {
     // Make sure to check that 'Unit' is non-NULL.
@@ -21,6 +21,7 @@
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclObjC.h"
 #include "clang/AST/Type.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/ASTUnit.h"
@@ -37,6 +38,7 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
@@ -525,36 +527,144 @@ static unsigned long long getContextsForContextKind(
   return contexts;
 }
 
+static StringRef GetTypedName(CodeCompletionString *String,
+                              SmallString<256> &Buffer);
+static bool isTypedNameBefore(StringRef XText, StringRef YText);
+
+/// \brief The rank of a result whose typed text doesn't match the filter.
+static const unsigned NoFilterMatch = ~0U;
+
+/// \brief Determine how well the typed text \p Name of a code-completion
+/// result matches the text \p Filter typed so far.
+///
+/// \returns 0 if \p Name starts with \p Filter, 1 if it does when case is
+/// ignored, 2 if it contains the characters of \p Filter in order, and
+/// NoFilterMatch otherwise.
+static unsigned getFilterMatchRank(StringRef Filter, StringRef Name) {
+  if (Name.startswith(Filter))
+    return 0;
+  if (Name.size() >= Filter.size() &&
+      Name.substr(0, Filter.size()).equals_lower(Filter))
+    return 1;
+
+  size_t Pos = 0;
+  for (unsigned I = 0, N = Filter.size(); I != N; ++I, ++Pos) {
+    char C = toLowercase(Filter[I]);
+    while (Pos != Name.size() && toLowercase(Name[Pos]) != C)
+      ++Pos;
+    if (Pos == Name.size())
+      return NoFilterMatch;
+  }
+  return 2;
+}
+
+/// \brief Determine the typed text of a code-completion result without
+/// building its completion string, when that is cheap.
+///
+/// \returns false if the typed text is only known from the completion
+/// string.
+static bool getTypedNameWithoutString(const CodeCompletionResult &R,
+                                      StringRef &Name) {
+  switch (R.Kind) {
+  case CodeCompletionResult::RK_Keyword:
+    Name = R.Keyword;
+    return true;
+
+  case CodeCompletionResult::RK_Macro:
+    Name = R.Macro->getName();
+    return true;
+
+  case CodeCompletionResult::RK_Declaration:
+    // The typed text of an Objective-C method depends on the selector
+    // pieces typed so far.
+    if (isa<ObjCMethodDecl>(R.Declaration))
+      return false;
+    if (IdentifierInfo *II
+          = R.Declaration->getDeclName().getAsIdentifierInfo()) {
+      Name = II->getName();
+      return true;
+    }
+    return false;
+
+  case CodeCompletionResult::RK_Pattern:
+    return false;
+  }
+  llvm_unreachable("Unknown code-completion result kind");
+}
+
 namespace {
+  /// \brief A code-completion result that passed the filter, with what it is
+  /// ranked on.
+  struct RankedCompletionResult {
+    unsigned MatchRank;
+    unsigned Priority;
+    StringRef TypedName;
+    CXCompletionResult Result;
+
+    /// \brief The index of the result among those Sema produced, to build
+    /// its completion string once it is among the best results.
+    unsigned Index;
+  };
+
+  struct OrderRankedCompletionResults {
+    bool operator()(const RankedCompletionResult &X,
+                    const RankedCompletionResult &Y) const {
+      if (X.MatchRank != Y.MatchRank)
+        return X.MatchRank < Y.MatchRank;
+      if (X.Priority != Y.Priority)
+        return X.Priority < Y.Priority;
+      return isTypedNameBefore(X.TypedName, Y.TypedName);
+    }
+  };
+
   class CaptureCompletionResults : public CodeCompleteConsumer {
     AllocatedCXCodeCompleteResults &AllocatedResults;
     CodeCompletionTUInfo CCTUInfo;
     SmallVector<CXCompletionResult, 16> StoredResults;
     CXTranslationUnit *TU;
+
+    /// \brief The text typed so far that results must match.
+    StringRef Filter;
+
+    /// \brief The maximum number of results, or 0 if there is no limit.
+    unsigned MaxResults;
+
+    /// \brief The results that passed the filter, when results are filtered
+    /// or limited.
+    SmallVector<RankedCompletionResult, 16> RankedResults;
+
   public:
     CaptureCompletionResults(const CodeCompleteOptions &Opts,
                              AllocatedCXCodeCompleteResults &Results,
-                             CXTranslationUnit *TranslationUnit)
+                             CXTranslationUnit *TranslationUnit,
+                             StringRef Filter = StringRef(),
+                             unsigned MaxResults = 0)
       : CodeCompleteConsumer(Opts, false), 
         AllocatedResults(Results), CCTUInfo(Results.CodeCompletionAllocator),
-        TU(TranslationUnit) { }
+        TU(TranslationUnit), Filter(Filter), MaxResults(MaxResults) { }
     ~CaptureCompletionResults() { Finish(); }
+
+    bool isRanking() const { return !Filter.empty() || MaxResults; }
     
     virtual void ProcessCodeCompleteResults(Sema &S, 
                                             CodeCompletionContext Context,
                                             CodeCompletionResult *Results,
                                             unsigned NumResults) {
-      StoredResults.reserve(StoredResults.size() + NumResults);
-      for (unsigned I = 0; I != NumResults; ++I) {
-        CodeCompletionString *StoredCompletion        
-          = Results[I].CreateCodeCompletionString(S, getAllocator(),
-                                                  getCodeCompletionTUInfo(),
-                                                  includeBriefComments());
-        
-        CXCompletionResult R;
-        R.CursorKind = Results[I].CursorKind;
-        R.CompletionString = StoredCompletion;
-        StoredResults.push_back(R);
+      if (isRanking()) {
+        RankResults(S, Results, NumResults);
+      } else {
+        StoredResults.reserve(StoredResults.size() + NumResults);
+        for (unsigned I = 0; I != NumResults; ++I) {
+          CodeCompletionString *StoredCompletion        
+            = Results[I].CreateCodeCompletionString(S, getAllocator(),
+                                                    getCodeCompletionTUInfo(),
+                                                    includeBriefComments());
+          
+          CXCompletionResult R;
+          R.CursorKind = Results[I].CursorKind;
+          R.CompletionString = StoredCompletion;
+          StoredResults.push_back(R);
+        }
       }
       
       enum CodeCompletionContext::Kind contextKind = Context.getKind();
@@ -629,7 +739,13 @@ namespace {
         CXCompletionResult R;
         R.CursorKind = CXCursor_NotImplemented;
         R.CompletionString = StoredCompletion;
-        StoredResults.push_back(R);
+        if (isRanking()) {
+          RankedCompletionResult RR = { 0, StoredCompletion->getPriority(),
+                                        StringRef(), R, 0 };
+          RankedResults.push_back(RR);
+        } else {
+          StoredResults.push_back(R);
+        }
       }
     }
     
@@ -640,7 +756,75 @@ namespace {
     virtual CodeCompletionTUInfo &getCodeCompletionTUInfo() { return CCTUInfo; }
     
   private:
+    /// \brief Keep the results that match the filter and, if the number of
+    /// results is limited, the best of them, building only their completion
+    /// strings.
+    void RankResults(Sema &S, CodeCompletionResult *Results,
+                     unsigned NumResults) {
+      SmallVector<RankedCompletionResult, 16> Matches;
+      for (unsigned I = 0; I != NumResults; ++I) {
+        RankedCompletionResult RR;
+        RR.Priority = Results[I].Priority;
+        RR.Result.CursorKind = Results[I].CursorKind;
+        RR.Result.CompletionString = 0;
+        RR.Index = I;
+
+        if (!getTypedNameWithoutString(Results[I], RR.TypedName)) {
+          CodeCompletionString *CCS
+            = Results[I].CreateCodeCompletionString(S, getAllocator(),
+                                                    getCodeCompletionTUInfo(),
+                                                    includeBriefComments());
+          SmallString<256> Buffer;
+          RR.TypedName = GetTypedName(CCS, Buffer);
+          if (!Buffer.empty())
+            RR.TypedName = getAllocator().CopyString(RR.TypedName);
+          RR.Result.CompletionString = CCS;
+        }
+
+        RR.MatchRank = getFilterMatchRank(Filter, RR.TypedName);
+        if (RR.MatchRank != NoFilterMatch)
+          Matches.push_back(RR);
+      }
+
+      selectBestResults(Matches);
+      for (unsigned I = 0, N = Matches.size(); I != N; ++I) {
+        RankedCompletionResult &RR = Matches[I];
+        if (!RR.Result.CompletionString) {
+          RR.Result.CompletionString
+            = Results[RR.Index].CreateCodeCompletionString(S, getAllocator(),
+                                                    getCodeCompletionTUInfo(),
+                                                    includeBriefComments());
+          // The name of a macro or a declaration belongs to the identifier
+          // table of the preprocessor, which is gone by the time the results
+          // of all batches are merged in Finish().
+          RR.TypedName = getAllocator().CopyString(RR.TypedName);
+        }
+        RankedResults.push_back(RR);
+      }
+    }
+
+    /// \brief Order the best \c MaxResults of \p Results first, and drop the
+    /// others, without sorting all of them.
+    void selectBestResults(SmallVectorImpl<RankedCompletionResult> &Results) {
+      if (!MaxResults || Results.size() <= MaxResults) {
+        std::sort(Results.begin(), Results.end(),
+                  OrderRankedCompletionResults());
+        return;
+      }
+      std::partial_sort(Results.begin(), Results.begin() + MaxResults,
+                        Results.end(), OrderRankedCompletionResults());
+      Results.resize(MaxResults);
+    }
+
     void Finish() {
+      if (isRanking()) {
+        // Results may have come from more than one batch.
+        selectBestResults(RankedResults);
+        for (unsigned I = 0, N = RankedResults.size(); I != N; ++I)
+          StoredResults.push_back(RankedResults[I].Result);
+        RankedResults.clear();
+      }
+
       AllocatedResults.Results = new CXCompletionResult [StoredResults.size()];
       AllocatedResults.NumResults = StoredResults.size();
       std::memcpy(AllocatedResults.Results, StoredResults.data(), 
@@ -659,6 +843,8 @@ struct CodeCompleteAtInfo {
   struct CXUnsavedFile *unsaved_files;
   unsigned num_unsaved_files;
   unsigned options;
+  const char *filter;
+  unsigned max_results;
   CXCodeCompleteResults *result;
 };
 void clang_codeCompleteAt_Impl(void *UserData) {
@@ -714,7 +900,9 @@ void clang_codeCompleteAt_Impl(void *UserData) {
   // Create a code-completion consumer to capture the results.
   CodeCompleteOptions Opts;
   Opts.IncludeBriefComments = IncludeBriefComments;
-  CaptureCompletionResults Capture(Opts, *Results, &TU);
+  CaptureCompletionResults Capture(Opts, *Results, &TU,
+                                   CCAI->filter ? CCAI->filter : "",
+                                   CCAI->max_results);
 
   // Perform completion.
   AST->CodeComplete(complete_filename, complete_line, complete_column,
@@ -816,14 +1004,34 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
                                             struct CXUnsavedFile *unsaved_files,
                                             unsigned num_unsaved_files,
                                             unsigned options) {
+  return clang_codeCompleteAtWithFilter(TU, complete_filename, complete_line,
+                                        complete_column, unsaved_files,
+                                        num_unsaved_files, options,
+                                        /*filter=*/0, /*max_results=*/0);
+}
+
+CXCodeCompleteResults *
+clang_codeCompleteAtWithFilter(CXTranslationUnit TU,
+                               const char *complete_filename,
+                               unsigned complete_line,
+                               unsigned complete_column,
+                               struct CXUnsavedFile *unsaved_files,
+                               unsigned num_unsaved_files,
+                               unsigned options,
+                               const char *filter,
+                               unsigned max_results) {
   LOG_FUNC_SECTION {
     *Log << TU << ' '
          << complete_filename << ':' << complete_line << ':' << complete_column;
+    if (filter)
+      *Log << " filter: " << filter;
+    if (max_results)
+      *Log << " max: " << max_results;
   }
 
   CodeCompleteAtInfo CCAI = { TU, complete_filename, complete_line,
                               complete_column, unsaved_files, num_unsaved_files,
-                              options, 0 };
+                              options, filter, max_results, 0 };
 
   if (getenv("LIBCLANG_NOTHREADS")) {
     clang_codeCompleteAt_Impl(&CCAI);
@@ -965,6 +1173,22 @@ static StringRef GetTypedName(CodeCompletionString *String,
   return Result;
 }
 
+/// \brief Determine whether a result with the typed text \p XText comes
+/// before one with the typed text \p YText in alphabetical order.
+static bool isTypedNameBefore(StringRef XText, StringRef YText) {
+  if (XText.empty() || YText.empty())
+    return !XText.empty();
+        
+  int result = XText.compare_lower(YText);
+  if (result < 0)
+    return true;
+  if (result > 0)
+    return false;
+  
+  result = XText.compare(YText);
+  return result < 0;
+}
+
 namespace {
   struct OrderCompletionResults {
     bool operator()(const CXCompletionResult &XR, 
@@ -978,18 +1202,7 @@ namespace {
       StringRef XText = GetTypedName(X, XBuffer);
       SmallString<256> YBuffer;
       StringRef YText = GetTypedName(Y, YBuffer);
-      
-      if (XText.empty() || YText.empty())
-        return !XText.empty();
-            
-      int result = XText.compare_lower(YText);
-      if (result < 0)
-        return true;
-      if (result > 0)
-        return false;
-      
-      result = XText.compare(YText);
-      return result < 0;
+      return isTypedNameBefore(XText, YText);
     }
   };
 }
@@ -16,6 +16,7 @@
 #define LLVM_CLANG_CINDEXER_H
 
 #include "clang-c/Index.h"
+#include "clang/Frontend/PrecompiledPreambleCache.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Path.h"
 #include <vector>
@@ -39,9 +40,14 @@ class CIndexer {
 
   std::string ResourcesPath;
 
+  /// \brief The precompiled preambles shared by the translation units of
+  /// this index.
+  IntrusiveRefCntPtr<PrecompiledPreambleCache> PreambleCache;
+
 public:
  CIndexer() : OnlyLocalDecls(false), DisplayDiagnostics(false),
-              Options(CXGlobalOpt_None) { }
+              Options(CXGlobalOpt_None),
+              PreambleCache(new PrecompiledPreambleCache()) { }
   
   /// \brief Whether we only want to see "local" declarations (that did not
   /// come from a previous precompiled header). If false, we want to see all
@@ -63,6 +69,10 @@ public:
 
   /// \brief Get the path of the clang resource files.
   const std::string &getClangResourcesPath();
+
+  PrecompiledPreambleCache *getPreambleCache() const {
+    return PreambleCache.getPtr();
+  }
 };
 
   /// \brief Return the current size to request for "safety".
@@ -17,6 +17,7 @@
 #include "CXTranslationUnit.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/DeclVisitor.h"
+#include "clang/Basic/ThreadPool.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/CompilerInvocation.h"
@@ -27,6 +28,7 @@
 #include "clang/Lex/PPConditionalDirectiveRecord.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/SemaConsumer.h"
+#include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Mutex.h"
@@ -145,24 +147,31 @@ namespace llvm {
 
 namespace {
 
+/// \brief The regions whose bodies were parsed by the translation units of
+/// an indexing session, which may be indexed on several threads at once.
 class SessionSkipBodyData {
   llvm::sys::Mutex Mux;
   PPRegionSetTy ParsedRegions;
 
 public:
   SessionSkipBodyData() : Mux(/*recursive=*/false) {}
-  ~SessionSkipBodyData() {
-    //llvm::errs() << "RegionData: " << Skipped.size() << " - " << Skipped.getMemorySize() << "\n";
-  }
 
-  void copyTo(PPRegionSetTy &Set) {
+  /// \brief Claim the parsing of the bodies of \p Region for the calling
+  /// translation unit.
+  ///
+  /// \returns false if another translation unit already claimed it.
+  bool claim(const PPRegion &Region) {
     llvm::MutexGuard MG(Mux);
-    Set = ParsedRegions;
+    return ParsedRegions.insert(Region).second;
   }
 
-  void update(ArrayRef<PPRegion> Regions) {
+  /// \brief Give up the claims of a translation unit that didn't parse the
+  /// bodies of \p Regions after all, so that later ones parse them.
+  void release(const PPRegionSetTy &Regions) {
     llvm::MutexGuard MG(Mux);
-    ParsedRegions.insert(Regions.begin(), Regions.end());
+    for (PPRegionSetTy::const_iterator I = Regions.begin(), E = Regions.end();
+         I != E; ++I)
+      ParsedRegions.erase(*I);
   }
 };
 
@@ -171,19 +180,29 @@ class TUSkipBodyControl {
   PPConditionalDirectiveRecord &PPRec;
   Preprocessor &PP;
 
-  PPRegionSetTy ParsedRegions;
-  SmallVector<PPRegion, 32> NewParsedRegions;
+  /// \brief The regions whose bodies this translation unit parses.
+  PPRegionSetTy ClaimedRegions;
   PPRegion LastRegion;
   bool LastIsParsed;
+  bool Finished;
 
 public:
   TUSkipBodyControl(SessionSkipBodyData &sessionData,
                     PPConditionalDirectiveRecord &ppRec,
                     Preprocessor &pp)
-    : SessionData(sessionData), PPRec(ppRec), PP(pp) {
-    SessionData.copyTo(ParsedRegions);
+    : SessionData(sessionData), PPRec(ppRec), PP(pp), Finished(false) { }
+
+  /// \brief Releases the claimed regions unless the translation unit was
+  /// finished, e.g. because it was aborted or crashed.
+  ~TUSkipBodyControl() {
+    if (!Finished)
+      SessionData.release(ClaimedRegions);
   }
 
+  /// \brief Keep the claimed regions, as the translation unit was parsed
+  /// through to its end.
+  void finished() { Finished = true; }
+
   bool isParsed(SourceLocation Loc, FileID FID, const FileEntry *FE) {
     PPRegion region = getRegion(Loc, FID, FE);
     if (region.isInvalid())
@@ -193,17 +212,20 @@ public:
     if (LastRegion == region)
       return LastIsParsed;
 
+    // A region is claimed when it is first seen, rather than when the
+    // translation unit is finished, so that translation units indexed
+    // concurrently don't all parse the bodies of the same headers.
     LastRegion = region;
-    LastIsParsed = ParsedRegions.count(region);
-    if (!LastIsParsed)
-      NewParsedRegions.push_back(region);
+    LastIsParsed = false;
+    if (!ClaimedRegions.count(region)) {
+      if (SessionData.claim(region))
+        ClaimedRegions.insert(region);
+      else
+        LastIsParsed = true;
+    }
     return LastIsParsed;
   }
 
-  void finished() {
-    SessionData.update(NewParsedRegions);
-  }
-
 private:
   PPRegion getRegion(SourceLocation Loc, FileID FID, const FileEntry *FE) {
     SourceLocation RegionLoc = PPRec.findConditionalDirectiveRegionLoc(Loc);
@@ -324,7 +346,10 @@ public:
   }
 
   virtual void HandleTranslationUnit(ASTContext &Ctx) {
-    if (SKCtrl)
+    // A translation unit that hit a fatal error may have stopped before the
+    // bodies of the regions it claimed.
+    if (SKCtrl && !IndexCtx.shouldAbort() &&
+        !Ctx.getDiagnostics().hasFatalErrorOccurred())
       SKCtrl->finished();
   }
 
@@ -667,7 +692,9 @@ static void clang_indexSourceFile_Impl(void *UserData) {
                                                        PrecompilePreamble,
                                                     CacheCodeCompletionResults,
                                  /*IncludeBriefCommentsInCodeCompletion=*/false,
-                                                 /*UserFilesAreVolatile=*/true);
+                                                 /*UserFilesAreVolatile=*/true,
+                                                       /*ErrAST=*/0,
+                                                  CXXIdx->getPreambleCache());
   if (DiagTrap.hasErrorOccurred() && CXXIdx->getDisplayDiagnostics())
     printDiagsToStderr(Unit);
 
@@ -810,6 +837,65 @@ static void clang_indexTranslationUnit_Impl(void *UserData) {
   ITUI->result = 0;
 }
 
+//===----------------------------------------------------------------------===//
+// clang_indexCompilationDatabase Implementation
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief The arguments of clang_indexCompilationDatabase, shared by the
+/// translation units it indexes.
+struct IndexCompilationDatabaseInfo {
+  CXIndexAction idxAction;
+  CXClientData client_data;
+  IndexerCallbacks CB;
+  unsigned index_options;
+  unsigned TU_options;
+};
+
+/// \brief The indexing of the translation unit of one compile command, run on
+/// a worker thread.
+struct IndexCompileCommandTask {
+  const IndexCompilationDatabaseInfo *Info;
+  const tooling::CompileCommand *Command;
+  int result;
+};
+
+} // anonymous namespace
+
+static void indexCompileCommand(void *UserData) {
+  IndexCompileCommandTask *Task =
+    static_cast<IndexCompileCommandTask *>(UserData);
+  const IndexCompilationDatabaseInfo &Info = *Task->Info;
+  const tooling::CompileCommand &Command = *Task->Command;
+  Task->result = 1; // init as error.
+
+  // Give the client a chance to stop before the translation unit is parsed.
+  if (Info.CB.abortQuery && Info.CB.abortQuery(Info.client_data, 0)) {
+    Task->result = 0;
+    return;
+  }
+
+  // The first argument is the compiler.
+  std::vector<const char *> Args;
+  for (unsigned I = 1, N = Command.CommandLine.size(); I < N; ++I)
+    Args.push_back(Command.CommandLine[I].c_str());
+
+  // Relative paths in the command are relative to its directory, which
+  // can't be made the working directory of just this thread.
+  Args.push_back("-working-directory");
+  Args.push_back(Command.Directory.c_str());
+
+  IndexerCallbacks CB = Info.CB;
+  Task->result = clang_indexSourceFile(Info.idxAction, Info.client_data,
+                                       &CB, sizeof(CB), Info.index_options,
+                                       /*source_filename=*/0,
+                                       Args.data(), Args.size(),
+                                       /*unsaved_files=*/0,
+                                       /*num_unsaved_files=*/0,
+                                       /*out_TU=*/0, Info.TU_options);
+}
+
 //===----------------------------------------------------------------------===//
 // libclang public APIs.
 //===----------------------------------------------------------------------===//
@@ -1048,6 +1134,60 @@ int clang_indexTranslationUnit(CXIndexAction idxAction,
   return ITUI.result;
 }
 
+int clang_indexCompilationDatabase(CXIndexAction idxAction,
+                                   CXClientData client_data,
+                                   IndexerCallbacks *index_callbacks,
+                                   unsigned index_callbacks_size,
+                                   unsigned index_options,
+                                   CXCompilationDatabase CDb,
+                                   unsigned num_threads,
+                                   unsigned TU_options) {
+  tooling::CompilationDatabase *DB =
+    static_cast<tooling::CompilationDatabase *>(CDb);
+  if (!idxAction || !DB || !index_callbacks || index_callbacks_size == 0)
+    return -1;
+
+  std::vector<tooling::CompileCommand> Commands =
+    DB->getAllCompileCommands();
+
+  LOG_FUNC_SECTION {
+    *Log << Commands.size() << " compile commands on " << num_threads
+         << " threads";
+  }
+
+  IndexCompilationDatabaseInfo Info;
+  Info.idxAction = idxAction;
+  Info.client_data = client_data;
+  memset(&Info.CB, 0, sizeof(Info.CB));
+  unsigned ClientCBSize = index_callbacks_size < sizeof(Info.CB)
+                                  ? index_callbacks_size : sizeof(Info.CB);
+  memcpy(&Info.CB, index_callbacks, ClientCBSize);
+  Info.index_options = index_options;
+  Info.TU_options = TU_options;
+
+  // The resource path is computed on first use, which would race between
+  // the workers.
+  IndexSessionData *IdxSession = static_cast<IndexSessionData *>(idxAction);
+  static_cast<CIndexer *>(IdxSession->CIdx)->getClangResourcesPath();
+
+  std::vector<IndexCompileCommandTask> Tasks(Commands.size());
+  {
+    ThreadPool Pool(num_threads);
+    for (unsigned I = 0, N = Commands.size(); I != N; ++I) {
+      Tasks[I].Info = &Info;
+      Tasks[I].Command = &Commands[I];
+      Tasks[I].result = 0;
+      Pool.async(indexCompileCommand, &Tasks[I]);
+    }
+  }
+
+  int NumFailed = 0;
+  for (unsigned I = 0, N = Tasks.size(); I != N; ++I)
+    if (Tasks[I].result)
+      ++NumFailed;
+  return NumFailed;
+}
+
 void clang_indexLoc_getFileLocation(CXIdxLoc location,
                                     CXIdxClientFile *indexFile,
                                     CXFile *file,
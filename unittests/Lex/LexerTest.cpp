@@ -355,4 +355,36 @@ TEST_F(LexerTest, LexAPI) {
   EXPECT_EQ("N", Lexer::getImmediateMacroName(idLoc4, SourceMgr, LangOpts));
 }
 
+TEST_F(LexerTest, LongRunsAcrossChunkBoundaries) {
+  // Runs longer than the 16-byte chunks scanned at once, ending at every
+  // offset within a chunk.
+  std::string Source;
+  std::vector<tok::TokenKind> ExpectedTokens;
+  const unsigned MaxLen = 40;
+  for (unsigned Len = 1; Len != MaxLen; ++Len) {
+    std::string Ident(Len, 'a');
+    Ident[Len - 1] = '_';
+    std::string Spaces(Len, ' ');
+    Spaces[Len / 2] = '\t';
+    std::string Text(Len, 'x');
+    Source += Spaces + Ident + Spaces + "\"" + Text + "\\\"" + Text + "\"" +
+              "'" + Text + "\\'" + Text + "'" +
+              "// " + Text + "\\\n" + Text + "\n" + Ident + "$\n";
+
+    ExpectedTokens.push_back(tok::identifier);
+    ExpectedTokens.push_back(tok::string_literal);
+    ExpectedTokens.push_back(tok::char_constant);
+    ExpectedTokens.push_back(tok::identifier);
+  }
+
+  std::vector<Token> toks = CheckLex(Source, ExpectedTokens);
+  ASSERT_EQ(ExpectedTokens.size(), toks.size());
+  for (unsigned Len = 1; Len != MaxLen; ++Len) {
+    EXPECT_EQ(Len, toks[4 * (Len - 1)].getLength());
+    EXPECT_EQ(2 * Len + 4, toks[4 * (Len - 1) + 1].getLength());
+    EXPECT_EQ(2 * Len + 4, toks[4 * (Len - 1) + 2].getLength());
+    EXPECT_EQ(Len + 1, toks[4 * (Len - 1) + 3].getLength());
+  }
+}
+
 } // anonymous namespace
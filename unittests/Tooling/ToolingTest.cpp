@@ -18,6 +18,9 @@
 #include "clang/Tooling/Tooling.h"
 #include "gtest/gtest.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include <string>
 
 namespace clang {
@@ -331,6 +334,110 @@ TEST(ClangToolTest, InjectDiagnosticConsumerInBuildASTs) {
   EXPECT_EQ(1u, ASTs.size());
   EXPECT_EQ(1u, Consumer.NumDiagnosticsSeen);
 }
+
+struct CollectFunctionNamesConsumer : public clang::ASTConsumer {
+  explicit CollectFunctionNamesConsumer(std::vector<std::string> &Names)
+      : Names(Names) {}
+  virtual bool HandleTopLevelDecl(clang::DeclGroupRef DeclGroup) {
+    for (DeclGroupRef::iterator I = DeclGroup.begin(), E = DeclGroup.end();
+         I != E; ++I)
+      if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(*I))
+        Names.push_back(FD->getNameAsString());
+    return true;
+  }
+  std::vector<std::string> &Names;
+};
+
+/// Collects the names of the functions declared in one translation unit.
+struct CollectFunctionNamesAction : public FrontendActionFactory {
+  virtual clang::FrontendAction *create() {
+    return new TestAction(new CollectFunctionNamesConsumer(Names));
+  }
+  std::vector<std::string> Names;
+};
+
+struct CollectFunctionNamesFactory : public ToolActionFactory {
+  CollectFunctionNamesFactory() : NumFailed(0) {}
+  virtual ToolAction *create() { return new CollectFunctionNamesAction; }
+  virtual void finish(ToolAction *Action, bool Succeeded) {
+    CollectFunctionNamesAction *Collector =
+        static_cast<CollectFunctionNamesAction *>(Action);
+    Names.insert(Names.end(), Collector->Names.begin(),
+                 Collector->Names.end());
+    if (!Succeeded)
+      ++NumFailed;
+    delete Collector;
+  }
+  std::vector<std::string> Names;
+  unsigned NumFailed;
+};
+
+TEST(ClangToolTest, RunInParallelMergesResultsInOrder) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources;
+  Sources.push_back("/a.cc");
+  Sources.push_back("/b.cc");
+  Sources.push_back("/c.cc");
+  Sources.push_back("/d.cc");
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/a.cc", "void a1(); void a2();");
+  Tool.mapVirtualFile("/b.cc", "void b();");
+  Tool.mapVirtualFile("/c.cc", "void c() { undeclared(); }");
+  Tool.mapVirtualFile("/d.cc", "void d();");
+  TestDiagnosticConsumer Consumer;
+  Tool.setDiagnosticConsumer(&Consumer);
+
+  CollectFunctionNamesFactory Factory;
+  EXPECT_EQ(1, Tool.runInParallel(&Factory, 3));
+  ASSERT_EQ(5u, Factory.Names.size());
+  EXPECT_EQ("a1", Factory.Names[0]);
+  EXPECT_EQ("a2", Factory.Names[1]);
+  EXPECT_EQ("b", Factory.Names[2]);
+  EXPECT_EQ("c", Factory.Names[3]);
+  EXPECT_EQ("d", Factory.Names[4]);
+  EXPECT_EQ(1u, Factory.NumFailed);
+  EXPECT_EQ(1u, Consumer.NumDiagnosticsSeen);
+}
+
+TEST(ClangToolTest, RunInParallelUsesCompileCommandDirectory) {
+  SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tooling-test", Dir));
+  SmallString<128> IncludeDir(Dir);
+  llvm::sys::path::append(IncludeDir, "include");
+  bool Existed;
+  ASSERT_FALSE(llvm::sys::fs::create_directory(IncludeDir.str(), Existed));
+  SmallString<128> Header(IncludeDir);
+  llvm::sys::path::append(Header, "header.h");
+  {
+    std::string ErrorInfo;
+    llvm::raw_fd_ostream OS(Header.c_str(), ErrorInfo);
+    ASSERT_TRUE(ErrorInfo.empty());
+    OS << "void fromHeader();\n";
+  }
+
+  SmallString<128> CurrentDir;
+  ASSERT_FALSE(llvm::sys::fs::current_path(CurrentDir));
+
+  // The include path is relative to the directory of the compile command.
+  FixedCompilationDatabase Compilations(
+      Dir.str(), std::vector<std::string>(1, "-Iinclude"));
+  ClangTool Tool(Compilations, std::vector<std::string>(1, "/a.cc"));
+  Tool.mapVirtualFile("/a.cc", "#include \"header.h\"\nvoid a();");
+
+  CollectFunctionNamesFactory Factory;
+  EXPECT_EQ(0, Tool.runInParallel(&Factory, 2));
+  ASSERT_EQ(2u, Factory.Names.size());
+  EXPECT_EQ("fromHeader", Factory.Names[0]);
+  EXPECT_EQ("a", Factory.Names[1]);
+
+  SmallString<128> DirAfterRun;
+  ASSERT_FALSE(llvm::sys::fs::current_path(DirAfterRun));
+  EXPECT_EQ(CurrentDir.str(), DirAfterRun.str());
+
+  llvm::sys::fs::remove(Header.str(), Existed);
+  llvm::sys::fs::remove(IncludeDir.str(), Existed);
+  llvm::sys::fs::remove(Dir.str(), Existed);
+}
 #endif
 
 } // end namespace tooling
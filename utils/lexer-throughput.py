@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+
+"""
+Measure the throughput of the lexer.
+
+Runs 'clang -cc1 -Eonly', which lexes and preprocesses a file without
+producing any output, over a large input and reports the best time of several
+runs in megabytes per second. The input is generated, with long identifiers,
+runs of whitespace, comments and string and character literals, unless one is
+given with --input; a preprocessed file (-E) keeps the measurement to the
+lexer, since it has no #includes left to search for.
+"""
+
+import optparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+###
+
+def generateLine(rng):
+    indent = ' ' * rng.choice([0, 2, 4, 8, 16, 24])
+    name = '_'.join(rng.choice(['buffer', 'token', 'identifier', 'location',
+                                'size', 'x', 'kind', 'value'])
+                    for i in range(rng.randint(1, 5)))
+    kind = rng.randint(0, 4)
+    if kind == 0:
+        return '%sint %s = %s + %d;\n' % (indent, name, name,
+                                          rng.randint(0, 99))
+    if kind == 1:
+        return '%s// %s\n' % (indent, ' '.join([name] * rng.randint(1, 8)))
+    if kind == 2:
+        return '%s/* %s */\n' % (indent, ' '.join([name] * rng.randint(1, 8)))
+    if kind == 3:
+        return '%sputs("%s\\n");\n' % (indent,
+                                       ' '.join([name] * rng.randint(1, 8)))
+    return "%sc = '%s';\n" % (indent, rng.choice(['a', '\\n', '\\0', 'abcd']))
+
+def generateInput(path, size):
+    rng = random.Random(0)
+    lines = [generateLine(rng) for i in range(1000)]
+    f = open(path, 'w')
+    written = 0
+    while written < size:
+        for line in lines:
+            f.write(line)
+            written += len(line)
+    f.close()
+
+def timeLexer(clang, path, runs):
+    best = None
+    for i in range(runs):
+        start = time.time()
+        subprocess.check_call([clang, '-cc1', '-Eonly', '-x', 'c', path])
+        elapsed = time.time() - start
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+def main():
+    parser = optparse.OptionParser("%prog [options] path/to/clang")
+    parser.add_option("", "--input", dest="input", metavar="FILE",
+                      help="Lex FILE instead of a generated input")
+    parser.add_option("", "--size", dest="size", type=int, default=64,
+                      help="Size of the generated input in megabytes "
+                           "[%default]")
+    parser.add_option("", "--runs", dest="runs", type=int, default=5,
+                      help="Number of runs to take the best time of "
+                           "[%default]")
+    opts, args = parser.parse_args()
+    if len(args) != 1:
+        parser.error("invalid number of arguments")
+    clang = args[0]
+
+    path = opts.input
+    if path is None:
+        fd, path = tempfile.mkstemp(suffix='.c')
+        os.close(fd)
+        generateInput(path, opts.size << 20)
+    try:
+        size = os.path.getsize(path)
+        best = timeLexer(clang, path, opts.runs)
+    finally:
+        if opts.input is None:
+            os.remove(path)
+
+    print('%s: %.1f MB in %.3f s, %.1f MB/s' % (
+        os.path.basename(path) if opts.input else 'generated input',
+        size / float(1 << 20), best, size / float(1 << 20) / best))
+
+if __name__ == '__main__':
+    main()